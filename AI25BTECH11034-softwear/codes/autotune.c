@@ -0,0 +1,414 @@
+#define _GNU_SOURCE
+#include "autotune.h"
+#include "svd_engine.h"
+#include "dense_svd.h"
+#include "qr_svd.h"
+#include "rrqr_cur.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define TUNE_MAGIC "svdcompress-profile"
+#define TUNE_VERSION 1
+// Calibration matrix and the ranks each engine is timed at, spanning the
+// 20% of min(m, n) where the built-in rules leave Lanczos
+#define TUNE_ROWS 640
+#define TUNE_COLS 512
+#define TUNE_RANKS 3
+static const int tune_ranks[TUNE_RANKS] = { 16, 100, 200 };
+// Thread and panel-width benchmarks: a Lanczos solve and a Householder QR
+#define TUNE_THREAD_ROWS 1024
+#define TUNE_THREAD_COLS 768
+#define TUNE_THREAD_RANK 8
+#define TUNE_QR_ROWS 2048
+#define TUNE_QR_COLS 192
+// A thread count must beat the best smaller one by this much to be kept
+#define TUNE_THREAD_GAIN 0.95
+// Engines measured within this factor of the optimal error count as exact
+#define TUNE_EXACT_RATIO 1.001
+
+static const int panel_widths[] = { 16, 32, 64, 96 };
+// The distributed engine is left out: its speed depends on how many
+// processes the caller grants, which a one-process benchmark cannot predict
+static const SVDEngine tuned_engines[] = {
+    SVD_ENGINE_LANCZOS, SVD_ENGINE_DENSE, SVD_ENGINE_RRQR, SVD_ENGINE_CUR
+};
+#define TUNED_ENGINE_COUNT (int)(sizeof(tuned_engines) / sizeof(tuned_engines[0]))
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Working width w of each engine in the cost model
+static double engine_width(SVDEngine e, int m, int n, int k) {
+    int p = m < n ? m : n;
+    switch (e) {
+        case SVD_ENGINE_DENSE: return p;
+        case SVD_ENGINE_LANCZOS: return 2 * k > k + 32 ? 2 * k : k + 32;
+        case SVD_ENGINE_RRQR: return k;
+        case SVD_ENGINE_CUR: return k + CUR_OVERSAMPLE;
+        default: return 0.0;
+    }
+}
+
+static double predict_seconds(const TuneProfile *p, SVDEngine e, int m, int n, int k) {
+    double w = engine_width(e, m, n, k);
+    return p->cost_a[e] * (double)m * n * w + p->cost_b[e] * (double)(m + n) * w * w;
+}
+
+static size_t engine_bytes(SVDEngine e, int m, int n, int k) {
+    size_t d = sizeof(double);
+    switch (e) {
+        case SVD_ENGINE_DENSE: return dense_svd_memory_bytes(m, n, k);
+        case SVD_ENGINE_LANCZOS: return lanczos_restarted_memory_bytes(m, n, k, 0);
+        case SVD_ENGINE_RRQR: return ((size_t)m * n + (size_t)(m + 2 * n) * k) * d;
+        case SVD_ENGINE_CUR: return (size_t)(3 * m + 4 * n) * (k + CUR_OVERSAMPLE) * d;
+        default: return 0;
+    }
+}
+
+static void fill_random(Matrix *X, uint64_t *rng) {
+    for (int i = 0; i < X->rows; i++) {
+        for (int j = 0; j < X->cols; j++) X->data[i][j] = rng_uniform(rng);
+    }
+}
+
+// A = U diag(1/i) Vᵀ with random orthonormal U and V; sigma receives the
+// spectrum
+static Matrix* calibration_matrix(double *sigma) {
+    int m = TUNE_ROWS, n = TUNE_COLS;
+    uint64_t rng = rng_seed(1);
+    Matrix *U = create_matrix_uninit(m, n);
+    Matrix *V = create_matrix_uninit(n, n);
+    Matrix *A = create_matrix(m, n);
+    int ok = U && V && A;
+    if (ok) {
+        fill_random(U, &rng);
+        fill_random(V, &rng);
+        ok = block_orthonormalize(U, NULL, 1) && block_orthonormalize(V, NULL, 1);
+    }
+    for (int i = 0; ok && i < n; i++) sigma[i] = 1.0 / (i + 1);
+    for (int i = 0; ok && i < m; i++) {
+        for (int l = 0; l < n; l++) {
+            double u = U->data[i][l] * sigma[l];
+            const double *v = V->data[0] + l;
+            for (int j = 0; j < n; j++) A->data[i][j] += u * v[(size_t)j * n];
+        }
+    }
+    free_matrix(U);
+    free_matrix(V);
+    if (!ok) {
+        free_matrix(A);
+        return NULL;
+    }
+    return A;
+}
+
+// ‖A - U Σ Vᵀ‖_F
+static double residual_norm(const Matrix *A, const SVDResult *svd) {
+    double sum = 0.0;
+    for (int i = 0; i < A->rows; i++) {
+        for (int j = 0; j < A->cols; j++) {
+            double r = A->data[i][j];
+            for (int l = 0; l < svd->k; l++) {
+                r -= svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            sum += r * r;
+        }
+    }
+    return sqrt(sum);
+}
+
+static void tune_options(SVDOptions *opts, SVDEngine e, int threads) {
+    svd_default_options(opts);
+    opts->verbose = 0;
+    opts->seed = 1;
+    opts->engine = e;
+    opts->threads = threads;
+}
+
+// Best of two runs; -1 on failure. residual receives the run's error.
+static double time_solve(Matrix *A, int k, const SVDOptions *opts, double *residual) {
+    double best = -1.0;
+    for (int run = 0; run < 2; run++) {
+        double t0 = now_seconds();
+        SVDResult *svd = svd_compute(A, k, opts);
+        double t = now_seconds() - t0;
+        if (!svd) return -1.0;
+        if (residual) *residual = residual_norm(A, svd);
+        free_svd_result(svd);
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+static int tune_threads(int max_threads, int verbose) {
+    uint64_t rng = rng_seed(2);
+    Matrix *A = create_matrix_uninit(TUNE_THREAD_ROWS, TUNE_THREAD_COLS);
+    if (!A) return 1;
+    fill_random(A, &rng);
+    int best = 1;
+    double best_time = -1.0;
+    for (int t = 1; t <= max_threads; t = t * 2 > max_threads && t < max_threads ? max_threads : t * 2) {
+        SVDOptions opts;
+        tune_options(&opts, SVD_ENGINE_LANCZOS, t);
+        double time = time_solve(A, TUNE_THREAD_RANK, &opts, NULL);
+        if (verbose) printf("  threads %-3d %8.1f ms\n", t, time * 1000.0);
+        if (time > 0 && (best_time < 0 || time < TUNE_THREAD_GAIN * best_time)) {
+            best = t;
+            best_time = time;
+        }
+    }
+    free_matrix(A);
+    return best;
+}
+
+static int tune_panel_width(int verbose) {
+    uint64_t rng = rng_seed(3);
+    Matrix *A = create_matrix_uninit(TUNE_QR_ROWS, TUNE_QR_COLS);
+    Matrix *W = create_matrix_uninit(TUNE_QR_ROWS, TUNE_QR_COLS);
+    double *tau = (double*)mem_alloc(TUNE_QR_COLS * sizeof(double));
+    int saved = householder_block();
+    int best = saved;
+    double best_time = -1.0;
+    if (A && W && tau) {
+        fill_random(A, &rng);
+        for (size_t i = 0; i < sizeof(panel_widths) / sizeof(panel_widths[0]); i++) {
+            householder_set_block(panel_widths[i]);
+            double time = -1.0;
+            for (int run = 0; run < 2; run++) {
+                memcpy(W->data[0], A->data[0], (size_t)TUNE_QR_ROWS * TUNE_QR_COLS * sizeof(double));
+                double t0 = now_seconds();
+                householder_qr(W, tau);
+                double t = now_seconds() - t0;
+                if (time < 0 || t < time) time = t;
+            }
+            if (verbose) printf("  panel %-3d   %8.1f ms\n", panel_widths[i], time * 1000.0);
+            if (best_time < 0 || time < best_time) {
+                best = panel_widths[i];
+                best_time = time;
+            }
+        }
+    }
+    householder_set_block(saved);
+    mem_free(tau);
+    free_matrix(W);
+    free_matrix(A);
+    return best;
+}
+
+TuneProfile* autotune_run(int max_threads, int verbose) {
+    TuneProfile *p = (TuneProfile*)mem_calloc(1, sizeof(TuneProfile));
+    double *sigma = (double*)mem_alloc(TUNE_COLS * sizeof(double));
+    Matrix *A = sigma ? calibration_matrix(sigma) : NULL;
+    if (!p || !A) {
+        fprintf(stderr, "Error: Out of memory for tuning\n");
+        free_matrix(A);
+        mem_free(sigma);
+        mem_free(p);
+        return NULL;
+    }
+    if (max_threads < 1) max_threads = 1;
+
+    if (verbose) printf("Tuning the Householder panel width...\n");
+    p->reflector_block = tune_panel_width(verbose);
+    if (verbose) printf("Tuning the thread count...\n");
+    p->threads = tune_threads(max_threads, verbose);
+
+    int saved = householder_block();
+    householder_set_block(p->reflector_block);
+    if (verbose) printf("Timing engines on a %dx%d calibration matrix...\n", TUNE_ROWS, TUNE_COLS);
+    for (int i = 0; i < TUNED_ENGINE_COUNT; i++) {
+        SVDEngine e = tuned_engines[i];
+        SVDOptions opts;
+        tune_options(&opts, e, p->threads);
+        double time[TUNE_RANKS], f1[TUNE_RANKS], f2[TUNE_RANKS], ratio = 1.0;
+        int ok = 1;
+        for (int r = 0; ok && r < TUNE_RANKS; r++) {
+            int k = tune_ranks[r];
+            double residual = 0.0;
+            time[r] = time_solve(A, k, &opts, &residual);
+            ok = time[r] > 0;
+            double w = engine_width(e, TUNE_ROWS, TUNE_COLS, k);
+            f1[r] = (double)TUNE_ROWS * TUNE_COLS * w;
+            f2[r] = (double)(TUNE_ROWS + TUNE_COLS) * w * w;
+            // The optimal rank-k error is the tail of the known spectrum
+            double tail = 0.0;
+            for (int l = k; l < TUNE_COLS; l++) tail += sigma[l] * sigma[l];
+            double excess = residual / sqrt(tail);
+            if (ok && excess > ratio) ratio = excess;
+            if (ok && verbose) {
+                printf("  %-12s k=%-3d %8.1f ms  error x%.3f\n", svd_engine_name(e), k,
+                       time[r] * 1000.0, excess);
+            }
+        }
+        if (!ok) continue;
+        // Least squares for a and b, relative to each time so short runs
+        // count as much as long ones. A width that does not change with k
+        // (the dense path), or a negative term, leaves a alone to fit.
+        double s11 = 0, s12 = 0, s22 = 0, t1 = 0, t2 = 0, mean = 0;
+        for (int r = 0; r < TUNE_RANKS; r++) {
+            double g1 = f1[r] / time[r], g2 = f2[r] / time[r];
+            s11 += g1 * g1;
+            s12 += g1 * g2;
+            s22 += g2 * g2;
+            t1 += g1;
+            t2 += g2;
+            mean += time[r] / f1[r] / TUNE_RANKS;
+        }
+        double det = s11 * s22 - s12 * s12;
+        double a = -1.0, b = -1.0;
+        if (det > 1e-9 * s11 * s22) {
+            a = (t1 * s22 - t2 * s12) / det;
+            b = (s11 * t2 - s12 * t1) / det;
+        }
+        if (a <= 0.0 || b < 0.0) {
+            a = mean;
+            b = 0.0;
+        }
+        p->cost_a[e] = a;
+        p->cost_b[e] = b;
+        p->error_ratio[e] = ratio;
+    }
+    householder_set_block(saved);
+
+    free_matrix(A);
+    mem_free(sigma);
+    return p;
+}
+
+const char* autotune_profile_path(void) {
+    static char path[4096];
+    const char *env = getenv("SVD_TUNE_PROFILE");
+    if (env && *env) return env;
+    const char *home = getenv("HOME");
+    snprintf(path, sizeof(path), "%s/.cache/svdcompress/profile", home ? home : ".");
+    return path;
+}
+
+// mkdir -p for the directories above path
+static void make_parents(const char *path) {
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *s = dir + 1; *s; s++) {
+        if (*s != '/') continue;
+        *s = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) return;
+        *s = '/';
+    }
+}
+
+int autotune_save(const TuneProfile *p, const char *path) {
+    make_parents(path);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write tuning profile %s\n", path);
+        return 0;
+    }
+    fprintf(f, "%s %d\n", TUNE_MAGIC, TUNE_VERSION);
+    fprintf(f, "threads %d\n", p->threads);
+    fprintf(f, "reflector_block %d\n", p->reflector_block);
+    for (int i = 0; i < TUNED_ENGINE_COUNT; i++) {
+        SVDEngine e = tuned_engines[i];
+        fprintf(f, "engine %s %.6g %.6g %.6g\n", svd_engine_name(e), p->cost_a[e], p->cost_b[e],
+                p->error_ratio[e]);
+    }
+    return fclose(f) == 0;
+}
+
+TuneProfile* autotune_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    TuneProfile *p = (TuneProfile*)mem_calloc(1, sizeof(TuneProfile));
+    char line[256], word[64];
+    int version = 0, ok = p != NULL;
+    if (ok && (!fgets(line, sizeof(line), f) ||
+               sscanf(line, TUNE_MAGIC " %d", &version) != 1 || version != TUNE_VERSION)) {
+        fprintf(stderr, "Warning: %s is not a version %d tuning profile, ignoring it\n",
+                path, TUNE_VERSION);
+        ok = 0;
+    }
+    while (ok && fgets(line, sizeof(line), f)) {
+        double a, b, ratio;
+        SVDEngine e;
+        if (sscanf(line, "threads %d", &p->threads) == 1) continue;
+        if (sscanf(line, "reflector_block %d", &p->reflector_block) == 1) continue;
+        if (sscanf(line, "engine %63s %lf %lf %lf", word, &a, &b, &ratio) == 4 &&
+            svd_engine_parse(word, &e) && e < TUNE_ENGINES) {
+            p->cost_a[e] = a;
+            p->cost_b[e] = b;
+            p->error_ratio[e] = ratio;
+        }
+    }
+    fclose(f);
+    if (ok && p->threads < 1) p->threads = 1;
+    if (!ok) {
+        mem_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void autotune_print(const TuneProfile *p) {
+    printf("Threads: %d, Householder panel width: %d\n", p->threads, p->reflector_block);
+    for (int i = 0; i < TUNED_ENGINE_COUNT; i++) {
+        SVDEngine e = tuned_engines[i];
+        if (p->cost_a[e] <= 0) continue;
+        printf("  %-12s %.3g + %.3g ns per unit of work, error x%.3f\n", svd_engine_name(e),
+               p->cost_a[e] * 1e9, p->cost_b[e] * 1e9, p->error_ratio[e]);
+    }
+}
+
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+static TuneProfile *default_profile;
+
+static void load_default(void) {
+    default_profile = autotune_load(autotune_profile_path());
+    if (default_profile) householder_set_block(default_profile->reflector_block);
+}
+
+const TuneProfile* autotune_default(void) {
+    pthread_once(&default_once, load_default);
+    return default_profile;
+}
+
+SVDEngine autotune_choose(const TuneProfile *p, int m, int n, int k, double quality,
+                          SVDOptions *opts) {
+    double allowed = quality > TUNE_EXACT_RATIO ? quality : TUNE_EXACT_RATIO;
+    SVDEngine best = SVD_ENGINE_AUTO;
+    double best_time = 0.0;
+    for (int i = 0; i < TUNED_ENGINE_COUNT; i++) {
+        SVDEngine e = tuned_engines[i];
+        if (p->cost_a[e] <= 0 || p->error_ratio[e] > allowed) continue;
+        // As in svd_select_engine, Lanczos keeps its scratch in the workspace
+        size_t bytes = engine_bytes(e, m, n, k);
+        int fits = e == SVD_ENGINE_LANCZOS && opts->ws ? workspace_available(opts->ws) >= bytes
+                                                       : mem_would_fit(bytes);
+        if (!fits) continue;
+        double time = predict_seconds(p, e, m, n, k);
+        if (best == SVD_ENGINE_AUTO || time < best_time) {
+            best = e;
+            best_time = time;
+        }
+    }
+    if (best == SVD_ENGINE_AUTO) return best;
+
+    // An exact solve of a very tall or wide matrix still goes through TSQR,
+    // which hands its square R factor back to svd_compute
+    int short_side = m < n ? m : n;
+    int long_side = m < n ? n : m;
+    if (p->error_ratio[best] <= TUNE_EXACT_RATIO && long_side >= SVD_QR_ASPECT_RATIO * short_side &&
+        mem_would_fit(qr_svd_memory_bytes(m, n, k, opts->threads))) {
+        return SVD_ENGINE_QR;
+    }
+    return best;
+}
@@ -0,0 +1,45 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "lanczos.h"
+
+// Per-host tuning profile. autotune_run benchmarks the Householder panel
+// width and the thread count once, then times each engine on a calibration
+// matrix with an image-like 1/i spectrum at two ranks, fitting the cost
+// model time ≈ a_e · mn·w + b_e · (m + n)·w², where w is the engine's working
+// width (Krylov dimension, k, k + oversampling, or min(m, n) for the dense
+// path): products with A plus orthogonalization. autotune_choose then picks,
+// among the engines that fit in memory and whose measured error stays
+// within the quality target, the one predicted fastest for (m, n, k).
+#define TUNE_ENGINES (SVD_ENGINE_DISTRIBUTED + 1)
+
+typedef struct {
+    int threads;                            // fastest thread count for the solvers
+    int reflector_block;                    // Householder panel width
+    double cost_a[TUNE_ENGINES];            // seconds per mn·w; 0 for engines never chosen
+    double cost_b[TUNE_ENGINES];            // seconds per (m + n)·w²
+    double error_ratio[TUNE_ENGINES];       // rank-k error over the optimal one
+} TuneProfile;
+
+// $SVD_TUNE_PROFILE, else ~/.cache/svdcompress/profile
+const char* autotune_profile_path(void);
+
+// About ten seconds on one core; thread counts up to max_threads are tried
+TuneProfile* autotune_run(int max_threads, int verbose);
+int autotune_save(const TuneProfile *p, const char *path);
+TuneProfile* autotune_load(const char *path);
+void autotune_print(const TuneProfile *p);
+
+// The profile at autotune_profile_path, loaded once (and its panel width
+// applied) on first use; NULL when the host was never tuned
+const TuneProfile* autotune_default(void);
+
+// Engine for an m×n rank-k solve among the single-process engines
+// (--processes picks the distributed one explicitly). quality ≥ 1 admits engines whose error is at most that
+// multiple of the optimal rank-k error; 0 admits exact engines only. Very
+// tall or wide shapes keep the TSQR path. Returns SVD_ENGINE_AUTO when no
+// tuned engine fits in memory.
+SVDEngine autotune_choose(const TuneProfile *p, int m, int n, int k, double quality,
+                          SVDOptions *opts);
+
+#endif
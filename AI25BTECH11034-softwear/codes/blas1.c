@@ -0,0 +1,64 @@
+#include "blas1.h"
+#include "simd_kernels.h"
+#include <float.h>
+#include <math.h>
+
+// A plain sum of squares in this range lost nothing to overflow or to
+// underflow of its larger terms
+#define SUMSQ_MIN (DBL_MIN / DBL_EPSILON)
+#define SUMSQ_MAX DBL_MAX
+
+double blas_dot(const double *x, const double *y, int n) {
+    return simd_kernels()->dot(x, y, n);
+}
+
+void blas_axpy(double *y, double a, const double *x, int n) {
+    simd_kernels()->axpy(y, a, x, n);
+}
+
+void blas_scal(double *x, double a, int n) {
+    simd_kernels()->scal(x, a, n);
+}
+
+static double scaled_nrm2(const double *x, int n) {
+    double amax = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (fabs(x[i]) > amax) amax = fabs(x[i]);
+    }
+    if (amax == 0.0 || isinf(amax)) return amax;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        double t = x[i] / amax;
+        sum += t * t;
+    }
+    return amax * sqrt(sum);
+}
+
+// sqrt of a sum of squares of x computed in one pass, redone with scaling
+// when it left the safe range. A NaN sum means x holds a NaN, which the
+// max-scaled pass would skip over, so it is returned as is.
+static double root_or_rescale(const double *x, int n, double sumsq) {
+    if (sumsq >= SUMSQ_MIN && sumsq <= SUMSQ_MAX) return sqrt(sumsq);
+    if (isnan(sumsq)) return sumsq;
+    return scaled_nrm2(x, n);
+}
+
+double blas_nrm2(const double *x, int n) {
+    return root_or_rescale(x, n, simd_kernels()->dot(x, x, n));
+}
+
+double blas_axpy_nrm2(double *y, double a, const double *x, int n) {
+    return root_or_rescale(y, n, simd_kernels()->axpy_sumsq(y, a, x, n));
+}
+
+double blas_normalize(double *x, int n) {
+    double norm = blas_nrm2(x, n);
+    if (norm > BLAS_NORMALIZE_MIN) simd_kernels()->scal(x, 1.0 / norm, n);
+    return norm;
+}
+
+double blas_normalize_diff(double *x, const double *prev, int n) {
+    double norm = blas_nrm2(x, n);
+    double a = norm > BLAS_NORMALIZE_MIN ? 1.0 / norm : 1.0;
+    return sqrt(simd_kernels()->scal_diff_sumsq(x, a, prev, n));
+}
@@ -0,0 +1,33 @@
+#ifndef BLAS1_H
+#define BLAS1_H
+
+// Level-1 vector operations on the run-time selected kernels
+// (simd_kernels.h), plus the fused passes the iterative solvers need: each
+// fused call reads and writes its vectors once instead of two or three
+// times.
+
+// blas_normalize leaves vectors with a norm at most this alone
+#define BLAS_NORMALIZE_MIN 1e-10
+
+double blas_dot(const double *x, const double *y, int n);
+// y += a x
+void blas_axpy(double *y, double a, const double *x, int n);
+// x *= a
+void blas_scal(double *x, double a, int n);
+
+// ‖x‖₂ without spurious overflow or underflow: one pass when the sum of
+// squares is safely representable, otherwise a second pass scaled by
+// max |x_i|. Any NaN in x gives NaN.
+double blas_nrm2(const double *x, int n);
+
+// y += a x, returning the updated ‖y‖₂
+double blas_axpy_nrm2(double *y, double a, const double *x, int n);
+
+// x /= ‖x‖₂ (when above BLAS_NORMALIZE_MIN), returning the former norm
+double blas_normalize(double *x, int n);
+
+// Normalizes x as above and returns ‖x - prev‖₂ of the result, the usual
+// power iteration convergence test
+double blas_normalize_diff(double *x, const double *prev, int n);
+
+#endif
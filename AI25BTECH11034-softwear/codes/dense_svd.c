@@ -0,0 +1,550 @@
+#include "dense_svd.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "simd_kernels.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+// Subproblems this small go straight to implicit QL
+#define DC_BASE_SIZE 32
+#define SECULAR_MAX_ITERS 100
+
+// Rank-one merge of two solved halves: the eigenproblem of D + rho z zᵀ
+// with rho > 0, solved on the non-deflated entries d[0..K) (ascending) and
+// the matching unit-norm z.
+
+static double secular_terms(const double *d, const double *z, int K, int j,
+                            int org, double tau, double *psi, double *dpsi,
+                            double *phi, double *dphi) {
+    double p = 0.0, dp = 0.0, f = 0.0, df = 0.0;
+    for (int i = 0; i < K; i++) {
+        double delta = (d[i] - d[org]) - tau;
+        double t = z[i] / delta;
+        if (i <= j) {
+            p += z[i] * t;
+            dp += t * t;
+        } else {
+            f += z[i] * t;
+            df += t * t;
+        }
+    }
+    *psi = p;
+    *dpsi = dp;
+    *phi = f;
+    *dphi = df;
+    return p + f;
+}
+
+// Root j of 1/rho + Σ z_i²/(d_i - λ) = 0, which lies in (d_j, d_{j+1}), or
+// in (d_{K-1}, d_{K-1} + rho) for the last one. It is returned as an offset
+// tau from the nearer pole d[*org] so that d_i - λ keeps full accuracy.
+static double secular_root(const double *d, const double *z, int K, int j,
+                           double rho, int *org) {
+    int last = j == K - 1;
+    double lo_pole = d[j];
+    double hi_pole = last ? d[j] + rho : d[j + 1];
+    double mid = 0.5 * (lo_pole + hi_pole);
+
+    double w_mid = 1.0 / rho;
+    for (int i = 0; i < K; i++) w_mid += z[i] * z[i] / (d[i] - mid);
+    *org = (last || w_mid >= 0) ? j : j + 1;
+
+    double lo, hi;
+    if (*org == j) {
+        lo = 0.0;
+        hi = mid - d[j];
+    } else {
+        lo = mid - d[j + 1];
+        hi = 0.0;
+    }
+    if (last) hi = rho;
+    double tau = 0.5 * (lo + hi);
+
+    for (int iter = 0; iter < SECULAR_MAX_ITERS; iter++) {
+        double psi, dpsi, phi, dphi;
+        double sum = secular_terms(d, z, K, j, *org, tau, &psi, &dpsi, &phi, &dphi);
+        double w = 1.0 / rho + sum;
+        if (fabs(w) <= 8.0 * DBL_EPSILON * K * (1.0 / rho + fabs(psi) + fabs(phi))) break;
+        // The function increases with λ between its poles
+        if (w > 0) hi = tau;
+        else lo = tau;
+        if (hi - lo <= 2.0 * DBL_EPSILON * fmax(fabs(lo), fabs(hi))) break;
+
+        // Model ψ and φ as constant plus simple pole at d_j and d_{j+1},
+        // matching value and slope, and solve for the step eta
+        double dj = (d[j] - d[*org]) - tau;
+        double q = dpsi * dj * dj;
+        double C = 1.0 / rho + psi - dpsi * dj;
+        double eta;
+        if (last) {
+            eta = C != 0.0 ? dj + q / C : NAN;
+        } else {
+            double dj1 = (d[j + 1] - d[*org]) - tau;
+            double s = dphi * dj1 * dj1;
+            C += phi - dphi * dj1;
+            double a = C;
+            double b = -(C * (dj + dj1) + q + s);
+            double c = C * dj * dj1 + q * dj1 + s * dj;
+            if (fabs(a) <= DBL_EPSILON * (fabs(b) + fabs(c))) {
+                eta = -c / b;
+            } else {
+                double disc = sqrt(fmax(b * b - 4.0 * a * c, 0.0));
+                double r1 = (b >= 0) ? (-b - disc) / (2.0 * a) : (-b + disc) / (2.0 * a);
+                double r2 = (r1 != 0.0) ? c / (a * r1) : 0.0;
+                // The root that stays between the two poles
+                eta = (tau + r1 > lo && tau + r1 < hi) ? r1 : r2;
+            }
+        }
+
+        double next = tau + eta;
+        if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+        tau = next;
+    }
+    return tau;
+}
+
+// Eigenvalues/vectors of D + rho z zᵀ rotated into the basis in the
+// columns of Q (n×n): on return lambda[i] and column i of Q form the
+// eigenpairs of the merged tridiagonal, in no particular order.
+static int rank_one_merge(double *D, double *z, double rho, int n, double *lambda, Matrix *Q) {
+    const SimdKernels *kern = simd_kernels();
+    // Solve for rho > 0; a negative rho is the same problem on -D
+    int flip = rho < 0;
+    if (flip) {
+        for (int i = 0; i < n; i++) D[i] = -D[i];
+        rho = -rho;
+    }
+
+    double znorm = sqrt(vector_dot(z, z, n));
+    if (znorm == 0.0) {
+        for (int i = 0; i < n; i++) lambda[i] = flip ? -D[i] : D[i];
+        return 1;
+    }
+    for (int i = 0; i < n; i++) z[i] /= znorm;
+    rho *= znorm * znorm;
+
+    int *order = (int*)mem_alloc(n * sizeof(int));
+    int *kept = (int*)mem_alloc(n * sizeof(int));
+    double *dk = (double*)mem_alloc(n * sizeof(double));
+    double *zk = (double*)mem_alloc(n * sizeof(double));
+    double *row = (double*)mem_alloc(n * sizeof(double));
+    if (!order || !kept || !dk || !zk || !row) {
+        mem_free(order);
+        mem_free(kept);
+        mem_free(dk);
+        mem_free(zk);
+        mem_free(row);
+        return 0;
+    }
+
+    // Insertion sort of the poles, ascending
+    for (int i = 0; i < n; i++) {
+        int key = i, p = i - 1;
+        while (p >= 0 && D[order[p]] > D[key]) {
+            order[p + 1] = order[p];
+            p--;
+        }
+        order[p + 1] = key;
+    }
+
+    double dmax = 0.0;
+    for (int i = 0; i < n; i++) dmax = fmax(dmax, fabs(D[i]));
+    double tol = 8.0 * DBL_EPSILON * fmax(dmax, rho);
+
+    // Deflation: a negligible z_i leaves (D_i, e_i) as an eigenpair; two
+    // nearly equal poles are rotated so that one of them has z_i = 0
+    int K = 0;
+    for (int t = 0; t < n; t++) {
+        int i = order[t];
+        if (rho * fabs(z[i]) <= tol) {
+            lambda[i] = D[i];
+            continue;
+        }
+        if (K > 0) {
+            int j = kept[K - 1];
+            double r = hypot(z[j], z[i]);
+            double c = z[j] / r, s = z[i] / r;
+            if (fabs((D[i] - D[j]) * c * s) <= tol) {
+                for (int row_i = 0; row_i < n; row_i++) {
+                    double *q = Q->data[row_i];
+                    double x = q[j], y = q[i];
+                    q[j] = c * x + s * y;
+                    q[i] = -s * x + c * y;
+                }
+                double dj = D[j] * c * c + D[i] * s * s;
+                D[i] = D[j] * s * s + D[i] * c * c;
+                D[j] = dj;
+                z[j] = r;
+                z[i] = 0.0;
+                lambda[i] = D[i];
+                continue;
+            }
+        }
+        kept[K++] = i;
+    }
+    for (int t = 0; t < K; t++) {
+        dk[t] = D[kept[t]];
+        zk[t] = z[kept[t]];
+    }
+
+    // delta[t][j] = dk[t] - λ_j, computed from each root's own origin
+    Matrix *delta = K ? create_matrix_uninit(K, K) : NULL;
+    double *roots = (double*)mem_alloc((K + 1) * sizeof(double));
+    int ok = roots && (delta || K == 0);
+    for (int j = 0; ok && j < K; j++) {
+        int org;
+        double tau = secular_root(dk, zk, K, j, rho, &org);
+        roots[j] = dk[org] + tau;
+        for (int t = 0; t < K; t++) delta->data[t][j] = (dk[t] - dk[org]) - tau;
+    }
+
+    if (ok && K > 0) {
+        // Gu-Eisenstat: recompute z from the computed roots so that the
+        // eigenvectors come out numerically orthogonal
+        for (int t = 0; t < K; t++) {
+            double w = -delta->data[t][t] / rho;
+            for (int j = 0; j < K; j++) {
+                if (j != t) w *= delta->data[t][j] / (dk[t] - dk[j]);
+            }
+            zk[t] = copysign(sqrt(fabs(w)), zk[t]);
+        }
+        // Eigenvector j of the rank-one problem is z_t / (d_t - λ_j);
+        // store them normalized in the columns of delta
+        for (int j = 0; j < K; j++) {
+            double norm = 0.0;
+            for (int t = 0; t < K; t++) {
+                double x = zk[t] / delta->data[t][j];
+                delta->data[t][j] = x;
+                norm += x * x;
+            }
+            norm = sqrt(norm);
+            for (int t = 0; t < K; t++) delta->data[t][j] /= norm;
+        }
+        // Q[:, kept] = Q[:, kept] S, one row at a time
+        for (int r = 0; r < n; r++) {
+            double *q = Q->data[r];
+            for (int j = 0; j < K; j++) row[j] = 0.0;
+            for (int t = 0; t < K; t++) {
+                double x = q[kept[t]];
+                if (x == 0.0) continue;
+                kern->axpy(row, x, delta->data[t], K);
+            }
+            for (int j = 0; j < K; j++) q[kept[j]] = row[j];
+        }
+        for (int j = 0; j < K; j++) lambda[kept[j]] = roots[j];
+    }
+
+    if (flip) {
+        for (int i = 0; i < n; i++) lambda[i] = -lambda[i];
+    }
+
+    free_matrix(delta);
+    mem_free(roots);
+    mem_free(row);
+    mem_free(zk);
+    mem_free(dk);
+    mem_free(kept);
+    mem_free(order);
+    return ok;
+}
+
+static int dc_solve(const double *d, const double *e, int n, double *lambda, Matrix *Q) {
+    if (n <= DC_BASE_SIZE) {
+        double *dd = (double*)mem_alloc(2 * n * sizeof(double));
+        if (!dd) return 0;
+        memcpy(dd, d, n * sizeof(double));
+        for (int i = 0; i < n - 1; i++) dd[n + i] = e[i];
+        compute_tridiagonal_eigenvalues(dd, dd + n, n, lambda, Q->data);
+        mem_free(dd);
+        return 1;
+    }
+
+    // T = diag(T1, T2) + rho v vᵀ with v = e_{h-1} + e_h
+    int h = n / 2;
+    double rho = e[h - 1];
+    double *dd = (double*)mem_alloc(n * sizeof(double));
+    double *z = (double*)mem_alloc(n * sizeof(double));
+    Matrix *Q1 = create_matrix_uninit(h, h);
+    Matrix *Q2 = create_matrix_uninit(n - h, n - h);
+    int ok = dd && z && Q1 && Q2;
+    if (ok) {
+        memcpy(dd, d, n * sizeof(double));
+        dd[h - 1] -= rho;
+        dd[h] -= rho;
+        ok = dc_solve(dd, e, h, lambda, Q1) &&
+             dc_solve(dd + h, e + h, n - h, lambda + h, Q2);
+    }
+
+    if (ok) {
+        // The merge works in the basis diag(Q1, Q2); z is its image of v
+        for (int i = 0; i < h; i++) {
+            memset(Q->data[i], 0, n * sizeof(double));
+            memcpy(Q->data[i], Q1->data[i], h * sizeof(double));
+            z[i] = Q1->data[h - 1][i];
+        }
+        for (int i = h; i < n; i++) {
+            memset(Q->data[i], 0, n * sizeof(double));
+            memcpy(Q->data[i] + h, Q2->data[i - h], (n - h) * sizeof(double));
+            z[i] = Q2->data[0][i - h];
+        }
+        free_matrix(Q1);
+        free_matrix(Q2);
+        Q1 = Q2 = NULL;
+        memcpy(dd, lambda, n * sizeof(double));
+        ok = rank_one_merge(dd, z, rho, n, lambda, Q);
+    }
+
+    free_matrix(Q1);
+    free_matrix(Q2);
+    mem_free(z);
+    mem_free(dd);
+    return ok;
+}
+
+int tridiagonal_eigen_dc(const double *d, const double *e, int n, double *lambda, Matrix *Q) {
+    if (!dc_solve(d, e, n, lambda, Q)) return 0;
+
+    // Selection sort, descending, swapping eigenvector columns along
+    for (int i = 0; i < n; i++) {
+        int best = i;
+        for (int j = i + 1; j < n; j++) {
+            if (lambda[j] > lambda[best]) best = j;
+        }
+        if (best == i) continue;
+        double tmp = lambda[i];
+        lambda[i] = lambda[best];
+        lambda[best] = tmp;
+        for (int r = 0; r < n; r++) {
+            tmp = Q->data[r][i];
+            Q->data[r][i] = Q->data[r][best];
+            Q->data[r][best] = tmp;
+        }
+    }
+    return 1;
+}
+
+// Reduces B (M×N, M ≥ N) to upper bidiagonal form d/e. The left reflectors
+// are kept below the diagonal, the right ones right of the superdiagonal.
+// Updates stream along rows: w = vᵀB accumulates row by row, and each right
+// reflector is a dot product and axpy per row.
+static int bidiagonalize(Matrix *B, double *d, double *e, double *tau_l, double *tau_r) {
+    int M = B->rows;
+    int N = B->cols;
+    const SimdKernels *kern = simd_kernels();
+    double *w = (double*)mem_alloc(N * sizeof(double));
+    if (!w) return 0;
+
+    for (int i = 0; i < N; i++) {
+        // Left reflector on column i, rows i..M-1 (rows are N apart)
+        double tl = householder_vector(&B->data[i][i], M - i, N);
+        tau_l[i] = tl;
+        d[i] = B->data[i][i];
+        if (tl != 0.0 && i + 1 < N) {
+            int cols = N - i - 1;
+            memcpy(w, &B->data[i][i + 1], cols * sizeof(double));
+            for (int r = i + 1; r < M; r++) kern->axpy(w, B->data[r][i], &B->data[r][i + 1], cols);
+            for (int c = 0; c < cols; c++) B->data[i][i + 1 + c] -= tl * w[c];
+            for (int r = i + 1; r < M; r++) kern->axpy(&B->data[r][i + 1], -tl * B->data[r][i], w, cols);
+        }
+
+        if (i + 1 >= N) {
+            tau_r[i] = 0.0;
+            continue;
+        }
+        // Right reflector on row i, columns i+1..N-1
+        double *u = &B->data[i][i + 1];
+        int len = N - i - 1;
+        double tr = householder_vector(u, len, 1);
+        tau_r[i] = tr;
+        e[i] = u[0];
+        if (tr != 0.0) {
+            for (int r = i + 1; r < M; r++) {
+                double *br = &B->data[r][i + 1];
+                double s = br[0];
+                for (int c = 1; c < len; c++) s += br[c] * u[c];
+                s *= tr;
+                br[0] -= s;
+                for (int c = 1; c < len; c++) br[c] -= s * u[c];
+            }
+        }
+    }
+    mem_free(w);
+    return 1;
+}
+
+// Columns from..k-1 of X (first rows entries used) are re-orthonormalized
+// against all earlier ones. For a zero singular value the Golub-Kahan
+// eigenvectors mix the u and v halves arbitrarily, so those halves are
+// neither unit nor orthogonal; any orthonormal completion is valid there.
+// Works on a transposed copy so every projection streams through memory.
+static int complete_null_columns(Matrix *X, int rows, int from, int k) {
+    if (from >= k) return 1;
+    Matrix *Ct = create_matrix_uninit(k, rows);
+    // energy[i]: squared norm of row i of the accepted columns; the
+    // coordinate direction with the least of it is furthest from their span
+    double *energy = (double*)mem_calloc(rows, sizeof(double));
+    if (!Ct || !energy) {
+        free_matrix(Ct);
+        mem_free(energy);
+        return 0;
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int l = 0; l < k; l++) Ct->data[l][i] = X->data[i][l];
+    }
+    for (int l = 0; l < from; l++) {
+        for (int i = 0; i < rows; i++) energy[i] += Ct->data[l][i] * Ct->data[l][i];
+    }
+
+    for (int l = from; l < k; l++) {
+        double *c = Ct->data[l];
+        for (int attempt = 0; attempt < 3; attempt++) {
+            for (int pass = 0; pass < 2; pass++) {
+                for (int j = 0; j < l; j++) {
+                    double proj = vector_dot(Ct->data[j], c, rows);
+                    const double *q = Ct->data[j];
+                    for (int i = 0; i < rows; i++) c[i] -= proj * q[i];
+                }
+            }
+            double norm = vector_norm(c, rows);
+            if (norm > 1e-6) {
+                for (int i = 0; i < rows; i++) c[i] /= norm;
+                break;
+            }
+            int best = 0;
+            for (int i = 1; i < rows; i++) {
+                if (energy[i] < energy[best]) best = i;
+            }
+            memset(c, 0, rows * sizeof(double));
+            c[best] = 1.0;
+        }
+        for (int i = 0; i < rows; i++) energy[i] += c[i] * c[i];
+    }
+
+    for (int i = 0; i < rows; i++) {
+        for (int l = from; l < k; l++) X->data[i][l] = Ct->data[l][i];
+    }
+    mem_free(energy);
+    free_matrix(Ct);
+    return 1;
+}
+
+size_t dense_svd_memory_bytes(int m, int n, int k) {
+    int M = m > n ? m : n;
+    int N = m > n ? n : m;
+    // Working copy, Golub-Kahan eigenvectors plus the two halves and merge
+    // scratch alive at the top-level merge, and the back-transformed factors
+    return matrix_storage_bytes(M, N) + 2 * matrix_storage_bytes(2 * N, 2 * N)
+         + matrix_storage_bytes(M, k) + matrix_storage_bytes(N, k)
+         + (size_t)(12 * N + M + k) * sizeof(double);
+}
+
+SVDResult* dense_svd(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows;
+    int n = A->cols;
+    if (k > n) k = n;
+    if (k > m) k = m;
+
+    // Work on Aᵀ for wide matrices so that the bidiagonal is upper
+    int wide = m < n;
+    int M = wide ? n : m;
+    int N = wide ? m : n;
+
+    if (opts->verbose) {
+        printf("Computing SVD using dense bidiagonal divide and conquer (k=%d)...\n", k);
+    }
+
+    Matrix *B = create_matrix_uninit(M, N);
+    Matrix *Q = create_matrix_uninit(2 * N, 2 * N);
+    Matrix *X = create_matrix(M, k);
+    Matrix *Y = create_matrix(N, k);
+    double *d = (double*)mem_alloc(N * sizeof(double));
+    double *e = (double*)mem_alloc(N * sizeof(double));
+    double *tau_l = (double*)mem_alloc(N * sizeof(double));
+    double *tau_r = (double*)mem_alloc(N * sizeof(double));
+    double *gk = (double*)mem_calloc(4 * N, sizeof(double));
+    double *lambda = (double*)mem_alloc(2 * N * sizeof(double));
+    int ok = B && Q && X && Y && d && e && tau_l && tau_r && gk && lambda;
+
+    if (ok) {
+        if (wide) matrix_transpose(A, B);
+        else for (int i = 0; i < m; i++) memcpy(B->data[i], A->data[i], n * sizeof(double));
+
+        perf_phase_begin("bidiagonalize");
+        ok = bidiagonalize(B, d, e, tau_l, tau_r);
+        perf_phase_end("bidiagonalize", 4.0 * M * N * N - 4.0 * N * N * N / 3.0,
+                       16.0 * M * N * N);
+    }
+
+    if (ok) {
+        // Golub-Kahan form: zero diagonal, off-diagonal d0 e0 d1 e1 ... dN-1;
+        // its eigenpair for +σ interleaves the right and left vectors
+        perf_phase_begin("bidiag_svd");
+        double *off = gk + 2 * N;
+        for (int i = 0; i < N; i++) {
+            off[2 * i] = d[i];
+            if (i + 1 < N) off[2 * i + 1] = e[i];
+        }
+        ok = tridiagonal_eigen_dc(gk, off, 2 * N, lambda, Q);
+        perf_phase_end("bidiag_svd", 4.0 * 8.0 * N * N * N / 3.0, 8.0 * 8.0 * N * N * N / 3.0);
+    }
+
+    SVDResult *result = NULL;
+    if (ok) {
+        perf_phase_begin("back_transform");
+        // Split each eigenvector into its v (even) and u (odd) halves and
+        // normalize them, walking Q by rows
+        double *nu = gk, *nv = gk + k;
+        memset(gk, 0, 2 * k * sizeof(double));
+        for (int i = 0; i < N; i++) {
+            const double *qv = Q->data[2 * i];
+            const double *qu = Q->data[2 * i + 1];
+            for (int l = 0; l < k; l++) {
+                nv[l] += qv[l] * qv[l];
+                nu[l] += qu[l] * qu[l];
+            }
+        }
+        for (int l = 0; l < k; l++) {
+            nu[l] = nu[l] > 0 ? 1.0 / sqrt(nu[l]) : 0.0;
+            nv[l] = nv[l] > 0 ? 1.0 / sqrt(nv[l]) : 0.0;
+        }
+        for (int i = 0; i < N; i++) {
+            const double *qv = Q->data[2 * i];
+            const double *qu = Q->data[2 * i + 1];
+            for (int l = 0; l < k; l++) {
+                Y->data[i][l] = qv[l] * nv[l];
+                X->data[i][l] = qu[l] * nu[l];
+            }
+        }
+        double null_tol = 8.0 * N * DBL_EPSILON * fabs(lambda[0]);
+        int null_from = k;
+        while (null_from > 0 && fabs(lambda[null_from - 1]) <= null_tol) null_from--;
+        ok = complete_null_columns(X, N, null_from, k) && complete_null_columns(Y, N, null_from, k) &&
+             householder_apply(B, tau_l, 0, X) && householder_apply(B, tau_r, 1, Y);
+        perf_phase_end("back_transform", 4.0 * (M + N) * N * k, 16.0 * (M + N) * N * k);
+    }
+    if (ok) result = create_svd_result(opts->ws, m, n, k);
+
+    if (result) {
+        Matrix *U = wide ? Y : X;
+        Matrix *V = wide ? X : Y;
+        for (int l = 0; l < k; l++) result->singular_values[l] = fabs(lambda[l]);
+        for (int i = 0; i < m; i++) memcpy(result->U->data[i], U->data[i], k * sizeof(double));
+        for (int j = 0; j < n; j++) memcpy(result->V->data[j], V->data[j], k * sizeof(double));
+        if (opts->verbose) svd_print_summary(result);
+    } else {
+        fprintf(stderr, "Error: Dense SVD failed (out of memory)\n");
+    }
+
+    mem_free(lambda);
+    mem_free(gk);
+    mem_free(tau_r);
+    mem_free(tau_l);
+    mem_free(e);
+    mem_free(d);
+    free_matrix(Y);
+    free_matrix(X);
+    free_matrix(Q);
+    free_matrix(B);
+    return result;
+}
@@ -0,0 +1,20 @@
+#ifndef DENSE_SVD_H
+#define DENSE_SVD_H
+
+#include "lanczos.h"
+
+// Full dense SVD for high-rank requests: Householder bidiagonalization of A
+// followed by a divide-and-conquer SVD of the bidiagonal, done as the
+// eigenproblem of its Golub-Kahan tridiagonal. Costs O(mn²) regardless of k
+// and keeps the singular vectors orthogonal to working precision, unlike
+// deflated power iteration. Intermediates live on the heap; the result
+// lives in opts->ws when one is given.
+SVDResult* dense_svd(Matrix *A, int k, const SVDOptions *opts);
+size_t dense_svd_memory_bytes(int m, int n, int k);
+
+// Cuppen's divide and conquer on the symmetric tridiagonal matrix with
+// diagonal d[0..n) and off-diagonal e[0..n-1). Eigenvalues come out
+// descending in lambda, eigenvectors in the columns of the n×n matrix Q.
+int tridiagonal_eigen_dc(const double *d, const double *e, int n, double *lambda, Matrix *Q);
+
+#endif
@@ -0,0 +1,379 @@
+#define _GNU_SOURCE
+#include "dist_svd.h"
+#include "dist_transport.h"
+#include "svd_engine.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include "rng.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef struct {
+    const Matrix *A;
+    const Matrix *omega;        // n×l start block, drawn by rank 0 before the fork
+    int k;
+    int l;
+    int *first;                 // first row of each rank; first[size] == m
+    const SVDOptions *opts;
+    DistTransport *t;           // NULL when running alone
+    int rank;
+    int size;
+    SVDResult *result;          // rank 0 only
+} DistJob;
+
+// Matrices sent whole are contiguous (create_matrix_uninit)
+static int send_rows(DistJob *j, int peer, const Matrix *M, int row, int rows) {
+    return j->t->send(j->t, peer, M->data[row], (size_t)rows * M->cols * sizeof(double));
+}
+
+static int recv_rows(DistJob *j, int peer, Matrix *M, int row, int rows) {
+    return j->t->recv(j->t, peer, M->data[row], (size_t)rows * M->cols * sizeof(double));
+}
+
+// Z = Σ over the subtree; the sum lands on rank 0. tmp is Z-sized.
+static int tree_sum(DistJob *j, Matrix *Z, Matrix *tmp) {
+    size_t count = (size_t)Z->rows * Z->cols;
+    for (int s = 1; s < dist_span(j->rank, j->size); s <<= 1) {
+        if (!recv_rows(j, j->rank + s, tmp, 0, tmp->rows)) return 0;
+        double *z = Z->data[0];
+        const double *x = tmp->data[0];
+        for (size_t i = 0; i < count; i++) z[i] += x[i];
+    }
+    return j->rank == 0 || send_rows(j, dist_parent(j->rank), Z, 0, Z->rows);
+}
+
+// Rank 0's M to every rank, largest subtrees first
+static int tree_broadcast(DistJob *j, Matrix *M) {
+    if (j->rank != 0 && !recv_rows(j, dist_parent(j->rank), M, 0, M->rows)) return 0;
+    int span = dist_span(j->rank, j->size);
+    int s = 1;
+    while (2 * s < span) s <<= 1;
+    for (; s >= 1 && span > 1; s >>= 1) {
+        if (!send_rows(j, j->rank + s, M, 0, M->rows)) return 0;
+    }
+    return 1;
+}
+
+// One stacked [R_self; R_child] merge per child, kept for the way down
+typedef struct {
+    int merges;
+    Matrix **P;
+    double **tau;
+    Matrix *R;                  // l×l
+    Matrix *C;                  // l×l block of the tree's Q for this rank
+    Matrix *X;                  // 2l×l
+} TreeQR;
+
+static void free_tree_qr(TreeQR *q) {
+    for (int c = 0; c < q->merges; c++) {
+        if (q->P) free_matrix(q->P[c]);
+        if (q->tau) mem_free(q->tau[c]);
+    }
+    mem_free(q->P);
+    mem_free(q->tau);
+    free_matrix(q->R);
+    free_matrix(q->C);
+    free_matrix(q->X);
+    memset(q, 0, sizeof(TreeQR));
+}
+
+static int init_tree_qr(TreeQR *q, int l, int merges) {
+    memset(q, 0, sizeof(TreeQR));
+    q->merges = merges;
+    q->P = (Matrix**)mem_calloc(merges ? merges : 1, sizeof(Matrix*));
+    q->tau = (double**)mem_calloc(merges ? merges : 1, sizeof(double*));
+    q->R = create_matrix_uninit(l, l);
+    q->C = create_matrix_uninit(l, l);
+    q->X = create_matrix_uninit(2 * l, l);
+    int ok = q->P && q->tau && q->R && q->C && q->X;
+    for (int c = 0; ok && c < merges; c++) {
+        q->P[c] = create_matrix_uninit(2 * l, l);
+        q->tau[c] = (double*)mem_alloc(l * sizeof(double));
+        ok = q->P[c] && q->tau[c];
+    }
+    if (!ok) free_tree_qr(q);
+    return ok;
+}
+
+// Y (this rank's rows of the distributed m×l block) becomes its rows of an
+// orthonormal basis Q. The local TSQR uses the threads; its R factor then
+// merges with the children's up the process tree, and the root's identity
+// comes back down as each rank's l×l block C of the tree's Q, so that
+// Q_r = Q_local [C; 0].
+static int tree_qr(DistJob *j, TreeQR *q, Matrix *Y) {
+    int l = j->l;
+    TSQR *f = tsqr_factor(Y, 0, j->opts->threads);
+    if (!f) return 0;
+    tsqr_get_r(f, q->R);
+
+    int ok = 1;
+    for (int c = 0, s = 1; ok && c < q->merges; c++, s <<= 1) {
+        Matrix *P = q->P[c];
+        for (int r = 0; r < l; r++) memcpy(P->data[r], q->R->data[r], l * sizeof(double));
+        ok = recv_rows(j, j->rank + s, P, l, l) && householder_qr(P, q->tau[c]);
+        for (int r = 0; ok && r < l; r++) {
+            for (int a = 0; a < l; a++) q->R->data[r][a] = a >= r ? P->data[r][a] : 0.0;
+        }
+    }
+    if (ok && j->rank != 0) {
+        ok = send_rows(j, dist_parent(j->rank), q->R, 0, l) &&
+             recv_rows(j, dist_parent(j->rank), q->C, 0, l);
+    } else if (ok) {
+        for (int r = 0; r < l; r++) {
+            for (int a = 0; a < l; a++) q->C->data[r][a] = r == a;
+        }
+    }
+    // Merge c's Q maps [C; 0] to the blocks of its two inputs
+    for (int c = q->merges - 1; ok && c >= 0; c--) {
+        for (int r = 0; r < 2 * l; r++) {
+            if (r < l) memcpy(q->X->data[r], q->C->data[r], l * sizeof(double));
+            else memset(q->X->data[r], 0, l * sizeof(double));
+        }
+        ok = householder_apply(q->P[c], q->tau[c], 0, q->X) &&
+             send_rows(j, j->rank + (1 << c), q->X, l, l);
+        for (int r = 0; ok && r < l; r++) memcpy(q->C->data[r], q->X->data[r], l * sizeof(double));
+    }
+    ok = ok && tsqr_apply_q(f, q->C, Y, j->opts->threads);
+    tsqr_free(f);
+    return ok;
+}
+
+typedef struct {
+    const Matrix *A;
+    int r0;                     // first row of the shard
+    const Matrix *X;
+    Matrix *Y;
+} ShardTask;
+
+// Rows [begin, end) of Y = A_r X
+static void shard_times(void *arg, int begin, int end) {
+    ShardTask *t = (ShardTask*)arg;
+    int n = t->A->cols, l = t->Y->cols;
+    const SimdKernels *kern = simd_kernels();
+    for (int i = begin; i < end; i++) {
+        const double *a = t->A->data[t->r0 + i];
+        double *y = t->Y->data[i];
+        memset(y, 0, l * sizeof(double));
+        for (int c = 0; c < n; c++) kern->axpy(y, a[c], t->X->data[c], l);
+    }
+}
+
+// Rows [begin, end) of Y = A_rᵀ X, i.e. those columns of the shard
+static void shard_transpose_times(void *arg, int begin, int end) {
+    ShardTask *t = (ShardTask*)arg;
+    int l = t->Y->cols;
+    const SimdKernels *kern = simd_kernels();
+    for (int c = begin; c < end; c++) memset(t->Y->data[c], 0, l * sizeof(double));
+    for (int i = 0; i < t->X->rows; i++) {
+        const double *a = t->A->data[t->r0 + i];
+        const double *x = t->X->data[i];
+        for (int c = begin; c < end; c++) kern->axpy(t->Y->data[c], a[c], x, l);
+    }
+}
+
+// Rank 0's share of the last step: Bᵀ = Ṽ Σ Wᵀ, W (l×k) kept for U = Q W
+static int solve_small(DistJob *j, Matrix *Bt, Matrix *W) {
+    SVDOptions inner = *j->opts;
+    inner.ws = NULL;
+    inner.verbose = 0;
+    inner.engine = SVD_ENGINE_AUTO;
+    inner.start = NULL;
+    SVDResult *small = svd_compute(Bt, j->k, &inner);
+    if (!small) return 0;
+
+    int m = j->first[j->size];
+    int n = j->A->cols;
+    // The other ranks expect all k columns of W; any the small solve did
+    // not return stay zero, as do their singular values
+    j->result = create_svd_result(j->opts->ws, m, n, j->k);
+    if (j->result) {
+        int k = j->k, got = small->k;
+        for (int q = 0; q < k; q++) j->result->singular_values[q] = q < got ? small->singular_values[q] : 0.0;
+        for (int c = 0; c < n; c++) {
+            for (int q = 0; q < k; q++) j->result->V->data[c][q] = q < got ? small->U->data[c][q] : 0.0;
+        }
+        for (int r = 0; r < j->l; r++) {
+            for (int q = 0; q < k; q++) W->data[r][q] = q < got ? small->V->data[r][q] : 0.0;
+        }
+        j->result->iterations = DIST_POWER_ITERS;
+    }
+    free_svd_result(small);
+    return j->result != NULL;
+}
+
+// The part of the solve every rank runs on its own rows
+static int dist_rank(DistJob *j) {
+    const Matrix *A = j->A;
+    int n = A->cols, l = j->l, k = j->k;
+    int r0 = j->first[j->rank];
+    int rows = j->first[j->rank + 1] - r0;
+    int span = dist_span(j->rank, j->size);
+    int sub = j->first[j->rank + span] - r0;
+    int merges = 0;
+    for (int s = 1; s < span; s <<= 1) merges++;
+    int threads = j->opts->threads;
+
+    Matrix *Q = create_matrix_uninit(rows, l);
+    Matrix *Z = create_matrix_uninit(n, l);
+    Matrix *tmp = j->size > 1 ? create_matrix_uninit(n, l) : NULL;
+    Matrix *W = create_matrix_uninit(l, k);
+    // Rank 0 gathers straight into the result
+    Matrix *G = j->rank ? create_matrix_uninit(sub, k) : NULL;
+    TreeQR tq;
+    int ok = init_tree_qr(&tq, l, merges) && Q && Z && W && (tmp || j->size == 1) &&
+             (G || !j->rank);
+
+    if (j->rank == 0) perf_phase_begin("dist_range");
+    ShardTask task = { A, r0, j->omega, Q };
+    if (ok) {
+        parallel_for(threads, rows, shard_times, &task);
+        ok = tree_qr(j, &tq, Q);
+    }
+    for (int it = 0; ok && it <= DIST_POWER_ITERS; it++) {
+        ShardTask back = { A, r0, Q, Z };
+        parallel_for(threads, n, shard_transpose_times, &back);
+        ok = tree_sum(j, Z, tmp);
+        if (!ok || it == DIST_POWER_ITERS) break;
+        if (j->rank == 0) ok = block_orthonormalize(Z, NULL, threads);
+        ok = ok && tree_broadcast(j, Z);
+        task.X = Z;
+        if (ok) parallel_for(threads, rows, shard_times, &task);
+        ok = ok && tree_qr(j, &tq, Q);
+    }
+    if (j->rank == 0) {
+        double m = j->first[j->size];
+        perf_phase_end("dist_range", 4.0 * m * n * l * (DIST_POWER_ITERS + 1),
+                       8.0 * m * n * (2 * DIST_POWER_ITERS + 2));
+    }
+
+    // Z now holds Bᵀ on rank 0
+    if (j->rank == 0) perf_phase_begin("dist_gather");
+    if (ok && j->rank == 0) ok = solve_small(j, Z, W);
+    ok = ok && tree_broadcast(j, W);
+    if (ok) {
+        // U_r = Q_r W heads this rank's block of the gathered rows
+        Matrix *out = j->rank ? G : j->result->U;
+        Matrix Ur = { rows, k, out->data, NULL, 1 };
+        ShardTask fold = { Q, 0, W, &Ur };
+        parallel_for(threads, rows, shard_times, &fold);
+        for (int s = 1; ok && s < span; s <<= 1) {
+            int from = j->first[j->rank + s] - r0;
+            int count = j->first[j->rank + s + dist_span(j->rank + s, j->size)] - r0 - from;
+            ok = recv_rows(j, j->rank + s, out, from, count);
+        }
+        if (ok && j->rank) ok = send_rows(j, dist_parent(j->rank), G, 0, sub);
+    }
+    if (j->rank == 0) {
+        double m = j->first[j->size];
+        perf_phase_end("dist_gather", 2.0 * m * l * k, 8.0 * m * (l + k));
+    }
+
+    if (!ok && j->t) j->t->fail(j->t);
+    free_tree_qr(&tq);
+    free_matrix(Q);
+    free_matrix(Z);
+    free_matrix(tmp);
+    free_matrix(W);
+    free_matrix(G);
+    return ok;
+}
+
+static void split_rows(int *first, int m, int size) {
+    for (int r = 0; r <= size; r++) first[r] = (int)((long)m * r / size);
+}
+
+SVDResult* dist_svd(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows, n = A->cols;
+    int p = m < n ? m : n;
+    if (k > p) k = p;
+    int l = k + DIST_OVERSAMPLE < p ? k + DIST_OVERSAMPLE : p;
+    int size = opts->processes > 0 ? opts->processes : parallel_cpu_count();
+    if (size > m / l) size = m / l;
+    if (size < 1) size = 1;
+
+    Matrix *omega = create_matrix_uninit(n, l);
+    int *first = (int*)mem_alloc((size + 1) * sizeof(int));
+    pid_t *pids = (pid_t*)mem_calloc(size, sizeof(pid_t));
+    if (!omega || !first || !pids) {
+        fprintf(stderr, "Error: Out of memory for the distributed SVD\n");
+        free_matrix(omega);
+        mem_free(first);
+        mem_free(pids);
+        return NULL;
+    }
+    uint64_t rng = rng_seed(opts->seed);
+    for (int c = 0; c < n; c++) {
+        for (int q = 0; q < l; q++) omega->data[c][q] = rng_uniform(&rng);
+    }
+
+    DistTransport *t = size > 1 ? dist_transport_create(opts->transport, size) : NULL;
+    if (size > 1 && !t) {
+        fprintf(stderr, "Warning: no %s transport, solving in one process\n",
+                dist_transport_name(opts->transport));
+        size = 1;
+    }
+    split_rows(first, m, size);
+    if (opts->verbose) {
+        printf("Computing rank-%d randomized SVD over %d process%s (%s transport, l=%d)...\n",
+               k, size, size > 1 ? "es" : "", t ? t->name : "no", l);
+    }
+
+    DistJob job = { A, omega, k, l, first, opts, t, 0, size, NULL };
+    // Buffered output would otherwise be flushed once per process
+    fflush(stdout);
+    fflush(stderr);
+    int forked = 1;
+    for (int r = 1; r < size; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            t->attach(t, r);
+            job.rank = r;
+            _exit(dist_rank(&job) ? 0 : 1);
+        }
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        pids[r] = pid;
+        forked++;
+    }
+
+    int ok;
+    if (forked < size) {
+        // The ranks already started give up on their first exchange
+        t->fail(t);
+        ok = 0;
+    } else {
+        if (t) t->attach(t, 0);
+        ok = dist_rank(&job);
+    }
+    for (int r = 1; r < forked; r++) {
+        int status;
+        while (waitpid(pids[r], &status, 0) < 0 && errno == EINTR) {}
+    }
+    if (t) t->destroy(t);
+
+    if (forked < size) {
+        fprintf(stderr, "Warning: could not start %d processes, solving in one\n", size);
+        job.t = NULL;
+        job.size = 1;
+        split_rows(first, m, 1);
+        ok = dist_rank(&job);
+    }
+
+    free_matrix(omega);
+    mem_free(first);
+    mem_free(pids);
+    if (!ok) {
+        free_svd_result(job.result);
+        fprintf(stderr, "Error: Distributed SVD failed\n");
+        return NULL;
+    }
+    if (opts->verbose) svd_print_summary(job.result);
+    return job.result;
+}
@@ -0,0 +1,27 @@
+#ifndef DIST_SVD_H
+#define DIST_SVD_H
+
+#include "lanczos.h"
+
+// Randomized truncated SVD with the rows of A sharded over opts->processes
+// processes: rank 0 is the caller, the others are forked and talk to it
+// over opts->transport (dist_transport.h). Rank r owns the row block A_r
+// and everything else is l = k + DIST_OVERSAMPLE columns wide:
+//
+//   Y_r = A_r Ω                 local
+//   Q = qr(Y)                   TSQR: local R factors merged up the process
+//                               tree, Q's l×l blocks sent back down it
+//   Z = Aᵀ Q = Σ_r A_rᵀ Q_r    summed up the tree, orthonormalized on rank 0
+//                               and broadcast, then Y_r = A_r Z again
+//
+// for DIST_POWER_ITERS rounds. Bᵀ = AᵀQ is then reduced once more, rank 0
+// decomposes the small n×l Bᵀ = Ṽ Σ Wᵀ, and U = Q W is gathered up the
+// tree. Per round a rank moves O(n·l) doubles however tall A is. Every
+// rank needs at least l rows, which caps the process count; only rank 0
+// allocates the result (in opts->ws when given).
+#define DIST_OVERSAMPLE 10
+#define DIST_POWER_ITERS 2
+
+SVDResult* dist_svd(Matrix *A, int k, const SVDOptions *opts);
+
+#endif
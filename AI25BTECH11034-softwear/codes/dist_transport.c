@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include "dist_transport.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+// Blocked shared-memory waits look for a failed solve or a dead process
+// this often
+#define SHM_POLL_NS 100000000L
+
+int dist_parent(int rank) {
+    return rank & (rank - 1);
+}
+
+int dist_span(int rank, int size) {
+    if (rank == 0) return size;
+    int span = rank & -rank;
+    return rank + span > size ? size - rank : span;
+}
+
+// The link to peer is stored under the child's rank
+static int edge_of(const DistTransport *t, int peer) {
+    return peer == dist_parent(t->rank) && t->rank != 0 ? t->rank : peer;
+}
+
+// Socket transport: one UNIX stream socket pair per tree edge, fds[2c] on
+// the parent's side and fds[2c + 1] on child c's.
+typedef struct {
+    int *fds;
+} SocketLinks;
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+}
+
+static int socket_attach(DistTransport *t, int rank) {
+    SocketLinks *s = (SocketLinks*)t->impl;
+    t->rank = rank;
+    for (int c = 1; c < t->size; c++) {
+        if (dist_parent(c) != rank) close_fd(&s->fds[2 * c]);
+        if (c != rank) close_fd(&s->fds[2 * c + 1]);
+    }
+    return 1;
+}
+
+static int socket_fd(DistTransport *t, int peer) {
+    SocketLinks *s = (SocketLinks*)t->impl;
+    int c = edge_of(t, peer);
+    return s->fds[2 * c + (c == t->rank)];
+}
+
+static int socket_send(DistTransport *t, int peer, const void *buf, size_t len) {
+    int fd = socket_fd(t, peer);
+    const char *p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int socket_recv(DistTransport *t, int peer, void *buf, size_t len) {
+    int fd = socket_fd(t, peer);
+    char *p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Closing every link shows up as EOF or EPIPE on the neighbours, which
+// fail in turn
+static void socket_fail(DistTransport *t) {
+    SocketLinks *s = (SocketLinks*)t->impl;
+    for (int i = 2; i < 2 * t->size; i++) close_fd(&s->fds[i]);
+}
+
+static void socket_destroy(DistTransport *t) {
+    if (!t) return;
+    socket_fail(t);
+    SocketLinks *s = (SocketLinks*)t->impl;
+    mem_free(s->fds);
+    mem_free(s);
+    mem_free(t);
+}
+
+// Shared-memory transport: an anonymous shared mapping made before the
+// fork holds one mailbox per direction of each edge. A mailbox passes up to
+// DIST_SHM_CHANNEL_BYTES at a time between two process-shared semaphores.
+typedef struct {
+    sem_t full;
+    sem_t empty;
+    size_t len;
+    unsigned char data[DIST_SHM_CHANNEL_BYTES];
+} ShmChannel;
+
+typedef struct {
+    int failed;
+    pid_t owner;                // rank 0, the parent of every other rank
+    pid_t pids[];               // each rank's, written at attach
+} ShmHeader;
+
+typedef struct {
+    ShmHeader *head;
+    ShmChannel *ch;             // ch[2c]: parent to child c, ch[2c + 1]: back
+    size_t bytes;
+    int sems;                   // semaphores initialized so far
+} ShmLinks;
+
+static void shm_fail(DistTransport *t);
+
+static int shm_wait(DistTransport *t, sem_t *sem) {
+    ShmLinks *s = (ShmLinks*)t->impl;
+    for (;;) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += SHM_POLL_NS;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        if (sem_timedwait(sem, &ts) == 0) return 1;
+        if (errno != ETIMEDOUT && errno != EINTR) return 0;
+        if (__atomic_load_n(&s->head->failed, __ATOMIC_ACQUIRE)) return 0;
+        if (t->rank != 0 && getppid() != s->head->owner) return 0;
+        // A rank that died without failing the solve is noticed by its
+        // parent, rank 0, which fails it for everyone (without reaping)
+        for (int r = 1; t->rank == 0 && r < t->size; r++) {
+            pid_t pid = __atomic_load_n(&s->head->pids[r], __ATOMIC_ACQUIRE);
+            siginfo_t info;
+            info.si_pid = 0;
+            if (pid > 0 && waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+                info.si_pid == pid) {
+                shm_fail(t);
+                return 0;
+            }
+        }
+    }
+}
+
+static ShmChannel* shm_channel(DistTransport *t, int peer, int sending) {
+    ShmLinks *s = (ShmLinks*)t->impl;
+    int c = edge_of(t, peer);
+    // Downward traffic uses the even mailbox
+    int down = (c == t->rank) != sending;
+    return &s->ch[2 * c + !down];
+}
+
+static int shm_attach(DistTransport *t, int rank) {
+    ShmLinks *s = (ShmLinks*)t->impl;
+    t->rank = rank;
+    __atomic_store_n(&s->head->pids[rank], getpid(), __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int shm_send(DistTransport *t, int peer, const void *buf, size_t len) {
+    ShmChannel *ch = shm_channel(t, peer, 1);
+    const unsigned char *p = (const unsigned char*)buf;
+    do {
+        size_t n = len < DIST_SHM_CHANNEL_BYTES ? len : DIST_SHM_CHANNEL_BYTES;
+        if (!shm_wait(t, &ch->empty)) return 0;
+        memcpy(ch->data, p, n);
+        ch->len = n;
+        sem_post(&ch->full);
+        p += n;
+        len -= n;
+    } while (len > 0);
+    return 1;
+}
+
+static int shm_recv(DistTransport *t, int peer, void *buf, size_t len) {
+    ShmChannel *ch = shm_channel(t, peer, 0);
+    unsigned char *p = (unsigned char*)buf;
+    do {
+        if (!shm_wait(t, &ch->full)) return 0;
+        size_t n = ch->len;
+        if (n > len) {
+            sem_post(&ch->empty);
+            return 0;
+        }
+        memcpy(p, ch->data, n);
+        sem_post(&ch->empty);
+        p += n;
+        len -= n;
+    } while (len > 0);
+    return 1;
+}
+
+static void shm_fail(DistTransport *t) {
+    ShmLinks *s = (ShmLinks*)t->impl;
+    __atomic_store_n(&s->head->failed, 1, __ATOMIC_RELEASE);
+}
+
+static void shm_destroy(DistTransport *t) {
+    if (!t) return;
+    ShmLinks *s = (ShmLinks*)t->impl;
+    if (s->head) {
+        for (int i = 0; i < s->sems; i++) {
+            sem_destroy(&s->ch[i].full);
+            sem_destroy(&s->ch[i].empty);
+        }
+        munmap(s->head, s->bytes);
+    }
+    mem_free(s);
+    mem_free(t);
+}
+
+static DistTransport* socket_create(DistTransport *t) {
+    SocketLinks *s = (SocketLinks*)mem_calloc(1, sizeof(SocketLinks));
+    t->impl = s;
+    t->attach = socket_attach;
+    t->send = socket_send;
+    t->recv = socket_recv;
+    t->fail = socket_fail;
+    t->destroy = socket_destroy;
+    if (s) s->fds = (int*)mem_alloc(2 * t->size * sizeof(int));
+    if (!s || !s->fds) {
+        if (s) mem_free(s);
+        mem_free(t);
+        return NULL;
+    }
+    for (int i = 0; i < 2 * t->size; i++) s->fds[i] = -1;
+    for (int c = 1; c < t->size; c++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, &s->fds[2 * c]) != 0) {
+            perror("socketpair");
+            socket_destroy(t);
+            return NULL;
+        }
+    }
+    return t;
+}
+
+static DistTransport* shm_create(DistTransport *t) {
+    ShmLinks *s = (ShmLinks*)mem_calloc(1, sizeof(ShmLinks));
+    t->impl = s;
+    t->attach = shm_attach;
+    t->send = shm_send;
+    t->recv = shm_recv;
+    t->fail = shm_fail;
+    t->destroy = shm_destroy;
+    if (!s) {
+        mem_free(t);
+        return NULL;
+    }
+    // The header takes the first channel-aligned slots
+    size_t head_bytes = sizeof(ShmHeader) + t->size * sizeof(pid_t);
+    size_t head = (head_bytes + sizeof(ShmChannel) - 1) / sizeof(ShmChannel);
+    s->bytes = (head + 2 * (size_t)t->size) * sizeof(ShmChannel);
+    void *area = mmap(NULL, s->bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        perror("mmap");
+        mem_free(s);
+        mem_free(t);
+        return NULL;
+    }
+    s->head = (ShmHeader*)area;
+    s->ch = (ShmChannel*)area + head;
+    s->head->owner = getpid();
+    for (; s->sems < 2 * t->size; s->sems++) {
+        ShmChannel *ch = &s->ch[s->sems];
+        if (sem_init(&ch->full, 1, 0) != 0 || sem_init(&ch->empty, 1, 1) != 0) {
+            perror("sem_init");
+            shm_destroy(t);
+            return NULL;
+        }
+    }
+    return t;
+}
+
+DistTransport* dist_transport_create(SVDTransport kind, int size) {
+    DistTransport *t = (DistTransport*)mem_calloc(1, sizeof(DistTransport));
+    if (!t) return NULL;
+    t->size = size;
+    t->name = dist_transport_name(kind);
+    switch (kind) {
+        case SVD_TRANSPORT_SOCKET: return socket_create(t);
+        case SVD_TRANSPORT_SHM: return shm_create(t);
+    }
+    mem_free(t);
+    return NULL;
+}
+
+const char* dist_transport_name(SVDTransport kind) {
+    switch (kind) {
+        case SVD_TRANSPORT_SOCKET: return "socket";
+        case SVD_TRANSPORT_SHM: return "shm";
+    }
+    return "unknown";
+}
+
+int dist_transport_parse(const char *name, SVDTransport *kind) {
+    for (int k = SVD_TRANSPORT_SOCKET; k <= SVD_TRANSPORT_SHM; k++) {
+        if (strcmp(name, dist_transport_name((SVDTransport)k)) == 0) {
+            *kind = (SVDTransport)k;
+            return 1;
+        }
+    }
+    return 0;
+}
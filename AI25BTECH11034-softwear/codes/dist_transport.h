@@ -0,0 +1,45 @@
+#ifndef DIST_TRANSPORT_H
+#define DIST_TRANSPORT_H
+
+#include <stddef.h>
+#include "lanczos.h"
+
+// Point-to-point links between the processes of a distributed solve.
+// Ranks 0..size-1 form a binomial tree: the parent of r is r with its
+// lowest set bit cleared, and only parent/child pairs are linked, which is
+// all the tree reductions and broadcasts of dist_svd need. Rank 0 creates
+// the transport before forking the others; every process (rank 0 last,
+// after all forks) then calls attach with its own rank.
+//
+// Messages are raw bytes and both ends know their length. A backend for
+// another interconnect (e.g. TCP between hosts) only fills in the table.
+typedef struct DistTransport DistTransport;
+struct DistTransport {
+    int size;
+    int rank;
+    const char *name;
+    int (*attach)(DistTransport *t, int rank);
+    // Both return 0 when the peer is gone or the solve has failed
+    int (*send)(DistTransport *t, int peer, const void *buf, size_t len);
+    int (*recv)(DistTransport *t, int peer, void *buf, size_t len);
+    // Makes every pending and later send/recv of the other ranks fail
+    void (*fail)(DistTransport *t);
+    void (*destroy)(DistTransport *t);
+    void *impl;
+};
+
+// Bytes a shared-memory mailbox carries per hand-off; longer messages go
+// through in pieces
+#define DIST_SHM_CHANNEL_BYTES (1 << 20)
+
+DistTransport* dist_transport_create(SVDTransport kind, int size);
+const char* dist_transport_name(SVDTransport kind);
+// Transport for a name as printed by dist_transport_name; 0 if unknown
+int dist_transport_parse(const char *name, SVDTransport *kind);
+
+int dist_parent(int rank);
+// The subtree under rank holds ranks [rank, rank + dist_span(rank, size)),
+// its children being rank + s for s = 1, 2, 4, ... below the span
+int dist_span(int rank, int size);
+
+#endif
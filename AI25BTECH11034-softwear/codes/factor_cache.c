@@ -0,0 +1,178 @@
+#define _GNU_SOURCE
+#include "factor_cache.h"
+#include "svd_stream.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// The exact engines agree to solver tolerance, so whichever one the tuner
+// routes a rank to can serve (or reuse) the entry another one stored
+static int32_t key_engine(SVDEngine engine) {
+    switch (engine) {
+        case SVD_ENGINE_RRQR:
+        case SVD_ENGINE_CUR:
+        case SVD_ENGINE_DISTRIBUTED:
+            return (int32_t)engine;
+        default:
+            return (int32_t)SVD_ENGINE_AUTO;
+    }
+}
+
+uint64_t factor_cache_key(const unsigned char *pixels, int width, int height, int stride,
+                          int max_val, const SVDOptions *opts) {
+    int32_t shape[3] = { width, height, max_val };
+    int32_t params[3] = { key_engine(opts->engine), opts->power_iters, opts->low_memory };
+    uint64_t h = fnv1a(FNV_OFFSET, shape, sizeof(shape));
+    h = fnv1a(h, params, sizeof(params));
+    h = fnv1a(h, &opts->tol, sizeof(opts->tol));
+    for (int i = 0; i < height; i++) h = fnv1a(h, pixels + (size_t)i * stride, width);
+    return h;
+}
+
+FactorCache* factor_cache_open(const char *dir, size_t max_bytes) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Cannot create cache directory %s\n", dir);
+        return NULL;
+    }
+    FactorCache *cache = (FactorCache*)mem_calloc(1, sizeof(FactorCache));
+    if (!cache) return NULL;
+    cache->dir = (char*)mem_alloc(strlen(dir) + 1);
+    if (!cache->dir) {
+        mem_free(cache);
+        return NULL;
+    }
+    strcpy(cache->dir, dir);
+    cache->max_bytes = max_bytes ? max_bytes : FACTOR_CACHE_DEFAULT_BYTES;
+    return cache;
+}
+
+void factor_cache_close(FactorCache *cache) {
+    if (!cache) return;
+    mem_free(cache->dir);
+    mem_free(cache);
+}
+
+static void entry_path(const FactorCache *cache, uint64_t key, char *path, size_t cap) {
+    snprintf(path, cap, "%s/%016llx.svdp", cache->dir, (unsigned long long)key);
+}
+
+SVDResult* factor_cache_get(FactorCache *cache, uint64_t key, int k) {
+    char path[4096];
+    entry_path(cache, key, path, sizeof(path));
+    int rank = 0;
+    SVDResult *svd = NULL;
+    if (svd_stream_info(path, NULL, NULL, &rank) && rank >= k) {
+        svd = svd_stream_load(path, k, NULL);
+    }
+    if (svd && svd->k == k) {
+        utimes(path, NULL);
+        cache->hits++;
+        return svd;
+    }
+    free_svd_result(svd);
+    cache->misses++;
+    return NULL;
+}
+
+typedef struct {
+    char name[64];
+    struct timespec mtime;
+    off_t size;
+} CacheEntry;
+
+static int compare_entries(const void *a, const void *b) {
+    const struct timespec *x = &((const CacheEntry*)a)->mtime;
+    const struct timespec *y = &((const CacheEntry*)b)->mtime;
+    if (x->tv_sec != y->tv_sec) return (x->tv_sec > y->tv_sec) - (x->tv_sec < y->tv_sec);
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+// Deletes the least recently used entries until the directory fits
+static void evict(FactorCache *cache) {
+    DIR *dir = opendir(cache->dir);
+    if (!dir) return;
+    CacheEntry *entries = NULL;
+    int count = 0, cap = 0;
+    size_t total = 0;
+    char path[4096];
+
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        size_t len = strlen(e->d_name);
+        if (len < 5 || len >= sizeof(entries->name) || strcmp(e->d_name + len - 5, ".svdp") != 0) {
+            continue;
+        }
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, e->d_name);
+        if (stat(path, &st) != 0) continue;
+        if (count == cap) {
+            int grown_cap = cap ? 2 * cap : 64;
+            CacheEntry *grown = (CacheEntry*)mem_alloc(grown_cap * sizeof(CacheEntry));
+            if (!grown) break;
+            if (count) memcpy(grown, entries, count * sizeof(CacheEntry));
+            mem_free(entries);
+            entries = grown;
+            cap = grown_cap;
+        }
+        strcpy(entries[count].name, e->d_name);
+        entries[count].mtime = st.st_mtim;
+        entries[count].size = st.st_size;
+        total += (size_t)st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(entries, count, sizeof(CacheEntry), compare_entries);
+    for (int i = 0; i < count && total > cache->max_bytes; i++) {
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, entries[i].name);
+        if (unlink(path) == 0) total -= (size_t)entries[i].size;
+    }
+    mem_free(entries);
+}
+
+int factor_cache_put(FactorCache *cache, uint64_t key, const SVDResult *svd, int k, int max_val) {
+    if (k > svd->k) k = svd->k;
+    char path[4096], tmp[4160];
+    entry_path(cache, key, path, sizeof(path));
+    int rank = 0;
+    if (svd_stream_info(path, NULL, NULL, &rank) && rank >= k) return 1;
+
+    // Written aside and renamed, so readers never see a partial entry
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create cache entry in %s\n", cache->dir);
+        return 0;
+    }
+    fchmod(fd, 0644);
+    close(fd);
+    if (!svd_stream_save(tmp, svd, k, max_val, 0)) {
+        unlink(tmp);
+        return 0;
+    }
+    if (rename(tmp, path) != 0) {
+        fprintf(stderr, "Error: Cannot store cache entry %s\n", path);
+        unlink(tmp);
+        return 0;
+    }
+    evict(cache);
+    return 1;
+}
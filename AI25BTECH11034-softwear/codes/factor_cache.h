@@ -0,0 +1,44 @@
+#ifndef FACTOR_CACHE_H
+#define FACTOR_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lanczos.h"
+
+// On-disk cache of factorizations keyed by a hash of the pixels and the
+// solver parameters. Each entry is a progressive factor file
+// (<dir>/<key>.svdp) holding the largest rank computed so far, so any
+// request up to that rank skips the decomposition. Entries are evicted
+// least recently used first (by mtime, refreshed on every hit) once the
+// directory exceeds max_bytes. Entries are replaced by rename, so several
+// processes may share one directory.
+//
+// Entries hold float32 factors (the .svdp format), so a hit reconstructs
+// from rounded U, σ, V: relative error ~1e-7 per factor, which moves an
+// 8-bit output pixel by at most one level against the uncached run.
+typedef struct {
+    char *dir;
+    size_t max_bytes;
+    long hits;
+    long misses;
+} FactorCache;
+
+#define FACTOR_CACHE_DEFAULT_BYTES ((size_t)1 << 30)
+
+// Creates dir when missing; max_bytes 0 uses FACTOR_CACHE_DEFAULT_BYTES
+FactorCache* factor_cache_open(const char *dir, size_t max_bytes);
+void factor_cache_close(FactorCache *cache);
+
+// FNV-1a over the image size, pixel rows and the parameters that change
+// the factors (tolerance, iteration cap, matrix-free mode, and the engine
+// for the approximate ones; all exact engines share one key)
+uint64_t factor_cache_key(const unsigned char *pixels, int width, int height, int stride,
+                          int max_val, const SVDOptions *opts);
+
+// Leading k triplets when an entry of rank >= k exists, else NULL
+SVDResult* factor_cache_get(FactorCache *cache, uint64_t key, int k);
+// Stores the leading k triplets unless the entry already holds as many.
+// Returns 1 when the cache holds rank >= k afterwards.
+int factor_cache_put(FactorCache *cache, uint64_t key, const SVDResult *svd, int k, int max_val);
+
+#endif
@@ -0,0 +1,174 @@
+#include "jacobi_svd.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+// Below this many matrix entries a round is too short to be worth threads
+#define JACOBI_PARALLEL_MIN (128 * 128)
+
+// The working columns are stored as rows (W is c×len) so every rotation
+// streams through contiguous memory; Q (c×c) accumulates the rotations.
+typedef struct {
+    Matrix *W;
+    Matrix *Q;
+    const int *pairs;           // 2 * npairs column indices for this round
+    int *rotated;               // per pair: whether it was rotated
+    double tol;
+} JacobiRound;
+
+static void rotate_pairs(void *arg, int begin, int end) {
+    JacobiRound *round = (JacobiRound*)arg;
+    int len = round->W->cols;
+    int c = round->Q->cols;
+    const SimdKernels *kern = simd_kernels();
+
+    for (int p = begin; p < end; p++) {
+        int i = round->pairs[2 * p], j = round->pairs[2 * p + 1];
+        double *a = round->W->data[i], *b = round->W->data[j];
+        double alpha, beta, gamma;
+        kern->pair_sums(a, b, len, &alpha, &beta, &gamma);
+        if (gamma == 0.0 || fabs(gamma) <= round->tol * sqrt(alpha * beta)) {
+            round->rotated[p] = 0;
+            continue;
+        }
+
+        double zeta = (beta - alpha) / (2.0 * gamma);
+        double t = (zeta >= 0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+        double cs = 1.0 / sqrt(1.0 + t * t);
+        double sn = cs * t;
+        kern->rot(a, b, len, cs, sn);
+        kern->rot(round->Q->data[i], round->Q->data[j], c, cs, sn);
+        round->rotated[p] = 1;
+    }
+}
+
+// Orthogonalizes the rows of W (c×len) against each other, accumulating the
+// rotations into Q, which starts as the identity. Returns the sweep count,
+// negated when the last sweep still rotated, or 0 on allocation failure.
+static int jacobi_sweeps(Matrix *W, Matrix *Q, Workspace *ws, int threads) {
+    int c = W->rows;
+    int len = W->cols;
+    int slots = c + (c & 1);            // odd counts get a dummy index c
+    int *order = (int*)scratch_alloc(ws, slots * sizeof(int));
+    int *pairs = (int*)scratch_alloc(ws, slots * sizeof(int));
+    int *rotated = (int*)scratch_alloc(ws, (slots / 2 + 1) * sizeof(int));
+    if (!order || !pairs || !rotated) {
+        scratch_free(ws, order);
+        scratch_free(ws, pairs);
+        scratch_free(ws, rotated);
+        return 0;
+    }
+    for (int i = 0; i < slots; i++) order[i] = i;
+    if ((long)c * len < JACOBI_PARALLEL_MIN) threads = 1;
+
+    JacobiRound round = { W, Q, pairs, rotated, DBL_EPSILON * sqrt((double)len) };
+    int sweep = 0, any = 1;
+    while (any && sweep < JACOBI_MAX_SWEEPS) {
+        sweep++;
+        any = 0;
+        // Round-robin tournament: slot 0 stays, the others shift by one
+        // each round, so every pair meets exactly once per sweep
+        for (int r = 0; r < slots - 1; r++) {
+            int npairs = 0;
+            for (int p = 0; p < slots / 2; p++) {
+                int i = order[p], j = order[slots - 1 - p];
+                if (i == c || j == c) continue;
+                pairs[2 * npairs] = i < j ? i : j;
+                pairs[2 * npairs + 1] = i < j ? j : i;
+                npairs++;
+            }
+            parallel_for(threads, npairs, rotate_pairs, &round);
+            for (int p = 0; p < npairs; p++) any |= rotated[p];
+
+            int last = order[slots - 1];
+            memmove(order + 2, order + 1, (slots - 2) * sizeof(int));
+            order[1] = last;
+        }
+    }
+
+    scratch_free(ws, rotated);
+    scratch_free(ws, pairs);
+    scratch_free(ws, order);
+    return any ? -sweep : sweep;
+}
+
+size_t jacobi_svd_memory_bytes(int m, int n) {
+    int c = m < n ? m : n;
+    int len = m < n ? n : m;
+    int slots = c + (c & 1);
+    return matrix_storage_bytes(c, len) + matrix_storage_bytes(c, c)
+         + (size_t)(c + 2 * slots + slots / 2 + 1) * sizeof(int) + 4 * 64;
+}
+
+int jacobi_svd(const Matrix *A, double *s, Matrix *U, Matrix *V, Workspace *ws, int threads) {
+    int m = A->rows;
+    int n = A->cols;
+    // Orthogonalize the columns of A, or of Aᵀ when A is wide; then the
+    // normalized columns are the left vectors of that matrix and the
+    // accumulated rotations its right vectors.
+    int wide = m < n;
+    int c = wide ? m : n;
+    int len = wide ? n : m;
+
+    size_t mark = ws ? workspace_mark(ws) : 0;
+    Matrix *W = scratch_matrix(ws, c, len);
+    Matrix *Q = scratch_matrix(ws, c, c);
+    int *order = (int*)scratch_alloc(ws, c * sizeof(int));
+    int sweeps = 0;
+    if (W && Q && order) {
+        for (int i = 0; i < c; i++) memset(Q->data[i], 0, c * sizeof(double));
+        if (wide) {
+            for (int i = 0; i < m; i++) memcpy(W->data[i], A->data[i], n * sizeof(double));
+        } else {
+            matrix_transpose((Matrix*)A, W);
+        }
+        for (int i = 0; i < c; i++) Q->data[i][i] = 1.0;
+        sweeps = jacobi_sweeps(W, Q, ws, threads);
+        if (sweeps < 0) {
+            fprintf(stderr, "Error: Jacobi SVD did not converge in %d sweeps\n", JACOBI_MAX_SWEEPS);
+        }
+    }
+
+    if (sweeps) {
+        for (int i = 0; i < c; i++) {
+            s[i] = vector_norm(W->data[i], len);
+            order[i] = i;
+        }
+        // Insertion sort of the column order, descending by singular value
+        for (int i = 1; i < c; i++) {
+            int key = order[i], j = i - 1;
+            while (j >= 0 && s[order[j]] < s[key]) {
+                order[j + 1] = order[j];
+                j--;
+            }
+            order[j + 1] = key;
+        }
+
+        Matrix *left = wide ? V : U;
+        Matrix *right = wide ? U : V;
+        for (int l = 0; l < c; l++) {
+            int src = order[l];
+            double sigma = s[src];
+            if (left) {
+                for (int r = 0; r < len; r++) {
+                    left->data[r][l] = sigma > 1e-300 ? W->data[src][r] / sigma : 0.0;
+                }
+            }
+            if (right) {
+                for (int r = 0; r < c; r++) right->data[r][l] = Q->data[src][r];
+            }
+        }
+        // Reorder s last; the loop above still indexes it by source column
+        for (int l = 0; l < c; l++) W->data[0][l] = s[order[l]];
+        memcpy(s, W->data[0], c * sizeof(double));
+    }
+
+    scratch_free(ws, order);
+    free_matrix(Q);
+    free_matrix(W);
+    if (ws) workspace_release(ws, mark);
+    return sweeps;
+}
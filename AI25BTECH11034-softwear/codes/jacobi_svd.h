@@ -0,0 +1,30 @@
+#ifndef JACOBI_SVD_H
+#define JACOBI_SVD_H
+
+#include "matrix.h"
+#include "workspace.h"
+
+#define JACOBI_MAX_SWEEPS 60
+
+// One-sided (Hestenes) Jacobi SVD for tiles and the small dense solves at
+// the end of the iterative methods (up to a few hundred columns). Columns
+// are orthogonalized pairwise in parallel round-robin order: each round's
+// pairs are disjoint, so they rotate independently and threads split them.
+// Gives singular values to high relative accuracy.
+//
+// A is m×n and is not modified. With p = min(m, n), s receives the p
+// singular values in descending order and the columns of U (m×p) and V
+// (n×p) the matching vectors; U or V may be NULL when not wanted. Columns
+// of U for zero singular values are left zero. Returns the number of
+// sweeps, or 0 if scratch could not be allocated. When the columns are
+// still rotating after JACOBI_MAX_SWEEPS (NaN or inf in A) the outputs are
+// filled in anyway and the sweep count comes back negated, so callers
+// testing > 0 treat it as a failure. Scratch comes from ws
+// when given (and is released again before returning), else the heap, so
+// solvers calling this every restart allocate nothing in steady state.
+int jacobi_svd(const Matrix *A, double *s, Matrix *U, Matrix *V, Workspace *ws, int threads);
+
+// Scratch jacobi_svd takes for an m×n A
+size_t jacobi_svd_memory_bytes(int m, int n);
+
+#endif
@@ -1,128 +1,928 @@
 #include "lanczos.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include "blas1.h"
+#include "rng.h"
+#include "jacobi_svd.h"
+#include <float.h>
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
 
-SVDResult* lanczos_svd(Matrix *A, int k, int max_iter) {
+// Extra random columns carried by the warm-started block iteration
+#define WARM_OVERSAMPLE 8
+// Default Krylov subspace size for the thick-restart Lanczos method: k plus
+// this many, or twice k when that is larger
+#define KRYLOV_EXTRA 32
+// Matrix-vector products split across threads only above this many entries
+#define LANCZOS_PARALLEL_MIN (256 * 256)
+// Columns of the Lanczos bases rotated per strip at a restart
+#define LANCZOS_STRIP 256
+
+void svd_default_options(SVDOptions *opts) {
+    opts->power_iters = 100;
+    opts->tol = 1e-6;
+    opts->low_memory = 0;
+    opts->ws = NULL;
+    opts->start = NULL;
+    opts->seed = 0;
+    opts->threads = 1;
+    opts->verbose = 1;
+    opts->engine = SVD_ENGINE_AUTO;
+    opts->krylov_dim = 0;
+    opts->processes = 0;
+    opts->transport = SVD_TRANSPORT_SOCKET;
+}
+
+size_t lanczos_svd_memory_bytes(int m, int n, int k, int low_memory) {
+    // Result factors plus the scratch each variant keeps alive at its peak,
+    // with slack for the 64-byte alignment of every block
+    size_t bytes = sizeof(SVDResult) + (size_t)k * sizeof(double)
+                 + matrix_storage_bytes(m, k) + matrix_storage_bytes(n, k)
+                 + (size_t)(2 * n + m) * sizeof(double) + 8 * 64;
+    // Warm-started block iteration: V, Z (n×p), Y (m×p), two p×p matrices
+    // and the Jacobi solve of the p×p Gram matrix
+    int p = k + WARM_OVERSAMPLE;
+    bytes += 2 * matrix_storage_bytes(n, p) + matrix_storage_bytes(m, p)
+           + 2 * matrix_storage_bytes(p, p) + 2 * (size_t)p * sizeof(double)
+           + jacobi_svd_memory_bytes(p, p);
+    if (!low_memory) {
+        bytes += matrix_storage_bytes(n, m);        // At
+        bytes += 2 * matrix_storage_bytes(n, n);    // AtA, A_deflated
+    }
+    return bytes;
+}
+
+// Seeds v from the warm-start block when it has a usable column for this
+// index, otherwise from random noise.
+static void start_vector(double *v, int n, int sing_idx, const SVDOptions *opts,
+                         uint64_t *rng) {
+    const Matrix *start = opts->start;
+    if (start && start->rows == n && sing_idx < start->cols) {
+        for (int i = 0; i < n; i++) {
+            v[i] = start->data[i][sing_idx];
+        }
+        if (blas_normalize(v, n) > BLAS_NORMALIZE_MIN) return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        v[i] = rng_uniform(rng);
+    }
+    blas_normalize(v, n);
+}
+
+static void store_singular_triplet(Matrix *A, SVDResult *result, int sing_idx,
+                                   double eigenvalue, double *v, double *u) {
     int m = A->rows;
     int n = A->cols;
-    
-    if (k > n) k = n;
-    if (k > m) k = m;
-    
-    printf("Computing SVD using power iteration method (k=%d)...\n", k);
-    
-    SVDResult *result = (SVDResult*)malloc(sizeof(SVDResult));
-    result->k = k;
-    result->singular_values = (double*)malloc(k * sizeof(double));
-    result->U = create_matrix(m, k);
-    result->V = create_matrix(n, k);
-    
-    Matrix *AtA = create_matrix(n, n);
-    Matrix *At = create_matrix(n, m);
-    matrix_transpose(A, At);
-    
+
+    result->singular_values[sing_idx] = sqrt(fabs(eigenvalue));
+
     for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            AtA->data[i][j] = 0.0;
-            for (int l = 0; l < m; l++) {
-                AtA->data[i][j] += At->data[i][l] * A->data[l][j];
-            }
+        result->V->data[i][sing_idx] = v[i];
+    }
+
+    perf_phase_begin("left_vectors");
+    for (int i = 0; i < m; i++) {
+        u[i] = blas_dot(A->data[i], v, n);
+        if (result->singular_values[sing_idx] > 1e-10) {
+            u[i] /= result->singular_values[sing_idx];
         }
     }
-    
-    Matrix *A_deflated = copy_matrix(AtA);
-    
-    for (int sing_idx = 0; sing_idx < k; sing_idx++) {
-        double *v = (double*)malloc(n * sizeof(double));
-        double *v_new = (double*)malloc(n * sizeof(double));
-        
-        srand(time(NULL) + sing_idx);
-        for (int i = 0; i < n; i++) {
-            v[i] = (double)rand() / RAND_MAX - 0.5;
-        }
-        vector_normalize(v, n);
-        
-        for (int iter = 0; iter < 100; iter++) {
-            for (int i = 0; i < n; i++) {
-                v_new[i] = 0.0;
-                for (int j = 0; j < n; j++) {
-                    v_new[i] += A_deflated->data[i][j] * v[j];
-                }
-            }
-            
-            vector_normalize(v_new, n);
-            
-            double diff = 0.0;
-            for (int i = 0; i < n; i++) {
-                diff += (v_new[i] - v[i]) * (v_new[i] - v[i]);
-            }
-            
+
+    // Store U vector
+    for (int i = 0; i < m; i++) {
+        result->U->data[i][sing_idx] = u[i];
+    }
+    perf_phase_end("left_vectors", 2.0 * m * n + m, 8.0 * m * n + 24.0 * m);
+}
+
+typedef struct {
+    Matrix *A;
+    Matrix *At;
+    Matrix *AtA;
+} GramTask;
+
+// Rows [begin, end) of AᵀA; rows are independent, so threads split them
+static void gram_rows(void *arg, int begin, int end) {
+    GramTask *t = (GramTask*)arg;
+    int m = t->A->rows;
+    int n = t->A->cols;
+    const SimdKernels *kern = simd_kernels();
+    // Row i of AᵀA is Σ_l A[l][i] A[l], accumulated along the rows of A
+    for (int i = begin; i < end; i++) {
+        double *out = t->AtA->data[i];
+        memset(out, 0, n * sizeof(double));
+        for (int l = 0; l < m; l++) kern->axpy(out, t->At->data[i][l], t->A->data[l], n);
+    }
+}
+
+// Power iteration on an explicitly formed AᵀA with Hotelling deflation.
+static int power_iteration_gram(Matrix *A, SVDResult *result, const SVDOptions *opts,
+                                uint64_t *rng) {
+    int m = A->rows;
+    int n = A->cols;
+    int k = result->k;
+
+    Workspace *ws = opts->ws;
+    Matrix *AtA = scratch_matrix(ws, n, n);
+    Matrix *At = scratch_matrix(ws, n, m);
+    if (!AtA || !At) {
+        free_matrix(AtA);
+        free_matrix(At);
+        return 0;
+    }
+    matrix_transpose(A, At);
+
+    perf_phase_begin("gram");
+    GramTask task = { A, At, AtA };
+    parallel_for(opts->threads, n, gram_rows, &task);
+    perf_phase_end("gram", 2.0 * n * n * m, 16.0 * n * n * m);
+
+    Matrix *A_deflated = scratch_matrix(ws, n, n);
+    double *v = (double*)scratch_alloc(ws, n * sizeof(double));
+    double *v_new = (double*)scratch_alloc(ws, n * sizeof(double));
+    double *u = (double*)scratch_alloc(ws, m * sizeof(double));
+    int ok = A_deflated && v && v_new && u;
+    for (int i = 0; ok && i < n; i++) {
+        memcpy(A_deflated->data[i], AtA->data[i], n * sizeof(double));
+    }
+
+    for (int sing_idx = 0; ok && sing_idx < k; sing_idx++) {
+        start_vector(v, n, sing_idx, opts, rng);
+
+        perf_phase_begin("power_iteration");
+        int iters = 0;
+        for (int iter = 0; iter < opts->power_iters; iter++) {
+            iters++;
+            for (int i = 0; i < n; i++) v_new[i] = blas_dot(A_deflated->data[i], v, n);
+            double diff = blas_normalize_diff(v_new, v, n);
             memcpy(v, v_new, n * sizeof(double));
-            
-            if (sqrt(diff) < 1e-6) break;
+            if (diff < opts->tol) break;
         }
-        
+        result->iterations += iters;
+        perf_phase_end("power_iteration", iters * (2.0 * n * n + 6.0 * n),
+                       iters * (8.0 * n * n + 48.0 * n));
+
+        perf_phase_begin("rayleigh");
         double eigenvalue = 0.0;
+        for (int i = 0; i < n; i++) eigenvalue += v[i] * blas_dot(A_deflated->data[i], v, n);
+        perf_phase_end("rayleigh", 2.0 * n * n + 2.0 * n, 8.0 * n * n + 16.0 * n);
+
+        store_singular_triplet(A, result, sing_idx, eigenvalue, v, u);
+
+        // Deflate: A_deflated = A_deflated - eigenvalue * v * v^T
+        perf_phase_begin("deflation");
+        for (int i = 0; i < n; i++) blas_axpy(A_deflated->data[i], -eigenvalue * v[i], v, n);
+        perf_phase_end("deflation", 3.0 * n * n, 16.0 * n * n);
+    }
+
+    scratch_free(ws, u);
+    scratch_free(ws, v);
+    scratch_free(ws, v_new);
+    free_matrix(AtA);
+    free_matrix(At);
+    free_matrix(A_deflated);
+    return ok;
+}
+
+// Same iteration as power_iteration_gram, but applies the deflated operator
+// AᵀA - Σ λ_j v_j v_jᵀ as Aᵀ(A v) minus the stored triplets, so only O(m + n)
+// scratch is needed instead of three n×n / n×m matrices.
+static double deflated_gram_apply(Matrix *A, SVDResult *result, int num_found,
+                                  double *v, double *w, double *out) {
+    int m = A->rows;
+    int n = A->cols;
+
+    for (int i = 0; i < m; i++) w[i] = blas_dot(A->data[i], v, n);
+    memset(out, 0, n * sizeof(double));
+    for (int i = 0; i < m; i++) blas_axpy(out, w[i], A->data[i], n);
+
+    double rayleigh = blas_dot(w, w, m);
+    for (int l = 0; l < num_found; l++) {
+        double lambda = result->singular_values[l] * result->singular_values[l];
+        double proj = 0.0;
+        for (int j = 0; j < n; j++) proj += result->V->data[j][l] * v[j];
+        for (int j = 0; j < n; j++) out[j] -= lambda * proj * result->V->data[j][l];
+        rayleigh -= lambda * proj * proj;
+    }
+    return rayleigh;
+}
+
+static int power_iteration_matrix_free(Matrix *A, SVDResult *result, const SVDOptions *opts,
+                                       uint64_t *rng) {
+    int m = A->rows;
+    int n = A->cols;
+    int k = result->k;
+
+    Workspace *ws = opts->ws;
+    double *v = (double*)scratch_alloc(ws, n * sizeof(double));
+    double *v_new = (double*)scratch_alloc(ws, n * sizeof(double));
+    double *w = (double*)scratch_alloc(ws, m * sizeof(double));
+    int ok = v && v_new && w;
+
+    for (int sing_idx = 0; ok && sing_idx < k; sing_idx++) {
+        start_vector(v, n, sing_idx, opts, rng);
+
+        perf_phase_begin("power_iteration");
+        int iters = 0;
+        for (int iter = 0; iter < opts->power_iters; iter++) {
+            iters++;
+            deflated_gram_apply(A, result, sing_idx, v, w, v_new);
+            double diff = blas_normalize_diff(v_new, v, n);
+            memcpy(v, v_new, n * sizeof(double));
+            if (diff < opts->tol) break;
+        }
+        result->iterations += iters;
+        perf_phase_end("power_iteration", iters * (4.0 * m * n + 4.0 * n * sing_idx),
+                       iters * (16.0 * m * n + 24.0 * n * sing_idx));
+
+        perf_phase_begin("rayleigh");
+        double eigenvalue = deflated_gram_apply(A, result, sing_idx, v, w, v_new);
+        perf_phase_end("rayleigh", 4.0 * m * n + 4.0 * n * sing_idx,
+                       16.0 * m * n + 24.0 * n * sing_idx);
+
+        store_singular_triplet(A, result, sing_idx, eigenvalue, v, w);
+    }
+
+    scratch_free(ws, v);
+    scratch_free(ws, v_new);
+    scratch_free(ws, w);
+    return ok;
+}
+
+// Block subspace iteration with Rayleigh-Ritz, seeded with the warm-start
+// vectors plus a few random oversampling columns. Starting close to the
+// answer it converges in a handful of block iterations, each costing two
+// passes over A.
+
+// C = B W for the p×p matrix W, one row at a time through row scratch
+static void rotate_rows(Matrix *B, Matrix *W, double *row) {
+    int p = W->rows;
+    for (int i = 0; i < B->rows; i++) {
+        memset(row, 0, p * sizeof(double));
+        for (int j = 0; j < p; j++) blas_axpy(row, B->data[i][j], W->data[j], p);
+        memcpy(B->data[i], row, p * sizeof(double));
+    }
+}
+
+static int subspace_iteration_warm(Matrix *A, SVDResult *result, const SVDOptions *opts,
+                                   uint64_t *rng) {
+    int m = A->rows;
+    int n = A->cols;
+    int k = result->k;
+    int p = k + WARM_OVERSAMPLE;
+    if (p > n) p = n;
+    if (p > m) p = m;
+
+    Workspace *ws = opts->ws;
+    Matrix *V = scratch_matrix(ws, n, p);
+    Matrix *Z = scratch_matrix(ws, n, p);
+    Matrix *Y = scratch_matrix(ws, m, p);
+    Matrix *H = scratch_matrix(ws, p, p);
+    Matrix *W = scratch_matrix(ws, p, p);
+    double *lambda = (double*)scratch_alloc(ws, p * sizeof(double));
+    double *row = (double*)scratch_alloc(ws, p * sizeof(double));
+    int ok = V && Z && Y && H && W && lambda && row;
+    int converged = 0;
+
+    if (ok) {
+        const Matrix *start = opts->start;
         for (int i = 0; i < n; i++) {
-            double sum = 0.0;
-            for (int j = 0; j < n; j++) {
-                sum += A_deflated->data[i][j] * v[j];
+            for (int l = 0; l < p; l++) {
+                V->data[i][l] = (l < start->cols) ? start->data[i][l] : rng_uniform(rng);
             }
-            eigenvalue += v[i] * sum;
         }
-        
-        result->singular_values[sing_idx] = sqrt(fabs(eigenvalue));
-        
-        for (int i = 0; i < n; i++) {
-            result->V->data[i][sing_idx] = v[i];
+        ok = block_orthonormalize(V, NULL, opts->threads);
+    }
+
+    for (int iter = 0; ok && iter < opts->power_iters; iter++) {
+        result->iterations++;
+
+        // Y = A V and H = YᵀY = Vᵀ AᵀA V
+        perf_phase_begin("power_iteration");
+        for (int i = 0; i < m; i++) {
+            double *y = Y->data[i];
+            memset(y, 0, p * sizeof(double));
+            for (int j = 0; j < n; j++) blas_axpy(y, A->data[i][j], V->data[j], p);
+        }
+        // Upper triangle accumulated a row of Y at a time, then mirrored
+        for (int a = 0; a < p; a++) memset(H->data[a], 0, p * sizeof(double));
+        for (int i = 0; i < m; i++) {
+            const double *y = Y->data[i];
+            for (int a = 0; a < p; a++) blas_axpy(H->data[a] + a, y[a], y + a, p - a);
+        }
+        for (int a = 0; a < p; a++) {
+            for (int b = a + 1; b < p; b++) H->data[b][a] = H->data[a][b];
         }
-        
-        double *u = (double*)malloc(m * sizeof(double));
+        perf_phase_end("power_iteration", 2.0 * m * n * p + m * p * p,
+                       8.0 * m * n + 16.0 * m * n * p + 8.0 * m * p * p);
+
+        // Rayleigh-Ritz: rotate V and Y = AV onto the Ritz vectors
+        perf_phase_begin("rayleigh");
+        // H is symmetric positive semidefinite, so its SVD is its
+        // eigendecomposition: lambda descending, eigenvectors in W
+        ok = jacobi_svd(H, lambda, NULL, W, ws, 1) > 0;
+        if (!ok) {
+            perf_phase_end("rayleigh", 0.0, 0.0);
+            break;
+        }
+        rotate_rows(V, W, row);
+        rotate_rows(Y, W, row);
+        perf_phase_end("rayleigh", 2.0 * (m + n) * p * p, 16.0 * (m + n) * p * p);
+
+        // Z = AᵀY = AᵀA V; Z - V Λ is the residual and Z the next iterate
+        perf_phase_begin("back_projection");
+        for (int j = 0; j < n; j++) memset(Z->data[j], 0, p * sizeof(double));
         for (int i = 0; i < m; i++) {
-            u[i] = 0.0;
+            for (int j = 0; j < n; j++) blas_axpy(Z->data[j], A->data[i][j], Y->data[i], p);
+        }
+        double max_residual = 0.0;
+        for (int l = 0; l < k; l++) {
+            double res = 0.0;
             for (int j = 0; j < n; j++) {
-                u[i] += A->data[i][j] * v[j];
+                double d = Z->data[j][l] - lambda[l] * V->data[j][l];
+                res += d * d;
             }
-            if (result->singular_values[sing_idx] > 1e-10) {
-                u[i] /= result->singular_values[sing_idx];
+            if (res > max_residual) max_residual = res;
+        }
+        perf_phase_end("back_projection", 2.0 * m * n * p + 3.0 * n * k,
+                       8.0 * m * n + 16.0 * m * n * p);
+
+        if (sqrt(max_residual) <= opts->tol * fabs(lambda[0])) {
+            converged = 1;
+            break;
+        }
+
+        for (int j = 0; j < n; j++) {
+            memcpy(V->data[j], Z->data[j], p * sizeof(double));
+        }
+        perf_phase_begin("orthonormalize");
+        ok = block_orthonormalize(V, NULL, opts->threads);
+        perf_phase_end("orthonormalize", 4.0 * n * p * p, 32.0 * n * p);
+    }
+
+    if (ok) {
+        perf_phase_begin("left_vectors");
+        for (int l = 0; l < k; l++) {
+            double sigma = sqrt(fabs(lambda[l]));
+            result->singular_values[l] = sigma;
+            for (int j = 0; j < n; j++) result->V->data[j][l] = V->data[j][l];
+            for (int i = 0; i < m; i++) {
+                result->U->data[i][l] = sigma > 1e-10 ? Y->data[i][l] / sigma : Y->data[i][l];
             }
         }
-        
-        // Store U vector
-        for (int i = 0; i < m; i++) {
-            result->U->data[i][sing_idx] = u[i];
+        perf_phase_end("left_vectors", 1.0 * m * k, 16.0 * (m + n) * k);
+        if (!converged && opts->verbose) {
+            printf("Warning: warm-started iteration stopped after %d block iterations\n",
+                   result->iterations);
         }
-        
-        // Deflate: A_deflated = A_deflated - eigenvalue * v * v^T
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                A_deflated->data[i][j] -= eigenvalue * v[i] * v[j];
+    }
+
+    scratch_free(ws, row);
+    scratch_free(ws, lambda);
+    free_matrix(W);
+    free_matrix(H);
+    free_matrix(Y);
+    free_matrix(Z);
+    free_matrix(V);
+    return ok;
+}
+
+// Thick-restart Lanczos bidiagonalization. Golub-Kahan steps build
+// orthonormal bases V (n×d) and U (m×d) with A V = U B for a small upper
+// triangular B, full reorthogonalization keeping both bases orthonormal.
+// At each restart B's SVD gives Ritz triplets whose residuals come for free
+// from the last Lanczos coefficient; the leading ones that have converged
+// are locked (their coupling to the rest is dropped and they are never
+// rotated again), the best unconverged ones are kept to seed the next
+// cycle, and the rest are purged. Memory stays at (m + n)·d. A wide A is
+// bidiagonalized as Aᵀ, so the V basis always lives on the shorter side.
+// When d reaches min(m, n) - 1 restarting cannot keep the Ritz vectors, and
+// the Krylov space would span everything anyway: a direct Jacobi SVD of A
+// is exact and cheaper.
+
+static int krylov_dim(int k, int p, int requested) {
+    int d = requested > 0 ? requested : (2 * k > k + KRYLOV_EXTRA ? 2 * k : k + KRYLOV_EXTRA);
+    // Room for at least one new Lanczos vector per cycle
+    if (d < k + 2) d = k + 2;
+    return d < p ? d : p;
+}
+
+static int lanczos_direct(int m, int n, int k, int krylov) {
+    int p = m < n ? m : n;
+    return krylov_dim(k, p, krylov) >= p - 1;
+}
+
+size_t lanczos_restarted_memory_bytes(int m, int n, int k, int krylov) {
+    int p = m < n ? m : n;
+    int d = krylov_dim(k, p, krylov);
+    size_t bytes = sizeof(SVDResult) + (size_t)k * sizeof(double)
+                 + matrix_storage_bytes(m, k) + matrix_storage_bytes(n, k) + 10 * 64;
+    if (lanczos_direct(m, n, k, krylov)) {
+        // All p triplets, plus the Jacobi working copy and rotations
+        return bytes + matrix_storage_bytes(m, p) + matrix_storage_bytes(n, p)
+             + (size_t)p * sizeof(double) + jacobi_svd_memory_bytes(m, n);
+    }
+    return bytes + matrix_storage_bytes(d + 1, p) + matrix_storage_bytes(d, m + n - p)
+         + 4 * matrix_storage_bytes(d, d) + jacobi_svd_memory_bytes(d, d)
+         + (size_t)(2 * d + d * LANCZOS_STRIP) * sizeof(double);
+}
+
+typedef struct {
+    const Matrix *A;
+    const double *x;
+    double *y;
+} MatVecTask;
+
+static void av_rows(void *arg, int begin, int end) {
+    MatVecTask *t = (MatVecTask*)arg;
+    for (int i = begin; i < end; i++) t->y[i] = blas_dot(t->A->data[i], t->x, t->A->cols);
+}
+
+// y[begin..end) of Aᵀx, still walking A along its rows
+static void atx_cols(void *arg, int begin, int end) {
+    MatVecTask *t = (MatVecTask*)arg;
+    int len = end - begin;
+    double *y = t->y + begin;
+    const SimdKernels *kern = simd_kernels();
+    memset(y, 0, len * sizeof(double));
+    for (int i = 0; i < t->A->rows; i++) {
+        double a = t->x[i];
+        if (a == 0.0) continue;
+        kern->axpy(y, a, t->A->data[i] + begin, len);
+    }
+}
+
+static void apply_a(const Matrix *A, const double *v, double *u, int threads) {
+    MatVecTask task = { A, v, u };
+    if ((long)A->rows * A->cols < LANCZOS_PARALLEL_MIN) threads = 1;
+    parallel_for(threads, A->rows, av_rows, &task);
+}
+
+static void apply_at(const Matrix *A, const double *u, double *v, int threads) {
+    MatVecTask task = { A, u, v };
+    if ((long)A->rows * A->cols < LANCZOS_PARALLEL_MIN) threads = 1;
+    parallel_for(threads, A->cols, atx_cols, &task);
+}
+
+// w -= Q Qᵀ w over the first count rows of Q, twice (classical Gram-Schmidt
+// with one reorthogonalization); the projections are added to coef. Returns
+// ‖w‖₂ afterwards, taken in the same pass as the last update.
+static double project_out(Matrix *Q, int count, double *w, double *coef) {
+    int len = Q->cols;
+    double norm = -1.0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < count; i++) {
+            double c = blas_dot(Q->data[i], w, len);
+            if (pass == 1 && i == count - 1) {
+                norm = blas_axpy_nrm2(w, -c, Q->data[i], len);
+            } else {
+                blas_axpy(w, -c, Q->data[i], len);
             }
+            if (coef) coef[i] += c;
         }
-        
-        free(u);
-        free(v);
-        free(v_new);
     }
-    
+    return norm < 0.0 ? blas_nrm2(w, len) : norm;
+}
+
+// Normalizes w, whose norm is given, and returns that norm. When w has all
+// but vanished (the Krylov space became invariant) a random direction
+// orthogonal to the first count rows of Q takes its place and 0 is
+// returned; if even that fails the space is exhausted and w is left zero.
+static double normalize_or_replace(Matrix *Q, int count, double *w, double norm, double scale,
+                                   uint64_t *rng) {
+    int len = Q->cols;
+    if (norm > 1e-12 * scale) {
+        blas_scal(w, 1.0 / norm, len);
+        return norm;
+    }
+    for (int attempt = 0; attempt < 3; attempt++) {
+        for (int j = 0; j < len; j++) w[j] = rng_uniform(rng);
+        double r = project_out(Q, count, w, NULL);
+        if (r > 1e-6) {
+            blas_scal(w, 1.0 / r, len);
+            return 0.0;
+        }
+    }
+    memset(w, 0, len * sizeof(double));
+    return 0.0;
+}
+
+// Rows [from, from + a) of Q become their combinations by the first cols
+// columns of W (a×cols), rotated in column strips through scratch
+static void rotate_basis(Matrix *Q, int from, const Matrix *W, int a, int cols, double *strip) {
+    int len = Q->cols;
+    const SimdKernels *kern = simd_kernels();
+    for (int c0 = 0; c0 < len; c0 += LANCZOS_STRIP) {
+        int w = len - c0 < LANCZOS_STRIP ? len - c0 : LANCZOS_STRIP;
+        for (int c = 0; c < cols; c++) {
+            double *out = strip + (size_t)c * LANCZOS_STRIP;
+            memset(out, 0, w * sizeof(double));
+            for (int r = 0; r < a; r++) {
+                double x = W->data[r][c];
+                if (x == 0.0) continue;
+                kern->axpy(out, x, Q->data[from + r] + c0, w);
+            }
+        }
+        for (int c = 0; c < cols; c++) {
+            memcpy(Q->data[from + c] + c0, strip + (size_t)c * LANCZOS_STRIP, w * sizeof(double));
+        }
+    }
+}
+
+// All min(m, n) triplets by Jacobi, of which the leading k are kept
+static int direct_svd(Matrix *A, SVDResult *result, const SVDOptions *opts) {
+    int m = A->rows;
+    int n = A->cols;
+    int p = m < n ? m : n;
+    int k = result->k;
+    Workspace *ws = opts->ws;
+    Matrix *U = scratch_matrix(ws, m, p);
+    Matrix *V = scratch_matrix(ws, n, p);
+    double *s = (double*)scratch_alloc(ws, p * sizeof(double));
+    int ok = U && V && s && jacobi_svd(A, s, U, V, ws, opts->threads) > 0;
+    if (ok) {
+        memcpy(result->singular_values, s, k * sizeof(double));
+        for (int i = 0; i < m; i++) memcpy(result->U->data[i], U->data[i], k * sizeof(double));
+        for (int j = 0; j < n; j++) memcpy(result->V->data[j], V->data[j], k * sizeof(double));
+    }
+    scratch_free(ws, s);
+    free_matrix(V);
+    free_matrix(U);
+    return ok;
+}
+
+static int thick_restart_lanczos(Matrix *A, SVDResult *result, const SVDOptions *opts,
+                                 uint64_t *rng) {
+    // Golub-Kahan on Aᵀ when A is wide: "rows" is the length of the U basis
+    int wide = A->rows < A->cols;
+    int m = wide ? A->cols : A->rows;
+    int n = wide ? A->rows : A->cols;
+    void (*forward)(const Matrix*, const double*, double*, int) = wide ? apply_at : apply_a;
+    void (*backward)(const Matrix*, const double*, double*, int) = wide ? apply_a : apply_at;
+    int k = result->k;
+    int d = krylov_dim(k, n, opts->krylov_dim);
+    int threads = opts->threads;
+
+    Workspace *ws = opts->ws;
+    Matrix *Vt = scratch_matrix(ws, d + 1, n);     // basis vectors as rows
+    Matrix *Ut = scratch_matrix(ws, d, m);
+    Matrix *B = scratch_matrix(ws, d, d);
+    Matrix *Bs = scratch_matrix(ws, d, d);
+    Matrix *X = scratch_matrix(ws, d, d);
+    Matrix *Y = scratch_matrix(ws, d, d);
+    double *s = (double*)scratch_alloc(ws, d * sizeof(double));
+    double *coef = (double*)scratch_alloc(ws, d * sizeof(double));
+    double *strip = (double*)scratch_alloc(ws, (size_t)d * LANCZOS_STRIP * sizeof(double));
+    int ok = Vt && Ut && B && Bs && X && Y && s && coef && strip;
+
+    int l = 0;                  // basis vectors carried into this cycle
+    int locked = 0;             // leading triplets that have converged
+    int want = k;               // active triplets still wanted
+    int converged = 0;
+    double beta = 0.0;
+    double scale = 0.0;         // largest Ritz value so far
+    if (ok) {
+        for (int i = 0; i < d; i++) memset(B->data[i], 0, d * sizeof(double));
+        for (int j = 0; j < n; j++) Vt->data[0][j] = rng_uniform(rng);
+        blas_normalize(Vt->data[0], n);
+    }
+
+    for (int cycle = 0; ok && cycle < opts->power_iters; cycle++) {
+        perf_phase_begin("lanczos");
+        for (int j = l; j < d; j++) {
+            double *u = Ut->data[j];
+            forward(A, Vt->data[j], u, threads);
+            memset(coef, 0, j * sizeof(double));
+            double norm = project_out(Ut, j, u, coef);
+            for (int i = locked; i < j; i++) B->data[i][j] = coef[i];
+            B->data[j][j] = normalize_or_replace(Ut, j, u, norm, scale, rng);
+
+            double *v = Vt->data[j + 1];
+            backward(A, u, v, threads);
+            norm = project_out(Vt, j + 1, v, NULL);
+            beta = normalize_or_replace(Vt, j + 1, v, norm, scale, rng);
+            result->iterations++;
+        }
+        perf_phase_end("lanczos", 4.0 * m * n * (d - l) + 8.0 * (m + n) * (d + l) * (d - l) / 2.0,
+                       16.0 * m * n * (d - l));
+
+        // SVD of the active block B[locked:, locked:] = Y Σ Xᵀ
+        perf_phase_begin("restart");
+        int a = d - locked;
+        for (int i = 0; i < a; i++) memcpy(Bs->data[i], B->data[locked + i] + locked, a * sizeof(double));
+        Matrix Bv = { a, a, Bs->data, NULL, 1 };
+        Matrix Xv = { a, a, X->data, NULL, 1 };
+        Matrix Yv = { a, a, Y->data, NULL, 1 };
+        ok = jacobi_svd(&Bv, s, &Yv, &Xv, ws, 1) > 0;
+        if (!ok) {
+            perf_phase_end("restart", 0.0, 0.0);
+            break;
+        }
+        if (s[0] > scale) scale = s[0];
+
+        // Aᵀ u_i - σ_i v_i = beta y_i[a-1] v_d for Ritz triplet i
+        int fresh = 0;
+        while (fresh < want && fabs(beta * Y->data[a - 1][fresh]) <= opts->tol * scale) fresh++;
+        converged = fresh == want;
+
+        // Keep the wanted triplets plus half the spare room; lock the newly
+        // converged leading ones; the residual vector follows them
+        int keep = converged ? want : k + (d - k) / 2 - locked;
+        if (locked + keep > d - 1 && !converged) keep = d - 1 - locked;
+        rotate_basis(Vt, locked, X, a, keep, strip);
+        rotate_basis(Ut, locked, Y, a, keep, strip);
+        for (int i = 0; i < keep; i++) {
+            memset(B->data[locked + i], 0, d * sizeof(double));
+            B->data[locked + i][locked + i] = s[i];
+        }
+        perf_phase_end("restart", 2.0 * (m + n) * a * keep + 20.0 * a * a * a,
+                       16.0 * (m + n) * a * keep);
+        if (converged) break;
+
+        l = locked + keep;
+        memcpy(Vt->data[l], Vt->data[d], n * sizeof(double));
+        locked += fresh;
+        want -= fresh;
+    }
+
+    if (ok) {
+        // The first k basis vectors hold the triplets; sort them by σ
+        int *order = (int*)coef;
+        for (int i = 0; i < k; i++) {
+            int p = i - 1;
+            while (p >= 0 && B->data[order[p]][order[p]] < B->data[i][i]) {
+                order[p + 1] = order[p];
+                p--;
+            }
+            order[p + 1] = i;
+        }
+        Matrix *left = wide ? result->V : result->U;
+        Matrix *right = wide ? result->U : result->V;
+        for (int l2 = 0; l2 < k; l2++) {
+            int src = order[l2];
+            result->singular_values[l2] = B->data[src][src];
+            for (int j = 0; j < n; j++) right->data[j][l2] = Vt->data[src][j];
+            for (int i = 0; i < m; i++) left->data[i][l2] = Ut->data[src][i];
+        }
+        if (!converged && opts->verbose) {
+            printf("Warning: Lanczos stopped after %d restarts with %d of %d triplets converged\n",
+                   opts->power_iters, locked, k);
+        }
+    }
+
+    scratch_free(ws, strip);
+    scratch_free(ws, coef);
+    scratch_free(ws, s);
+    free_matrix(Y);
+    free_matrix(X);
+    free_matrix(Bs);
+    free_matrix(B);
+    free_matrix(Ut);
+    free_matrix(Vt);
+    return ok;
+}
+
+SVDResult* lanczos_restarted_svd(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows;
+    int n = A->cols;
+    if (k > n) k = n;
+    if (k > m) k = m;
+
+    Workspace *ws = opts->ws;
+    size_t bytes = lanczos_restarted_memory_bytes(m, n, k, opts->krylov_dim);
+    if (!(ws ? workspace_available(ws) >= bytes : mem_would_fit(bytes))) {
+        fprintf(stderr, "Error: SVD needs at least %.2f MB, exceeding the memory limit\n",
+                bytes / 1048576.0);
+        return NULL;
+    }
+    int direct = lanczos_direct(m, n, k, opts->krylov_dim);
+    if (opts->verbose && direct) {
+        printf("Computing SVD using Jacobi (k=%d leaves no room to restart on %dx%d)...\n", k, m, n);
+    } else if (opts->verbose) {
+        printf("Computing SVD using thick-restart Lanczos bidiagonalization (k=%d, subspace %d)...\n",
+               k, krylov_dim(k, m < n ? m : n, opts->krylov_dim));
+    }
+
+    SVDResult *result = create_svd_result(ws, m, n, k);
+    if (!result) return NULL;
+    size_t mark = ws ? workspace_mark(ws) : 0;
+    uint64_t rng = rng_seed(opts->seed);
+    int ok = direct ? direct_svd(A, result, opts) : thick_restart_lanczos(A, result, opts, &rng);
+    if (ws) workspace_release(ws, mark);
+    if (!ok) {
+        free_svd_result(result);
+        return NULL;
+    }
+
+    if (opts->verbose) svd_print_summary(result);
+    return result;
+}
+
+// max_iter caps the Krylov subspace, so memory stays at (m + n)·max_iter
+SVDResult* lanczos_svd(Matrix *A, int k, int max_iter) {
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_LANCZOS;
+    opts.krylov_dim = max_iter;
+    return lanczos_restarted_svd(A, k, &opts);
+}
+
+SVDResult* lanczos_svd_opts(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows;
+    int n = A->cols;
+
+    if (k > n) k = n;
+    if (k > m) k = m;
+
+    // A workspace was sized up front, so it is the budget to check against
+    Workspace *ws = opts->ws;
+    size_t gram_bytes = lanczos_svd_memory_bytes(m, n, k, 0);
+    size_t free_bytes = lanczos_svd_memory_bytes(m, n, k, 1);
+    // A warm start never forms AᵀA: each block iteration costs O(mnk)
+    // against the O(mn²) Gram build.
+    int low_memory = opts->low_memory || opts->start;
+    if (!low_memory && !(ws ? workspace_available(ws) >= gram_bytes : mem_would_fit(gram_bytes))) {
+        if (!(ws ? workspace_available(ws) >= free_bytes : mem_would_fit(free_bytes))) {
+            fprintf(stderr, "Error: SVD needs at least %.2f MB, exceeding the memory limit\n",
+                    free_bytes / 1048576.0);
+            return NULL;
+        }
+        if (opts->verbose) {
+            printf("AᵀA does not fit in the memory limit, using matrix-free iteration\n");
+        }
+        low_memory = 1;
+    }
+
+    if (opts->verbose) {
+        if (opts->start) {
+            printf("Computing SVD using warm-started subspace iteration (k=%d)...\n", k);
+        } else {
+            printf("Computing SVD using %s power iteration method (k=%d)...\n",
+                   low_memory ? "matrix-free" : "AᵀA", k);
+        }
+    }
+
+    // With a workspace the result lives there too; scratch above it is
+    // rewound once the triplets are computed
+    SVDResult *result = create_svd_result(ws, m, n, k);
+    if (!result) return NULL;
+    size_t mark = ws ? workspace_mark(ws) : 0;
+
+    uint64_t rng = rng_seed(opts->seed);
+    int ok;
+    if (opts->start) {
+        ok = subspace_iteration_warm(A, result, opts, &rng);
+    } else {
+        ok = low_memory ? power_iteration_matrix_free(A, result, opts, &rng)
+                        : power_iteration_gram(A, result, opts, &rng);
+    }
+    if (ws) workspace_release(ws, mark);
+    if (!ok) {
+        free_svd_result(result);
+        return NULL;
+    }
+
+    if (opts->verbose) svd_print_summary(result);
+
+    return result;
+}
+
+SVDResult* create_svd_result(Workspace *ws, int m, int n, int k) {
+    SVDResult *result = (SVDResult*)scratch_alloc(ws, sizeof(SVDResult));
+    if (!result) return NULL;
+    result->k = k;
+    result->from_workspace = ws != NULL;
+    result->iterations = 0;
+    result->singular_values = (double*)scratch_alloc(ws, k * sizeof(double));
+    result->U = scratch_matrix(ws, m, k);
+    result->V = scratch_matrix(ws, n, k);
+    if (!result->singular_values || !result->U || !result->V) {
+        free_svd_result(result);
+        return NULL;
+    }
+    return result;
+}
+
+void svd_print_summary(const SVDResult *svd) {
+    int k = svd->k;
     printf("SVD computation complete. Top %d singular values:\n", k < 5 ? k : 5);
     for (int i = 0; i < k && i < 5; i++) {
-        printf("  σ[%d] = %.4f\n", i, result->singular_values[i]);
+        printf("  σ[%d] = %.4f\n", i, svd->singular_values[i]);
     }
-    
-    // Cleanup
-    free_matrix(AtA);
-    free_matrix(At);
-    free_matrix(A_deflated);
-    
-    return result;
+}
+
+// Heap copy of svd, e.g. to keep factors computed inside a Workspace
+SVDResult* copy_svd_result(const SVDResult *svd) {
+    int m = svd->U->rows;
+    int n = svd->V->rows;
+    SVDResult *copy = create_svd_result(NULL, m, n, svd->k);
+    if (!copy) return NULL;
+    copy->iterations = svd->iterations;
+    memcpy(copy->singular_values, svd->singular_values, svd->k * sizeof(double));
+    for (int i = 0; i < m; i++) {
+        memcpy(copy->U->data[i], svd->U->data[i], svd->k * sizeof(double));
+    }
+    for (int j = 0; j < n; j++) {
+        memcpy(copy->V->data[j], svd->V->data[j], svd->k * sizeof(double));
+    }
+    return copy;
 }
 
 void free_svd_result(SVDResult *svd) {
-    if (!svd) return;
-    free(svd->singular_values);
+    if (!svd || svd->from_workspace) return;
+    mem_free(svd->singular_values);
     free_matrix(svd->U);
     free_matrix(svd->V);
-    free(svd);
-}
\ No newline at end of file
+    mem_free(svd);
+}
+
+// Implicit QL with Wilkinson shifts on the symmetric tridiagonal matrix with
+// diagonal alpha[0..n) and off-diagonal beta[0..n-1), which are left intact.
+// Eigenvalues come out descending; eigenvectors, when not NULL, is an n×n
+// row-pointer array that receives the matching eigenvectors as columns.
+void compute_tridiagonal_eigenvalues(double *alpha, double *beta, int n,
+                                     double *eigenvalues, double **eigenvectors) {
+    double *d = eigenvalues;
+    double **z = eigenvectors;
+    double *e = (double*)mem_alloc(n * sizeof(double));
+    if (!e) {
+        fprintf(stderr, "Error: Cannot allocate tridiagonal eigensolver scratch\n");
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        d[i] = alpha[i];
+        e[i] = i < n - 1 ? beta[i] : 0.0;
+        if (z) {
+            for (int j = 0; j < n; j++) z[i][j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+
+    for (int l = 0; l < n; l++) {
+        int iter = 0;
+        int m;
+        do {
+            // Look for a negligible off-diagonal element to split at
+            for (m = l; m < n - 1; m++) {
+                if (fabs(e[m]) <= DBL_EPSILON * (fabs(d[m]) + fabs(d[m + 1]))) break;
+            }
+            if (m == l || iter++ == 60) break;
+
+            double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+            double r = hypot(g, 1.0);
+            g = d[m] - d[l] + e[l] / (g + copysign(r, g));
+            double s = 1.0, c = 1.0, p = 0.0;
+            int i;
+            for (i = m - 1; i >= l; i--) {
+                double f = s * e[i];
+                double b = c * e[i];
+                r = hypot(f, g);
+                e[i + 1] = r;
+                if (r == 0.0) {
+                    // Underflow: the matrix split, restart from l
+                    d[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2.0 * c * b;
+                p = s * r;
+                d[i + 1] = g + p;
+                g = c * r - b;
+                if (z) {
+                    for (int k = 0; k < n; k++) {
+                        f = z[k][i + 1];
+                        z[k][i + 1] = s * z[k][i] + c * f;
+                        z[k][i] = c * z[k][i] - s * f;
+                    }
+                }
+            }
+            if (r == 0.0 && i >= l) continue;
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0.0;
+        } while (m != l);
+    }
+
+    // Selection sort, descending, swapping eigenvector columns along
+    for (int i = 0; i < n; i++) {
+        int best = i;
+        for (int j = i + 1; j < n; j++) {
+            if (d[j] > d[best]) best = j;
+        }
+        if (best == i) continue;
+        double tmp = d[i];
+        d[i] = d[best];
+        d[best] = tmp;
+        for (int r = 0; z && r < n; r++) {
+            tmp = z[r][i];
+            z[r][i] = z[r][best];
+            z[r][best] = tmp;
+        }
+    }
+    mem_free(e);
+}
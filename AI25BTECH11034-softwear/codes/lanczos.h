@@ -1,17 +1,61 @@
 #ifndef LANCZOS_H
 #define LANCZOS_H
 
+#include <stdint.h>
 #include "matrix.h"
+#include "workspace.h"
 
 typedef struct {
     int k;                  
     double *singular_values; 
     Matrix *U;              
     Matrix *V;             
+    int from_workspace;     // allocated from a Workspace; free_svd_result is a no-op
+    int iterations;         // power iterations spent over all k vectors
 } SVDResult;
 
+typedef enum {
+    SVD_ENGINE_AUTO,        // pick by rank fraction and memory (svd_compute)
+    SVD_ENGINE_POWER,       // deflated power iteration / warm subspace iteration
+    SVD_ENGINE_DENSE,       // Householder bidiagonalization + divide and conquer
+    SVD_ENGINE_QR,          // TSQR first, then either of the above on the R factor
+    SVD_ENGINE_LANCZOS,     // thick-restart Lanczos bidiagonalization
+    SVD_ENGINE_RRQR,        // column-pivoted QR (approximate, never chosen by AUTO)
+    SVD_ENGINE_CUR,         // CUR / interpolative decomposition (approximate, never chosen by AUTO)
+    SVD_ENGINE_DISTRIBUTED  // randomized subspace iteration over row shards in several processes
+} SVDEngine;
+
+typedef enum {
+    SVD_TRANSPORT_SOCKET,   // UNIX socket pairs (dist_transport.h)
+    SVD_TRANSPORT_SHM       // mailboxes in a shared mapping
+} SVDTransport;
+
+typedef struct {
+    int power_iters;        // iteration cap per singular value
+    double tol;             // stop when ||v_new - v|| drops below this
+    int low_memory;         // iterate on A directly instead of forming AᵀA
+    Workspace *ws;          // scratch and result storage; NULL uses the heap
+    const Matrix *start;    // n×j warm-start vectors (column i seeds vector i)
+    uint64_t seed;          // random start vectors; 0 seeds from the clock
+    int threads;            // threads for the AᵀA build; 1 runs on the caller
+    int verbose;            // progress messages on stdout
+    SVDEngine engine;       // solver used by svd_compute
+    int krylov_dim;         // Lanczos subspace cap; 0 picks max(2k, k + 32)
+    int processes;          // distributed engine: processes sharing the rows; 0 = one per CPU
+    SVDTransport transport; // distributed engine: how those processes talk
+} SVDOptions;
+
+void svd_default_options(SVDOptions *opts);
+size_t lanczos_svd_memory_bytes(int m, int n, int k, int low_memory);
+
 SVDResult* lanczos_svd(Matrix *A, int k, int max_iter);
+SVDResult* lanczos_svd_opts(Matrix *A, int k, const SVDOptions *opts);
+SVDResult* lanczos_restarted_svd(Matrix *A, int k, const SVDOptions *opts);
+size_t lanczos_restarted_memory_bytes(int m, int n, int k, int krylov);
+SVDResult* create_svd_result(Workspace *ws, int m, int n, int k);
+SVDResult* copy_svd_result(const SVDResult *svd);
 void free_svd_result(SVDResult *svd);
+void svd_print_summary(const SVDResult *svd);
 
 void compute_tridiagonal_eigenvalues(double *alpha, double *beta, int n, 
                                      double *eigenvalues, double **eigenvectors);
@@ -1,43 +1,149 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "pgm_io.h"
 #include "svd_compress.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "svd_stream.h"
+#include "svd_daemon.h"
+#include "shared_basis.h"
+#include "tucker.h"
+#include "svd_engine.h"
+#include "dist_transport.h"
+#include "autotune.h"
+#include "simd_kernels.h"
 
 void print_usage(const char *prog_name) {
-    printf("Usage: %s <input> <output> <k>\n", prog_name);
-    printf("  input  - Input image (JPG, PNG, or PGM P5 format)\n");
+    printf("Usage: %s [options] <input> <output> <k> [<input> <output> <k> ...]\n", prog_name);
+    printf("  input  - Input image (JPG, PNG, or PGM/PPM P2, P5, P6 format, 8 or 16-bit)\n");
     printf("  output - Output compressed image (JPG, PNG, or PGM P5 format)\n");
     printf("  k      - Number of singular values to keep (compression rank)\n");
+    printf("  Several input/output/k triples are compressed as a batch sharing one workspace\n");
+    printf("\nOptions:\n");
+    printf("  --perf              Report cycles, IPC, LLC misses, FLOP/s and bytes/s per phase\n");
+    printf("  --max-memory <size> Fail (or use matrix-free SVD) beyond size bytes, e.g. 512M\n");
+    printf("  --huge-pages        Back the solver workspace with huge pages\n");
+    printf("  --threads <n>       Threads for the AᵀA build and reconstruction (0 = the tuned\n");
+    printf("                      count, or all CPUs on an untuned host)\n");
+    printf("  --engine <name>     auto, power, dense, qr, lanczos, or the fast approximate\n");
+    printf("                      rrqr (pivoted QR) and cur (CUR decomposition)\n");
+    printf("  --tune              Benchmark this host and save the profile used to pick\n");
+    printf("                      engines and block sizes (see autotune.h for its path)\n");
+    printf("  --quality <ratio>   Allow engines whose error is up to ratio times the optimal\n");
+    printf("                      rank-k error (e.g. 1.5) when the profile says they are faster\n");
+    printf("  --processes <n>     Randomized SVD with the rows split over n processes\n");
+    printf("                      (0 = one per CPU), each using --threads threads\n");
+    printf("  --transport <name>  How those processes talk: socket (default) or shm\n");
+    printf("  --simd <level>      Use at most scalar, sse2, avx2 or avx512 kernels (default:\n");
+    printf("                      the best this CPU supports)\n");
+    printf("  --ascii             Write netpbm outputs as plain text (P2)\n");
+    printf("  --prune <budget>    Prune near-zero factor entries within a relative error\n");
+    printf("                      budget (e.g. 0.01) and reconstruct from sparse factors\n");
+    printf("  --cache <dir>       Reuse factorizations of identical images across runs; any\n");
+    printf("                      rank up to the largest computed skips the SVD\n");
+    printf("  --cache-size <size> Cap the cache directory, evicting least recently used\n");
+    printf("                      entries (default 1G)\n");
+    printf("  --save-factors      Also write each output's factors to <output>.svdp, rank-\n");
+    printf("                      ordered so any prefix of the file decodes\n");
+    printf("  --decode            Triples are <factors.svdp> <output> <rank>: render the\n");
+    printf("                      leading rank triplets of a saved factor file\n");
+    printf("  --sequence          Treat the triples as video frames: warm-start each SVD from\n");
+    printf("                      the previous frame, cold start on scene cuts\n");
+    printf("  --corpus <dict>     Triples are <input> <coeffs.svdc> <k>: encode against a\n");
+    printf("                      basis shared by all inputs, learned into dict when it\n");
+    printf("                      does not exist; with --decode, <coeffs.svdc> <output> <k>\n");
+    printf("  --tucker <file> <r1>x<r2>x<r3>\n");
+    printf("                      Arguments are the slices of one stack (same size), stored\n");
+    printf("                      as a Tucker core and factors with those multilinear ranks\n");
+    printf("  --untucker <file>   Arguments are output files for the slices of a stack\n");
+    printf("  --daemon <socket>   Serve compression jobs on a UNIX socket with --threads\n");
+    printf("                      workers (see svd_daemon.h for the protocol)\n");
     printf("\nExample: %s input.jpg compressed.jpg 50\n", prog_name);
 }
 
-int main(int argc, char *argv[]) {
-    printf("=================================\n");
-    printf("  Image Compressor using SVD\n");
-    printf("  Supports JPG, PNG, PGM formats\n");
-    printf("=================================\n\n");
+// Sizes the shared workspace for this image, preferring the AᵀA solver and
+// falling back to the matrix-free sizing when that would break --max-memory.
+static Workspace* prepare_workspace(Workspace *ws, int m, int n, int k, int huge_pages) {
+    size_t have = ws ? ws->capacity : 0;
+    size_t bytes = compress_workspace_bytes(m, n, k, 0);
+    if (bytes > have && !mem_would_fit(bytes - have)) {
+        bytes = compress_workspace_bytes(m, n, k, 1);
+    }
+    if (!ws) return workspace_create(bytes, huge_pages);
+    return workspace_reserve(ws, bytes) ? ws : NULL;
+}
+
+static char* factors_path(const char *output_file) {
+    char *path = (char*)malloc(strlen(output_file) + 6);
+    if (path) sprintf(path, "%s.svdp", output_file);
+    return path;
+}
+
+// 16-bit netpbm input with netpbm output skips the 8-bit image entirely
+static int compress_deep_file(NetpbmFile *f, const char *output_file, int k, Workspace **ws,
+                              int huge_pages, const CompressOptions *base, int save_factors,
+                              int ascii) {
+    printf("Successfully read P%c image: %dx%d, maxval=%d (kept at full depth)\n",
+           f->format, f->width, f->height, f->max_val);
+    int max_k = (f->width < f->height) ? f->width : f->height;
+    if (k > max_k) {
+        printf("Warning: k=%d exceeds image dimensions, using k=%d instead\n", k, max_k);
+        k = max_k;
+    }
     
-    if (argc != 4) {
-        print_usage(argv[0]);
-        return 1;
+    Workspace *grown = prepare_workspace(*ws, f->height, f->width, k, huge_pages);
+    if (!grown) {
+        fprintf(stderr, "Error: Cannot allocate workspace\n");
+        netpbm_close(f);
+        return 0;
     }
+    *ws = grown;
     
-    const char *input_file = argv[1];
-    const char *output_file = argv[2];
-    int k = atoi(argv[3]);
+    CompressOptions opts = *base;
+    opts.ws = *ws;
+    char *factors_file = save_factors ? factors_path(output_file) : NULL;
+    opts.factors_file = factors_file;
+    int ok = compress_netpbm_svd_opts(f, output_file, k, ascii, &opts);
+    free(factors_file);
+    netpbm_close(f);
     
+    if (!ok) {
+        fprintf(stderr, "Error: Compression failed\n");
+        return 0;
+    }
+    printf("\nSuccess! Compressed image saved to %s\n", output_file);
+    return 1;
+}
+
+// base carries the command-line settings shared by every image
+static int compress_file(const char *input_file, const char *output_file, int k,
+                         Workspace **ws, int huge_pages, const CompressOptions *base,
+                         int save_factors, int ascii) {
     if (k <= 0) {
         fprintf(stderr, "Error: k must be a positive integer\n");
-        return 1;
+        return 0;
     }
     
  
     printf("Reading input image: %s\n", input_file);
+    mem_phase_begin("read");
+    if (is_netpbm_file(input_file) && is_netpbm_file(output_file)) {
+        NetpbmFile *f = netpbm_open(input_file);
+        if (f && f->max_val > 255) {
+            mem_phase_end("read");
+            return compress_deep_file(f, output_file, k, ws, huge_pages, base, save_factors,
+                                      ascii);
+        }
+        netpbm_close(f);
+    }
     PGMImage *img = read_image(input_file);
+    mem_phase_end("read");
     if (!img) {
         fprintf(stderr, "Error: Failed to read input image\n");
-        return 1;
+        return 0;
     }
     
  
@@ -47,28 +153,485 @@ int main(int argc, char *argv[]) {
         k = max_k;
     }
     
+    Workspace *grown = prepare_workspace(*ws, img->height, img->width, k, huge_pages);
+    if (!grown) {
+        fprintf(stderr, "Error: Cannot allocate workspace\n");
+        free_pgm_image(img);
+        return 0;
+    }
+    *ws = grown;
+    
  
-    PGMImage *compressed = compress_image_svd(img, k);
+    CompressOptions opts = *base;
+    opts.ws = *ws;
+    char *factors_file = save_factors ? factors_path(output_file) : NULL;
+    opts.factors_file = factors_file;
+    PGMImage *compressed = compress_image_svd_opts(img, k, &opts);
+    free(factors_file);
     if (!compressed) {
         fprintf(stderr, "Error: Compression failed\n");
         free_pgm_image(img);
-        return 1;
+        return 0;
     }
     
    
     printf("Writing compressed image: %s\n", output_file);
-    if (!write_image(output_file, compressed)) {
+    mem_phase_begin("write");
+    int written = ascii && is_netpbm_file(output_file) ? netpbm_write_pgm(output_file, compressed, 1)
+                                                       : write_image(output_file, compressed);
+    mem_phase_end("write");
+    
+    free_pgm_image(img);
+    free_pgm_image(compressed);
+    
+    if (!written) {
+        fprintf(stderr, "Error: Failed to write output image\n");
+        return 0;
+    }
+    printf("\nSuccess! Compressed image saved to %s\n", output_file);
+    return 1;
+}
+
+// Renders the leading rank triplets of a progressive factor file, reading
+// only the chunks they live in
+static int decode_file(const char *input_file, const char *output_file, int rank) {
+    printf("Reading factors: %s\n", input_file);
+    int max_val = 255;
+    SVDResult *svd = svd_stream_load(input_file, rank, &max_val);
+    if (!svd) return 0;
+    printf("Decoding rank %d of a %dx%d image\n", svd->k, svd->V->rows, svd->U->rows);
+
+    Matrix *image = reconstruct_from_svd(svd, svd->k);
+    PGMImage *out = image ? matrix_to_pgm(image, max_val) : NULL;
+    free_matrix(image);
+    free_svd_result(svd);
+    if (!out) {
+        fprintf(stderr, "Error: Decoding failed\n");
+        return 0;
+    }
+
+    int written = write_image(output_file, out);
+    free_pgm_image(out);
+    if (!written) {
         fprintf(stderr, "Error: Failed to write output image\n");
+        return 0;
+    }
+    printf("Decoded image saved to %s\n", output_file);
+    return 1;
+}
+
+// Learns a rank-k basis from every input of the corpus, one image in
+// memory at a time, and saves it as the dictionary
+static SharedBasis* learn_basis(const char *dict, const char **args, int num_args, int threads) {
+    int rank = 0;
+    for (int i = 2; i < num_args; i += 3) {
+        if (atoi(args[i]) > rank) rank = atoi(args[i]);
+    }
+    printf("Learning a rank-%d shared basis from %d images\n", rank, num_args / 3);
+    SharedBasisBuilder *builder = NULL;
+    for (int i = 0; i < num_args; i += 3) {
+        PGMImage *img = read_image(args[i]);
+        Matrix *A = img ? pgm_to_matrix(img) : NULL;
+        if (!builder && A) builder = shared_basis_builder_create(A->cols, threads);
+        int ok = A && builder && shared_basis_builder_add(builder, A);
+        free_matrix(A);
         free_pgm_image(img);
-        free_pgm_image(compressed);
+        if (!ok) {
+            fprintf(stderr, "Error: Cannot add %s to the corpus\n", args[i]);
+            shared_basis_builder_free(builder);
+            return NULL;
+        }
+    }
+    SharedBasis *basis = builder ? shared_basis_builder_finish(builder, rank) : NULL;
+    shared_basis_builder_free(builder);
+    if (basis && !shared_basis_save(dict, basis)) {
+        free_shared_basis(basis);
+        return NULL;
+    }
+    if (basis) printf("Saved basis: %s (%dx%d)\n", dict, basis->width, basis->rank);
+    return basis;
+}
+
+static int corpus_encode_file(const SharedBasis *basis, const char *input_file,
+                              const char *output_file, int k, int threads) {
+    PGMImage *img = read_image(input_file);
+    if (!img) return 0;
+    Matrix *A = pgm_to_matrix(img);
+    Matrix *C = A ? shared_basis_encode(basis, A, k, threads) : NULL;
+    PGMImage *out = C ? create_pgm_image(img->width, img->height, img->max_gray) : NULL;
+    int ok = out && shared_basis_decode(basis, C, out->pixels, out->stride, img->max_gray, threads) &&
+             shared_basis_save_coeffs(output_file, basis, C, img->max_gray);
+    if (ok) {
+        double error = 0.0;
+        for (int i = 0; i < img->height; i++) {
+            for (int j = 0; j < img->width; j++) error += fabs(A->data[i][j] - out->data[i][j]);
+        }
+        double avg_error = error / ((double)img->width * img->height);
+        double own = (double)C->rows * C->cols + (double)img->width * C->cols + C->cols;
+        printf("%s: k=%d, error %.2f%%, %d coefficients (%.1f%% of standalone factors)\n",
+               output_file, C->cols, avg_error / img->max_gray * 100.0, C->rows * C->cols,
+               100.0 * C->rows * C->cols / own);
+    }
+    free_pgm_image(out);
+    free_matrix(C);
+    free_matrix(A);
+    free_pgm_image(img);
+    return ok;
+}
+
+static int corpus_decode_file(const SharedBasis *basis, const char *input_file,
+                              const char *output_file, int k, int threads) {
+    int max_val = 255;
+    Matrix *C = shared_basis_load_coeffs(input_file, basis, &max_val);
+    if (!C) return 0;
+    // The leading columns are a valid lower-rank encoding on their own
+    if (k > 0 && k < C->cols) C->cols = k;
+    PGMImage *out = create_pgm_image(basis->width, C->rows, max_val);
+    int ok = out && shared_basis_decode(basis, C, out->pixels, out->stride, max_val, threads) &&
+             write_image(output_file, out);
+    if (ok) printf("Decoded %s at rank %d into %s\n", input_file, C->cols, output_file);
+    free_pgm_image(out);
+    free_matrix(C);
+    return ok;
+}
+
+static int run_corpus(const char *dict, const char **args, int num_args, int decode, int threads) {
+    FILE *existing = fopen(dict, "rb");
+    if (existing) fclose(existing);
+    SharedBasis *basis = existing || decode ? shared_basis_load(dict)
+                                            : learn_basis(dict, args, num_args, threads);
+    if (!basis) return num_args / 3;
+
+    int failures = 0;
+    for (int i = 0; i < num_args; i += 3) {
+        int ok = decode ? corpus_decode_file(basis, args[i], args[i + 1], atoi(args[i + 2]), threads)
+                        : corpus_encode_file(basis, args[i], args[i + 1], atoi(args[i + 2]), threads);
+        if (!ok) failures++;
+    }
+    printf("Shared basis: %dx%d from %d images, %.1f KB\n", basis->width, basis->rank,
+           basis->images, basis->width * basis->rank * 4.0 / 1024.0);
+    free_shared_basis(basis);
+    return failures;
+}
+
+static int tucker_stack(const char *container, const char *rank_text, const char **args,
+                        int num_args, int threads) {
+    int ranks[3];
+    if (sscanf(rank_text, "%dx%dx%d", &ranks[0], &ranks[1], &ranks[2]) != 3) {
+        fprintf(stderr, "Error: Invalid multilinear ranks %s\n", rank_text);
+        return 0;
+    }
+    Matrix **slices = (Matrix**)calloc(num_args, sizeof(Matrix*));
+    int max_val = 0, ok = slices != NULL;
+    for (int s = 0; ok && s < num_args; s++) {
+        PGMImage *img = read_image(args[s]);
+        if (img) {
+            slices[s] = pgm_to_matrix(img);
+            if (img->max_gray > max_val) max_val = img->max_gray;
+            free_pgm_image(img);
+        }
+        ok = slices[s] != NULL;
+    }
+
+    TuckerTensor *t = ok ? tucker_compress(slices, num_args, ranks, max_val, threads) : NULL;
+    Matrix **rebuilt = t ? (Matrix**)calloc(num_args, sizeof(Matrix*)) : NULL;
+    ok = rebuilt != NULL;
+    for (int s = 0; ok && s < num_args; s++) {
+        rebuilt[s] = create_matrix(t->rows, t->cols);
+        ok = rebuilt[s] != NULL;
+    }
+    ok = ok && tucker_reconstruct(t, rebuilt, threads) && tucker_save(container, t);
+    if (ok) {
+        // Statistics over the whole stack, seen as one tall image
+        Matrix original = { num_args * t->rows, t->cols, NULL, NULL, 1 };
+        Matrix compressed = original;
+        original.data = (double**)malloc(original.rows * sizeof(double*));
+        compressed.data = (double**)malloc(compressed.rows * sizeof(double*));
+        if (original.data && compressed.data) {
+            for (int s = 0; s < num_args; s++) {
+                memcpy(original.data + (size_t)s * t->rows, slices[s]->data, t->rows * sizeof(double*));
+                memcpy(compressed.data + (size_t)s * t->rows, rebuilt[s]->data, t->rows * sizeof(double*));
+            }
+            printf("Tucker ranks %dx%dx%d for %d slices of %dx%d\n", t->ranks[0], t->ranks[1],
+                   t->ranks[2], t->slices, t->cols, t->rows);
+            print_compression_stats(&original, &compressed, max_val,
+                                    (double)original.rows * original.cols / tucker_parameter_count(t));
+        }
+        free(original.data);
+        free(compressed.data);
+        printf("Saved stack: %s\n", container);
+    }
+
+    for (int s = 0; s < num_args; s++) {
+        if (slices) free_matrix(slices[s]);
+        if (rebuilt) free_matrix(rebuilt[s]);
+    }
+    free(slices);
+    free(rebuilt);
+    free_tucker(t);
+    return ok;
+}
+
+static int untucker_stack(const char *container, const char **args, int num_args, int threads) {
+    TuckerTensor *t = tucker_load(container);
+    if (!t) return 0;
+    if (num_args > t->slices) {
+        fprintf(stderr, "Error: %s holds %d slices, %d outputs given\n", container, t->slices,
+                num_args);
+        free_tucker(t);
+        return 0;
+    }
+    Matrix **rebuilt = (Matrix**)calloc(t->slices, sizeof(Matrix*));
+    int ok = rebuilt != NULL;
+    for (int s = 0; ok && s < t->slices; s++) {
+        rebuilt[s] = create_matrix_uninit(t->rows, t->cols);
+        ok = rebuilt[s] != NULL;
+    }
+    ok = ok && tucker_reconstruct(t, rebuilt, threads);
+    for (int s = 0; ok && s < num_args; s++) {
+        PGMImage *img = matrix_to_pgm(rebuilt[s], t->max_val);
+        ok = img && write_image(args[s], img);
+        free_pgm_image(img);
+    }
+    for (int s = 0; rebuilt && s < t->slices; s++) free_matrix(rebuilt[s]);
+    free(rebuilt);
+    free_tucker(t);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    printf("=================================\n");
+    printf("  Image Compressor using SVD\n");
+    printf("  Supports JPG, PNG, PGM formats\n");
+    printf("=================================\n\n");
+    
+    const char **args = (const char**)malloc(argc * sizeof(char*));
+    int num_args = 0;
+    int profile = 0;
+    int huge_pages = 0;
+    int sequence_mode = 0;
+    int save_factors = 0;
+    int ascii = 0;
+    int decode = 0;
+    int threads = 1;
+    double prune = 0.0;
+    SVDEngine engine = SVD_ENGINE_AUTO;
+    int processes = -1;
+    int tune = 0;
+    double quality = 0.0;
+    SVDTransport transport = SVD_TRANSPORT_SOCKET;
+    const char *daemon_socket = NULL;
+    const char *cache_dir = NULL;
+    const char *corpus_dict = NULL;
+    const char *tucker_file = NULL;
+    const char *tucker_ranks = NULL;
+    const char *untucker_file = NULL;
+    size_t cache_bytes = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            profile = 1;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            huge_pages = 1;
+        } else if (strcmp(argv[i], "--sequence") == 0) {
+            sequence_mode = 1;
+        } else if (strcmp(argv[i], "--save-factors") == 0) {
+            save_factors = 1;
+        } else if (strcmp(argv[i], "--ascii") == 0) {
+            ascii = 1;
+        } else if (strcmp(argv[i], "--decode") == 0) {
+            decode = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads <= 0) {
+                const TuneProfile *profile = autotune_default();
+                threads = profile ? profile->threads : parallel_cpu_count();
+            }
+        } else if (strcmp(argv[i], "--daemon") == 0 && i + 1 < argc) {
+            daemon_socket = argv[++i];
+        } else if (strcmp(argv[i], "--tucker") == 0 && i + 2 < argc) {
+            tucker_file = argv[++i];
+            tucker_ranks = argv[++i];
+        } else if (strcmp(argv[i], "--untucker") == 0 && i + 1 < argc) {
+            untucker_file = argv[++i];
+        } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus_dict = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cache_bytes = parse_memory_size(argv[++i]);
+            if (cache_bytes == 0) {
+                fprintf(stderr, "Error: Invalid cache size %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            if (!svd_engine_parse(argv[++i], &engine)) {
+                fprintf(stderr, "Error: Unknown engine %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            tune = 1;
+        } else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+            quality = atof(argv[++i]);
+            if (quality != 0.0 && quality < 1.0) {
+                fprintf(stderr, "Error: Invalid quality ratio %s (0 or at least 1)\n", argv[i]);
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+            processes = atoi(argv[++i]);
+            if (processes < 0) processes = 0;
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            if (!dist_transport_parse(argv[++i], &transport)) {
+                fprintf(stderr, "Error: Unknown transport %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            SimdLevel level;
+            if (!simd_level_parse(argv[++i], &level)) {
+                fprintf(stderr, "Error: Unknown SIMD level %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+            if (!simd_select(level)) {
+                fprintf(stderr, "Warning: This CPU lacks %s, using %s kernels\n",
+                        argv[i], simd_level_name(simd_kernels()->level));
+            }
+        } else if (strcmp(argv[i], "--prune") == 0 && i + 1 < argc) {
+            prune = atof(argv[++i]);
+            if (prune < 0) {
+                fprintf(stderr, "Error: Invalid prune budget %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) {
+            size_t limit = parse_memory_size(argv[++i]);
+            if (limit == 0) {
+                fprintf(stderr, "Error: Invalid memory size %s\n", argv[i]);
+                free(args);
+                return 1;
+            }
+            mem_set_limit(limit);
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+            print_usage(argv[0]);
+            free(args);
+            return 1;
+        } else {
+            args[num_args++] = argv[i];
+        }
+    }
+    
+    if (tune) {
+        const char *path = autotune_profile_path();
+        TuneProfile *profile = autotune_run(parallel_cpu_count(), 1);
+        int ok = profile && autotune_save(profile, path);
+        if (ok) {
+            autotune_print(profile);
+            printf("Saved tuning profile: %s\n", path);
+        }
+        mem_free(profile);
+        if (!ok || num_args == 0) {
+            free(args);
+            return ok ? 0 : 1;
+        }
+    }
+    
+    if (daemon_socket) {
+        free(args);
+        DaemonConfig cfg;
+        svd_daemon_default_config(&cfg);
+        cfg.workers = threads;
+        return svd_daemon_run(daemon_socket, &cfg) ? 0 : 1;
+    }
+    
+    if ((tucker_file || untucker_file) && num_args > 0) {
+        if (profile) perf_enable();
+        int ok = tucker_file ? tucker_stack(tucker_file, tucker_ranks, args, num_args, threads)
+                             : untucker_stack(untucker_file, args, num_args, threads);
+        if (profile) {
+            perf_report(stdout);
+            perf_disable();
+        }
+        free(args);
+        printf("\n=== Memory Usage ===\n");
+        mem_report(stdout);
+        return ok ? 0 : 1;
+    }
+    
+    if (num_args == 0 || num_args % 3 != 0) {
+        print_usage(argv[0]);
+        free(args);
         return 1;
     }
     
-    printf("\nSuccess! Compressed image saved to %s\n", output_file);
+    if (corpus_dict) {
+        if (profile) perf_enable();
+        int failures = run_corpus(corpus_dict, args, num_args, decode, threads);
+        if (profile) {
+            perf_report(stdout);
+            perf_disable();
+        }
+        free(args);
+        printf("\n=== Memory Usage ===\n");
+        mem_report(stdout);
+        return failures ? 1 : 0;
+    }
     
-   
-    free_pgm_image(img);
-    free_pgm_image(compressed);
+    // A frame counts as a scene cut when the previous frame's subspace
+    // misses over 4x more of its energy than it did for that frame
+    SVDSequence *sequence = sequence_mode ? svd_sequence_create(4.0) : NULL;
+    FactorCache *cache = NULL;
+    if (cache_dir) {
+        cache = factor_cache_open(cache_dir, cache_bytes);
+        if (!cache) {
+            svd_sequence_free(sequence);
+            free(args);
+            return 1;
+        }
+    }
+    CompressOptions base;
+    compress_default_options(&base);
+    base.sequence = sequence;
+    base.threads = threads;
+    base.prune = prune;
+    base.cache = cache;
+    base.engine = engine;
+    base.quality = quality;
+    // --processes alone selects the distributed engine
+    if (processes >= 0) {
+        base.processes = processes;
+        if (engine == SVD_ENGINE_AUTO) base.engine = SVD_ENGINE_DISTRIBUTED;
+    }
+    base.transport = transport;
+    Workspace *ws = NULL;
+    int failures = 0;
+    if (profile) perf_enable();
     
-    return 0;
-}
\ No newline at end of file
+    for (int i = 0; i < num_args; i += 3) {
+        if (decode) {
+            if (!decode_file(args[i], args[i + 1], atoi(args[i + 2]))) failures++;
+        } else if (!compress_file(args[i], args[i + 1], atoi(args[i + 2]), &ws, huge_pages, &base,
+                                  save_factors, ascii)) {
+            failures++;
+        }
+    }
+    
+    if (profile) {
+        perf_report(stdout);
+        perf_disable();
+    }
+    if (sequence) svd_sequence_report(sequence);
+    svd_sequence_free(sequence);
+    factor_cache_close(cache);
+    workspace_destroy(ws);
+    free(args);
+    
+    printf("\n=== Memory Usage ===\n");
+    mem_report(stdout);
+    
+    return failures ? 1 : 0;
+}
@@ -1,43 +1,69 @@
 #include "matrix.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include "blas1.h"
 #include <string.h>
+#include <stdint.h>
 
-Matrix* create_matrix(int rows, int cols) {
-    Matrix *m = (Matrix*)malloc(sizeof(Matrix));
-    if (!m) return NULL;
-    
+#define MATRIX_ALIGN 64
+// Householder reflectors applied together by householder_apply, unless a
+// tuning profile sets another width (householder_set_block)
+#define REFLECTOR_BLOCK 32
+// Rows of a transposed TSQR block copied per strip
+#define TSQR_COPY_ROWS 64
+// Cholesky QR gives up on pivots below this fraction of the column norm²
+#define CHOLQR_MIN_PIVOT 1e-12
+
+static size_t align_up(size_t bytes) {
+    return (bytes + MATRIX_ALIGN - 1) & ~(size_t)(MATRIX_ALIGN - 1);
+}
+
+// A matrix is one block: the header, the row pointer table, then the rows
+// back to back, each section starting on a cache line.
+size_t matrix_storage_bytes(int rows, int cols) {
+    return align_up(sizeof(Matrix)) + align_up((size_t)rows * sizeof(double*))
+         + (size_t)rows * cols * sizeof(double) + MATRIX_ALIGN;
+}
+
+Matrix* matrix_init_block(void *block, int rows, int cols, int from_workspace) {
+    uintptr_t base = ((uintptr_t)block + MATRIX_ALIGN - 1) & ~(uintptr_t)(MATRIX_ALIGN - 1);
+    Matrix *m = (Matrix*)base;
     m->rows = rows;
     m->cols = cols;
-    m->data = (double**)malloc(rows * sizeof(double*));
-    if (!m->data) {
-        free(m);
-        return NULL;
-    }
-    
+    m->from_workspace = from_workspace;
+    m->block = block;
+    m->data = (double**)(base + align_up(sizeof(Matrix)));
+
+    double *values = (double*)((uintptr_t)m->data + align_up((size_t)rows * sizeof(double*)));
     for (int i = 0; i < rows; i++) {
-        m->data[i] = (double*)calloc(cols, sizeof(double));
-        if (!m->data[i]) {
-            for (int j = 0; j < i; j++) free(m->data[j]);
-            free(m->data);
-            free(m);
-            return NULL;
-        }
+        m->data[i] = values + (size_t)i * cols;
     }
     return m;
 }
 
+Matrix* create_matrix_uninit(int rows, int cols) {
+    void *block = mem_alloc(matrix_storage_bytes(rows, cols));
+    if (!block) return NULL;
+    return matrix_init_block(block, rows, cols, 0);
+}
+
+Matrix* create_matrix(int rows, int cols) {
+    Matrix *m = create_matrix_uninit(rows, cols);
+    if (!m) return NULL;
+    
+    if (rows > 0) memset(m->data[0], 0, (size_t)rows * cols * sizeof(double));
+    return m;
+}
+
 void free_matrix(Matrix *m) {
-    if (!m) return;
-    if (m->data) {
-        for (int i = 0; i < m->rows; i++) {
-            free(m->data[i]);
-        }
-        free(m->data);
-    }
-    free(m);
+    if (!m || m->from_workspace) return;
+    mem_free(m->block);
 }
 
 Matrix* copy_matrix(Matrix *m) {
-    Matrix *copy = create_matrix(m->rows, m->cols);
+    Matrix *copy = create_matrix_uninit(m->rows, m->cols);
     if (!copy) return NULL;
     
     for (int i = 0; i < m->rows; i++) {
@@ -47,50 +73,608 @@ Matrix* copy_matrix(Matrix *m) {
 }
 
 void matrix_multiply(Matrix *A, Matrix *B, Matrix *result) {
+    perf_phase_begin("gemm");
+    const SimdKernels *kern = simd_kernels();
+    // Row i of the result accumulates rows of B, so every pass is contiguous
     for (int i = 0; i < A->rows; i++) {
-        for (int j = 0; j < B->cols; j++) {
-            result->data[i][j] = 0.0;
-            for (int k = 0; k < A->cols; k++) {
-                result->data[i][j] += A->data[i][k] * B->data[k][j];
-            }
+        memset(result->data[i], 0, B->cols * sizeof(double));
+        for (int k = 0; k < A->cols; k++) {
+            kern->axpy(result->data[i], A->data[i][k], B->data[k], B->cols);
         }
     }
+    perf_phase_end("gemm", 2.0 * A->rows * B->cols * A->cols,
+                   16.0 * A->rows * B->cols * A->cols);
 }
 
 void matrix_transpose(Matrix *A, Matrix *result) {
+    perf_phase_begin("transpose");
     for (int i = 0; i < A->rows; i++) {
         for (int j = 0; j < A->cols; j++) {
             result->data[j][i] = A->data[i][j];
         }
     }
+    perf_phase_end("transpose", 0.0, 16.0 * A->rows * A->cols);
 }
 
 void matrix_vector_multiply(Matrix *A, double *v, double *result) {
+    perf_phase_begin("gemv");
+    const SimdKernels *kern = simd_kernels();
     for (int i = 0; i < A->rows; i++) {
-        result[i] = 0.0;
-        for (int j = 0; j < A->cols; j++) {
-            result[i] += A->data[i][j] * v[j];
-        }
+        result[i] = kern->dot(A->data[i], v, A->cols);
     }
+    perf_phase_end("gemv", 2.0 * A->rows * A->cols, 16.0 * A->rows * A->cols);
 }
 
 double vector_dot(double *a, double *b, int n) {
-    double sum = 0.0;
-    for (int i = 0; i < n; i++) {
-        sum += a[i] * b[i];
-    }
-    return sum;
+    return blas_dot(a, b, n);
 }
 
 double vector_norm(double *v, int n) {
-    return sqrt(vector_dot(v, v, n));
+    return blas_nrm2(v, n);
 }
 
 void vector_normalize(double *v, int n) {
-    double norm = vector_norm(v, n);
-    if (norm > 1e-10) {
-        for (int i = 0; i < n; i++) {
-            v[i] /= norm;
+    blas_normalize(v, n);
+}
+
+// y += a x, the inner loop of every row-streaming update below
+static void row_axpy(double *y, double a, const double *x, int n) {
+    blas_axpy(y, a, x, n);
+}
+
+// Householder vector for x[0..len) (entries step apart): on return x[0]
+// holds beta, the rest the reflector tail (its head is an implicit 1), and
+// the result is tau, so that (I - tau v vᵀ) x = beta e_0.
+double householder_vector(double *x, int len, int step) {
+    double alpha = x[0];
+    double tail = 0.0;
+    for (int i = 1; i < len; i++) tail += x[i * step] * x[i * step];
+    if (tail == 0.0) return 0.0;
+
+    double beta = -copysign(sqrt(alpha * alpha + tail), alpha);
+    double scale = 1.0 / (alpha - beta);
+    for (int i = 1; i < len; i++) x[i * step] *= scale;
+    x[0] = beta;
+    return (beta - alpha) / beta;
+}
+
+// Entry r of reflector i as stored in B: left reflectors run down column i
+// from row i, right ones along row i from column i+1; the head is 1.
+static double reflector_entry(Matrix *B, int right, int i, int r) {
+    int start = right ? i + 1 : i;
+    if (r < start) return 0.0;
+    if (r == start) return 1.0;
+    return right ? B->data[i][r] : B->data[r][i];
+}
+
+// Compact WY form of the b reflectors from i0 stored in B, over rows
+// [p0, end): H_i0 ... H_i0+b-1 = I - V T Vᵀ with V (end-p0)×b and T upper
+// triangular. y is b doubles of scratch.
+static void wy_build(Matrix *B, const double *tau, int right, int i0, int b,
+                     int p0, int end, Matrix *V, Matrix *T, double *y) {
+    for (int r = p0; r < end; r++) {
+        for (int j = 0; j < b; j++) V->data[r - p0][j] = reflector_entry(B, right, i0 + j, r);
+    }
+    // T[0:j, j] = -tau_j T[0:j, 0:j] V[:, 0:j]ᵀ v_j, T[j][j] = tau_j
+    for (int j = 0; j < b; j++) {
+        for (int l = 0; l < j; l++) y[l] = 0.0;
+        for (int r = 0; r < end - p0; r++) {
+            double vj = V->data[r][j];
+            if (vj == 0.0) continue;
+            for (int l = 0; l < j; l++) y[l] += V->data[r][l] * vj;
+        }
+        for (int l = 0; l < j; l++) {
+            double sum = 0.0;
+            for (int t = l; t < j; t++) sum += T->data[l][t] * y[t];
+            T->data[l][j] = -tau[i0 + j] * sum;
+        }
+        for (int l = j + 1; l < b; l++) T->data[l][j] = 0.0;
+        T->data[j][j] = tau[i0 + j];
+    }
+}
+
+// X[p0:end, c0:c0+k] -= V op(T) Vᵀ X[p0:end, c0:c0+k], op(T) = T, or Tᵀ
+// when trans is set (the block's transpose). W is b×k of scratch.
+static void wy_apply(const Matrix *V, const Matrix *T, int b, int trans, Matrix *X,
+                     int p0, int end, int c0, int k, Matrix *W) {
+    for (int j = 0; j < b; j++) memset(W->data[j], 0, k * sizeof(double));
+    for (int r = p0; r < end; r++) {
+        const double *xr = X->data[r] + c0;
+        const double *vr = V->data[r - p0];
+        for (int j = 0; j < b; j++) {
+            if (vr[j] != 0.0) row_axpy(W->data[j], vr[j], xr, k);
+        }
+    }
+    // In place: row j of op(T) W only reads rows not yet overwritten
+    for (int jj = 0; jj < b; jj++) {
+        int j = trans ? b - 1 - jj : jj;
+        double *wj = W->data[j];
+        for (int c = 0; c < k; c++) {
+            double sum = 0.0;
+            if (trans) {
+                for (int t = 0; t <= j; t++) sum += T->data[t][j] * W->data[t][c];
+            } else {
+                for (int t = j; t < b; t++) sum += T->data[j][t] * W->data[t][c];
+            }
+            wj[c] = sum;
+        }
+    }
+    for (int r = p0; r < end; r++) {
+        double *xr = X->data[r] + c0;
+        const double *vr = V->data[r - p0];
+        for (int j = 0; j < b; j++) {
+            if (vr[j] != 0.0) row_axpy(xr, -vr[j], W->data[j], k);
+        }
+    }
+}
+
+static int reflector_block = REFLECTOR_BLOCK;
+
+void householder_set_block(int nb) {
+    __atomic_store_n(&reflector_block, nb > 0 ? nb : REFLECTOR_BLOCK, __ATOMIC_RELAXED);
+}
+
+int householder_block(void) {
+    return __atomic_load_n(&reflector_block, __ATOMIC_RELAXED);
+}
+
+// X = H_0 H_1 ... H_{N-1} X for the left (right = 0) or right reflectors
+// stored in B. Reflectors are applied householder_block() at a time in compact
+// WY form, so each row of X is read twice per block rather than twice per
+// reflector.
+int householder_apply(Matrix *B, const double *tau, int right, Matrix *X) {
+    int N = B->cols;
+    int k = X->cols;
+    int end = right ? N : B->rows;
+    int nb = householder_block();
+
+    Matrix *V = create_matrix_uninit(end, nb);
+    Matrix *T = create_matrix_uninit(nb, nb);
+    Matrix *W = create_matrix_uninit(nb, k);
+    double *y = (double*)mem_alloc(nb * sizeof(double));
+    int ok = V && T && W && y;
+
+    for (int i0 = ((N - 1) / nb) * nb; ok && i0 >= 0; i0 -= nb) {
+        int b = N - i0 < nb ? N - i0 : nb;
+        int p0 = right ? i0 + 1 : i0;
+        if (p0 >= end) continue;
+        wy_build(B, tau, right, i0, b, p0, end, V, T, y);
+        wy_apply(V, T, b, 0, X, p0, end, 0, k, W);
+    }
+
+    mem_free(y);
+    free_matrix(W);
+    free_matrix(T);
+    free_matrix(V);
+    return ok;
+}
+
+// Blocked: each panel of householder_block() columns is factored one reflector
+// at a time (w = vᵀA accumulated along rows, then a rank-one update), and
+// the trailing columns are updated once per panel with its WY form.
+int householder_qr(Matrix *A, double *tau) {
+    int M = A->rows;
+    int N = A->cols;
+    int nb = householder_block();
+    double *w = (double*)mem_alloc(N * sizeof(double));
+    double *y = (double*)mem_alloc(nb * sizeof(double));
+    Matrix *V = create_matrix_uninit(M, nb);
+    Matrix *T = create_matrix_uninit(nb, nb);
+    Matrix *W = create_matrix_uninit(nb, N);
+    int ok = w && y && V && T && W;
+
+    for (int i0 = 0; ok && i0 < N; i0 += nb) {
+        int b = N - i0 < nb ? N - i0 : nb;
+        for (int i = i0; i < i0 + b; i++) {
+            double t = householder_vector(&A->data[i][i], M - i, N);
+            tau[i] = t;
+            int cols = i0 + b - i - 1;
+            if (t == 0.0 || cols == 0) continue;
+            memcpy(w, &A->data[i][i + 1], cols * sizeof(double));
+            for (int r = i + 1; r < M; r++) row_axpy(w, A->data[r][i], &A->data[r][i + 1], cols);
+            row_axpy(&A->data[i][i + 1], -t, w, cols);
+            for (int r = i + 1; r < M; r++) row_axpy(&A->data[r][i + 1], -t * A->data[r][i], w, cols);
+        }
+        // Trailing columns get (H_i0 ... H_i0+b-1)ᵀ = I - V Tᵀ Vᵀ
+        if (i0 + b < N) {
+            wy_build(A, tau, 0, i0, b, i0, M, V, T, y);
+            wy_apply(V, T, b, 1, A, i0, M, i0 + b, N - i0 - b, W);
+        }
+    }
+
+    free_matrix(W);
+    free_matrix(T);
+    free_matrix(V);
+    mem_free(y);
+    mem_free(w);
+    return ok;
+}
+
+// Children (one or two) of node i on tree level `level` (blocks are level 0)
+static int tsqr_children(const TSQR *f, int level, int i) {
+    int below = level == 1 ? f->blocks : f->count[level - 2];
+    return 2 * i + 1 < below ? 2 : 1;
+}
+
+static const Matrix* tsqr_r_factor(const TSQR *f, int level, int i) {
+    return level == 0 ? f->panels[i] : f->nodes[level - 1][i];
+}
+
+typedef struct {
+    const Matrix *A;
+    int transpose;
+    TSQR *f;
+    int level;
+    int *ok;
+} TSQRFactorTask;
+
+// Copies blocks [begin, end) of A (or Aᵀ) out and factors each in place
+static void tsqr_factor_blocks(void *arg, int begin, int end) {
+    TSQRFactorTask *t = (TSQRFactorTask*)arg;
+    TSQR *f = t->f;
+    for (int b = begin; b < end; b++) {
+        Matrix *P = f->panels[b];
+        int r0 = f->first[b];
+        if (t->transpose) {
+            // In strips of TSQR_COPY_ROWS rows so the writes stay cached
+            for (int s = 0; s < P->rows; s += TSQR_COPY_ROWS) {
+                int e = s + TSQR_COPY_ROWS < P->rows ? s + TSQR_COPY_ROWS : P->rows;
+                for (int j = 0; j < f->cols; j++) {
+                    const double *a = t->A->data[j] + r0;
+                    for (int r = s; r < e; r++) P->data[r][j] = a[r];
+                }
+            }
+        } else {
+            for (int r = 0; r < P->rows; r++) {
+                memcpy(P->data[r], t->A->data[r0 + r], f->cols * sizeof(double));
+            }
+        }
+        t->ok[b] = householder_qr(P, f->tau[b]);
+    }
+}
+
+// Nodes [begin, end) of a tree level: stack the children's R factors and
+// factor them again
+static void tsqr_factor_nodes(void *arg, int begin, int end) {
+    TSQRFactorTask *t = (TSQRFactorTask*)arg;
+    TSQR *f = t->f;
+    int N = f->cols;
+    int l = t->level;
+    for (int i = begin; i < end; i++) {
+        Matrix *P = f->nodes[l - 1][i];
+        for (int c = 0; c < tsqr_children(f, l, i); c++) {
+            const Matrix *R = tsqr_r_factor(f, l - 1, 2 * i + c);
+            for (int r = 0; r < N; r++) {
+                memset(P->data[c * N + r], 0, r * sizeof(double));
+                memcpy(&P->data[c * N + r][r], &R->data[r][r], (N - r) * sizeof(double));
+            }
+        }
+        t->ok[i] = householder_qr(P, f->node_tau[l - 1][i]);
+    }
+}
+
+static int tsqr_block_count(int rows, int cols, int threads) {
+    // Every block needs at least cols rows to have a cols×cols R factor
+    int blocks = threads < rows / cols ? threads : rows / cols;
+    return blocks < 1 ? 1 : blocks;
+}
+
+TSQR* tsqr_factor(const Matrix *A, int transpose, int threads) {
+    int M = transpose ? A->cols : A->rows;
+    int N = transpose ? A->rows : A->cols;
+    if (M < N || N < 1) return NULL;
+
+    int blocks = tsqr_block_count(M, N, threads);
+    int levels = 0;
+    for (int c = blocks; c > 1; c = (c + 1) / 2) levels++;
+
+    TSQR *f = (TSQR*)mem_calloc(1, sizeof(TSQR));
+    if (!f) return NULL;
+    f->rows = M;
+    f->cols = N;
+    f->blocks = blocks;
+    f->levels = levels;
+    f->first = (int*)mem_alloc((blocks + 1) * sizeof(int));
+    f->panels = (Matrix**)mem_calloc(blocks, sizeof(Matrix*));
+    f->tau = (double**)mem_calloc(blocks, sizeof(double*));
+    f->count = (int*)mem_calloc(levels + 1, sizeof(int));
+    f->nodes = (Matrix***)mem_calloc(levels + 1, sizeof(Matrix**));
+    f->node_tau = (double***)mem_calloc(levels + 1, sizeof(double**));
+    int *ok = (int*)mem_calloc(blocks, sizeof(int));
+    int good = f->first && f->panels && f->tau && f->count && f->nodes && f->node_tau && ok;
+    for (int b = 0; good && b <= blocks; b++) f->first[b] = (int)((long)M * b / blocks);
+    for (int b = 0; good && b < blocks; b++) {
+        f->panels[b] = create_matrix_uninit(f->first[b + 1] - f->first[b], N);
+        f->tau[b] = (double*)mem_alloc(N * sizeof(double));
+        good = f->panels[b] && f->tau[b];
+    }
+    for (int l = 1; good && l <= levels; l++) {
+        int count = ((l == 1 ? blocks : f->count[l - 2]) + 1) / 2;
+        f->count[l - 1] = count;
+        f->nodes[l - 1] = (Matrix**)mem_calloc(count, sizeof(Matrix*));
+        f->node_tau[l - 1] = (double**)mem_calloc(count, sizeof(double*));
+        good = f->nodes[l - 1] && f->node_tau[l - 1];
+        for (int i = 0; good && i < count; i++) {
+            f->nodes[l - 1][i] = create_matrix_uninit(tsqr_children(f, l, i) * N, N);
+            f->node_tau[l - 1][i] = (double*)mem_alloc(N * sizeof(double));
+            good = f->nodes[l - 1][i] && f->node_tau[l - 1][i];
+        }
+    }
+
+    if (good) {
+        perf_phase_begin("tsqr");
+        TSQRFactorTask task = { A, transpose, f, 0, ok };
+        parallel_for(threads, blocks, tsqr_factor_blocks, &task);
+        for (int b = 0; b < blocks; b++) good = good && ok[b];
+        // Reduction tree: pairs of R factors merge level by level
+        for (int l = 1; good && l <= levels; l++) {
+            task.level = l;
+            parallel_for(threads, f->count[l - 1], tsqr_factor_nodes, &task);
+            for (int i = 0; i < f->count[l - 1]; i++) good = good && ok[i];
         }
+        perf_phase_end("tsqr", 2.0 * N * N * (M + (blocks - 1) * N), 16.0 * M * N);
     }
-}
\ No newline at end of file
+
+    mem_free(ok);
+    if (!good) {
+        tsqr_free(f);
+        return NULL;
+    }
+    return f;
+}
+
+void tsqr_get_r(const TSQR *f, Matrix *R) {
+    const Matrix *src = tsqr_r_factor(f, f->levels, 0);
+    for (int i = 0; i < f->cols; i++) {
+        for (int j = 0; j < f->cols; j++) R->data[i][j] = j >= i ? src->data[i][j] : 0.0;
+    }
+}
+
+typedef struct {
+    const TSQR *f;
+    int level;
+    const Matrix *Y;        // N rows per node of this level
+    Matrix *X;              // output: N rows per node of the level below, or the result
+    int *ok;
+} TSQRApplyTask;
+
+// Node i of the level gets Q_i [Y_i; 0]; its rows in X are those of its
+// children (or, at the leaves, its block of rows)
+static void tsqr_apply_nodes(void *arg, int begin, int end) {
+    TSQRApplyTask *t = (TSQRApplyTask*)arg;
+    const TSQR *f = t->f;
+    int N = f->cols;
+    int k = t->X->cols;
+    for (int i = begin; i < end; i++) {
+        Matrix *P;
+        const double *tau;
+        int r0;
+        if (t->level == 0) {
+            P = f->panels[i];
+            tau = f->tau[i];
+            r0 = f->first[i];
+        } else {
+            P = f->nodes[t->level - 1][i];
+            tau = f->node_tau[t->level - 1][i];
+            r0 = 2 * i * N;
+        }
+        Matrix Xi = { P->rows, k, t->X->data + r0, NULL, 1 };
+        for (int r = 0; r < Xi.rows; r++) {
+            if (r < N) memcpy(Xi.data[r], t->Y->data[i * N + r], k * sizeof(double));
+            else memset(Xi.data[r], 0, k * sizeof(double));
+        }
+        t->ok[i] = householder_apply(P, tau, 0, &Xi);
+    }
+}
+
+int tsqr_apply_q(const TSQR *f, const Matrix *C, Matrix *X, int threads) {
+    int N = f->cols;
+    int k = C->cols;
+    int *ok = (int*)mem_calloc(f->blocks, sizeof(int));
+    Matrix *Y = NULL;
+    int good = ok != NULL;
+
+    perf_phase_begin("tsqr_apply_q");
+    // Down the tree from the root: each level turns N rows per node into
+    // N rows per child, ending with N rows per leaf block
+    const Matrix *in = C;
+    for (int l = f->levels; good && l >= 1; l--) {
+        int below = l == 1 ? f->blocks : f->count[l - 2];
+        Matrix *out = create_matrix_uninit(below * N, k);
+        good = out != NULL;
+        if (good) {
+            TSQRApplyTask task = { f, l, in, out, ok };
+            parallel_for(threads, f->count[l - 1], tsqr_apply_nodes, &task);
+            for (int i = 0; i < f->count[l - 1]; i++) good = good && ok[i];
+        }
+        free_matrix(Y);
+        Y = out;
+        in = Y;
+    }
+    if (good) {
+        TSQRApplyTask task = { f, 0, in, X, ok };
+        parallel_for(threads, f->blocks, tsqr_apply_nodes, &task);
+        for (int b = 0; b < f->blocks; b++) good = good && ok[b];
+    }
+    perf_phase_end("tsqr_apply_q", 4.0 * f->rows * N * k, 16.0 * f->rows * k);
+
+    free_matrix(Y);
+    mem_free(ok);
+    return good;
+}
+
+void tsqr_free(TSQR *f) {
+    if (!f) return;
+    for (int b = 0; f->panels && b < f->blocks; b++) {
+        free_matrix(f->panels[b]);
+        if (f->tau) mem_free(f->tau[b]);
+    }
+    for (int l = 0; f->nodes && l < f->levels; l++) {
+        for (int i = 0; f->nodes[l] && i < f->count[l]; i++) {
+            free_matrix(f->nodes[l][i]);
+            if (f->node_tau[l]) mem_free(f->node_tau[l][i]);
+        }
+        mem_free(f->nodes[l]);
+        if (f->node_tau) mem_free(f->node_tau[l]);
+    }
+    mem_free(f->node_tau);
+    mem_free(f->nodes);
+    mem_free(f->count);
+    mem_free(f->tau);
+    mem_free(f->panels);
+    mem_free(f->first);
+    mem_free(f);
+}
+
+size_t tsqr_memory_bytes(int rows, int cols, int threads) {
+    int blocks = tsqr_block_count(rows, cols, threads);
+    size_t bytes = (size_t)blocks * (matrix_storage_bytes(rows / blocks + 1, cols) + cols * sizeof(double));
+    // The tree has fewer than blocks nodes of at most 2·cols rows each
+    if (blocks > 1) bytes += (size_t)blocks * (matrix_storage_bytes(2 * cols, cols) + cols * sizeof(double));
+    return bytes;
+}
+
+// Cholesky QR: partial Gram matrices per row chunk, summed pairwise
+typedef struct {
+    const Matrix *Q;
+    Matrix **G;             // one k×k partial per part
+    int parts;
+    int step;
+} CholQRTask;
+
+static void gram_parts(void *arg, int begin, int end) {
+    CholQRTask *t = (CholQRTask*)arg;
+    int n = t->Q->rows;
+    int k = t->Q->cols;
+    for (int p = begin; p < end; p++) {
+        Matrix *G = t->G[p];
+        for (int a = 0; a < k; a++) memset(G->data[a], 0, k * sizeof(double));
+        int r1 = (int)((long)n * (p + 1) / t->parts);
+        // Upper triangle only, one rank-one row update at a time
+        for (int r = (int)((long)n * p / t->parts); r < r1; r++) {
+            const double *q = t->Q->data[r];
+            for (int a = 0; a < k; a++) {
+                if (q[a] != 0.0) row_axpy(&G->data[a][a], q[a], &q[a], k - a);
+            }
+        }
+    }
+}
+
+static void gram_reduce(void *arg, int begin, int end) {
+    CholQRTask *t = (CholQRTask*)arg;
+    int k = t->Q->cols;
+    for (int i = begin; i < end; i++) {
+        int p = i * 2 * t->step;
+        if (p + t->step >= t->parts) continue;
+        Matrix *G = t->G[p];
+        const Matrix *H = t->G[p + t->step];
+        for (int a = 0; a < k; a++) row_axpy(&G->data[a][a], 1.0, &H->data[a][a], k - a);
+    }
+}
+
+typedef struct {
+    Matrix *Q;
+    const Matrix *R;
+} TriSolveTask;
+
+// Rows [begin, end) of Q become Q R⁻¹, solved forward along each row
+static void solve_rows(void *arg, int begin, int end) {
+    TriSolveTask *t = (TriSolveTask*)arg;
+    int k = t->Q->cols;
+    for (int r = begin; r < end; r++) {
+        double *q = t->Q->data[r];
+        for (int j = 0; j < k; j++) {
+            q[j] /= t->R->data[j][j];
+            if (q[j] != 0.0) row_axpy(&q[j + 1], -q[j], &t->R->data[j][j + 1], k - j - 1);
+        }
+    }
+}
+
+// One Cholesky QR pass: R = chol(QᵀQ), Q = Q R⁻¹. Fails before touching Q
+// when a pivot shows a column within CHOLQR_MIN_PIVOT of the span of the
+// ones before it.
+static int cholesky_qr_pass(Matrix *Q, Matrix *R, Matrix **G, int parts, int threads) {
+    int k = Q->cols;
+    CholQRTask task = { Q, G, parts, 1 };
+    parallel_for(threads, parts, gram_parts, &task);
+    for (task.step = 1; task.step < parts; task.step *= 2) {
+        int pairs = (parts + 2 * task.step - 1) / (2 * task.step);
+        parallel_for(threads, pairs, gram_reduce, &task);
+    }
+
+    Matrix *S = G[0];
+    for (int j = 0; j < k; j++) {
+        double d = S->data[j][j];
+        for (int i = 0; i < j; i++) d -= R->data[i][j] * R->data[i][j];
+        if (!(d > CHOLQR_MIN_PIVOT * S->data[j][j])) return 0;
+        double rjj = sqrt(d);
+        R->data[j][j] = rjj;
+        for (int c = j + 1; c < k; c++) {
+            double s = S->data[j][c];
+            for (int i = 0; i < j; i++) s -= R->data[i][j] * R->data[i][c];
+            R->data[j][c] = s / rjj;
+        }
+        for (int c = 0; c < j; c++) R->data[j][c] = 0.0;
+    }
+
+    TriSolveTask solve = { Q, R };
+    parallel_for(threads, Q->rows, solve_rows, &solve);
+    return 1;
+}
+
+int cholesky_qr2(Matrix *Q, Matrix *R, int threads) {
+    int n = Q->rows;
+    int k = Q->cols;
+    if (k < 1 || n < k) return 0;
+    if (threads < 1) threads = 1;
+    int parts = threads < n / k ? threads : n / k;
+    if (parts < 1) parts = 1;
+
+    Matrix **G = (Matrix**)mem_calloc(parts, sizeof(Matrix*));
+    Matrix *R1 = create_matrix_uninit(k, k);
+    Matrix *R2 = create_matrix_uninit(k, k);
+    int ok = G && R1 && R2;
+    for (int p = 0; ok && p < parts; p++) ok = (G[p] = create_matrix_uninit(k, k)) != NULL;
+
+    perf_phase_begin("cholesky_qr2");
+    // The second pass fixes the orthogonality the first loses to κ(Q)²
+    ok = ok && cholesky_qr_pass(Q, R1, G, parts, threads) &&
+         cholesky_qr_pass(Q, R2, G, parts, threads);
+    perf_phase_end("cholesky_qr2", 4.0 * n * k * k, 32.0 * n * k);
+
+    if (ok && R) {
+        // R = R2 R1, both upper triangular
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                double sum = 0.0;
+                for (int t = i; t <= j; t++) sum += R2->data[i][t] * R1->data[t][j];
+                R->data[i][j] = sum;
+            }
+        }
+    }
+
+    for (int p = 0; G && p < parts; p++) free_matrix(G[p]);
+    mem_free(G);
+    free_matrix(R2);
+    free_matrix(R1);
+    return ok;
+}
+
+int block_orthonormalize(Matrix *V, Matrix *R, int threads) {
+    if (cholesky_qr2(V, R, threads)) return 1;
+
+    // Too ill-conditioned (or rank deficient) for Cholesky: Householder
+    // TSQR still returns orthonormal columns spanning what V spans
+    int k = V->cols;
+    TSQR *f = tsqr_factor(V, 0, threads);
+    Matrix *I = create_matrix(k, k);
+    int ok = f && I;
+    if (ok) {
+        for (int j = 0; j < k; j++) I->data[j][j] = 1.0;
+        if (R) tsqr_get_r(f, R);
+        ok = tsqr_apply_q(f, I, V, threads);
+    }
+    free_matrix(I);
+    tsqr_free(f);
+    return ok;
+}
@@ -7,10 +7,15 @@
 typedef struct {
     int rows;
     int cols;
-    double **data;
+    double **data;          // row pointers into one contiguous block
+    void *block;            // allocation holding header, row table and values
+    int from_workspace;     // owned by a Workspace; free_matrix leaves it alone
 } Matrix;
 
 Matrix* create_matrix(int rows, int cols);
+Matrix* create_matrix_uninit(int rows, int cols);
+size_t matrix_storage_bytes(int rows, int cols);
+Matrix* matrix_init_block(void *block, int rows, int cols, int from_workspace);
 void free_matrix(Matrix *m);
 Matrix* copy_matrix(Matrix *m);
 
@@ -21,4 +26,50 @@ double vector_dot(double *a, double *b, int n);
 void vector_normalize(double *v, int n);
 double vector_norm(double *v, int n);
 
+// Householder reflectors. householder_qr factors A (m×n, m ≥ n) in place:
+// R in the upper triangle, reflector tails below the diagonal, scalars in
+// tau[0..n). householder_apply computes X = H_0 H_1 ... H_{n-1} X for the
+// left (right = 0) reflectors stored that way, or for right reflectors
+// stored along the rows right of the superdiagonal.
+double householder_vector(double *x, int len, int step);
+int householder_qr(Matrix *A, double *tau);
+int householder_apply(Matrix *B, const double *tau, int right, Matrix *X);
+// Panel width of both (32 unless a tuning profile picked another)
+void householder_set_block(int nb);
+int householder_block(void);
+
+// Tall-skinny QR of an M×N matrix (M ≥ N): row blocks are factored in
+// parallel, one per thread, and their R factors merged pairwise up a binary
+// reduction tree, each level in parallel, so A is read in a single pass.
+// Q stays implicit in the block and tree reflectors.
+typedef struct {
+    int rows;
+    int cols;
+    int blocks;
+    int *first;             // first row of each block; first[blocks] == rows
+    Matrix **panels;        // per-block householder_qr factors
+    double **tau;
+    int levels;             // reduction tree levels above the blocks
+    int *count;             // nodes per level
+    Matrix ***nodes;        // nodes[l][i]: stacked R factors of its (one or two) children, factored
+    double ***node_tau;
+} TSQR;
+
+// Factors A, or Aᵀ when transpose is set; NULL if it is wide or no memory
+TSQR* tsqr_factor(const Matrix *A, int transpose, int threads);
+void tsqr_get_r(const TSQR *f, Matrix *R);
+// X (rows×k) = Q C for C (cols×k)
+int tsqr_apply_q(const TSQR *f, const Matrix *C, Matrix *X, int threads);
+void tsqr_free(TSQR *f);
+size_t tsqr_memory_bytes(int rows, int cols, int threads);
+
+// CholeskyQR2 on the columns of Q (n×k, n ≥ k) in place: R = chol(QᵀQ) and
+// Q = Q R⁻¹, done twice, with the Gram matrix summed over thread-parallel
+// row chunks. R (k×k, may be NULL) receives the combined factor. Returns 0
+// when Q is too ill-conditioned for Cholesky; Q still spans the same space.
+int cholesky_qr2(Matrix *Q, Matrix *R, int threads);
+// Orthonormal basis for the columns of V in place: CholeskyQR2, or TSQR
+// when V is ill-conditioned or rank deficient. Returns 0 when out of memory.
+int block_orthonormalize(Matrix *V, Matrix *R, int threads);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "mem_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#define MEM_MAX_PHASES 32
+#define MEM_MAX_DEPTH 16
+
+// Every block carries its size in front of the user pointer; 16 bytes
+// keeps the returned pointer aligned for doubles and SSE loads.
+typedef union {
+    size_t size;
+    double align[2];
+} MemHeader;
+
+typedef struct {
+    const char *name;
+    size_t peak;        // highest live bytes seen while the phase was open
+    size_t start_live;
+    long allocs;
+} MemPhaseStats;
+
+// The global counters are updated with atomics so library calls on several
+// threads account correctly. Phases open and close under phase_lock while
+// parallel_for workers keep allocating: the stack entry is stored before
+// depth is raised (release), allocations read depth with acquire and bump
+// the phase counters atomically. Phase records are never freed, so a
+// racing allocation at worst lands in a phase that has just closed.
+static size_t live_bytes = 0;
+static size_t peak_bytes = 0;
+static long alloc_count = 0;
+static size_t limit_bytes = 0;
+
+static pthread_mutex_t phase_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemPhaseStats phases[MEM_MAX_PHASES];
+static int num_phases = 0;
+static MemPhaseStats *open_phases[MEM_MAX_DEPTH];
+static int depth = 0;
+
+static size_t load_live(void) {
+    return __atomic_load_n(&live_bytes, __ATOMIC_RELAXED);
+}
+
+static void account_free(size_t bytes) {
+    __atomic_sub_fetch(&live_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+static void raise_peak(size_t *peak, size_t live) {
+    size_t seen = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (live > seen &&
+           !__atomic_compare_exchange_n(peak, &seen, live, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void account_alloc(size_t bytes) {
+    size_t live = __atomic_add_fetch(&live_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    raise_peak(&peak_bytes, live);
+    int open = __atomic_load_n(&depth, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < open; i++) {
+        MemPhaseStats *s = __atomic_load_n(&open_phases[i], __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s->allocs, 1, __ATOMIC_RELAXED);
+        raise_peak(&s->peak, live);
+    }
+}
+
+// Checked before allocating, so concurrent callers may overshoot the limit
+// by at most their in-flight requests
+static int check_limit(size_t bytes) {
+    size_t live = load_live();
+    if (limit_bytes && live + bytes > limit_bytes) {
+        fprintf(stderr, "Error: Memory limit exceeded (requested %zu bytes, "
+                "%zu live, limit %zu)\n", bytes, live, limit_bytes);
+        return 0;
+    }
+    return 1;
+}
+
+void* mem_alloc(size_t bytes) {
+    if (!check_limit(bytes)) return NULL;
+    MemHeader *h = (MemHeader*)malloc(sizeof(MemHeader) + bytes);
+    if (!h) return NULL;
+    h->size = bytes;
+    account_alloc(bytes);
+    return h + 1;
+}
+
+void* mem_calloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size) return NULL;
+    size_t bytes = count * size;
+    if (!check_limit(bytes)) return NULL;
+    MemHeader *h = (MemHeader*)calloc(1, sizeof(MemHeader) + bytes);
+    if (!h) return NULL;
+    h->size = bytes;
+    account_alloc(bytes);
+    return h + 1;
+}
+
+void* mem_realloc(void *ptr, size_t bytes) {
+    if (!ptr) return mem_alloc(bytes);
+    MemHeader *h = (MemHeader*)ptr - 1;
+    size_t old = h->size;
+    if (bytes > old && !check_limit(bytes - old)) return NULL;
+
+    MemHeader *nh = (MemHeader*)realloc(h, sizeof(MemHeader) + bytes);
+    if (!nh) return NULL;
+    nh->size = bytes;
+    account_free(old);
+    account_alloc(bytes);
+    return nh + 1;
+}
+
+void mem_free(void *ptr) {
+    if (!ptr) return;
+    MemHeader *h = (MemHeader*)ptr - 1;
+    account_free(h->size);
+    free(h);
+}
+
+void mem_track(size_t bytes) {
+    account_alloc(bytes);
+}
+
+void mem_untrack(size_t bytes) {
+    account_free(bytes);
+}
+
+void mem_set_limit(size_t bytes) {
+    limit_bytes = bytes;
+}
+
+size_t mem_limit(void) {
+    return limit_bytes;
+}
+
+int mem_would_fit(size_t bytes) {
+    return !limit_bytes || load_live() + bytes <= limit_bytes;
+}
+
+size_t mem_live_bytes(void) {
+    return load_live();
+}
+
+size_t mem_peak_bytes(void) {
+    return __atomic_load_n(&peak_bytes, __ATOMIC_RELAXED);
+}
+
+long mem_alloc_count(void) {
+    return __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+}
+
+void mem_phase_begin(const char *phase) {
+    pthread_mutex_lock(&phase_lock);
+    if (depth >= MEM_MAX_DEPTH) {
+        pthread_mutex_unlock(&phase_lock);
+        return;
+    }
+
+    MemPhaseStats *s = NULL;
+    for (int i = 0; i < num_phases; i++) {
+        if (strcmp(phases[i].name, phase) == 0) s = &phases[i];
+    }
+    if (!s && num_phases < MEM_MAX_PHASES) {
+        // Not visible to allocating threads until pushed below
+        s = &phases[num_phases++];
+        s->name = phase;
+        s->peak = 0;
+        s->allocs = 0;
+    }
+    if (s) {
+        s->start_live = load_live();
+        raise_peak(&s->peak, s->start_live);
+        __atomic_store_n(&open_phases[depth], s, __ATOMIC_RELAXED);
+        __atomic_store_n(&depth, depth + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&phase_lock);
+}
+
+void mem_phase_end(const char *phase) {
+    pthread_mutex_lock(&phase_lock);
+    if (depth > 0 && strcmp(open_phases[depth - 1]->name, phase) == 0) {
+        __atomic_store_n(&depth, depth - 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&phase_lock);
+}
+
+void mem_report(FILE *fp) {
+    fprintf(fp, "Peak memory: %.2f MB (%ld allocations, %.2f MB still live)\n",
+            mem_peak_bytes() / 1048576.0, mem_alloc_count(), mem_live_bytes() / 1048576.0);
+    pthread_mutex_lock(&phase_lock);
+    for (int i = 0; i < num_phases; i++) {
+        MemPhaseStats *s = &phases[i];
+        fprintf(fp, "  %-12s peak %10.2f MB, %6ld allocations\n", s->name,
+                __atomic_load_n(&s->peak, __ATOMIC_RELAXED) / 1048576.0,
+                __atomic_load_n(&s->allocs, __ATOMIC_RELAXED));
+    }
+    pthread_mutex_unlock(&phase_lock);
+    if (limit_bytes) {
+        fprintf(fp, "Memory limit: %.2f MB\n", limit_bytes / 1048576.0);
+    }
+}
+
+size_t parse_memory_size(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) return 0;
+
+    switch (tolower((unsigned char)*end)) {
+        case 'k': value *= 1024.0; break;
+        case 'm': value *= 1024.0 * 1024.0; break;
+        case 'g': value *= 1024.0 * 1024.0 * 1024.0; break;
+        case '\0': break;
+        default: return 0;
+    }
+    return (size_t)value;
+}
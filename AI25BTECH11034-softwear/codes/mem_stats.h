@@ -0,0 +1,37 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Tracking allocator used by create_matrix, create_pgm_image, the solver
+// scratch vectors and the stb decoder/encoder buffers. Keeps live bytes,
+// peak bytes and allocation counts globally and per named phase, and
+// enforces an optional limit (mem_set_limit) by failing the allocation.
+// Safe to call from any thread. Phases are opened by one driver thread;
+// allocations on worker threads while they are open count towards them.
+
+void* mem_alloc(size_t bytes);
+void* mem_calloc(size_t count, size_t size);
+void* mem_realloc(void *ptr, size_t bytes);
+void mem_free(void *ptr);
+
+// Accounting for memory obtained elsewhere (e.g. anonymous mappings)
+void mem_track(size_t bytes);
+void mem_untrack(size_t bytes);
+
+void mem_set_limit(size_t bytes);   // 0 = unlimited
+size_t mem_limit(void);
+int mem_would_fit(size_t bytes);
+
+size_t mem_live_bytes(void);
+size_t mem_peak_bytes(void);
+long mem_alloc_count(void);
+
+void mem_phase_begin(const char *phase);
+void mem_phase_end(const char *phase);
+void mem_report(FILE *fp);
+
+size_t parse_memory_size(const char *text);
+
+#endif
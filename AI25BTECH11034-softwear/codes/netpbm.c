@@ -0,0 +1,424 @@
+#define _GNU_SOURCE
+#include "netpbm.h"
+#include "mem_stats.h"
+#include "simd_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// Outputs at least this large bypass the page cache with O_DIRECT
+#define NETPBM_DIRECT_THRESHOLD (8u << 20)
+#define NETPBM_DIRECT_ALIGN 4096
+
+static const unsigned char* skip_space_and_comments(const unsigned char *p,
+                                                    const unsigned char *end) {
+    while (p < end) {
+        if (*p == '#') {
+            while (p < end && *p != '\n') p++;
+        } else if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+            p++;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+static const unsigned char* parse_uint(const unsigned char *p, const unsigned char *end,
+                                       int *value) {
+    p = skip_space_and_comments(p, end);
+    if (p == end || *p < '0' || *p > '9') return NULL;
+
+    long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+        if (v > 0x7fffffff) return NULL;
+    }
+    *value = (int)v;
+    return p;
+}
+
+NetpbmFile* netpbm_open(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 3) {
+        fprintf(stderr, "Error: Not a netpbm file %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    // Private writable mapping so an adopted image can be modified in place
+    // without touching the file (pages are copied on first write only).
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map file %s\n", filename);
+        return NULL;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    NetpbmFile *f = (NetpbmFile*)mem_calloc(1, sizeof(NetpbmFile));
+    if (!f) {
+        munmap(map, len);
+        return NULL;
+    }
+    f->map = map;
+    f->map_len = len;
+
+    const unsigned char *p = (const unsigned char*)map;
+    const unsigned char *end = p + len;
+    if (p[0] != 'P' || (p[1] != '2' && p[1] != '5' && p[1] != '6')) {
+        fprintf(stderr, "Error: Unsupported netpbm format in %s (need P2, P5 or P6)\n", filename);
+        netpbm_close(f);
+        return NULL;
+    }
+    f->format = (char)p[1];
+    f->channels = (f->format == '6') ? 3 : 1;
+    p += 2;
+
+    if (!(p = parse_uint(p, end, &f->width)) ||
+        !(p = parse_uint(p, end, &f->height)) ||
+        !(p = parse_uint(p, end, &f->max_val)) ||
+        f->width <= 0 || f->height <= 0 || f->max_val <= 0 || f->max_val > 65535 ||
+        p == end) {
+        fprintf(stderr, "Error: Invalid netpbm header in %s\n", filename);
+        netpbm_close(f);
+        return NULL;
+    }
+    p++; // Single whitespace after maxval
+
+    f->bytes_per_sample = (f->max_val > 255) ? 2 : 1;
+    f->samples = p;
+    f->samples_len = (size_t)(end - p);
+
+    if (f->format != '2') {
+        size_t needed = (size_t)f->width * f->height * f->channels * f->bytes_per_sample;
+        if (f->samples_len < needed) {
+            fprintf(stderr, "Error: Truncated netpbm data in %s\n", filename);
+            netpbm_close(f);
+            return NULL;
+        }
+        f->samples_len = needed;
+    }
+    return f;
+}
+
+void netpbm_close(NetpbmFile *f) {
+    if (!f) return;
+    if (f->map) munmap(f->map, f->map_len);
+    mem_free(f);
+}
+
+static void release_mapping(void *owner) {
+    netpbm_close((NetpbmFile*)owner);
+}
+
+void widen_u8_to_double(const unsigned char *src, double *dst, int n) {
+    simd_kernels()->widen_u8(src, dst, n);
+}
+
+// Netpbm stores 16-bit samples most significant byte first
+void widen_u16be_to_double(const unsigned char *src, double *dst, int n) {
+    simd_kernels()->widen_u16be(src, dst, n);
+}
+
+static int sample_at(const unsigned char *p, int bytes_per_sample) {
+    return bytes_per_sample == 2 ? (p[0] << 8) | p[1] : p[0];
+}
+
+// Gray value of pixel idx for the binary formats; P6 uses the same
+// integer luma weights as stb_image's grayscale conversion.
+static int gray_sample(const NetpbmFile *f, size_t idx) {
+    int bps = f->bytes_per_sample;
+    const unsigned char *p = f->samples + idx * f->channels * bps;
+    if (f->channels == 1) return sample_at(p, bps);
+
+    int r = sample_at(p, bps);
+    int g = sample_at(p + bps, bps);
+    int b = sample_at(p + 2 * bps, bps);
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+// Parses P2 samples one at a time; returns 0 when the data runs out.
+static int next_ascii_sample(const unsigned char **pos, const unsigned char *end, int *value) {
+    const unsigned char *p = parse_uint(*pos, end, value);
+    if (!p) return 0;
+    *pos = p;
+    return 1;
+}
+
+PGMImage* netpbm_to_pgm(NetpbmFile *f) {
+    // 8-bit P5 is exposed in place: the image adopts the mapping
+    if (f->format == '5' && f->bytes_per_sample == 1) {
+        PGMImage *img = pgm_image_adopt((unsigned char*)f->samples, f->width, f->height,
+                                        f->width, f->max_val, f, release_mapping);
+        if (!img) netpbm_close(f);
+        return img;
+    }
+
+    // Everything else is narrowed to 8-bit gray; 16-bit data is rescaled
+    int max_gray = (f->max_val > 255) ? 255 : f->max_val;
+    PGMImage *img = create_pgm_image(f->width, f->height, max_gray);
+    if (!img) {
+        netpbm_close(f);
+        return NULL;
+    }
+
+    const unsigned char *pos = f->samples;
+    const unsigned char *end = f->samples + f->samples_len;
+    for (int i = 0; i < f->height; i++) {
+        unsigned char *row = img->data[i];
+        for (int j = 0; j < f->width; j++) {
+            int v;
+            if (f->format == '2') {
+                if (!next_ascii_sample(&pos, end, &v)) {
+                    fprintf(stderr, "Error: Truncated P2 data\n");
+                    free_pgm_image(img);
+                    netpbm_close(f);
+                    return NULL;
+                }
+            } else {
+                v = gray_sample(f, (size_t)i * f->width + j);
+            }
+            if (v > f->max_val) v = f->max_val;
+            row[j] = (f->max_val > 255) ?
+                (unsigned char)((v * 255 + f->max_val / 2) / f->max_val) : (unsigned char)v;
+        }
+    }
+
+    netpbm_close(f);
+    return img;
+}
+
+// Full-precision path straight into the compute buffer, without the
+// 8-bit narrowing of netpbm_to_pgm.
+int netpbm_to_matrix(const NetpbmFile *f, Matrix *out) {
+    if (out->rows != f->height || out->cols != f->width) {
+        fprintf(stderr, "Error: Matrix dimensions don't match\n");
+        return 0;
+    }
+
+    const unsigned char *pos = f->samples;
+    const unsigned char *end = f->samples + f->samples_len;
+    size_t row_bytes = (size_t)f->width * f->channels * f->bytes_per_sample;
+
+    for (int i = 0; i < f->height; i++) {
+        double *row = out->data[i];
+        if (f->format == '5') {
+            const unsigned char *src = f->samples + i * row_bytes;
+            if (f->bytes_per_sample == 2) {
+                widen_u16be_to_double(src, row, f->width);
+            } else {
+                widen_u8_to_double(src, row, f->width);
+            }
+        } else if (f->format == '6') {
+            for (int j = 0; j < f->width; j++) {
+                const unsigned char *p = f->samples + ((size_t)i * f->width + j) * 3 * f->bytes_per_sample;
+                int bps = f->bytes_per_sample;
+                row[j] = (sample_at(p, bps) * 77.0 + sample_at(p + bps, bps) * 150.0 +
+                          sample_at(p + 2 * bps, bps) * 29.0) / 256.0;
+            }
+        } else {
+            for (int j = 0; j < f->width; j++) {
+                int v;
+                if (!next_ascii_sample(&pos, end, &v)) {
+                    fprintf(stderr, "Error: Truncated P2 data\n");
+                    return 0;
+                }
+                row[j] = v;
+            }
+        }
+    }
+    return 1;
+}
+
+PGMImage* netpbm_read(const char *filename) {
+    NetpbmFile *f = netpbm_open(filename);
+    if (!f) return NULL;
+
+    int width = f->width, height = f->height, max_val = f->max_val;
+    char format = f->format;
+    PGMImage *img = netpbm_to_pgm(f);
+    if (img) {
+        printf("Successfully read P%c image: %dx%d, maxval=%d\n", format, width, height, max_val);
+    }
+    return img;
+}
+
+static int write_all(int fd, const unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Large outputs are staged in one page-aligned buffer and written with
+// O_DIRECT, finishing the unaligned tail after clearing the flag. Smaller
+// ones go out as a single writev of header and pixels.
+static int write_netpbm_file(const char *filename, const char *header, size_t header_len,
+                             const unsigned char *body, size_t body_len) {
+    size_t total = header_len + body_len;
+
+#ifdef O_DIRECT
+    if (total >= NETPBM_DIRECT_THRESHOLD) {
+        int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        unsigned char *block = fd >= 0 ? (unsigned char*)mem_alloc(total + NETPBM_DIRECT_ALIGN) : NULL;
+        if (block) {
+            unsigned char *staging = block + (NETPBM_DIRECT_ALIGN -
+                                              (uintptr_t)block % NETPBM_DIRECT_ALIGN);
+            memcpy(staging, header, header_len);
+            memcpy((unsigned char*)staging + header_len, body, body_len);
+
+            size_t aligned = total - total % NETPBM_DIRECT_ALIGN;
+            int ok = write_all(fd, staging, aligned);
+            if (ok && aligned < total) {
+                ok = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) == 0 &&
+                     write_all(fd, staging + aligned, total - aligned);
+            }
+            mem_free(block);
+            if (close(fd) == 0 && ok) return 1;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        // Filesystems without O_DIRECT support fall through to buffered I/O
+    }
+#endif
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        return 0;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)header;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void*)body;
+    iov[1].iov_len = body_len;
+
+    ssize_t n = writev(fd, iov, 2);
+    int ok = n >= 0;
+    if (ok && (size_t)n < total) {
+        // Short write: finish whatever is left of header and body
+        size_t done = (size_t)n;
+        if (done < header_len) {
+            ok = write_all(fd, (const unsigned char*)header + done, header_len - done);
+            done = header_len;
+        }
+        ok = ok && write_all(fd, body + (done - header_len), body_len - (done - header_len));
+    }
+    if (close(fd) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write image data\n");
+    return ok;
+}
+
+// Sample j of a row of width as P2 text, followed by its separator; at
+// most 6 bytes
+static size_t format_ascii_sample(unsigned int v, int j, int width, unsigned char *out) {
+    unsigned char digits[5];
+    size_t len = 0, pos = 0;
+    do {
+        digits[len++] = (unsigned char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (len > 0) out[pos++] = digits[--len];
+    // Keep lines under the 70 character limit of the format
+    out[pos++] = (j % 10 == 9 || j == width - 1) ? '\n' : ' ';
+    return pos;
+}
+
+static size_t format_ascii_samples(PGMImage *img, unsigned char *out) {
+    size_t pos = 0;
+    for (int i = 0; i < img->height; i++) {
+        for (int j = 0; j < img->width; j++) {
+            pos += format_ascii_sample(img->data[i][j], j, img->width, out + pos);
+        }
+    }
+    return pos;
+}
+
+int netpbm_write_pgm(const char *filename, PGMImage *img, int ascii) {
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "P%c\n%d %d\n%d\n",
+                              ascii ? '2' : '5', img->width, img->height, img->max_gray);
+
+    unsigned char *body = img->pixels;
+    size_t body_len = (size_t)img->width * img->height;
+    int packed = 0;
+
+    if (ascii) {
+        body = (unsigned char*)mem_alloc(body_len * 4);
+        if (!body) return 0;
+        body_len = format_ascii_samples(img, body);
+        packed = 1;
+    } else if (img->stride != img->width) {
+        body = (unsigned char*)mem_alloc(body_len);
+        if (!body) return 0;
+        for (int i = 0; i < img->height; i++) {
+            memcpy(body + (size_t)i * img->width, img->data[i], img->width);
+        }
+        packed = 1;
+    }
+
+    int ok = write_netpbm_file(filename, header, header_len, body, body_len);
+    if (packed) mem_free(body);
+    if (ok) printf("Successfully wrote PGM image: %s\n", filename);
+    return ok;
+}
+
+// Writes a P5 (or P2 when ascii) file straight from the compute buffer,
+// clamping and rounding to max_val; binary values above 255 produce
+// big-endian 16-bit samples.
+int netpbm_write_matrix(const char *filename, Matrix *m, int max_val, int ascii) {
+    if (max_val <= 0 || max_val > 65535) {
+        fprintf(stderr, "Error: Invalid maxval %d\n", max_val);
+        return 0;
+    }
+    int bps = (max_val > 255) ? 2 : 1;
+    size_t samples = (size_t)m->rows * m->cols;
+    unsigned char *body = (unsigned char*)mem_alloc(samples * (ascii ? 6 : bps));
+    if (!body) return 0;
+
+    unsigned char *p = body;
+    for (int i = 0; i < m->rows; i++) {
+        for (int j = 0; j < m->cols; j++) {
+            double val = m->data[i][j];
+            if (val < 0) val = 0;
+            if (val > max_val) val = max_val;
+            unsigned int v = (unsigned int)(val + 0.5);
+            if (ascii) {
+                p += format_ascii_sample(v, j, m->cols, p);
+                continue;
+            }
+            if (bps == 2) *p++ = (unsigned char)(v >> 8);
+            *p++ = (unsigned char)(v & 0xff);
+        }
+    }
+
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "P%c\n%d %d\n%d\n",
+                              ascii ? '2' : '5', m->cols, m->rows, max_val);
+    int ok = write_netpbm_file(filename, header, header_len, body, (size_t)(p - body));
+    mem_free(body);
+    if (ok) printf("Successfully wrote P%c image: %s (maxval %d)\n", ascii ? '2' : '5', filename, max_val);
+    return ok;
+}
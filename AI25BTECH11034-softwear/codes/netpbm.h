@@ -0,0 +1,37 @@
+#ifndef NETPBM_H
+#define NETPBM_H
+
+#include <stddef.h>
+#include "pgm_io.h"
+#include "matrix.h"
+
+// Memory-mapped netpbm backend: P2 (ASCII gray), P5 (binary gray) and
+// P6 (binary RGB), with 8-bit or 16-bit big-endian samples. The header is
+// parsed once and binary sample data is exposed in place from the mapping.
+typedef struct {
+    char format;                    // '2', '5' or '6'
+    int width;
+    int height;
+    int channels;                   // 1 for P2/P5, 3 for P6
+    int max_val;
+    int bytes_per_sample;           // 1, or 2 when max_val > 255
+    const unsigned char *samples;   // first sample, inside the mapping
+    size_t samples_len;
+    void *map;
+    size_t map_len;
+} NetpbmFile;
+
+NetpbmFile* netpbm_open(const char *filename);
+void netpbm_close(NetpbmFile *f);
+
+PGMImage* netpbm_to_pgm(NetpbmFile *f);
+int netpbm_to_matrix(const NetpbmFile *f, Matrix *out);
+PGMImage* netpbm_read(const char *filename);
+
+int netpbm_write_pgm(const char *filename, PGMImage *img, int ascii);
+int netpbm_write_matrix(const char *filename, Matrix *m, int max_val, int ascii);
+
+void widen_u8_to_double(const unsigned char *src, double *dst, int n);
+void widen_u16be_to_double(const unsigned char *src, double *dst, int n);
+
+#endif
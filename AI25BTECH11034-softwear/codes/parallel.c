@@ -0,0 +1,51 @@
+#define _GNU_SOURCE
+#include "parallel.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#define PARALLEL_MAX_THREADS 64
+
+typedef struct {
+    ParallelFn fn;
+    void *arg;
+    int begin;
+    int end;
+} ParallelChunk;
+
+static void* run_chunk(void *p) {
+    ParallelChunk *c = (ParallelChunk*)p;
+    if (c->begin < c->end) c->fn(c->arg, c->begin, c->end);
+    return NULL;
+}
+
+void parallel_for(int threads, int n, ParallelFn fn, void *arg) {
+    if (threads > n) threads = n;
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    if (threads <= 1) {
+        if (n > 0) fn(arg, 0, n);
+        return;
+    }
+
+    pthread_t tid[PARALLEL_MAX_THREADS];
+    ParallelChunk chunks[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        chunks[t].fn = fn;
+        chunks[t].arg = arg;
+        chunks[t].begin = (int)((long)n * t / threads);
+        chunks[t].end = (int)((long)n * (t + 1) / threads);
+    }
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&tid[t], NULL, run_chunk, &chunks[t]) == 0;
+    }
+    run_chunk(&chunks[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(tid[t], NULL);
+        else run_chunk(&chunks[t]);
+    }
+}
+
+int parallel_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
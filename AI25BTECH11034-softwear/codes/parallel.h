@@ -0,0 +1,12 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Splits [0, n) into contiguous chunks and runs fn on each from its own
+// thread, the caller taking the first chunk. With threads <= 1 (or when a
+// thread cannot be started) the work simply runs on the caller.
+typedef void (*ParallelFn)(void *arg, int begin, int end);
+
+void parallel_for(int threads, int n, ParallelFn fn, void *arg);
+int parallel_cpu_count(void);
+
+#endif
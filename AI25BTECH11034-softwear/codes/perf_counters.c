@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include "perf_counters.h"
+#include "simd_kernels.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define PERF_MAX_PHASES 32
+#define PERF_MAX_DEPTH 16
+
+enum { CNT_CYCLES, CNT_INSTRUCTIONS, CNT_LLC_MISSES, CNT_COUNT };
+
+typedef struct {
+    const char *name;
+    long calls;
+    double seconds;
+    unsigned long long counts[CNT_COUNT];
+    double flops;
+    double bytes;
+} PerfPhaseStats;
+
+typedef struct {
+    const char *name;
+    double start_time;
+    unsigned long long start_counts[CNT_COUNT];
+} PerfFrame;
+
+static int perf_on = 0;
+static int perf_hw = 0;
+static int perf_fds[CNT_COUNT] = {-1, -1, -1};
+static PerfPhaseStats phases[PERF_MAX_PHASES];
+static int num_phases = 0;
+static PerfFrame stack[PERF_MAX_DEPTH];
+static int depth = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef __linux__
+static int open_counter(unsigned int type, unsigned long long config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Threads started later (the parallel_for workers) count into these
+    // counters too; their totals are folded in as they exit, before join
+    attr.inherit = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void read_counters(unsigned long long *counts) {
+    memset(counts, 0, CNT_COUNT * sizeof(unsigned long long));
+#ifdef __linux__
+    if (!perf_hw) return;
+    for (int c = 0; c < CNT_COUNT; c++) {
+        if (perf_fds[c] < 0) continue;
+        unsigned long long value;
+        if (read(perf_fds[c], &value, sizeof(value)) == sizeof(value)) {
+            counts[c] = value;
+        }
+    }
+#endif
+}
+
+int perf_enable(void) {
+    perf_reset();
+    perf_on = 1;
+    perf_hw = 0;
+#ifdef __linux__
+    perf_fds[CNT_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (perf_fds[CNT_CYCLES] >= 0) {
+        int leader = perf_fds[CNT_CYCLES];
+        perf_fds[CNT_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE,
+                                                  PERF_COUNT_HW_INSTRUCTIONS, leader);
+        perf_fds[CNT_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE,
+                                                PERF_COUNT_HW_CACHE_MISSES, leader);
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        perf_hw = 1;
+    }
+#endif
+    if (!perf_hw) {
+        fprintf(stderr, "Warning: hardware counters unavailable, reporting time only\n");
+    }
+    return perf_hw;
+}
+
+void perf_disable(void) {
+#ifdef __linux__
+    for (int c = 0; c < CNT_COUNT; c++) {
+        if (perf_fds[c] >= 0) close(perf_fds[c]);
+        perf_fds[c] = -1;
+    }
+#endif
+    perf_on = 0;
+    perf_hw = 0;
+}
+
+int perf_enabled(void) {
+    return perf_on;
+}
+
+void perf_reset(void) {
+    memset(phases, 0, sizeof(phases));
+    num_phases = 0;
+    depth = 0;
+}
+
+static PerfPhaseStats* find_phase(const char *name) {
+    for (int i = 0; i < num_phases; i++) {
+        if (phases[i].name == name || strcmp(phases[i].name, name) == 0) {
+            return &phases[i];
+        }
+    }
+    if (num_phases == PERF_MAX_PHASES) return NULL;
+    phases[num_phases].name = name;
+    return &phases[num_phases++];
+}
+
+void perf_phase_begin(const char *phase) {
+    if (!perf_on) return;
+    if (depth == PERF_MAX_DEPTH) {
+        depth++;
+        return;
+    }
+    PerfFrame *f = &stack[depth++];
+    f->name = phase;
+    read_counters(f->start_counts);
+    f->start_time = now_seconds();
+}
+
+void perf_phase_end(const char *phase, double flops, double bytes) {
+    if (!perf_on || depth == 0) return;
+    double end_time = now_seconds();
+    unsigned long long end_counts[CNT_COUNT];
+    read_counters(end_counts);
+
+    if (depth-- > PERF_MAX_DEPTH) return;
+    PerfFrame *f = &stack[depth];
+    if (strcmp(f->name, phase) != 0) {
+        fprintf(stderr, "Warning: perf phase '%s' ended while '%s' was open\n",
+                phase, f->name);
+        return;
+    }
+
+    PerfPhaseStats *s = find_phase(phase);
+    if (!s) return;
+    s->calls++;
+    s->seconds += end_time - f->start_time;
+    for (int c = 0; c < CNT_COUNT; c++) {
+        s->counts[c] += end_counts[c] - f->start_counts[c];
+    }
+    s->flops += flops;
+    s->bytes += bytes;
+}
+
+void perf_report(FILE *fp) {
+    if (!perf_on) return;
+
+    fprintf(fp, "\n=== Performance Counters ===\n");
+    fprintf(fp, "Kernels: %s\n", simd_level_name(simd_kernels()->level));
+    fprintf(fp, "%-16s %6s %10s %14s %14s %6s %12s %9s %9s %8s\n",
+            "phase", "calls", "time(ms)", "cycles", "instructions", "IPC",
+            "LLC-misses", "GFLOP/s", "GB/s", "flop/B");
+    for (int i = 0; i < num_phases; i++) {
+        PerfPhaseStats *s = &phases[i];
+        double t = s->seconds > 0 ? s->seconds : 1e-12;
+        double ipc = s->counts[CNT_CYCLES] ?
+            (double)s->counts[CNT_INSTRUCTIONS] / s->counts[CNT_CYCLES] : 0.0;
+        double intensity = s->bytes > 0 ? s->flops / s->bytes : 0.0;
+
+        if (perf_hw) {
+            fprintf(fp, "%-16s %6ld %10.3f %14llu %14llu %6.2f %12llu %9.3f %9.3f %8.3f\n",
+                    s->name, s->calls, s->seconds * 1e3,
+                    s->counts[CNT_CYCLES], s->counts[CNT_INSTRUCTIONS], ipc,
+                    s->counts[CNT_LLC_MISSES],
+                    s->flops / t * 1e-9, s->bytes / t * 1e-9, intensity);
+        } else {
+            fprintf(fp, "%-16s %6ld %10.3f %14s %14s %6s %12s %9.3f %9.3f %8.3f\n",
+                    s->name, s->calls, s->seconds * 1e3, "-", "-", "-", "-",
+                    s->flops / t * 1e-9, s->bytes / t * 1e-9, intensity);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+
+// Optional per-phase profiler. When enabled, every perf_phase_begin/end pair
+// accumulates wall time and (on Linux, via perf_event_open) cycles,
+// instructions and last-level cache misses under the given phase name.
+// flops and bytes are the caller's count of floating point operations and
+// bytes loaded/stored by the kernel, used for FLOP/s, bytes/s and intensity.
+// Disabled by default; the hooks then cost a single branch.
+//
+// Counters cover the calling thread and every thread it starts after
+// perf_enable, so parallel_for phases count all their workers. The phase
+// stack itself is global and unsynchronized: one run, with begin/end
+// called only from the driver thread (not, e.g., from daemon workers).
+
+int perf_enable(void);
+void perf_disable(void);
+int perf_enabled(void);
+
+void perf_phase_begin(const char *phase);
+void perf_phase_end(const char *phase, double flops, double bytes);
+
+void perf_report(FILE *fp);
+void perf_reset(void);
+
+#endif
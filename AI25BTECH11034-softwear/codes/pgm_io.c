@@ -1,6 +1,16 @@
 #include "pgm_io.h"
+#include "netpbm.h"
+#include "mem_stats.h"
 #include <string.h>
 
+// Route the stb decoder/encoder buffers through the tracking allocator
+#define STBI_MALLOC(sz) mem_alloc(sz)
+#define STBI_REALLOC(p, newsz) mem_realloc(p, newsz)
+#define STBI_FREE(p) mem_free(p)
+#define STBIW_MALLOC(sz) mem_alloc(sz)
+#define STBIW_REALLOC(p, newsz) mem_realloc(p, newsz)
+#define STBIW_FREE(p) mem_free(p)
+
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image.h"
@@ -22,122 +32,66 @@ int get_file_extension(const char *filename, char *ext, int max_len) {
     return 1;
 }
 
-PGMImage* create_pgm_image(int width, int height, int max_gray) {
-    PGMImage *img = (PGMImage*)malloc(sizeof(PGMImage));
+// Wraps an existing pixel buffer without copying it. release(owner) is
+// called from free_pgm_image; pass NULL to leave the buffer with the caller.
+PGMImage* pgm_image_adopt(unsigned char *pixels, int width, int height, int stride,
+                          int max_gray, void *owner, void (*release)(void *owner)) {
+    PGMImage *img = (PGMImage*)mem_alloc(sizeof(PGMImage));
     if (!img) return NULL;
     
     img->width = width;
     img->height = height;
     img->max_gray = max_gray;
+    img->stride = stride;
+    img->pixels = pixels;
+    img->owner = owner;
+    img->release = release;
     
-    img->data = (unsigned char**)malloc(height * sizeof(unsigned char*));
+    img->data = (unsigned char**)mem_alloc(height * sizeof(unsigned char*));
     if (!img->data) {
-        free(img);
+        mem_free(img);
         return NULL;
     }
     
     for (int i = 0; i < height; i++) {
-        img->data[i] = (unsigned char*)calloc(width, sizeof(unsigned char));
-        if (!img->data[i]) {
-            for (int j = 0; j < i; j++) free(img->data[j]);
-            free(img->data);
-            free(img);
-            return NULL;
-        }
+        img->data[i] = pixels + (size_t)i * stride;
     }
     return img;
 }
 
-PGMImage* read_pgm_p5(const char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot open file %s\n", filename);
-        return NULL;
-    }
-    
-    char magic[3];
-    if (fscanf(fp, "%2s", magic) != 1 || strcmp(magic, "P5") != 0) {
-        fprintf(stderr, "Error: Not a P5 PGM file\n");
-        fclose(fp);
-        return NULL;
-    }
-    
-    // Skip comments
-    int c;
-    while ((c = fgetc(fp)) == '#') {
-        while (fgetc(fp) != '\n');
-    }
-    ungetc(c, fp);
-    
-    int width, height, max_gray;
-    if (fscanf(fp, "%d %d %d", &width, &height, &max_gray) != 3) {
-        fprintf(stderr, "Error: Invalid PGM header\n");
-        fclose(fp);
-        return NULL;
-    }
-    fgetc(fp); // Skip single whitespace after header
-    
-    PGMImage *img = create_pgm_image(width, height, max_gray);
-    if (!img) {
-        fclose(fp);
-        return NULL;
-    }
-    
-    for (int i = 0; i < height; i++) {
-        if (fread(img->data[i], sizeof(unsigned char), width, fp) != width) {
-            fprintf(stderr, "Error: Failed to read image data\n");
-            free_pgm_image(img);
-            fclose(fp);
-            return NULL;
-        }
-    }
+PGMImage* create_pgm_image(int width, int height, int max_gray) {
+    unsigned char *pixels = (unsigned char*)mem_calloc((size_t)width * height, 1);
+    if (!pixels) return NULL;
     
-    fclose(fp);
-    printf("Successfully read PGM image: %dx%d, max_gray=%d\n", width, height, max_gray);
+    PGMImage *img = pgm_image_adopt(pixels, width, height, width, max_gray, pixels, mem_free);
+    if (!img) mem_free(pixels);
     return img;
 }
 
+PGMImage* read_pgm_p5(const char *filename) {
+    return netpbm_read(filename);
+}
+
 int write_pgm_p5(const char *filename, PGMImage *img) {
-    FILE *fp = fopen(filename, "wb");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot create file %s\n", filename);
-        return 0;
-    }
-    
-    fprintf(fp, "P5\n%d %d\n%d\n", img->width, img->height, img->max_gray);
-    
-    for (int i = 0; i < img->height; i++) {
-        if (fwrite(img->data[i], sizeof(unsigned char), img->width, fp) != img->width) {
-            fprintf(stderr, "Error: Failed to write image data\n");
-            fclose(fp);
-            return 0;
-        }
-    }
-    
-    fclose(fp);
-    printf("Successfully wrote PGM image: %s\n", filename);
-    return 1;
+    return netpbm_write_pgm(filename, img, 0);
 }
 
 void free_pgm_image(PGMImage *img) {
     if (!img) return;
     
-    if (img->data) {
-        for (int i = 0; i < img->height; i++) {
-            free(img->data[i]);
-        }
-        free(img->data);
-    }
-    free(img);
+    if (img->release) img->release(img->owner);
+    mem_free(img->data);
+    mem_free(img);
 }
 
-PGMImage* read_image(const char *filename) {
+int is_netpbm_file(const char *filename) {
     char ext[10];
-    if (get_file_extension(filename, ext, sizeof(ext))) {
-        if (strcmp(ext, "pgm") == 0) {
-            return read_pgm_p5(filename);
-        }
-    }
+    return get_file_extension(filename, ext, sizeof(ext)) &&
+           (strcmp(ext, "pgm") == 0 || strcmp(ext, "ppm") == 0 || strcmp(ext, "pnm") == 0);
+}
+
+PGMImage* read_image(const char *filename) {
+    if (is_netpbm_file(filename)) return netpbm_read(filename);
     
     // Use stb_image for JPG, PNG, etc.
     int width, height, channels;
@@ -148,33 +102,32 @@ PGMImage* read_image(const char *filename) {
         return NULL;
     }
     
-    PGMImage *img = create_pgm_image(width, height, 255);
+    // Adopt the decoder's buffer instead of copying it
+    PGMImage *img = pgm_image_adopt(img_data, width, height, width, 255,
+                                    img_data, stbi_image_free);
     if (!img) {
         stbi_image_free(img_data);
         return NULL;
     }
     
-    // Copy data
-    for (int i = 0; i < height; i++) {
-        memcpy(img->data[i], img_data + i * width, width);
-    }
-    
-    stbi_image_free(img_data);
     printf("Successfully read image: %dx%d (converted to grayscale)\n", width, height);
     return img;
 }
 
 int write_jpg(const char *filename, PGMImage *img, int quality) {
-    // Flatten 2D array to 1D for stb_image_write
-    unsigned char *flat_data = (unsigned char*)malloc(img->height * img->width);
-    if (!flat_data) return 0;
-    
-    for (int i = 0; i < img->height; i++) {
-        memcpy(flat_data + i * img->width, img->data[i], img->width);
+    // stbi_write_jpg has no stride argument, so only padded rows need packing
+    unsigned char *flat_data = img->pixels;
+    if (img->stride != img->width) {
+        flat_data = (unsigned char*)mem_alloc((size_t)img->height * img->width);
+        if (!flat_data) return 0;
+        
+        for (int i = 0; i < img->height; i++) {
+            memcpy(flat_data + (size_t)i * img->width, img->data[i], img->width);
+        }
     }
     
     int result = stbi_write_jpg(filename, img->width, img->height, 1, flat_data, quality);
-    free(flat_data);
+    if (flat_data != img->pixels) mem_free(flat_data);
     
     if (result) {
         printf("Successfully wrote JPG image: %s\n", filename);
@@ -192,16 +145,8 @@ int write_image(const char *filename, PGMImage *img) {
         } else if (strcmp(ext, "jpg") == 0 || strcmp(ext, "jpeg") == 0) {
             return write_jpg(filename, img, 90); // 90% quality
         } else if (strcmp(ext, "png") == 0) {
-            // Flatten data for PNG
-            unsigned char *flat_data = (unsigned char*)malloc(img->height * img->width);
-            if (!flat_data) return 0;
-            
-            for (int i = 0; i < img->height; i++) {
-                memcpy(flat_data + i * img->width, img->data[i], img->width);
-            }
-            
-            int result = stbi_write_png(filename, img->width, img->height, 1, flat_data, img->width);
-            free(flat_data);
+            int result = stbi_write_png(filename, img->width, img->height, 1,
+                                        img->pixels, img->stride);
             
             if (result) {
                 printf("Successfully wrote PNG image: %s\n", filename);
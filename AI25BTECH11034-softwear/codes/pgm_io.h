@@ -8,15 +8,23 @@ typedef struct {
     int width;
     int height;
     int max_gray;
-    unsigned char **data;
+    int stride;                 // bytes between the starts of two rows
+    unsigned char *pixels;      // one contiguous buffer of height * stride bytes
+    unsigned char **data;       // row pointers into pixels
+    void *owner;                // handed to release() when the image is freed
+    void (*release)(void *owner);
 } PGMImage;
 
 PGMImage* read_pgm_p5(const char *filename);
 PGMImage* read_image(const char *filename);  
+// .pgm, .ppm or .pnm
+int is_netpbm_file(const char *filename);
 int write_pgm_p5(const char *filename, PGMImage *img);
 int write_jpg(const char *filename, PGMImage *img, int quality);
 int write_image(const char *filename, PGMImage *img);  
 void free_pgm_image(PGMImage *img);
 PGMImage* create_pgm_image(int width, int height, int max_gray);
+PGMImage* pgm_image_adopt(unsigned char *pixels, int width, int height, int stride,
+                          int max_gray, void *owner, void (*release)(void *owner));
 
 #endif
\ No newline at end of file
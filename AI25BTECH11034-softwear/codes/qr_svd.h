@@ -0,0 +1,15 @@
+#ifndef QR_SVD_H
+#define QR_SVD_H
+
+#include "lanczos.h"
+
+// QR-preconditioned SVD for very tall (or, via Aᵀ, very wide) matrices:
+// a tall-skinny QR reduces A to its small N×N R factor, R is decomposed by
+// svd_compute, and the long singular vectors are mapped back through the
+// implicit Q. Only the TSQR and the final Q application touch A-sized data,
+// each in one parallel pass. Intermediates live on the heap; the result
+// lives in opts->ws when one is given.
+SVDResult* qr_svd(Matrix *A, int k, const SVDOptions *opts);
+size_t qr_svd_memory_bytes(int m, int n, int k, int threads);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <time.h>
+
+// xorshift64* generator for start vectors and oversampling columns. Each
+// solve carries its own state, so concurrent solves neither share nor
+// perturb each other's sequence the way srand()/rand() did.
+
+// Scrambles seed (splitmix64) into a usable nonzero state; 0 seeds from the
+// clock and the caller's stack address so simultaneous calls still differ.
+static inline uint64_t rng_seed(uint64_t seed) {
+    uint64_t z = seed ? seed : ((uint64_t)time(NULL) << 20) ^ (uint64_t)(uintptr_t)&seed;
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [-0.5, 0.5), the range the rand()-based start vectors used
+static inline double rng_uniform(uint64_t *state) {
+    return (double)(rng_next(state) >> 11) * (1.0 / 9007199254740992.0) - 0.5;
+}
+
+#endif
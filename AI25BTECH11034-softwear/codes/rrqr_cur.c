@@ -0,0 +1,316 @@
+#include "rrqr_cur.h"
+#include "svd_engine.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include "rng.h"
+#include <stdio.h>
+#include <string.h>
+
+// Tail norms are recomputed once downdating has cancelled this much of them
+#define PIVOT_NORM_RECOMPUTE 1e-8
+
+typedef struct {
+    Matrix *W;
+    int j;
+    double tau;
+    double *norms;
+} ReflectTask;
+
+// Applies reflector j (stored in row j) to rows [begin, end) of W and
+// downdates their remaining squared norms
+static void reflect_rows(void *arg, int begin, int end) {
+    ReflectTask *t = (ReflectTask*)arg;
+    int len = t->W->cols, j = t->j;
+    const double *v = t->W->data[j];
+    // Rows after the pivot: task index 0 is row j + 1
+    for (int c = j + 1 + begin; c < j + 1 + end; c++) {
+        double *w = t->W->data[c];
+        double s = w[j];
+        for (int i = j + 1; i < len; i++) s += v[i] * w[i];
+        s *= t->tau;
+        w[j] -= s;
+        for (int i = j + 1; i < len; i++) w[i] -= s * v[i];
+
+        double left = t->norms[c] - w[j] * w[j];
+        if (left < PIVOT_NORM_RECOMPUTE * t->norms[c]) {
+            left = 0.0;
+            for (int i = j + 1; i < len; i++) left += w[i] * w[i];
+        }
+        t->norms[c] = left;
+    }
+}
+
+// Column-pivoted QR on the rows of W (each row is one candidate column of
+// length W->cols), stopped after k steps. Rows are swapped in place and
+// perm[r] names the original row now at r. Afterwards row c holds the R
+// entries R[i][c] = W[c][i] for i < min(c, k), β on the diagonal for c < k,
+// and reflector c's tail beyond it. Returns the steps taken, fewer than k
+// when the remaining columns vanish.
+static int pivoted_qr(Matrix *W, int k, int *perm, double *tau, int threads) {
+    int n = W->rows, len = W->cols;
+    if (k > n) k = n;
+    if (k > len) k = len;
+    double *norms = (double*)mem_alloc(n * sizeof(double));
+    if (!norms) return -1;
+    for (int c = 0; c < n; c++) {
+        double s = 0.0;
+        for (int i = 0; i < len; i++) s += W->data[c][i] * W->data[c][i];
+        norms[c] = s;
+        perm[c] = c;
+    }
+
+    int steps = 0;
+    for (int j = 0; j < k; j++) {
+        int best = j;
+        for (int c = j + 1; c < n; c++) {
+            if (norms[c] > norms[best]) best = c;
+        }
+        if (norms[best] <= 0.0) break;
+        double *row = W->data[j];
+        W->data[j] = W->data[best];
+        W->data[best] = row;
+        double nt = norms[j];
+        norms[j] = norms[best];
+        norms[best] = nt;
+        int pt = perm[j];
+        perm[j] = perm[best];
+        perm[best] = pt;
+
+        tau[j] = householder_vector(&W->data[j][j], len - j, 1);
+        ReflectTask task = { W, j, tau[j], norms };
+        if (tau[j] != 0.0 && j + 1 < n) {
+            parallel_for(n - j - 1 > 64 ? threads : 1, n - j - 1, reflect_rows, &task);
+        }
+        steps++;
+    }
+    mem_free(norms);
+    return steps;
+}
+
+// Q_k = H_0 ... H_{k-1} [I; 0] (len × k) from the reflectors in rows 0..k-1;
+// w is k doubles of scratch
+static void form_q(const Matrix *W, const double *tau, int k, Matrix *Q, double *w) {
+    int len = W->cols;
+    for (int i = 0; i < len; i++) memset(Q->data[i], 0, k * sizeof(double));
+    for (int i = 0; i < k; i++) Q->data[i][i] = 1.0;
+    for (int j = k - 1; j >= 0; j--) {
+        if (tau[j] == 0.0) continue;
+        const double *v = W->data[j];
+        memcpy(w, Q->data[j], k * sizeof(double));
+        for (int i = j + 1; i < len; i++) {
+            const double *qi = Q->data[i];
+            for (int q = 0; q < k; q++) w[q] += v[i] * qi[q];
+        }
+        for (int q = 0; q < k; q++) {
+            w[q] *= tau[j];
+            Q->data[j][q] -= w[q];
+        }
+        for (int i = j + 1; i < len; i++) {
+            double *qi = Q->data[i];
+            for (int q = 0; q < k; q++) qi[q] -= v[i] * w[q];
+        }
+    }
+}
+
+// A ≈ L S Rᵀ with orthonormal L (m×k) and R (n×k, or NULL for the
+// identity): the SVD of the small S is rotated out to U = L Ũ, V = R Ṽ
+static SVDResult* rotate_small(const Matrix *L, Matrix *S, const Matrix *R, int m, int n,
+                               const SVDOptions *opts) {
+    SVDOptions inner = *opts;
+    inner.ws = NULL;
+    inner.verbose = 0;
+    inner.engine = SVD_ENGINE_AUTO;
+    inner.start = NULL;
+    int k = S->rows < S->cols ? S->rows : S->cols;
+    SVDResult *small = svd_compute(S, k, &inner);
+    if (!small) return NULL;
+
+    SVDResult *result = create_svd_result(opts->ws, m, n, k);
+    if (result) {
+        memcpy(result->singular_values, small->singular_values, k * sizeof(double));
+        for (int i = 0; i < m; i++) {
+            double *u = result->U->data[i];
+            memset(u, 0, k * sizeof(double));
+            for (int a = 0; a < L->cols; a++) {
+                double l = L->data[i][a];
+                const double *su = small->U->data[a];
+                for (int q = 0; q < k; q++) u[q] += l * su[q];
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            double *v = result->V->data[j];
+            if (!R) {
+                memcpy(v, small->V->data[j], k * sizeof(double));
+                continue;
+            }
+            memset(v, 0, k * sizeof(double));
+            for (int a = 0; a < R->cols; a++) {
+                double r = R->data[j][a];
+                const double *sv = small->V->data[a];
+                for (int q = 0; q < k; q++) v[q] += r * sv[q];
+            }
+        }
+    }
+    free_svd_result(small);
+    return result;
+}
+
+SVDResult* rrqr_svd(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows, n = A->cols;
+    if (k > m) k = m;
+    if (k > n) k = n;
+    if (opts->verbose) printf("Computing rank-%d approximation by column-pivoted QR...\n", k);
+
+    // Columns of A become contiguous rows
+    Matrix *W = create_matrix_uninit(n, m);
+    Matrix *Q = create_matrix_uninit(m, k);
+    Matrix *B = NULL;
+    int *perm = (int*)mem_alloc(n * sizeof(int));
+    double *tau = (double*)mem_alloc(k * sizeof(double));
+    double *w = (double*)mem_alloc(k * sizeof(double));
+    SVDResult *result = NULL;
+    int steps = -1;
+
+    if (W && Q && perm && tau && w) {
+        matrix_transpose(A, W);
+        perf_phase_begin("pivoted_qr");
+        steps = pivoted_qr(W, k, perm, tau, opts->threads);
+        perf_phase_end("pivoted_qr", 4.0 * m * n * k, 16.0 * m * n * k);
+    }
+    if (steps > 0) {
+        k = steps;
+        Q->cols = k;
+        form_q(W, tau, k, Q, w);
+        // B = R_k Pᵀ: column perm[c] of B is column c of R
+        B = create_matrix(k, n);
+        for (int c = 0; B && c < n; c++) {
+            int top = c < k ? c : k;
+            for (int i = 0; i < top; i++) B->data[i][perm[c]] = W->data[c][i];
+            if (c < k) B->data[c][perm[c]] = W->data[c][c];
+        }
+        if (B) result = rotate_small(Q, B, NULL, m, n, opts);
+    }
+
+    free_matrix(B);
+    free_matrix(W);
+    free_matrix(Q);
+    mem_free(perm);
+    mem_free(tau);
+    mem_free(w);
+    if (result && opts->verbose) svd_print_summary(result);
+    return result;
+}
+
+typedef struct {
+    const Matrix *A;
+    const Matrix *X;            // left factor (s × m) or right factor (n × s)
+    Matrix *Y;
+    int left;                   // Y = X A (rows of Y split) or Y = A X (rows of A split)
+} SketchTask;
+
+static void sketch_rows(void *arg, int begin, int end) {
+    SketchTask *t = (SketchTask*)arg;
+    int m = t->A->rows, n = t->A->cols, s = t->Y->cols;
+    const SimdKernels *kern = simd_kernels();
+    for (int r = begin; r < end; r++) {
+        double *y = t->Y->data[r];
+        if (t->left) {
+            memset(y, 0, n * sizeof(double));
+            for (int i = 0; i < m; i++) kern->axpy(y, t->X->data[r][i], t->A->data[i], n);
+        } else {
+            memset(y, 0, s * sizeof(double));
+            const double *a = t->A->data[r];
+            for (int j = 0; j < n; j++) kern->axpy(y, a[j], t->X->data[j], s);
+        }
+    }
+}
+
+static void fill_random(Matrix *X, uint64_t *rng) {
+    for (int i = 0; i < X->rows; i++) {
+        for (int j = 0; j < X->cols; j++) X->data[i][j] = rng_uniform(rng);
+    }
+}
+
+SVDResult* cur_svd(Matrix *A, int k, const SVDOptions *opts) {
+    int m = A->rows, n = A->cols;
+    int p = m < n ? m : n;
+    if (k > p) k = p;
+    int s = k + CUR_OVERSAMPLE < p ? k + CUR_OVERSAMPLE : p;
+    if (opts->verbose) printf("Computing rank-%d CUR decomposition...\n", k);
+    uint64_t rng = rng_seed(opts->seed);
+
+    Matrix *G = create_matrix_uninit(s, m);         // column sketch G A
+    Matrix *Y = create_matrix_uninit(s, n);
+    Matrix *Yt = create_matrix_uninit(n, s);
+    Matrix *Omega = create_matrix_uninit(n, s);     // row sketch A Ω
+    Matrix *Z = create_matrix_uninit(m, s);
+    Matrix *C = create_matrix_uninit(m, k);
+    Matrix *R = create_matrix_uninit(n, k);
+    Matrix *T = create_matrix_uninit(m, k);
+    Matrix *M = create_matrix(k, k);
+    int *cols = (int*)mem_alloc(n * sizeof(int));
+    int *rows = (int*)mem_alloc(m * sizeof(int));
+    double *tau = (double*)mem_alloc(s * sizeof(double));
+    SVDResult *result = NULL;
+    int ok = G && Y && Yt && Omega && Z && C && R && T && M && cols && rows && tau;
+
+    if (ok) {
+        fill_random(G, &rng);
+        fill_random(Omega, &rng);
+        perf_phase_begin("cur_sketch");
+        SketchTask left = { A, G, Y, 1 };
+        parallel_for(opts->threads, s, sketch_rows, &left);
+        SketchTask right = { A, Omega, Z, 0 };
+        parallel_for(opts->threads, m, sketch_rows, &right);
+        perf_phase_end("cur_sketch", 4.0 * m * n * s, 16.0 * m * n);
+
+        matrix_transpose(Y, Yt);
+        perf_phase_begin("pivoted_qr");
+        ok = pivoted_qr(Yt, k, cols, tau, opts->threads) == k &&
+             pivoted_qr(Z, k, rows, tau, opts->threads) == k;
+        perf_phase_end("pivoted_qr", 4.0 * (m + n) * s * k, 8.0 * (m + n) * s * k);
+        if (!ok) fprintf(stderr, "Error: Matrix has rank below %d\n", k);
+    }
+    if (ok) {
+        // C = A[:, cols], R = A[rows, :]ᵀ, each orthonormalized
+        for (int i = 0; i < m; i++) {
+            for (int l = 0; l < k; l++) C->data[i][l] = A->data[i][cols[l]];
+        }
+        for (int j = 0; j < n; j++) {
+            for (int l = 0; l < k; l++) R->data[j][l] = A->data[rows[l]][j];
+        }
+        ok = block_orthonormalize(C, NULL, opts->threads) &&
+             block_orthonormalize(R, NULL, opts->threads);
+    }
+    if (ok) {
+        // M = Cᵀ A R: the projection of A on both spans
+        perf_phase_begin("cur_core");
+        SketchTask core = { A, R, T, 0 };
+        parallel_for(opts->threads, m, sketch_rows, &core);
+        for (int i = 0; i < m; i++) {
+            for (int a = 0; a < k; a++) {
+                double c = C->data[i][a];
+                for (int b = 0; b < k; b++) M->data[a][b] += c * T->data[i][b];
+            }
+        }
+        perf_phase_end("cur_core", 2.0 * m * n * k + 2.0 * m * k * k, 8.0 * m * n);
+        result = rotate_small(C, M, R, m, n, opts);
+    }
+
+    free_matrix(G);
+    free_matrix(Y);
+    free_matrix(Yt);
+    free_matrix(Omega);
+    free_matrix(Z);
+    free_matrix(C);
+    free_matrix(R);
+    free_matrix(T);
+    free_matrix(M);
+    mem_free(cols);
+    mem_free(rows);
+    mem_free(tau);
+    if (result && opts->verbose) svd_print_summary(result);
+    return result;
+}
@@ -0,0 +1,24 @@
+#ifndef RRQR_CUR_H
+#define RRQR_CUR_H
+
+#include "lanczos.h"
+
+// Fast near-optimal rank-k approximations, returned in SVD form so they
+// slot into the rest of the pipeline (pruning, factor files, decoding).
+//
+// rrqr_svd: column-pivoted Householder QR stopped after k steps,
+// A P ≈ Q_k R_k, in O(mnk); the SVD of the small k×n factor R_k Pᵀ then
+// rotates it into U Σ Vᵀ.
+//
+// cur_svd: interpolative / CUR decomposition. k columns and k rows of A
+// are picked by pivoted QR on two random sketches of k + CUR_OVERSAMPLE
+// vectors; the approximation is A ≈ C (C⁺ A R⁺) R, i.e. the projection of
+// A on the spans of the chosen columns and rows, whose k×k core is
+// diagonalized. The chosen columns and rows are actual image pixels, which
+// quantize well when stored as such.
+#define CUR_OVERSAMPLE 10
+
+SVDResult* rrqr_svd(Matrix *A, int k, const SVDOptions *opts);
+SVDResult* cur_svd(Matrix *A, int k, const SVDOptions *opts);
+
+#endif
@@ -0,0 +1,354 @@
+#define _GNU_SOURCE
+#include "shared_basis.h"
+#include "svd_engine.h"
+#include "svd_decode.h"
+#include "svd_stream.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SHARED_BASIS_VERSION 1
+#define BASIS_HEADER_BYTES 20
+#define COEFF_HEADER_BYTES 32
+
+struct SharedBasisBuilder {
+    int width;
+    int threads;
+    int images;
+    Matrix *R;                  // at most width rows; NULL before the first image
+};
+
+SharedBasisBuilder* shared_basis_builder_create(int width, int threads) {
+    if (width <= 0) return NULL;
+    SharedBasisBuilder *b = (SharedBasisBuilder*)mem_calloc(1, sizeof(SharedBasisBuilder));
+    if (!b) return NULL;
+    b->width = width;
+    b->threads = threads;
+    return b;
+}
+
+void shared_basis_builder_free(SharedBasisBuilder *b) {
+    if (!b) return;
+    free_matrix(b->R);
+    mem_free(b);
+}
+
+int shared_basis_builder_add(SharedBasisBuilder *b, const Matrix *A) {
+    int n = b->width;
+    if (A->cols != n) {
+        fprintf(stderr, "Error: Corpus image is %d wide, the basis is %d\n", A->cols, n);
+        return 0;
+    }
+    int have = b->R ? b->R->rows : 0;
+    int rows = have + A->rows;
+    Matrix *stacked = create_matrix_uninit(rows, n);
+    if (!stacked) return 0;
+    for (int i = 0; i < have; i++) memcpy(stacked->data[i], b->R->data[i], n * sizeof(double));
+    for (int i = 0; i < A->rows; i++) memcpy(stacked->data[have + i], A->data[i], n * sizeof(double));
+
+    // Until the stack is taller than wide there is nothing to reduce
+    if (rows <= n) {
+        free_matrix(b->R);
+        b->R = stacked;
+        b->images++;
+        return 1;
+    }
+
+    perf_phase_begin("basis_tsqr");
+    TSQR *f = tsqr_factor(stacked, 0, b->threads);
+    Matrix *R = f ? create_matrix_uninit(n, n) : NULL;
+    if (R) tsqr_get_r(f, R);
+    perf_phase_end("basis_tsqr", 2.0 * rows * n * n, 16.0 * rows * n);
+    tsqr_free(f);
+    free_matrix(stacked);
+    if (!R) return 0;
+
+    free_matrix(b->R);
+    b->R = R;
+    b->images++;
+    return 1;
+}
+
+SharedBasis* shared_basis_builder_finish(SharedBasisBuilder *b, int rank) {
+    if (!b->R) {
+        fprintf(stderr, "Error: No images to learn a basis from\n");
+        return NULL;
+    }
+    int p = b->R->rows < b->width ? b->R->rows : b->width;
+    if (rank > p) rank = p;
+    if (rank <= 0) return NULL;
+
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.threads = b->threads;
+    opts.verbose = 0;
+    SVDResult *svd = svd_compute(b->R, rank, &opts);
+    if (!svd) return NULL;
+
+    SharedBasis *basis = (SharedBasis*)mem_calloc(1, sizeof(SharedBasis));
+    if (!basis) {
+        free_svd_result(svd);
+        return NULL;
+    }
+    basis->width = b->width;
+    basis->rank = rank;
+    basis->images = b->images;
+    basis->singular_values = (double*)mem_alloc(rank * sizeof(double));
+    basis->V = create_matrix_uninit(b->width, rank);
+    if (!basis->singular_values || !basis->V) {
+        free_shared_basis(basis);
+        free_svd_result(svd);
+        return NULL;
+    }
+    memcpy(basis->singular_values, svd->singular_values, rank * sizeof(double));
+    for (int j = 0; j < b->width; j++) memcpy(basis->V->data[j], svd->V->data[j], rank * sizeof(double));
+    free_svd_result(svd);
+    return basis;
+}
+
+void free_shared_basis(SharedBasis *basis) {
+    if (!basis) return;
+    mem_free(basis->singular_values);
+    free_matrix(basis->V);
+    mem_free(basis);
+}
+
+// FNV-1a of the serialized basis body
+static uint64_t hash_bytes(const unsigned char *p, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// σ then V rows as float32; V is rounded to what was written so that the
+// in-memory basis matches a later load bit for bit
+static unsigned char* serialize_basis(SharedBasis *basis, size_t *len) {
+    int n = basis->width, k = basis->rank;
+    *len = (size_t)(k + (size_t)n * k) * 4;
+    unsigned char *body = (unsigned char*)mem_alloc(*len);
+    if (!body) return NULL;
+    unsigned char *p = body;
+    for (int l = 0; l < k; l++, p += 4) stream_put_f32(p, basis->singular_values[l]);
+    for (int j = 0; j < n; j++) {
+        for (int l = 0; l < k; l++, p += 4) {
+            stream_put_f32(p, basis->V->data[j][l]);
+            basis->V->data[j][l] = stream_get_f32(p);
+        }
+    }
+    basis->id = hash_bytes(body, *len);
+    return body;
+}
+
+int shared_basis_save(const char *filename, SharedBasis *basis) {
+    size_t len;
+    unsigned char *body = serialize_basis(basis, &len);
+    if (!body) return 0;
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        mem_free(body);
+        return 0;
+    }
+    unsigned char header[BASIS_HEADER_BYTES];
+    memcpy(header, "SVDD", 4);
+    stream_put_u32(header + 4, SHARED_BASIS_VERSION);
+    stream_put_u32(header + 8, (uint32_t)basis->width);
+    stream_put_u32(header + 12, (uint32_t)basis->rank);
+    stream_put_u32(header + 16, (uint32_t)basis->images);
+    int ok = stream_write_all(fd, header, sizeof(header)) && stream_write_all(fd, body, len);
+    if (close(fd) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write basis to %s\n", filename);
+    mem_free(body);
+    return ok;
+}
+
+SharedBasis* shared_basis_load(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+    unsigned char header[BASIS_HEADER_BYTES];
+    if (stream_read_all(fd, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, "SVDD", 4) != 0 || stream_get_u32(header + 4) != SHARED_BASIS_VERSION) {
+        fprintf(stderr, "Error: %s is not a version %d basis file\n", filename, SHARED_BASIS_VERSION);
+        close(fd);
+        return NULL;
+    }
+    uint32_t n = stream_get_u32(header + 8), k = stream_get_u32(header + 12);
+    if (n == 0 || n > (1u << 20) || k == 0 || k > n) {
+        fprintf(stderr, "Error: Corrupt basis header in %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    SharedBasis *basis = (SharedBasis*)mem_calloc(1, sizeof(SharedBasis));
+    size_t len = (size_t)(k + (size_t)n * k) * 4;
+    unsigned char *body = (unsigned char*)mem_alloc(len);
+    if (basis) {
+        basis->width = (int)n;
+        basis->rank = (int)k;
+        basis->images = (int)stream_get_u32(header + 16);
+        basis->singular_values = (double*)mem_alloc(k * sizeof(double));
+        basis->V = create_matrix_uninit((int)n, (int)k);
+    }
+    int ok = basis && body && basis->singular_values && basis->V &&
+             stream_read_all(fd, body, len) == len;
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to read basis from %s\n", filename);
+        free_shared_basis(basis);
+        mem_free(body);
+        return NULL;
+    }
+
+    const unsigned char *p = body;
+    for (uint32_t l = 0; l < k; l++, p += 4) basis->singular_values[l] = stream_get_f32(p);
+    for (uint32_t j = 0; j < n; j++) {
+        for (uint32_t l = 0; l < k; l++, p += 4) basis->V->data[j][l] = stream_get_f32(p);
+    }
+    basis->id = hash_bytes(body, len);
+    mem_free(body);
+    return basis;
+}
+
+typedef struct {
+    const SharedBasis *basis;
+    const Matrix *A;
+    Matrix *C;
+} EncodeTask;
+
+// C[i][:] = Σ_j A[i][j] V[j][:k], streaming the rows of V
+static void encode_rows(void *arg, int begin, int end) {
+    EncodeTask *t = (EncodeTask*)arg;
+    int n = t->A->cols, k = t->C->cols;
+    for (int i = begin; i < end; i++) {
+        double *c = t->C->data[i];
+        memset(c, 0, k * sizeof(double));
+        for (int j = 0; j < n; j++) {
+            double a = t->A->data[i][j];
+            const double *v = t->basis->V->data[j];
+            for (int l = 0; l < k; l++) c[l] += a * v[l];
+        }
+    }
+}
+
+Matrix* shared_basis_encode(const SharedBasis *basis, const Matrix *A, int k, int threads) {
+    if (A->cols != basis->width) {
+        fprintf(stderr, "Error: Image is %d wide, the basis is %d\n", A->cols, basis->width);
+        return NULL;
+    }
+    if (k <= 0 || k > basis->rank) k = basis->rank;
+    Matrix *C = create_matrix_uninit(A->rows, k);
+    if (!C) return NULL;
+
+    double work = (double)A->rows * A->cols * k;
+    perf_phase_begin("basis_encode");
+    EncodeTask task = { basis, A, C };
+    parallel_for(threads, A->rows, encode_rows, &task);
+    perf_phase_end("basis_encode", 2.0 * work, 8.0 * work);
+    return C;
+}
+
+int shared_basis_decode(const SharedBasis *basis, const Matrix *C, unsigned char *pixels,
+                        int stride, int max_val, int threads) {
+    int k = C->cols;
+    if (k > basis->rank) return 0;
+    // C already carries Σ, so decode it as factors with unit singular values
+    double *ones = (double*)mem_alloc(k * sizeof(double));
+    if (!ones) return 0;
+    for (int l = 0; l < k; l++) ones[l] = 1.0;
+    SVDResult factors = { k, ones, (Matrix*)C, basis->V, 1, 0 };
+    int ok = svd_decode_region(&factors, k, 0, C->rows, 0, basis->width, pixels, stride,
+                               max_val, threads);
+    mem_free(ones);
+    return ok;
+}
+
+int shared_basis_save_coeffs(const char *filename, const SharedBasis *basis, const Matrix *C,
+                             int max_val) {
+    int m = C->rows, k = C->cols;
+    size_t len = COEFF_HEADER_BYTES + (size_t)m * k * 4;
+    unsigned char *buf = (unsigned char*)mem_alloc(len);
+    if (!buf) return 0;
+    memcpy(buf, "SVDC", 4);
+    stream_put_u32(buf + 4, SHARED_BASIS_VERSION);
+    stream_put_u32(buf + 8, (uint32_t)m);
+    stream_put_u32(buf + 12, (uint32_t)basis->width);
+    stream_put_u32(buf + 16, (uint32_t)k);
+    stream_put_u32(buf + 20, (uint32_t)max_val);
+    stream_put_u32(buf + 24, (uint32_t)basis->id);
+    stream_put_u32(buf + 28, (uint32_t)(basis->id >> 32));
+    unsigned char *p = buf + COEFF_HEADER_BYTES;
+    for (int i = 0; i < m; i++) {
+        for (int l = 0; l < k; l++, p += 4) stream_put_f32(p, C->data[i][l]);
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        mem_free(buf);
+        return 0;
+    }
+    int ok = stream_write_all(fd, buf, len);
+    if (close(fd) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write coefficients to %s\n", filename);
+    mem_free(buf);
+    return ok;
+}
+
+Matrix* shared_basis_load_coeffs(const char *filename, const SharedBasis *basis, int *max_val) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+    unsigned char header[COEFF_HEADER_BYTES];
+    if (stream_read_all(fd, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, "SVDC", 4) != 0 || stream_get_u32(header + 4) != SHARED_BASIS_VERSION) {
+        fprintf(stderr, "Error: %s is not a version %d coefficient file\n", filename,
+                SHARED_BASIS_VERSION);
+        close(fd);
+        return NULL;
+    }
+    uint32_t m = stream_get_u32(header + 8), n = stream_get_u32(header + 12);
+    uint32_t k = stream_get_u32(header + 16);
+    uint64_t id = stream_get_u32(header + 24) | (uint64_t)stream_get_u32(header + 28) << 32;
+    if (id != basis->id || n != (uint32_t)basis->width || k > (uint32_t)basis->rank) {
+        fprintf(stderr, "Error: %s was encoded against a different basis\n", filename);
+        close(fd);
+        return NULL;
+    }
+    if (m == 0 || m > (1u << 20) || k == 0) {
+        fprintf(stderr, "Error: Corrupt coefficient header in %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = (size_t)m * k * 4;
+    unsigned char *body = (unsigned char*)mem_alloc(len);
+    Matrix *C = create_matrix_uninit((int)m, (int)k);
+    int ok = body && C && stream_read_all(fd, body, len) == len;
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to read coefficients from %s\n", filename);
+        free_matrix(C);
+        mem_free(body);
+        return NULL;
+    }
+    const unsigned char *p = body;
+    for (uint32_t i = 0; i < m; i++) {
+        for (uint32_t l = 0; l < k; l++, p += 4) C->data[i][l] = stream_get_f32(p);
+    }
+    mem_free(body);
+    if (max_val) *max_val = (int)stream_get_u32(header + 20);
+    return C;
+}
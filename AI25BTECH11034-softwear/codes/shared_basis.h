@@ -0,0 +1,54 @@
+#ifndef SHARED_BASIS_H
+#define SHARED_BASIS_H
+
+#include <stdint.h>
+#include "lanczos.h"
+
+// Corpus compression against one shared right basis. Images of the same
+// width are stacked [A_1; A_2; ...] and the top right singular vectors of
+// the stack become a dictionary V (width × rank). Each image is then
+// stored as coefficients C_i = A_i V_k (its U·Σ against the basis) and
+// decoded as C_i V_kᵀ, so only height·k numbers are kept per image.
+//
+// Learning streams the corpus through a running TSQR: the R factor of
+// [R; A_i] replaces R after every image, so memory stays at width² plus one
+// image, and the SVD at the end is of the small R alone.
+typedef struct {
+    int width;
+    int rank;
+    int images;                 // images the basis was learned from
+    double *singular_values;    // of the stacked corpus
+    Matrix *V;                  // width × rank, orthonormal columns
+    uint64_t id;                // hash of the stored basis, checked by coefficient files
+} SharedBasis;
+
+typedef struct SharedBasisBuilder SharedBasisBuilder;
+
+SharedBasisBuilder* shared_basis_builder_create(int width, int threads);
+// Folds one height × width image into the running R factor
+int shared_basis_builder_add(SharedBasisBuilder *b, const Matrix *A);
+// Top rank right singular vectors of everything added
+SharedBasis* shared_basis_builder_finish(SharedBasisBuilder *b, int rank);
+void shared_basis_builder_free(SharedBasisBuilder *b);
+
+void free_shared_basis(SharedBasis *basis);
+
+// Dictionary file (.svdd): "SVDD", version, width, rank, images, then σ and
+// the rows of V as little-endian float32. V is stored at float32 precision
+// and the id is the hash of those bytes, so a loaded basis equals the saved one.
+int shared_basis_save(const char *filename, SharedBasis *basis);
+SharedBasis* shared_basis_load(const char *filename);
+
+// C (height × k) = A V_k, rows split across threads
+Matrix* shared_basis_encode(const SharedBasis *basis, const Matrix *A, int k, int threads);
+// 8-bit C V_kᵀ, rounded and clamped to [0, max_val]
+int shared_basis_decode(const SharedBasis *basis, const Matrix *C, unsigned char *pixels,
+                        int stride, int max_val, int threads);
+
+// Coefficient file (.svdc): "SVDC", version, height, width, k, max_val, the
+// basis id, then C row by row as float32. Loading fails for another basis.
+int shared_basis_save_coeffs(const char *filename, const SharedBasis *basis, const Matrix *C,
+                             int max_val);
+Matrix* shared_basis_load_coeffs(const char *filename, const SharedBasis *basis, int *max_val);
+
+#endif
@@ -0,0 +1,793 @@
+#include "simd_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+// Each variant is compiled for its own instruction set whatever the
+// translation unit's flags, and only ever called after simd_detect
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// Four running sums hide the latency of the floating point adder
+static double dot_scalar(const double *a, const double *b, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void axpy_scalar(double *y, double a, const double *x, int n) {
+    for (int i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+static void scal_scalar(double *x, double a, int n) {
+    for (int i = 0; i < n; i++) x[i] *= a;
+}
+
+static double axpy_sumsq_scalar(double *y, double a, const double *x, int n) {
+    double s0 = 0.0, s1 = 0.0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        double y0 = y[i] + a * x[i], y1 = y[i + 1] + a * x[i + 1];
+        y[i] = y0;
+        y[i + 1] = y1;
+        s0 += y0 * y0;
+        s1 += y1 * y1;
+    }
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+        s0 += y[i] * y[i];
+    }
+    return s0 + s1;
+}
+
+static double scal_diff_sumsq_scalar(double *x, double a, const double *y, int n) {
+    double s0 = 0.0, s1 = 0.0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        double x0 = x[i] * a, x1 = x[i + 1] * a;
+        x[i] = x0;
+        x[i + 1] = x1;
+        s0 += (x0 - y[i]) * (x0 - y[i]);
+        s1 += (x1 - y[i + 1]) * (x1 - y[i + 1]);
+    }
+    for (; i < n; i++) {
+        x[i] *= a;
+        s0 += (x[i] - y[i]) * (x[i] - y[i]);
+    }
+    return s0 + s1;
+}
+
+static double abs_diff_scalar(const double *a, const double *b, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += fabs(a[i] - b[i]);
+    return sum;
+}
+
+static void pair_sums_scalar(const double *a, const double *b, int n,
+                             double *aa, double *bb, double *ab) {
+    double saa = 0.0, sbb = 0.0, sab = 0.0;
+    for (int i = 0; i < n; i++) {
+        saa += a[i] * a[i];
+        sbb += b[i] * b[i];
+        sab += a[i] * b[i];
+    }
+    *aa = saa;
+    *bb = sbb;
+    *ab = sab;
+}
+
+static void rot_scalar(double *a, double *b, int n, double c, double s) {
+    for (int i = 0; i < n; i++) {
+        double x = a[i], y = b[i];
+        a[i] = c * x - s * y;
+        b[i] = s * x + c * y;
+    }
+}
+
+static void widen_u8_scalar(const unsigned char *src, double *dst, int n) {
+    for (int i = 0; i < n; i++) dst[i] = (double)src[i];
+}
+
+static void widen_u16be_scalar(const unsigned char *src, double *dst, int n) {
+    for (int i = 0; i < n; i++) dst[i] = (double)((src[2 * i] << 8) | src[2 * i + 1]);
+}
+
+static unsigned char quantize_one(double v, double max_val) {
+    if (!(v > 0)) v = 0;            // also NaN
+    if (v > max_val) v = max_val;
+    return (unsigned char)(v + 0.5);
+}
+
+static void quantize_u8_scalar(const double *src, unsigned char *dst, int n, double max_val) {
+    if (max_val > 255) max_val = 255;
+    for (int i = 0; i < n; i++) dst[i] = quantize_one(src[i], max_val);
+}
+
+static const SimdKernels scalar_kernels = {
+    SIMD_SCALAR, dot_scalar, axpy_scalar, scal_scalar, axpy_sumsq_scalar, scal_diff_sumsq_scalar,
+    abs_diff_scalar, pair_sums_scalar, rot_scalar, widen_u8_scalar, widen_u16be_scalar,
+    quantize_u8_scalar
+};
+
+#ifdef SIMD_X86
+
+TARGET_SSE2 static double dot_sse2(const double *a, const double *b, int n) {
+    int i = 0;
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    double sum = t[0] + t[1];
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_SSE2 static void axpy_sse2(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m128d va = _mm_set1_pd(a);
+    for (; i + 4 <= n; i += 4) {
+        __m128d y0 = _mm_loadu_pd(y + i), y1 = _mm_loadu_pd(y + i + 2);
+        y0 = _mm_add_pd(y0, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+        y1 = _mm_add_pd(y1, _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+        _mm_storeu_pd(y + i, y0);
+        _mm_storeu_pd(y + i + 2, y1);
+    }
+    for (; i < n; i++) y[i] += a * x[i];
+}
+
+TARGET_SSE2 static double abs_diff_sse2(const double *a, const double *b, int n) {
+    int i = 0;
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+        s0 = _mm_add_pd(s0, _mm_andnot_pd(sign, d0));
+        s1 = _mm_add_pd(s1, _mm_andnot_pd(sign, d1));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    double sum = t[0] + t[1];
+    for (; i < n; i++) sum += fabs(a[i] - b[i]);
+    return sum;
+}
+
+TARGET_SSE2 static void widen_u8_sse2(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(b, zero);
+        __m128i hi = _mm_unpackhi_epi8(b, zero);
+        __m128i q[4] = {
+            _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+        };
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_pd(dst + i + 4 * j, _mm_cvtepi32_pd(q[j]));
+            _mm_storeu_pd(dst + i + 4 * j + 2,
+                          _mm_cvtepi32_pd(_mm_shuffle_epi32(q[j], _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+    }
+    for (; i < n; i++) dst[i] = (double)src[i];
+}
+
+TARGET_SSE2 static void widen_u16be_sse2(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        __m128i lo = _mm_unpacklo_epi16(x, zero);
+        __m128i hi = _mm_unpackhi_epi16(x, zero);
+        _mm_storeu_pd(dst + i, _mm_cvtepi32_pd(lo));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2))));
+        _mm_storeu_pd(dst + i + 4, _mm_cvtepi32_pd(hi));
+        _mm_storeu_pd(dst + i + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    widen_u16be_scalar(src + 2 * i, dst + i, n - i);
+}
+
+// max(v, 0) returns its second operand for NaN, as quantize_one does
+TARGET_SSE2 static void quantize_u8_sse2(const double *src, unsigned char *dst, int n,
+                                         double max_val) {
+    if (max_val > 255) max_val = 255;
+    int i = 0;
+    const __m128d zero = _mm_setzero_pd(), top = _mm_set1_pd(max_val), half = _mm_set1_pd(0.5);
+    for (; i + 4 <= n; i += 4) {
+        __m128d v0 = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(src + i), zero), top);
+        __m128d v1 = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(src + i + 2), zero), top);
+        __m128i q = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_add_pd(v0, half)),
+                                       _mm_cvttpd_epi32(_mm_add_pd(v1, half)));
+        q = _mm_packs_epi32(q, q);
+        q = _mm_packus_epi16(q, q);
+        int bytes = _mm_cvtsi128_si32(q);
+        memcpy(dst + i, &bytes, 4);
+    }
+    for (; i < n; i++) dst[i] = quantize_one(src[i], max_val);
+}
+
+TARGET_SSE2 static void scal_sse2(double *x, double a, int n) {
+    int i = 0;
+    __m128d va = _mm_set1_pd(a);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_pd(x + i, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+        _mm_storeu_pd(x + i + 2, _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+    }
+    for (; i < n; i++) x[i] *= a;
+}
+
+TARGET_SSE2 static double axpy_sumsq_sse2(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m128d va = _mm_set1_pd(a);
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128d y0 = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+        __m128d y1 = _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+        _mm_storeu_pd(y + i, y0);
+        _mm_storeu_pd(y + i + 2, y1);
+        s0 = _mm_add_pd(s0, _mm_mul_pd(y0, y0));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(y1, y1));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    double sum = t[0] + t[1];
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+        sum += y[i] * y[i];
+    }
+    return sum;
+}
+
+TARGET_SSE2 static double scal_diff_sumsq_sse2(double *x, double a, const double *y, int n) {
+    int i = 0;
+    __m128d va = _mm_set1_pd(a);
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128d x0 = _mm_mul_pd(va, _mm_loadu_pd(x + i));
+        __m128d x1 = _mm_mul_pd(va, _mm_loadu_pd(x + i + 2));
+        _mm_storeu_pd(x + i, x0);
+        _mm_storeu_pd(x + i + 2, x1);
+        __m128d d0 = _mm_sub_pd(x0, _mm_loadu_pd(y + i));
+        __m128d d1 = _mm_sub_pd(x1, _mm_loadu_pd(y + i + 2));
+        s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    double sum = t[0] + t[1];
+    for (; i < n; i++) {
+        x[i] *= a;
+        sum += (x[i] - y[i]) * (x[i] - y[i]);
+    }
+    return sum;
+}
+
+TARGET_SSE2 static double hsum128(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+TARGET_SSE2 static void pair_sums_sse2(const double *a, const double *b, int n,
+                                       double *aa, double *bb, double *ab) {
+    int i = 0;
+    __m128d saa = _mm_setzero_pd(), sbb = _mm_setzero_pd(), sab = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(a + i), y = _mm_loadu_pd(b + i);
+        saa = _mm_add_pd(saa, _mm_mul_pd(x, x));
+        sbb = _mm_add_pd(sbb, _mm_mul_pd(y, y));
+        sab = _mm_add_pd(sab, _mm_mul_pd(x, y));
+    }
+    double raa = hsum128(saa), rbb = hsum128(sbb), rab = hsum128(sab);
+    for (; i < n; i++) {
+        raa += a[i] * a[i];
+        rbb += b[i] * b[i];
+        rab += a[i] * b[i];
+    }
+    *aa = raa;
+    *bb = rbb;
+    *ab = rab;
+}
+
+TARGET_SSE2 static void rot_sse2(double *a, double *b, int n, double c, double s) {
+    int i = 0;
+    __m128d vc = _mm_set1_pd(c), vs = _mm_set1_pd(s);
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(a + i), y = _mm_loadu_pd(b + i);
+        _mm_storeu_pd(a + i, _mm_sub_pd(_mm_mul_pd(vc, x), _mm_mul_pd(vs, y)));
+        _mm_storeu_pd(b + i, _mm_add_pd(_mm_mul_pd(vs, x), _mm_mul_pd(vc, y)));
+    }
+    for (; i < n; i++) {
+        double x = a[i], y = b[i];
+        a[i] = c * x - s * y;
+        b[i] = s * x + c * y;
+    }
+}
+
+static const SimdKernels sse2_kernels = {
+    SIMD_SSE2, dot_sse2, axpy_sse2, scal_sse2, axpy_sumsq_sse2, scal_diff_sumsq_sse2,
+    abs_diff_sse2, pair_sums_sse2, rot_sse2, widen_u8_sse2, widen_u16be_sse2,
+    quantize_u8_sse2
+};
+
+TARGET_AVX2 static double hsum256(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+TARGET_AVX2 static double dot_avx2(const double *a, const double *b, int n) {
+    int i = 0;
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), s3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+    }
+    double sum = hsum256(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX2 static void axpy_avx2(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m256d va = _mm256_set1_pd(a);
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        __m256d y1 = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) y[i] += a * x[i];
+}
+
+TARGET_AVX2 static double abs_diff_avx2(const double *a, const double *b, int n) {
+    int i = 0;
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        s0 = _mm256_add_pd(s0, _mm256_andnot_pd(sign, d0));
+        s1 = _mm256_add_pd(s1, _mm256_andnot_pd(sign, d1));
+    }
+    double sum = hsum256(_mm256_add_pd(s0, s1));
+    for (; i < n; i++) sum += fabs(a[i] - b[i]);
+    return sum;
+}
+
+TARGET_AVX2 static void widen_u8_avx2(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        __m256i lo = _mm256_cvtepu8_epi32(b);
+        __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8));
+        _mm256_storeu_pd(dst + i, _mm256_cvtepi32_pd(_mm256_castsi256_si128(lo)));
+        _mm256_storeu_pd(dst + i + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1)));
+        _mm256_storeu_pd(dst + i + 8, _mm256_cvtepi32_pd(_mm256_castsi256_si128(hi)));
+        _mm256_storeu_pd(dst + i + 12, _mm256_cvtepi32_pd(_mm256_extracti128_si256(hi, 1)));
+    }
+    for (; i < n; i++) dst[i] = (double)src[i];
+}
+
+TARGET_AVX2 static void widen_u16be_avx2(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + 2 * i));
+        x = _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+        __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x));
+        __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1));
+        _mm256_storeu_pd(dst + i, _mm256_cvtepi32_pd(_mm256_castsi256_si128(lo)));
+        _mm256_storeu_pd(dst + i + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1)));
+        _mm256_storeu_pd(dst + i + 8, _mm256_cvtepi32_pd(_mm256_castsi256_si128(hi)));
+        _mm256_storeu_pd(dst + i + 12, _mm256_cvtepi32_pd(_mm256_extracti128_si256(hi, 1)));
+    }
+    widen_u16be_scalar(src + 2 * i, dst + i, n - i);
+}
+
+TARGET_AVX2 static void quantize_u8_avx2(const double *src, unsigned char *dst, int n,
+                                         double max_val) {
+    if (max_val > 255) max_val = 255;
+    int i = 0;
+    const __m256d zero = _mm256_setzero_pd(), top = _mm256_set1_pd(max_val);
+    const __m256d half = _mm256_set1_pd(0.5);
+    for (; i + 8 <= n; i += 8) {
+        __m256d v0 = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src + i), zero), top);
+        __m256d v1 = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src + i + 4), zero), top);
+        __m128i q = _mm_packs_epi32(_mm256_cvttpd_epi32(_mm256_add_pd(v0, half)),
+                                    _mm256_cvttpd_epi32(_mm256_add_pd(v1, half)));
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(q, q));
+    }
+    for (; i < n; i++) dst[i] = quantize_one(src[i], max_val);
+}
+
+TARGET_AVX2 static void scal_avx2(double *x, double a, int n) {
+    int i = 0;
+    __m256d va = _mm256_set1_pd(a);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+        _mm256_storeu_pd(x + i + 4, _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 4)));
+    }
+    for (; i < n; i++) x[i] *= a;
+}
+
+TARGET_AVX2 static double axpy_sumsq_avx2(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m256d va = _mm256_set1_pd(a);
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        __m256d y1 = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+        s0 = _mm256_fmadd_pd(y0, y0, s0);
+        s1 = _mm256_fmadd_pd(y1, y1, s1);
+    }
+    double sum = hsum256(_mm256_add_pd(s0, s1));
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+        sum += y[i] * y[i];
+    }
+    return sum;
+}
+
+TARGET_AVX2 static double scal_diff_sumsq_avx2(double *x, double a, const double *y, int n) {
+    int i = 0;
+    __m256d va = _mm256_set1_pd(a);
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m256d x0 = _mm256_mul_pd(va, _mm256_loadu_pd(x + i));
+        __m256d x1 = _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 4));
+        _mm256_storeu_pd(x + i, x0);
+        _mm256_storeu_pd(x + i + 4, x1);
+        __m256d d0 = _mm256_sub_pd(x0, _mm256_loadu_pd(y + i));
+        __m256d d1 = _mm256_sub_pd(x1, _mm256_loadu_pd(y + i + 4));
+        s0 = _mm256_fmadd_pd(d0, d0, s0);
+        s1 = _mm256_fmadd_pd(d1, d1, s1);
+    }
+    double sum = hsum256(_mm256_add_pd(s0, s1));
+    for (; i < n; i++) {
+        x[i] *= a;
+        sum += (x[i] - y[i]) * (x[i] - y[i]);
+    }
+    return sum;
+}
+
+TARGET_AVX2 static void pair_sums_avx2(const double *a, const double *b, int n,
+                                       double *aa, double *bb, double *ab) {
+    int i = 0;
+    __m256d saa = _mm256_setzero_pd(), sbb = _mm256_setzero_pd(), sab = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+        saa = _mm256_fmadd_pd(x, x, saa);
+        sbb = _mm256_fmadd_pd(y, y, sbb);
+        sab = _mm256_fmadd_pd(x, y, sab);
+    }
+    double raa = hsum256(saa), rbb = hsum256(sbb), rab = hsum256(sab);
+    for (; i < n; i++) {
+        raa += a[i] * a[i];
+        rbb += b[i] * b[i];
+        rab += a[i] * b[i];
+    }
+    *aa = raa;
+    *bb = rbb;
+    *ab = rab;
+}
+
+TARGET_AVX2 static void rot_avx2(double *a, double *b, int n, double c, double s) {
+    int i = 0;
+    __m256d vc = _mm256_set1_pd(c), vs = _mm256_set1_pd(s);
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(a + i, _mm256_fmsub_pd(vc, x, _mm256_mul_pd(vs, y)));
+        _mm256_storeu_pd(b + i, _mm256_fmadd_pd(vs, x, _mm256_mul_pd(vc, y)));
+    }
+    for (; i < n; i++) {
+        double x = a[i], y = b[i];
+        a[i] = c * x - s * y;
+        b[i] = s * x + c * y;
+    }
+}
+
+static const SimdKernels avx2_kernels = {
+    SIMD_AVX2, dot_avx2, axpy_avx2, scal_avx2, axpy_sumsq_avx2, scal_diff_sumsq_avx2,
+    abs_diff_avx2, pair_sums_avx2, rot_avx2, widen_u8_avx2, widen_u16be_avx2,
+    quantize_u8_avx2
+};
+
+// Tails are done with masked loads and stores rather than scalar loops
+TARGET_AVX512 static __mmask8 tail_mask(int left) {
+    return (__mmask8)((1u << left) - 1);
+}
+
+TARGET_AVX512 static double dot_avx512(const double *a, const double *b, int n) {
+    int i = 0;
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+        s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), s2);
+        s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+    }
+    if (i < n) {
+        __mmask8 m = tail_mask(n - i);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+TARGET_AVX512 static void axpy_avx512(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m512d va = _mm512_set1_pd(a);
+    for (; i + 16 <= n; i += 16) {
+        __m512d y0 = _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        __m512d y1 = _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+        _mm512_storeu_pd(y + i, y0);
+        _mm512_storeu_pd(y + i + 8, y1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        __m512d y0 = _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i),
+                                     _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, y0);
+    }
+}
+
+TARGET_AVX512 static double abs_diff_avx512(const double *a, const double *b, int n) {
+    int i = 0;
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i),
+                                                           _mm512_loadu_pd(b + i))));
+        s1 = _mm512_add_pd(s1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i + 8),
+                                                           _mm512_loadu_pd(b + i + 8))));
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + i),
+                                                           _mm512_maskz_loadu_pd(m, b + i))));
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+TARGET_AVX512 static void widen_u8_avx512(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i w = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+        _mm512_storeu_pd(dst + i, _mm512_cvtepi32_pd(_mm512_castsi512_si256(w)));
+        _mm512_storeu_pd(dst + i + 8, _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(w, 1)));
+    }
+    for (; i < n; i++) dst[i] = (double)src[i];
+}
+
+TARGET_AVX512 static void widen_u16be_avx512(const unsigned char *src, double *dst, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + 2 * i));
+        x = _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+        __m512i w = _mm512_cvtepu16_epi32(x);
+        _mm512_storeu_pd(dst + i, _mm512_cvtepi32_pd(_mm512_castsi512_si256(w)));
+        _mm512_storeu_pd(dst + i + 8, _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(w, 1)));
+    }
+    widen_u16be_scalar(src + 2 * i, dst + i, n - i);
+}
+
+TARGET_AVX512 static void quantize_u8_avx512(const double *src, unsigned char *dst, int n,
+                                             double max_val) {
+    if (max_val > 255) max_val = 255;
+    int i = 0;
+    const __m512d zero = _mm512_setzero_pd(), top = _mm512_set1_pd(max_val);
+    const __m512d half = _mm512_set1_pd(0.5);
+    for (; i + 16 <= n; i += 16) {
+        __m512d v0 = _mm512_min_pd(_mm512_max_pd(_mm512_loadu_pd(src + i), zero), top);
+        __m512d v1 = _mm512_min_pd(_mm512_max_pd(_mm512_loadu_pd(src + i + 8), zero), top);
+        __m512i q = _mm512_inserti64x4(
+            _mm512_castsi256_si512(_mm512_cvttpd_epi32(_mm512_add_pd(v0, half))),
+            _mm512_cvttpd_epi32(_mm512_add_pd(v1, half)), 1);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm512_cvtepi32_epi8(q));
+    }
+    for (; i < n; i++) dst[i] = quantize_one(src[i], max_val);
+}
+
+TARGET_AVX512 static void scal_avx512(double *x, double a, int n) {
+    __m512d va = _mm512_set1_pd(a);
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        _mm512_mask_storeu_pd(x + i, m, _mm512_mul_pd(va, _mm512_maskz_loadu_pd(m, x + i)));
+    }
+}
+
+TARGET_AVX512 static double axpy_sumsq_avx512(double *y, double a, const double *x, int n) {
+    int i = 0;
+    __m512d va = _mm512_set1_pd(a);
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        __m512d y0 = _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        __m512d y1 = _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+        _mm512_storeu_pd(y + i, y0);
+        _mm512_storeu_pd(y + i + 8, y1);
+        s0 = _mm512_fmadd_pd(y0, y0, s0);
+        s1 = _mm512_fmadd_pd(y1, y1, s1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        __m512d y0 = _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i),
+                                     _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, y0);
+        s0 = _mm512_fmadd_pd(y0, y0, s0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+TARGET_AVX512 static double scal_diff_sumsq_avx512(double *x, double a, const double *y, int n) {
+    int i = 0;
+    __m512d va = _mm512_set1_pd(a);
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        __m512d x0 = _mm512_mul_pd(va, _mm512_loadu_pd(x + i));
+        __m512d x1 = _mm512_mul_pd(va, _mm512_loadu_pd(x + i + 8));
+        _mm512_storeu_pd(x + i, x0);
+        _mm512_storeu_pd(x + i + 8, x1);
+        __m512d d0 = _mm512_sub_pd(x0, _mm512_loadu_pd(y + i));
+        __m512d d1 = _mm512_sub_pd(x1, _mm512_loadu_pd(y + i + 8));
+        s0 = _mm512_fmadd_pd(d0, d0, s0);
+        s1 = _mm512_fmadd_pd(d1, d1, s1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        __m512d x0 = _mm512_mul_pd(va, _mm512_maskz_loadu_pd(m, x + i));
+        _mm512_mask_storeu_pd(x + i, m, x0);
+        __m512d d0 = _mm512_sub_pd(x0, _mm512_maskz_loadu_pd(m, y + i));
+        s0 = _mm512_fmadd_pd(d0, d0, s0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+TARGET_AVX512 static void pair_sums_avx512(const double *a, const double *b, int n,
+                                           double *aa, double *bb, double *ab) {
+    __m512d saa = _mm512_setzero_pd(), sbb = _mm512_setzero_pd(), sab = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        __m512d x = _mm512_maskz_loadu_pd(m, a + i), y = _mm512_maskz_loadu_pd(m, b + i);
+        saa = _mm512_fmadd_pd(x, x, saa);
+        sbb = _mm512_fmadd_pd(y, y, sbb);
+        sab = _mm512_fmadd_pd(x, y, sab);
+    }
+    *aa = _mm512_reduce_add_pd(saa);
+    *bb = _mm512_reduce_add_pd(sbb);
+    *ab = _mm512_reduce_add_pd(sab);
+}
+
+TARGET_AVX512 static void rot_avx512(double *a, double *b, int n, double c, double s) {
+    __m512d vc = _mm512_set1_pd(c), vs = _mm512_set1_pd(s);
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xff : tail_mask(n - i);
+        __m512d x = _mm512_maskz_loadu_pd(m, a + i), y = _mm512_maskz_loadu_pd(m, b + i);
+        _mm512_mask_storeu_pd(a + i, m, _mm512_fmsub_pd(vc, x, _mm512_mul_pd(vs, y)));
+        _mm512_mask_storeu_pd(b + i, m, _mm512_fmadd_pd(vs, x, _mm512_mul_pd(vc, y)));
+    }
+}
+
+static const SimdKernels avx512_kernels = {
+    SIMD_AVX512, dot_avx512, axpy_avx512, scal_avx512, axpy_sumsq_avx512, scal_diff_sumsq_avx512,
+    abs_diff_avx512, pair_sums_avx512, rot_avx512, widen_u8_avx512, widen_u16be_avx512,
+    quantize_u8_avx512
+};
+
+// XCR0: which register files the OS saves on a context switch
+static unsigned long long read_xcr0(void) {
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+SimdLevel simd_detect(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return SIMD_SCALAR;
+    if (!(d & bit_SSE2)) return SIMD_SCALAR;
+    int fma = (c & bit_FMA) != 0;
+    int avx = (c & bit_AVX) && (c & bit_OSXSAVE);
+    unsigned long long xcr0 = avx ? read_xcr0() : 0;
+    // SSE and AVX state, plus the opmask and upper ZMM state for AVX-512
+    if (!avx || (xcr0 & 0x6) != 0x6) return SIMD_SSE2;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return SIMD_SSE2;
+    if (!(b & bit_AVX2) || !fma) return SIMD_SSE2;
+    if ((b & bit_AVX512F) && (xcr0 & 0xe6) == 0xe6) return SIMD_AVX512;
+    return SIMD_AVX2;
+}
+
+#else
+
+SimdLevel simd_detect(void) {
+    return SIMD_SCALAR;
+}
+
+#endif
+
+static const SimdKernels *active = &scalar_kernels;
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+
+static const SimdKernels* kernels_for(SimdLevel level) {
+    switch (level) {
+#ifdef SIMD_X86
+        case SIMD_AVX512: return &avx512_kernels;
+        case SIMD_AVX2: return &avx2_kernels;
+        case SIMD_SSE2: return &sse2_kernels;
+#endif
+        default: return &scalar_kernels;
+    }
+}
+
+static void pick_default(void) {
+    SimdLevel level = simd_detect();
+    const char *env = getenv("SVD_SIMD");
+    SimdLevel cap;
+    if (env && *env) {
+        if (!simd_level_parse(env, &cap)) {
+            fprintf(stderr, "Warning: Unknown SVD_SIMD level %s, ignored\n", env);
+        } else if (cap < level) {
+            level = cap;
+        }
+    }
+    __atomic_store_n(&active, kernels_for(level), __ATOMIC_RELEASE);
+}
+
+const SimdKernels* simd_kernels(void) {
+    pthread_once(&detect_once, pick_default);
+    return __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+}
+
+int simd_select(SimdLevel level) {
+    pthread_once(&detect_once, pick_default);
+    if (level > simd_detect()) return 0;
+    __atomic_store_n(&active, kernels_for(level), __ATOMIC_RELEASE);
+    return 1;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_SCALAR: return "scalar";
+        case SIMD_SSE2: return "sse2";
+        case SIMD_AVX2: return "avx2";
+        case SIMD_AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+int simd_level_parse(const char *name, SimdLevel *level) {
+    for (int l = SIMD_SCALAR; l <= SIMD_AVX512; l++) {
+        if (strcmp(name, simd_level_name((SimdLevel)l)) == 0) {
+            *level = (SimdLevel)l;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// The innermost loops (BLAS-1 kernels, Jacobi's pair sums and rotations,
+// pixel conversion, quantization and the error metric) are compiled once
+// per instruction set and picked at run time from cpuid and the OS's saved
+// register state, so one baseline x86-64 binary uses AVX2+FMA or AVX-512
+// where the host has them. The choice is
+// made once, on first use; $SVD_SIMD (scalar, sse2, avx2, avx512) caps it.
+// Reductions keep several independent sums, in a different order per
+// level, so results may differ in the last bits between hosts.
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,                  // with FMA
+    SIMD_AVX512                 // AVX-512F
+} SimdLevel;
+
+typedef struct {
+    SimdLevel level;
+    double (*dot)(const double *a, const double *b, int n);
+    // y += a x
+    void (*axpy)(double *y, double a, const double *x, int n);
+    // x *= a
+    void (*scal)(double *x, double a, int n);
+    // y += a x, returning Σ y_i² of the updated y
+    double (*axpy_sumsq)(double *y, double a, const double *x, int n);
+    // x *= a, returning Σ (x_i - y_i)² of the scaled x
+    double (*scal_diff_sumsq)(double *x, double a, const double *y, int n);
+    // Σ |a_i - b_i|
+    double (*abs_diff_sum)(const double *a, const double *b, int n);
+    // Σ a_i², Σ b_i² and Σ a_i b_i in one pass
+    void (*pair_sums)(const double *a, const double *b, int n, double *aa, double *bb, double *ab);
+    // [a b] <- [a b] [c s; -s c], a plane rotation of two vectors
+    void (*rot)(double *a, double *b, int n, double c, double s);
+    void (*widen_u8)(const unsigned char *src, double *dst, int n);
+    // n big-endian 16-bit samples (2n bytes), as in 16-bit netpbm rasters
+    void (*widen_u16be)(const unsigned char *src, double *dst, int n);
+    // Clamp to [0, max_val], round half up; max_val is at most 255
+    void (*quantize_u8)(const double *src, unsigned char *dst, int n, double max_val);
+} SimdKernels;
+
+const SimdKernels* simd_kernels(void);
+
+// Best level this CPU and OS support
+SimdLevel simd_detect(void);
+// Switches to level; 0 when the host lacks it
+int simd_select(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
+int simd_level_parse(const char *name, SimdLevel *level);
+
+#endif
@@ -1,108 +1,299 @@
 #include "svd_compress.h"
+#include "netpbm.h"
+#include "svd_engine.h"
+#include "svd_prune.h"
+#include "svd_decode.h"
+#include "svd_stream.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
-Matrix* pgm_to_matrix(PGMImage *img) {
-    Matrix *m = create_matrix(img->height, img->width);
+#define RECONSTRUCT_BLOCK 256
+
+static Matrix* pgm_to_matrix_ws(PGMImage *img, Workspace *ws) {
+    Matrix *m = scratch_matrix(ws, img->height, img->width);
     if (!m) return NULL;
     
     for (int i = 0; i < img->height; i++) {
-        for (int j = 0; j < img->width; j++) {
-            m->data[i][j] = (double)img->data[i][j];
-        }
+        widen_u8_to_double(img->data[i], m->data[i], img->width);
     }
     return m;
 }
 
+Matrix* pgm_to_matrix(PGMImage *img) {
+    return pgm_to_matrix_ws(img, NULL);
+}
+
 PGMImage* matrix_to_pgm(Matrix *m, int max_gray) {
     PGMImage *img = create_pgm_image(m->cols, m->rows, max_gray);
     if (!img) return NULL;
     
+    const SimdKernels *kern = simd_kernels();
     for (int i = 0; i < m->rows; i++) {
-        for (int j = 0; j < m->cols; j++) {
-            double val = m->data[i][j];
-            
-            if (val < 0) val = 0;
-            if (val > max_gray) val = max_gray;
-            
-            img->data[i][j] = (unsigned char)(val + 0.5);
-        }
+        kern->quantize_u8(m->data[i], img->data[i], m->cols, max_gray);
     }
     return img;
 }
 
-Matrix* reconstruct_from_svd(SVDResult *svd, int k) {
+typedef struct {
+    const SVDResult *svd;
+    int k;
+    Matrix *out;
+} ReconstructTask;
+
+// Rows [begin, end) of U_k Σ_k V_kᵀ. Each output row is independent, so the
+// row range is what threads split; Σ is folded into up to RECONSTRUCT_BLOCK
+// entries of the row of U at a time, leaving dot products with rows of V.
+static void reconstruct_rows(void *arg, int begin, int end) {
+    ReconstructTask *t = (ReconstructTask*)arg;
+    const SVDResult *svd = t->svd;
+    int n = svd->V->rows;
+    int k = t->k;
+
+    const SimdKernels *kern = simd_kernels();
+    double us[RECONSTRUCT_BLOCK];
+
+    for (int i = begin; i < end; i++) {
+        double *out = t->out->data[i];
+        memset(out, 0, n * sizeof(double));
+        for (int l0 = 0; l0 < k; l0 += RECONSTRUCT_BLOCK) {
+            int len = k - l0 < RECONSTRUCT_BLOCK ? k - l0 : RECONSTRUCT_BLOCK;
+            for (int l = 0; l < len; l++) {
+                us[l] = svd->U->data[i][l0 + l] * svd->singular_values[l0 + l];
+            }
+            for (int j = 0; j < n; j++) out[j] += kern->dot(us, svd->V->data[j] + l0, len);
+        }
+    }
+}
+
+static Matrix* reconstruct_threads(SVDResult *svd, int k, Workspace *ws, int threads) {
     if (k > svd->k) k = svd->k;
     
     int m = svd->U->rows;
     int n = svd->V->rows;
     
-    Matrix *reconstructed = create_matrix(m, n);
+    Matrix *reconstructed = scratch_matrix(ws, m, n);
     if (!reconstructed) return NULL;
     
-    for (int i = 0; i < m; i++) {
-        for (int j = 0; j < n; j++) {
-            reconstructed->data[i][j] = 0.0;
-            for (int l = 0; l < k; l++) {
-                reconstructed->data[i][j] += 
-                    svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
-            }
-        }
-    }
+    perf_phase_begin("reconstruct");
+    ReconstructTask task = { svd, k, reconstructed };
+    parallel_for(threads, m, reconstruct_rows, &task);
+    perf_phase_end("reconstruct", 3.0 * m * n * k, 8.0 * m * n + 24.0 * m * n * k);
     
     return reconstructed;
 }
 
+Matrix* reconstruct_from_svd(SVDResult *svd, int k) {
+    return reconstruct_from_svd_ws(svd, k, NULL);
+}
+
+Matrix* reconstruct_from_svd_ws(SVDResult *svd, int k, Workspace *ws) {
+    return reconstruct_threads(svd, k, ws, 1);
+}
+
+void reconstruct_to_buffer(const SVDResult *svd, int k, unsigned char *pixels, int stride,
+                           int max_val, int threads) {
+    svd_decode_region(svd, k, 0, svd->U->rows, 0, svd->V->rows, pixels, stride, max_val, threads);
+}
+
+size_t compress_workspace_bytes(int m, int n, int k, int low_memory) {
+    // Image matrix and reconstruction on top of the larger of the
+    // power/subspace and Lanczos solvers' needs
+    size_t solver = lanczos_svd_memory_bytes(m, n, k, low_memory);
+    size_t krylov = lanczos_restarted_memory_bytes(m, n, k, 0);
+    return 2 * matrix_storage_bytes(m, n) + (krylov > solver ? krylov : solver);
+}
+
+void compress_default_options(CompressOptions *opts) {
+    opts->ws = NULL;
+    opts->sequence = NULL;
+    opts->threads = 1;
+    opts->prune = 0.0;
+    opts->factors_file = NULL;
+    opts->cache = NULL;
+    opts->engine = SVD_ENGINE_AUTO;
+    opts->tune = autotune_default();
+    opts->quality = 0.0;
+    opts->processes = 0;
+    opts->transport = SVD_TRANSPORT_SOCKET;
+}
+
 PGMImage* compress_image_svd(PGMImage *img, int k) {
-    printf("\n=== Starting SVD Compression ===\n");
-    printf("Original image size: %dx%d\n", img->width, img->height);
-    printf("Rank for compression: k=%d\n", k);
+    CompressOptions opts;
+    compress_default_options(&opts);
+    return compress_image_svd_opts(img, k, &opts);
+}
+
+// SVD, optional pruning and rank-k reconstruction of A, whose samples run
+// up to max_val. img, when given, holds A's pixels and keys the factor
+// cache. The reconstruction and every intermediate come from opts->ws when
+// it is given; the caller rewinds it.
+static Matrix* compress_matrix(Matrix *A, const PGMImage *img, int max_val, int k,
+                               const CompressOptions *opts) {
+    Workspace *ws = opts->ws;
+    int m = A->rows, n = A->cols;
+    int threads = opts->threads > 0 ? opts->threads : opts->tune ? opts->tune->threads : 1;
     
-    Matrix *img_matrix = pgm_to_matrix(img);
-    if (!img_matrix) {
-        fprintf(stderr, "Error converting image to matrix\n");
-        return NULL;
+    mem_phase_begin("svd");
+    SVDOptions svd_opts;
+    svd_default_options(&svd_opts);
+    svd_opts.ws = ws;
+    svd_opts.threads = threads;
+    svd_opts.engine = opts->engine;
+    svd_opts.processes = opts->processes;
+    svd_opts.transport = opts->transport;
+    if (opts->engine == SVD_ENGINE_AUTO && opts->tune && !opts->sequence) {
+        svd_opts.engine = autotune_choose(opts->tune, m, n, k, opts->quality, &svd_opts);
+        if (svd_opts.engine != SVD_ENGINE_AUTO) {
+            printf("Tuned engine: %s\n", svd_engine_name(svd_opts.engine));
+        }
+    }
+    FactorCache *cache = opts->sequence || !img ? NULL : opts->cache;
+    uint64_t key = 0;
+    SVDResult *svd = NULL;
+    if (cache) {
+        key = factor_cache_key(img->pixels, img->width, img->height, img->stride, img->max_gray,
+                               &svd_opts);
+        svd = factor_cache_get(cache, key, k);
+        printf("Factor cache %s (%016llx)\n", svd ? "hit, skipping the SVD" : "miss",
+               (unsigned long long)key);
     }
-    
-    SVDResult *svd = lanczos_svd(img_matrix, k, k + 10);
+    if (!svd) {
+        svd = opts->sequence ?
+            svd_sequence_next(opts->sequence, A, k, &svd_opts) :
+            svd_compute(A, k, &svd_opts);
+        if (svd && cache) factor_cache_put(cache, key, svd, k, max_val);
+    }
+    mem_phase_end("svd");
     if (!svd) {
         fprintf(stderr, "Error computing SVD\n");
-        free_matrix(img_matrix);
         return NULL;
     }
     
+    if (opts->factors_file) {
+        mem_phase_begin("save_factors");
+        if (svd_stream_save(opts->factors_file, svd, k, max_val, 0)) {
+            printf("Saved progressive factors: %s\n", opts->factors_file);
+        }
+        mem_phase_end("save_factors");
+    }
+
+    SparseSVD *sparse = NULL;
+    if (opts->prune > 0) {
+        sparse = svd_prune(svd, k, opts->prune);
+        if (!sparse) {
+            fprintf(stderr, "Warning: pruning failed, reconstructing from dense factors\n");
+        } else if (!sparse_svd_is_smaller(sparse)) {
+            printf("Pruned factors: %.1f%% nonzero, %.1f KB vs %.1f KB dense; keeping the dense factors\n",
+                   sparse_svd_density(sparse) * 100.0, sparse_svd_payload_bytes(sparse) / 1024.0,
+                   dense_svd_payload_bytes(m, n, sparse->k) / 1024.0);
+            free_sparse_svd(sparse);
+            sparse = NULL;
+        }
+    }
+
     printf("Reconstructing image...\n");
-    Matrix *reconstructed = reconstruct_from_svd(svd, k);
+    mem_phase_begin("reconstruct");
+    Matrix *reconstructed = sparse ? sparse_reconstruct(sparse, ws, threads)
+                                   : reconstruct_threads(svd, k, ws, threads);
+    mem_phase_end("reconstruct");
     if (!reconstructed) {
         fprintf(stderr, "Error reconstructing image\n");
+        free_sparse_svd(sparse);
         free_svd_result(svd);
-        free_matrix(img_matrix);
         return NULL;
     }
     
-    PGMImage *compressed_img = matrix_to_pgm(reconstructed, img->max_gray);
+    print_compression_stats(A, reconstructed, max_val, calculate_compression_ratio(m, n, k));
+    if (sparse) {
+        printf("Pruned factors: %.1f%% nonzero, %.1f KB vs %.1f KB dense, "
+               "estimated added error %.3f%%\n",
+               sparse_svd_density(sparse) * 100.0, sparse_svd_payload_bytes(sparse) / 1024.0,
+               dense_svd_payload_bytes(m, n, sparse->k) / 1024.0,
+               sparse->error_estimate * 100.0);
+    }
+    printf("Peak memory so far: %.2f MB (%ld allocations)\n",
+           mem_peak_bytes() / 1048576.0, mem_alloc_count());
+    if (ws) {
+        printf("Workspace: %.2f of %.2f MB used at peak\n",
+               ws->high_water / 1048576.0, ws->capacity / 1048576.0);
+    }
     
-    double error = calculate_error(img_matrix, reconstructed);
-    int total_pixels = img->height * img->width;
-    double avg_error = error / total_pixels;
+    free_sparse_svd(sparse);
+    free_svd_result(svd);
+    return reconstructed;
+}
+
+// All intermediate matrices come from opts->ws when it is given; it is
+// rewound to where it was on entry before returning, ready for the next image.
+PGMImage* compress_image_svd_opts(PGMImage *img, int k, const CompressOptions *opts) {
+    Workspace *ws = opts->ws;
+    size_t mark = ws ? workspace_mark(ws) : 0;
     
-    double ratio = calculate_compression_ratio(img->height, img->width, k);
+    printf("\n=== Starting SVD Compression ===\n");
+    printf("Original image size: %dx%d\n", img->width, img->height);
+    printf("Rank for compression: k=%d\n", k);
     
-    printf("\n=== Compression Statistics ===\n");
-    printf("Compression ratio: %.2f:1\n", ratio);
-    printf("Storage required: %.2f%% of original\n", 100.0 / ratio);
-    printf("Total error: %.2f\n", error);
-    printf("Average error per pixel: %.4f\n", avg_error);
-    printf("Error percentage: %.2f%%\n", (avg_error / img->max_gray) * 100.0);
+    mem_phase_begin("to_matrix");
+    Matrix *img_matrix = pgm_to_matrix_ws(img, ws);
+    mem_phase_end("to_matrix");
+    if (!img_matrix) {
+        fprintf(stderr, "Error converting image to matrix\n");
+        return NULL;
+    }
     
-    free_matrix(img_matrix);
-    free_matrix(reconstructed);
-    free_svd_result(svd);
+    Matrix *reconstructed = compress_matrix(img_matrix, img, img->max_gray, k, opts);
+    PGMImage *compressed_img = NULL;
+    if (reconstructed) {
+        mem_phase_begin("to_image");
+        compressed_img = matrix_to_pgm(reconstructed, img->max_gray);
+        mem_phase_end("to_image");
+    }
     
-    printf("=== Compression Complete ===\n\n");
+    free_matrix(reconstructed);
+    free_matrix(img_matrix);
+    if (ws) workspace_release(ws, mark);
+    if (compressed_img) printf("=== Compression Complete ===\n\n");
     return compressed_img;
 }
 
+int compress_netpbm_svd_opts(NetpbmFile *f, const char *output, int k, int ascii,
+                             const CompressOptions *opts) {
+    Workspace *ws = opts->ws;
+    size_t mark = ws ? workspace_mark(ws) : 0;
+    int max_val = f->max_val;
+    
+    printf("\n=== Starting SVD Compression ===\n");
+    printf("Original image size: %dx%d, maxval %d\n", f->width, f->height, max_val);
+    printf("Rank for compression: k=%d\n", k);
+    
+    mem_phase_begin("to_matrix");
+    Matrix *img_matrix = scratch_matrix(ws, f->height, f->width);
+    int ok = img_matrix && netpbm_to_matrix(f, img_matrix);
+    mem_phase_end("to_matrix");
+    
+    Matrix *reconstructed = NULL;
+    if (!ok) fprintf(stderr, "Error converting image to matrix\n");
+    else reconstructed = compress_matrix(img_matrix, NULL, max_val, k, opts);
+    ok = reconstructed != NULL;
+    if (ok) {
+        printf("Writing compressed image: %s\n", output);
+        mem_phase_begin("write");
+        ok = netpbm_write_matrix(output, reconstructed, max_val, ascii);
+        mem_phase_end("write");
+    }
+    
+    free_matrix(reconstructed);
+    free_matrix(img_matrix);
+    if (ws) workspace_release(ws, mark);
+    if (ok) printf("=== Compression Complete ===\n\n");
+    return ok;
+}
+
 double calculate_compression_ratio(int m, int n, int k) {
     // Original storage: m * n
     double original = m * n;
@@ -113,18 +304,28 @@ double calculate_compression_ratio(int m, int n, int k) {
     return original / compressed;
 }
 
+void print_compression_stats(Matrix *original, Matrix *compressed, int max_gray, double ratio) {
+    double error = calculate_error(original, compressed);
+    double avg_error = error / ((double)original->rows * original->cols);
+
+    printf("\n=== Compression Statistics ===\n");
+    printf("Compression ratio: %.2f:1\n", ratio);
+    printf("Storage required: %.2f%% of original\n", 100.0 / ratio);
+    printf("Total error: %.2f\n", error);
+    printf("Average error per pixel: %.4f\n", avg_error);
+    printf("Error percentage: %.2f%%\n", (avg_error / max_gray) * 100.0);
+}
+
 double calculate_error(Matrix *original, Matrix *compressed) {
     if (original->rows != compressed->rows || original->cols != compressed->cols) {
         fprintf(stderr, "Error: Matrix dimensions don't match\n");
         return -1.0;
     }
     
+    const SimdKernels *kern = simd_kernels();
     double total_error = 0.0;
     for (int i = 0; i < original->rows; i++) {
-        for (int j = 0; j < original->cols; j++) {
-            double diff = original->data[i][j] - compressed->data[i][j];
-            total_error += fabs(diff);
-        }
+        total_error += kern->abs_diff_sum(original->data[i], compressed->data[i], original->cols);
     }
     
     return total_error;
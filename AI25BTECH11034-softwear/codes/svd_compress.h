@@ -2,18 +2,51 @@
 #define SVD_COMPRESS_H
 
 #include "pgm_io.h"
+#include "netpbm.h"
 #include "lanczos.h"
+#include "svd_sequence.h"
+#include "factor_cache.h"
+#include "autotune.h"
 
 Matrix* pgm_to_matrix(PGMImage *img);
 
 PGMImage* matrix_to_pgm(Matrix *m, int max_gray);
 
+typedef struct {
+    Workspace *ws;              // scratch for every intermediate; NULL uses the heap
+    SVDSequence *sequence;      // warm-start from the previous frame when set
+    int threads;                // threads for the AᵀA build and reconstruction; 0 = tuned count
+    double prune;               // error budget for sparse-pruned factors; 0 keeps them dense
+    const char *factors_file;   // also save the factors as a progressive stream (.svdp)
+    FactorCache *cache;         // reuse stored factors of the same pixels; ignored for sequences
+    SVDEngine engine;           // solver; AUTO picks from the tuning profile, else by shape, rank and memory
+    const TuneProfile *tune;    // host profile (autotune_default() by default); NULL for the built-in rules
+    double quality;             // accepted error over the optimal rank-k one (e.g. 1.5); 0 = exact
+    int processes;              // distributed engine: processes sharing the rows; 0 = one per CPU
+    SVDTransport transport;     // distributed engine: socket pairs or shared memory
+} CompressOptions;
+
+void compress_default_options(CompressOptions *opts);
+
 PGMImage* compress_image_svd(PGMImage *img, int k);
+PGMImage* compress_image_svd_opts(PGMImage *img, int k, const CompressOptions *opts);
+// Full-depth path for netpbm input: f's samples (16-bit ones included) go
+// straight into the compute buffer and the reconstruction is written to
+// output at f's maxval, as P2 text when ascii is set. Returns 1 on success.
+int compress_netpbm_svd_opts(NetpbmFile *f, const char *output, int k, int ascii,
+                             const CompressOptions *opts);
+size_t compress_workspace_bytes(int m, int n, int k, int low_memory);
 
 Matrix* reconstruct_from_svd(SVDResult *svd, int k);
+Matrix* reconstruct_from_svd_ws(SVDResult *svd, int k, Workspace *ws);
+// Rounds and clamps the rank-k reconstruction straight into 8-bit rows
+void reconstruct_to_buffer(const SVDResult *svd, int k, unsigned char *pixels, int stride,
+                           int max_val, int threads);
 
 double calculate_compression_ratio(int m, int n, int k);
 
 double calculate_error(Matrix *original, Matrix *compressed);
+// The "Compression Statistics" block shared by every compression mode
+void print_compression_stats(Matrix *original, Matrix *compressed, int max_gray, double ratio);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,505 @@
+#define _GNU_SOURCE
+#include "svd_daemon.h"
+#include "svdcompress.h"
+#include "pgm_io.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DAEMON_LINE_MAX 4096
+#define DAEMON_LATENCY_WINDOW 1024      // recent jobs kept for percentiles
+#define DAEMON_QUALITY_START_RANK 16    // first rank tried for a quality target
+#define DAEMON_READ_TIMEOUT 2           // seconds a client may take to send its line
+
+typedef struct {
+    int fd;
+    char line[DAEMON_LINE_MAX];
+    double queued_at;
+} DaemonJob;
+
+typedef struct {
+    DaemonConfig cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    DaemonJob *queue;           // ring of cfg.queue_capacity jobs
+    int head;
+    int count;
+    int running;
+    int stopping;
+    long done;
+    long failed;
+    long rejected;
+    double latency[DAEMON_LATENCY_WINDOW];
+    double latency_sum;
+    double latency_max;
+} Daemon;
+
+static volatile sig_atomic_t daemon_signalled = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    daemon_signalled = 1;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void svd_daemon_default_config(DaemonConfig *cfg) {
+    cfg->workers = 0;
+    cfg->threads_per_job = 1;
+    cfg->queue_capacity = 256;
+}
+
+static void send_reply(int fd, const char *reply) {
+    size_t len = strlen(reply);
+    while (len > 0) {
+        ssize_t n = send(fd, reply, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        reply += n;
+        len -= (size_t)n;
+    }
+}
+
+// One line, without the newline; 0 on timeout, EOF or overflow
+static int read_line(int fd, char *line, size_t cap) {
+    size_t len = 0;
+    while (len + 1 < cap) {
+        ssize_t n = recv(fd, line + len, cap - 1 - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+        char *end = memchr(line, '\n', len);
+        if (end) {
+            *end = '\0';
+            if (end > line && end[-1] == '\r') end[-1] = '\0';
+            return 1;
+        }
+    }
+    line[len] = '\0';
+    return len > 0 && len + 1 < cap;
+}
+
+// "50" is a rank, "2%" a relative error target
+static int parse_rank(const char *token, int *k, double *target) {
+    char *end;
+    double v = strtod(token, &end);
+    if (end == token || v <= 0) return 0;
+    if (*end == '%' && end[1] == '\0') {
+        *k = 0;
+        *target = v / 100.0;
+        return 1;
+    }
+    if (*end != '\0' || v != (int)v) return 0;
+    *k = (int)v;
+    *target = 0;
+    return 1;
+}
+
+// Compresses the 8-bit image in pixels and writes the reconstruction to out
+// (which may alias pixels). A quality target is met by doubling the rank
+// until the error left in the discarded singular values drops below it,
+// then cutting at the first rank that meets it.
+static int run_compress(SVDCompressor *ctx, const unsigned char *pixels, int width, int height,
+                        int stride, int k, double target, unsigned char *out, int out_stride,
+                        int max_val, char *reply, size_t cap, int *rank, double *error) {
+    double energy = 0.0;
+    for (int i = 0; i < height; i++) {
+        const unsigned char *row = pixels + (size_t)i * stride;
+        for (int j = 0; j < width; j++) energy += (double)row[j] * row[j];
+    }
+
+    int p = width < height ? width : height;
+    int solve_k = target > 0 ? DAEMON_QUALITY_START_RANK : k;
+    SVDResult *svd = NULL;
+    int keep = 0;
+    double kept_energy = 0.0;
+    for (;;) {
+        if (solve_k > p) solve_k = p;
+        free_svd_result(svd);
+        svd = svdc_compress(ctx, pixels, width, height, stride, solve_k);
+        if (!svd) {
+            snprintf(reply, cap, "ERR decomposition failed\n");
+            return 0;
+        }
+
+        keep = svd->k;
+        kept_energy = 0.0;
+        for (int l = 0; l < svd->k; l++) {
+            kept_energy += svd->singular_values[l] * svd->singular_values[l];
+            if (target > 0 && sqrt(fmax(energy - kept_energy, 0.0)) <= target * sqrt(energy)) {
+                keep = l + 1;
+                break;
+            }
+        }
+        if (target <= 0 || keep < svd->k || solve_k == p) break;
+        if (sqrt(fmax(energy - kept_energy, 0.0)) <= target * sqrt(energy)) break;
+        solve_k *= 2;
+    }
+    *rank = keep;
+    *error = energy > 0 ? sqrt(fmax(energy - kept_energy, 0.0) / energy) : 0.0;
+
+    int ok = svdc_decompress(ctx, svd, keep, out, out_stride, max_val);
+    free_svd_result(svd);
+    if (!ok) snprintf(reply, cap, "ERR reconstruction failed\n");
+    return ok;
+}
+
+static int job_file(SVDCompressor *ctx, const char *line, char *reply, size_t cap,
+                    int *rank, double *error) {
+    char input[1024], output[1024], rank_token[64];
+    int k;
+    double target;
+    if (sscanf(line, "%*s %1023s %1023s %63s", input, output, rank_token) != 3 ||
+        !parse_rank(rank_token, &k, &target)) {
+        snprintf(reply, cap, "ERR usage: COMPRESS <input> <output> <k|error%%>\n");
+        return 0;
+    }
+
+    PGMImage *img = read_image(input);
+    if (!img) {
+        snprintf(reply, cap, "ERR cannot read %s\n", input);
+        return 0;
+    }
+    int max_val = img->max_gray > 255 ? 255 : img->max_gray;
+    PGMImage *out = create_pgm_image(img->width, img->height, max_val);
+    int ok = out && run_compress(ctx, img->pixels, img->width, img->height, img->stride, k, target,
+                                 out->pixels, out->stride, max_val, reply, cap, rank, error);
+    if (!out) snprintf(reply, cap, "ERR out of memory\n");
+    if (ok && !write_image(output, out)) {
+        snprintf(reply, cap, "ERR cannot write %s\n", output);
+        ok = 0;
+    }
+    free_pgm_image(out);
+    free_pgm_image(img);
+    return ok;
+}
+
+static int job_shm(SVDCompressor *ctx, const char *line, char *reply, size_t cap,
+                   int *rank, double *error) {
+    char name[256], rank_token[64];
+    int width, height, k;
+    double target;
+    if (sscanf(line, "%*s %255s %d %d %63s", name, &width, &height, rank_token) != 4 ||
+        width <= 0 || height <= 0 || !parse_rank(rank_token, &k, &target)) {
+        snprintf(reply, cap, "ERR usage: COMPRESS_SHM <name> <width> <height> <k|error%%>\n");
+        return 0;
+    }
+    if (width > INT_MAX / height) {
+        snprintf(reply, cap, "ERR image %dx%d is too large\n", width, height);
+        return 0;
+    }
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        snprintf(reply, cap, "ERR cannot open shared memory %s\n", name);
+        return 0;
+    }
+    // A short object would fault (SIGBUS) once the pixels are touched
+    size_t len = (size_t)width * height;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || (size_t)st.st_size < len) {
+        snprintf(reply, cap, "ERR shared memory %s holds fewer than %zu bytes\n", name, len);
+        close(fd);
+        return 0;
+    }
+    unsigned char *pixels = (unsigned char*)mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pixels == MAP_FAILED) {
+        snprintf(reply, cap, "ERR cannot map %zu bytes of %s\n", len, name);
+        return 0;
+    }
+    // The pixels are copied into the solver before the result overwrites them
+    int ok = run_compress(ctx, pixels, width, height, width, k, target, pixels, width, 255,
+                          reply, cap, rank, error);
+    munmap(pixels, len);
+    return ok;
+}
+
+static void record_job(Daemon *d, int ok, double latency) {
+    pthread_mutex_lock(&d->lock);
+    d->running--;
+    if (ok) {
+        d->latency[d->done % DAEMON_LATENCY_WINDOW] = latency;
+        d->latency_sum += latency;
+        if (latency > d->latency_max) d->latency_max = latency;
+        d->done++;
+    } else {
+        d->failed++;
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void* worker_main(void *arg) {
+    Daemon *d = (Daemon*)arg;
+    SVDCompressorConfig cfg;
+    svdc_default_config(&cfg);
+    cfg.threads = d->cfg.threads_per_job;
+    SVDCompressor *ctx = svdc_create(&cfg);
+
+    for (;;) {
+        pthread_mutex_lock(&d->lock);
+        while (d->count == 0 && !d->stopping) pthread_cond_wait(&d->ready, &d->lock);
+        if (d->count == 0) {
+            pthread_mutex_unlock(&d->lock);
+            break;
+        }
+        DaemonJob job = d->queue[d->head];
+        d->head = (d->head + 1) % d->cfg.queue_capacity;
+        d->count--;
+        d->running++;
+        pthread_mutex_unlock(&d->lock);
+
+        double started = now_seconds();
+        char reply[DAEMON_LINE_MAX];
+        int rank = 0;
+        double error = 0.0;
+        int ok = 0;
+        if (!ctx) {
+            snprintf(reply, sizeof(reply), "ERR out of memory\n");
+        } else if (strncmp(job.line, "COMPRESS_SHM ", 13) == 0) {
+            ok = job_shm(ctx, job.line, reply, sizeof(reply), &rank, &error);
+        } else {
+            ok = job_file(ctx, job.line, reply, sizeof(reply), &rank, &error);
+        }
+        double finished = now_seconds();
+        if (ok) {
+            snprintf(reply, sizeof(reply), "OK k=%d error=%.4f%% wait_ms=%.2f run_ms=%.2f\n",
+                     rank, error * 100.0, (started - job.queued_at) * 1e3,
+                     (finished - started) * 1e3);
+        }
+        // Recorded before replying, so a client's next STATS counts its job
+        record_job(d, ok, finished - job.queued_at);
+        send_reply(job.fd, reply);
+        close(job.fd);
+    }
+
+    svdc_destroy(ctx);
+    return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void format_stats(Daemon *d, char *reply, size_t cap) {
+    double window[DAEMON_LATENCY_WINDOW];
+    pthread_mutex_lock(&d->lock);
+    int queued = d->count, running = d->running;
+    long done = d->done, failed = d->failed, rejected = d->rejected;
+    double sum = d->latency_sum, max = d->latency_max;
+    int n = done < DAEMON_LATENCY_WINDOW ? (int)done : DAEMON_LATENCY_WINDOW;
+    memcpy(window, d->latency, n * sizeof(double));
+    pthread_mutex_unlock(&d->lock);
+
+    qsort(window, n, sizeof(double), compare_doubles);
+    double p50 = n ? window[(n - 1) / 2] : 0.0;
+    double p95 = n ? window[(int)((n - 1) * 0.95)] : 0.0;
+    double p99 = n ? window[(int)((n - 1) * 0.99)] : 0.0;
+    snprintf(reply, cap,
+             "OK queued=%d running=%d done=%ld failed=%ld rejected=%ld mean_ms=%.2f "
+             "p50_ms=%.2f p95_ms=%.2f p99_ms=%.2f max_ms=%.2f\n",
+             queued, running, done, failed, rejected, done ? sum / done * 1e3 : 0.0,
+             p50 * 1e3, p95 * 1e3, p99 * 1e3, max * 1e3);
+}
+
+// Reads the request on the accepting thread: STATS and SHUTDOWN are
+// answered at once, compression jobs are queued for the workers
+static void dispatch(Daemon *d, int fd) {
+    DaemonJob job;
+    job.fd = fd;
+    job.queued_at = now_seconds();
+    char reply[DAEMON_LINE_MAX];
+
+    if (!read_line(fd, job.line, sizeof(job.line))) {
+        send_reply(fd, "ERR malformed request\n");
+        close(fd);
+        return;
+    }
+    if (strcmp(job.line, "STATS") == 0) {
+        format_stats(d, reply, sizeof(reply));
+        send_reply(fd, reply);
+        close(fd);
+        return;
+    }
+    if (strcmp(job.line, "SHUTDOWN") == 0) {
+        send_reply(fd, "OK shutting down\n");
+        close(fd);
+        pthread_mutex_lock(&d->lock);
+        d->stopping = 1;
+        pthread_mutex_unlock(&d->lock);
+        return;
+    }
+    if (strncmp(job.line, "COMPRESS ", 9) != 0 && strncmp(job.line, "COMPRESS_SHM ", 13) != 0) {
+        send_reply(fd, "ERR unknown request\n");
+        close(fd);
+        return;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    int queued = d->count < d->cfg.queue_capacity;
+    if (queued) {
+        d->queue[(d->head + d->count) % d->cfg.queue_capacity] = job;
+        d->count++;
+        pthread_cond_signal(&d->ready);
+    } else {
+        d->rejected++;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (!queued) {
+        send_reply(fd, "ERR queue full\n");
+        close(fd);
+    }
+}
+
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un addr;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create socket\n");
+        return -1;
+    }
+    unlink(socket_path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int svd_daemon_run(const char *socket_path, const DaemonConfig *cfg) {
+    Daemon d;
+    memset(&d, 0, sizeof(d));
+    if (cfg) d.cfg = *cfg;
+    else svd_daemon_default_config(&d.cfg);
+    if (d.cfg.workers <= 0) d.cfg.workers = parallel_cpu_count();
+    if (d.cfg.threads_per_job <= 0) d.cfg.threads_per_job = 1;
+    if (d.cfg.queue_capacity <= 0) d.cfg.queue_capacity = 1;
+
+    d.queue = (DaemonJob*)mem_alloc((size_t)d.cfg.queue_capacity * sizeof(DaemonJob));
+    pthread_t *tid = (pthread_t*)mem_alloc(d.cfg.workers * sizeof(pthread_t));
+    if (!d.queue || !tid) {
+        mem_free(d.queue);
+        mem_free(tid);
+        return 0;
+    }
+    int listener = open_listener(socket_path);
+    if (listener < 0) {
+        mem_free(d.queue);
+        mem_free(tid);
+        return 0;
+    }
+    pthread_mutex_init(&d.lock, NULL);
+    pthread_cond_init(&d.ready, NULL);
+
+    // Workers never see SIGINT/SIGTERM, so the signal interrupts accept()
+    // on this thread
+    sigset_t stop_signals, previous;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+    int started = 0;
+    while (started < d.cfg.workers && pthread_create(&tid[started], NULL, worker_main, &d) == 0) {
+        started++;
+    }
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    daemon_signalled = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    printf("Listening on %s with %d workers\n", socket_path, started);
+    fflush(stdout);
+    int ok = started > 0;
+    for (;;) {
+        pthread_mutex_lock(&d.lock);
+        int stopping = d.stopping;
+        pthread_mutex_unlock(&d.lock);
+        if (stopping || daemon_signalled || !ok) break;
+
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+            ok = 0;
+            break;
+        }
+        struct timeval timeout = { DAEMON_READ_TIMEOUT, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        dispatch(&d, fd);
+    }
+
+    close(listener);
+    unlink(socket_path);
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+
+    // Queued jobs are finished before the workers leave
+    pthread_mutex_lock(&d.lock);
+    d.stopping = 1;
+    pthread_cond_broadcast(&d.ready);
+    pthread_mutex_unlock(&d.lock);
+    for (int t = 0; t < started; t++) pthread_join(tid[t], NULL);
+
+    char stats[DAEMON_LINE_MAX];
+    format_stats(&d, stats, sizeof(stats));
+    printf("Daemon stopped: %s", stats + 3);
+
+    pthread_cond_destroy(&d.ready);
+    pthread_mutex_destroy(&d.lock);
+    mem_free(d.queue);
+    mem_free(tid);
+    return ok;
+}
+
+int svd_daemon_request(const char *socket_path, const char *request, char *reply, size_t cap) {
+    struct sockaddr_un addr;
+    if (strlen(socket_path) >= sizeof(addr.sun_path) || cap == 0) return 0;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Error: Cannot connect to %s\n", socket_path);
+        close(fd);
+        return 0;
+    }
+    send_reply(fd, request);
+    send_reply(fd, "\n");
+    int ok = read_line(fd, reply, cap);
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,38 @@
+#ifndef SVD_DAEMON_H
+#define SVD_DAEMON_H
+
+#include <stddef.h>
+
+// Long-running compression service on a UNIX domain socket. Each
+// connection carries one request line and gets one reply line:
+//
+//   COMPRESS <input> <output> <rank>       compress a file (paths without spaces)
+//   COMPRESS_SHM <name> <width> <height> <rank>
+//                                          8-bit gray pixels in POSIX shared
+//                                          memory, replaced by the result
+//   STATS                                  queue depth and latency statistics
+//   SHUTDOWN                               finish queued jobs and exit
+//
+// <rank> is either k or a quality target such as "2%", meaning the smallest
+// rank whose relative Frobenius error is at most 2%. Replies start with
+// "OK " followed by key=value metrics, or "ERR " and a reason.
+//
+// Jobs run on a fixed pool of workers, each owning an SVDCompressor whose
+// workspace is sized per job and reused, so steady-state requests pay no
+// process start-up or allocator warm-up.
+typedef struct {
+    int workers;                // worker threads; 0 = one per online CPU
+    int threads_per_job;        // threads inside one job
+    int queue_capacity;         // jobs waiting beyond this are refused
+} DaemonConfig;
+
+void svd_daemon_default_config(DaemonConfig *cfg);
+
+// Serves until SHUTDOWN, SIGINT or SIGTERM. Returns 1 on a clean exit.
+int svd_daemon_run(const char *socket_path, const DaemonConfig *cfg);
+
+// Client side: sends one request line and stores the reply line (without
+// the newline) in reply. Returns 1 when a reply was received.
+int svd_daemon_request(const char *socket_path, const char *request, char *reply, size_t cap);
+
+#endif
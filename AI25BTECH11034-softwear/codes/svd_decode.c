@@ -0,0 +1,223 @@
+#include "svd_decode.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const SVDResult *svd;
+    int k;
+    int r0, c0, c1;
+    unsigned char *pixels;
+    int stride;
+    int max_val;
+    int *ok;
+} RegionTask;
+
+// Region rows [begin, end): Σ is folded into the row of U once, then every
+// pixel is a dot product of two contiguous k-vectors, quantized a row at a
+// time
+static void decode_rows(void *arg, int begin, int end) {
+    RegionTask *t = (RegionTask*)arg;
+    int k = t->k;
+    int width = t->c1 - t->c0;
+    const SimdKernels *kern = simd_kernels();
+    double *us = (double*)mem_alloc((k + width) * sizeof(double));
+    if (!us) {
+        t->ok[begin] = 0;
+        return;
+    }
+    double *sums = us + k;
+    for (int r = begin; r < end; r++) {
+        const double *u = t->svd->U->data[t->r0 + r];
+        for (int l = 0; l < k; l++) us[l] = u[l] * t->svd->singular_values[l];
+        for (int j = 0; j < width; j++) sums[j] = kern->dot(us, t->svd->V->data[t->c0 + j], k);
+        kern->quantize_u8(sums, t->pixels + (size_t)r * t->stride, width, t->max_val);
+    }
+    mem_free(us);
+}
+
+int svd_decode_region(const SVDResult *svd, int k, int r0, int r1, int c0, int c1,
+                      unsigned char *pixels, int stride, int max_val, int threads) {
+    int m = svd->U->rows;
+    int n = svd->V->rows;
+    if (k > svd->k) k = svd->k;
+    if (r0 < 0 || c0 < 0 || r1 > m || c1 > n || r0 >= r1 || c0 >= c1 || k <= 0) {
+        fprintf(stderr, "Error: Invalid region [%d,%d)x[%d,%d) of a %dx%d image\n",
+                r0, r1, c0, c1, m, n);
+        return 0;
+    }
+
+    int rows = r1 - r0;
+    int *ok = (int*)mem_alloc(rows * sizeof(int));
+    if (!ok) return 0;
+    for (int r = 0; r < rows; r++) ok[r] = 1;
+
+    double area = (double)rows * (c1 - c0);
+    perf_phase_begin("decode_region");
+    RegionTask task = { svd, k, r0, c0, c1, pixels, stride, max_val, ok };
+    parallel_for(threads, rows, decode_rows, &task);
+    perf_phase_end("decode_region", 2.0 * area * k, 8.0 * area * k + area);
+
+    int good = 1;
+    for (int r = 0; r < rows; r++) good = good && ok[r];
+    mem_free(ok);
+    return good;
+}
+
+// Slots form a doubly linked list in recency order (head = most recent);
+// slot_of maps every tile of the image to its slot, or -1
+struct TileCache {
+    const SVDResult *svd;
+    int k;
+    int tile_size;
+    int tiles_y, tiles_x;
+    int max_val;
+    int threads;
+    int max_tiles;
+    int used;
+    int head, tail;
+    int *slot_of;
+    int *tile_of;               // per slot
+    int *prev, *next;           // per slot
+    unsigned char *pixels;      // max_tiles tiles of tile_size² bytes
+    long hits, misses;
+};
+
+TileCache* tile_cache_create(const SVDResult *svd, int k, int tile_size, int max_tiles,
+                             int max_val, int threads) {
+    if (tile_size <= 0 || max_tiles <= 0) {
+        fprintf(stderr, "Error: Invalid tile size %d or cache size %d\n", tile_size, max_tiles);
+        return NULL;
+    }
+    TileCache *c = (TileCache*)mem_calloc(1, sizeof(TileCache));
+    if (!c) return NULL;
+    c->svd = svd;
+    c->k = k < svd->k ? k : svd->k;
+    c->tile_size = tile_size;
+    c->tiles_y = (svd->U->rows + tile_size - 1) / tile_size;
+    c->tiles_x = (svd->V->rows + tile_size - 1) / tile_size;
+    c->max_val = max_val;
+    c->threads = threads;
+    c->max_tiles = max_tiles;
+    c->head = c->tail = -1;
+
+    int tiles = c->tiles_y * c->tiles_x;
+    c->slot_of = (int*)mem_alloc(tiles * sizeof(int));
+    c->tile_of = (int*)mem_alloc(max_tiles * sizeof(int));
+    c->prev = (int*)mem_alloc(max_tiles * sizeof(int));
+    c->next = (int*)mem_alloc(max_tiles * sizeof(int));
+    c->pixels = (unsigned char*)mem_alloc((size_t)max_tiles * tile_size * tile_size);
+    if (!c->slot_of || !c->tile_of || !c->prev || !c->next || !c->pixels) {
+        tile_cache_destroy(c);
+        return NULL;
+    }
+    for (int t = 0; t < tiles; t++) c->slot_of[t] = -1;
+    return c;
+}
+
+void tile_cache_destroy(TileCache *cache) {
+    if (!cache) return;
+    mem_free(cache->pixels);
+    mem_free(cache->next);
+    mem_free(cache->prev);
+    mem_free(cache->tile_of);
+    mem_free(cache->slot_of);
+    mem_free(cache);
+}
+
+static void unlink_slot(TileCache *c, int s) {
+    if (c->prev[s] >= 0) c->next[c->prev[s]] = c->next[s];
+    else c->head = c->next[s];
+    if (c->next[s] >= 0) c->prev[c->next[s]] = c->prev[s];
+    else c->tail = c->prev[s];
+}
+
+static void push_front(TileCache *c, int s) {
+    c->prev[s] = -1;
+    c->next[s] = c->head;
+    if (c->head >= 0) c->prev[c->head] = s;
+    c->head = s;
+    if (c->tail < 0) c->tail = s;
+}
+
+static void push_back(TileCache *c, int s) {
+    c->next[s] = -1;
+    c->prev[s] = c->tail;
+    if (c->tail >= 0) c->next[c->tail] = s;
+    c->tail = s;
+    if (c->head < 0) c->head = s;
+}
+
+// Pixels of tile (ty, tx), rows tile_size bytes apart; decodes it into the
+// least recently used slot on a miss
+static const unsigned char* get_tile(TileCache *c, int ty, int tx) {
+    int t = ty * c->tiles_x + tx;
+    int ts = c->tile_size;
+    int s = c->slot_of[t];
+    if (s >= 0) {
+        c->hits++;
+        unlink_slot(c, s);
+        push_front(c, s);
+        return c->pixels + (size_t)s * ts * ts;
+    }
+
+    c->misses++;
+    if (c->used < c->max_tiles) {
+        s = c->used++;
+    } else {
+        s = c->tail;
+        unlink_slot(c, s);
+        if (c->tile_of[s] >= 0) c->slot_of[c->tile_of[s]] = -1;
+    }
+    unsigned char *px = c->pixels + (size_t)s * ts * ts;
+    int r0 = ty * ts, c0 = tx * ts;
+    int r1 = r0 + ts < c->svd->U->rows ? r0 + ts : c->svd->U->rows;
+    int c1 = c0 + ts < c->svd->V->rows ? c0 + ts : c->svd->V->rows;
+    if (!svd_decode_region(c->svd, c->k, r0, r1, c0, c1, px, ts, c->max_val, c->threads)) {
+        // The slot holds nothing valid; make it the next one evicted
+        c->tile_of[s] = -1;
+        push_back(c, s);
+        return NULL;
+    }
+    c->tile_of[s] = t;
+    c->slot_of[t] = s;
+    push_front(c, s);
+    return px;
+}
+
+int tile_cache_decode_region(TileCache *cache, int r0, int r1, int c0, int c1,
+                             unsigned char *pixels, int stride) {
+    int m = cache->svd->U->rows;
+    int n = cache->svd->V->rows;
+    if (r0 < 0 || c0 < 0 || r1 > m || c1 > n || r0 >= r1 || c0 >= c1) {
+        fprintf(stderr, "Error: Invalid region [%d,%d)x[%d,%d) of a %dx%d image\n",
+                r0, r1, c0, c1, m, n);
+        return 0;
+    }
+
+    int ts = cache->tile_size;
+    for (int ty = r0 / ts; ty <= (r1 - 1) / ts; ty++) {
+        for (int tx = c0 / ts; tx <= (c1 - 1) / ts; tx++) {
+            const unsigned char *tile = get_tile(cache, ty, tx);
+            if (!tile) return 0;
+            // Overlap of the tile with the region
+            int y0 = ty * ts > r0 ? ty * ts : r0;
+            int y1 = (ty + 1) * ts < r1 ? (ty + 1) * ts : r1;
+            int x0 = tx * ts > c0 ? tx * ts : c0;
+            int x1 = (tx + 1) * ts < c1 ? (tx + 1) * ts : c1;
+            for (int y = y0; y < y1; y++) {
+                memcpy(pixels + (size_t)(y - r0) * stride + (x0 - c0),
+                       tile + (size_t)(y - ty * ts) * ts + (x0 - tx * ts), x1 - x0);
+            }
+        }
+    }
+    return 1;
+}
+
+void tile_cache_stats(const TileCache *cache, long *hits, long *misses) {
+    if (hits) *hits = cache->hits;
+    if (misses) *misses = cache->misses;
+}
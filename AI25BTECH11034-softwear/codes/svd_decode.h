@@ -0,0 +1,29 @@
+#ifndef SVD_DECODE_H
+#define SVD_DECODE_H
+
+#include "lanczos.h"
+
+// Random-access decoding of stored factors. Any rectangle of the rank-k
+// image costs O(area·k): each pixel is one k-term dot product of a scaled
+// row of U with a row of V, so nothing outside the viewport is computed.
+
+// Rows [r0, r1) × columns [c0, c1) of U_k Σ_k V_kᵀ, rounded and clamped to
+// [0, max_val], into pixels (row i - r0 at pixels + (i - r0) * stride).
+// Returns 0 for an empty or out-of-range rectangle or when out of memory.
+int svd_decode_region(const SVDResult *svd, int k, int r0, int r1, int c0, int c1,
+                      unsigned char *pixels, int stride, int max_val, int threads);
+
+// LRU cache of decoded tile_size × tile_size tiles for panning viewers:
+// regions are assembled from cached tiles and only missing tiles are
+// decoded. Not thread-safe; use one cache per viewer thread. The factors
+// must outlive the cache.
+typedef struct TileCache TileCache;
+
+TileCache* tile_cache_create(const SVDResult *svd, int k, int tile_size, int max_tiles,
+                             int max_val, int threads);
+void tile_cache_destroy(TileCache *cache);
+int tile_cache_decode_region(TileCache *cache, int r0, int r1, int c0, int c1,
+                             unsigned char *pixels, int stride);
+void tile_cache_stats(const TileCache *cache, long *hits, long *misses);
+
+#endif
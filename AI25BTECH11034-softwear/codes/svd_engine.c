@@ -0,0 +1,75 @@
+#include "svd_engine.h"
+#include "dense_svd.h"
+#include "qr_svd.h"
+#include "rrqr_cur.h"
+#include "dist_svd.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+// The Lanczos path keeps its scratch in the workspace when there is one
+static int lanczos_fits(int m, int n, int k, const SVDOptions *opts) {
+    size_t bytes = lanczos_restarted_memory_bytes(m, n, k, opts->krylov_dim);
+    return opts->ws ? workspace_available(opts->ws) >= bytes : mem_would_fit(bytes);
+}
+
+SVDEngine svd_select_engine(int m, int n, int k, const SVDOptions *opts) {
+    if (opts->engine != SVD_ENGINE_AUTO) return opts->engine;
+    if (opts->start) return SVD_ENGINE_POWER;
+    // Matrix-free either way; Lanczos needs (m + n)·2k, power iteration less
+    if (opts->low_memory) return lanczos_fits(m, n, k, opts) ? SVD_ENGINE_LANCZOS : SVD_ENGINE_POWER;
+
+    int p = m < n ? m : n;
+    int q = m < n ? n : m;
+    if (q >= SVD_QR_ASPECT_RATIO * p && mem_would_fit(qr_svd_memory_bytes(m, n, k, opts->threads))) {
+        return SVD_ENGINE_QR;
+    }
+    int lanczos = lanczos_fits(m, n, k, opts);
+    if (k <= SVD_DENSE_RANK_FRACTION * p && lanczos) return SVD_ENGINE_LANCZOS;
+    // The dense path keeps its intermediates on the heap
+    if (mem_would_fit(dense_svd_memory_bytes(m, n, k))) return SVD_ENGINE_DENSE;
+    return lanczos ? SVD_ENGINE_LANCZOS : SVD_ENGINE_POWER;
+}
+
+const char* svd_engine_name(SVDEngine engine) {
+    switch (engine) {
+        case SVD_ENGINE_AUTO: return "auto";
+        case SVD_ENGINE_POWER: return "power";
+        case SVD_ENGINE_DENSE: return "dense";
+        case SVD_ENGINE_QR: return "qr";
+        case SVD_ENGINE_LANCZOS: return "lanczos";
+        case SVD_ENGINE_RRQR: return "rrqr";
+        case SVD_ENGINE_CUR: return "cur";
+        case SVD_ENGINE_DISTRIBUTED: return "distributed";
+    }
+    return "unknown";
+}
+
+int svd_engine_parse(const char *name, SVDEngine *engine) {
+    for (int e = SVD_ENGINE_AUTO; e <= SVD_ENGINE_DISTRIBUTED; e++) {
+        if (strcmp(name, svd_engine_name((SVDEngine)e)) == 0) {
+            *engine = (SVDEngine)e;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+SVDResult* svd_compute(Matrix *A, int k, const SVDOptions *opts) {
+    switch (svd_select_engine(A->rows, A->cols, k, opts)) {
+        case SVD_ENGINE_DENSE:
+            return dense_svd(A, k, opts);
+        case SVD_ENGINE_QR:
+            return qr_svd(A, k, opts);
+        case SVD_ENGINE_LANCZOS:
+            return lanczos_restarted_svd(A, k, opts);
+        case SVD_ENGINE_RRQR:
+            return rrqr_svd(A, k, opts);
+        case SVD_ENGINE_CUR:
+            return cur_svd(A, k, opts);
+        case SVD_ENGINE_DISTRIBUTED:
+            return dist_svd(A, k, opts);
+        default:
+            return lanczos_svd_opts(A, k, opts);
+    }
+}
@@ -0,0 +1,258 @@
+#include "svd_prune.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+// Output rows accumulated together by the sparse reconstruction
+#define SPARSE_STRIP_ROWS 16
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void free_sparse_factor(SparseFactor *f) {
+    if (!f) return;
+    mem_free(f->colptr);
+    mem_free(f->rowidx);
+    mem_free(f->values);
+    mem_free(f);
+}
+
+// Keeps the entries of the first k columns of F whose weight σ_l |x|
+// exceeds tau; the squared weights dropped are added to *dropped
+static SparseFactor* sparsify(const Matrix *F, int k, const double *sigma, double tau,
+                              double *dropped) {
+    int rows = F->rows;
+    SparseFactor *f = (SparseFactor*)mem_calloc(1, sizeof(SparseFactor));
+    if (!f) return NULL;
+    f->rows = rows;
+    f->cols = k;
+    f->colptr = (int*)mem_calloc(k + 1, sizeof(int));
+    if (!f->colptr) {
+        free_sparse_factor(f);
+        return NULL;
+    }
+
+    // Counted row by row (F is row-major), then filled the same way
+    for (int i = 0; i < rows; i++) {
+        for (int l = 0; l < k; l++) {
+            if (sigma[l] * fabs(F->data[i][l]) > tau) f->colptr[l + 1]++;
+        }
+    }
+    for (int l = 0; l < k; l++) f->colptr[l + 1] += f->colptr[l];
+    int nnz = f->colptr[k];
+    f->rowidx = (int*)mem_alloc((nnz ? nnz : 1) * sizeof(int));
+    f->values = (double*)mem_alloc((nnz ? nnz : 1) * sizeof(double));
+    int *next = (int*)mem_alloc((k ? k : 1) * sizeof(int));
+    if (!f->rowidx || !f->values || !next) {
+        mem_free(next);
+        free_sparse_factor(f);
+        return NULL;
+    }
+    memcpy(next, f->colptr, k * sizeof(int));
+    for (int i = 0; i < rows; i++) {
+        for (int l = 0; l < k; l++) {
+            double x = F->data[i][l];
+            double w = sigma[l] * fabs(x);
+            if (w > tau) {
+                f->rowidx[next[l]] = i;
+                f->values[next[l]++] = x;
+            } else {
+                *dropped += w * w;
+            }
+        }
+    }
+    mem_free(next);
+    return f;
+}
+
+SparseSVD* svd_prune(const SVDResult *svd, int k, double budget) {
+    if (k > svd->k) k = svd->k;
+    int m = svd->U->rows;
+    int n = svd->V->rows;
+    const double *sigma = svd->singular_values;
+
+    double energy = 0.0;
+    for (int l = 0; l < k; l++) energy += sigma[l] * sigma[l];
+    double allowed = budget * budget * energy;
+
+    // Largest threshold whose dropped squared weights fit the budget
+    size_t count = (size_t)(m + n) * k;
+    double *w = (double*)mem_alloc((count ? count : 1) * sizeof(double));
+    if (!w) return NULL;
+    size_t c = 0;
+    for (int i = 0; i < m; i++) {
+        for (int l = 0; l < k; l++) w[c++] = sigma[l] * fabs(svd->U->data[i][l]);
+    }
+    for (int j = 0; j < n; j++) {
+        for (int l = 0; l < k; l++) w[c++] = sigma[l] * fabs(svd->V->data[j][l]);
+    }
+    qsort(w, count, sizeof(double), compare_doubles);
+    double sum = 0.0, tau = -1.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += w[i] * w[i];
+        if (sum > allowed) break;
+        // Ties go together, so stop before a run that would overshoot
+        if (i + 1 == count || w[i + 1] > w[i]) tau = w[i];
+    }
+    mem_free(w);
+
+    SparseSVD *s = (SparseSVD*)mem_calloc(1, sizeof(SparseSVD));
+    if (!s) return NULL;
+    s->k = k;
+    s->singular_values = (double*)mem_alloc((k ? k : 1) * sizeof(double));
+    double dropped = 0.0;
+    s->U = sparsify(svd->U, k, sigma, tau, &dropped);
+    s->V = sparsify(svd->V, k, sigma, tau, &dropped);
+    if (!s->singular_values || !s->U || !s->V) {
+        free_sparse_svd(s);
+        return NULL;
+    }
+    memcpy(s->singular_values, sigma, k * sizeof(double));
+    s->error_estimate = energy > 0 ? sqrt(dropped / energy) : 0.0;
+    return s;
+}
+
+void free_sparse_svd(SparseSVD *svd) {
+    if (!svd) return;
+    free_sparse_factor(svd->U);
+    free_sparse_factor(svd->V);
+    mem_free(svd->singular_values);
+    mem_free(svd);
+}
+
+double sparse_svd_density(const SparseSVD *svd) {
+    double total = (double)(svd->U->rows + svd->V->rows) * svd->k;
+    return total > 0 ? (svd->U->colptr[svd->k] + svd->V->colptr[svd->k]) / total : 0.0;
+}
+
+size_t sparse_svd_payload_bytes(const SparseSVD *svd) {
+    size_t nnz = (size_t)svd->U->colptr[svd->k] + svd->V->colptr[svd->k];
+    return nnz * (sizeof(double) + sizeof(int)) + 2 * (svd->k + 1) * sizeof(int)
+         + svd->k * sizeof(double);
+}
+
+size_t dense_svd_payload_bytes(int m, int n, int k) {
+    return ((size_t)m * k + k + (size_t)n * k) * sizeof(double);
+}
+
+int sparse_svd_is_smaller(const SparseSVD *svd) {
+    return sparse_svd_payload_bytes(svd) < dense_svd_payload_bytes(svd->U->rows, svd->V->rows, svd->k);
+}
+
+typedef struct {
+    const SparseSVD *svd;
+    Matrix *out;                // double output, or NULL to write pixels
+    unsigned char *pixels;
+    int stride;
+    int max_val;
+    int *ok;
+} SparseReconstructTask;
+
+// First position in column l of f at or after row r
+static int column_lower_bound(const SparseFactor *f, int l, int r) {
+    int lo = f->colptr[l], hi = f->colptr[l + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (f->rowidx[mid] < r) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Strips [begin, end) of SPARSE_STRIP_ROWS rows: every nonzero of U in the
+// strip is scattered against the nonzeros of the matching V column
+static void reconstruct_strips(void *arg, int begin, int end) {
+    SparseReconstructTask *t = (SparseReconstructTask*)arg;
+    const SparseSVD *svd = t->svd;
+    const SparseFactor *U = svd->U, *V = svd->V;
+    int m = U->rows;
+    int n = V->rows;
+    double *acc = t->out ? NULL : (double*)mem_alloc((size_t)SPARSE_STRIP_ROWS * n * sizeof(double));
+    if (!t->out && !acc) {
+        t->ok[begin] = 0;
+        return;
+    }
+
+    for (int s = begin; s < end; s++) {
+        int r0 = s * SPARSE_STRIP_ROWS;
+        int r1 = r0 + SPARSE_STRIP_ROWS < m ? r0 + SPARSE_STRIP_ROWS : m;
+        for (int i = r0; i < r1; i++) {
+            double *row = t->out ? t->out->data[i] : acc + (size_t)(i - r0) * n;
+            memset(row, 0, n * sizeof(double));
+        }
+        for (int l = 0; l < svd->k; l++) {
+            int vb = V->colptr[l], ve = V->colptr[l + 1];
+            if (vb == ve) continue;
+            const int *vj = V->rowidx + vb;
+            const double *vx = V->values + vb;
+            int len = ve - vb;
+            for (int p = column_lower_bound(U, l, r0); p < U->colptr[l + 1] && U->rowidx[p] < r1; p++) {
+                int i = U->rowidx[p];
+                double a = svd->singular_values[l] * U->values[p];
+                double *row = t->out ? t->out->data[i] : acc + (size_t)(i - r0) * n;
+                for (int q = 0; q < len; q++) row[vj[q]] += a * vx[q];
+            }
+        }
+        if (!t->out) {
+            for (int i = r0; i < r1; i++) {
+                const double *row = acc + (size_t)(i - r0) * n;
+                unsigned char *px = t->pixels + (size_t)i * t->stride;
+                for (int j = 0; j < n; j++) {
+                    double v = row[j];
+                    if (v < 0) v = 0;
+                    if (v > t->max_val) v = t->max_val;
+                    px[j] = (unsigned char)(v + 0.5);
+                }
+            }
+        }
+    }
+    mem_free(acc);
+}
+
+static int run_reconstruct(SparseReconstructTask *task, int threads) {
+    const SparseSVD *svd = task->svd;
+    int strips = (svd->U->rows + SPARSE_STRIP_ROWS - 1) / SPARSE_STRIP_ROWS;
+    task->ok = (int*)mem_alloc((strips ? strips : 1) * sizeof(int));
+    if (!task->ok) return 0;
+    for (int s = 0; s < strips; s++) task->ok[s] = 1;
+
+    // Flops follow the nonzero pairs: Σ_l nnz(u_l) nnz(v_l)
+    double pairs = 0.0;
+    for (int l = 0; l < svd->k; l++) {
+        pairs += (double)(svd->U->colptr[l + 1] - svd->U->colptr[l])
+               * (svd->V->colptr[l + 1] - svd->V->colptr[l]);
+    }
+    perf_phase_begin("sparse_recon");
+    parallel_for(threads, strips, reconstruct_strips, task);
+    perf_phase_end("sparse_recon", 2.0 * pairs, 24.0 * pairs);
+
+    int ok = 1;
+    for (int s = 0; s < strips; s++) ok = ok && task->ok[s];
+    mem_free(task->ok);
+    return ok;
+}
+
+Matrix* sparse_reconstruct(const SparseSVD *svd, Workspace *ws, int threads) {
+    Matrix *out = scratch_matrix(ws, svd->U->rows, svd->V->rows);
+    if (!out) return NULL;
+    SparseReconstructTask task = { svd, out, NULL, 0, 0, NULL };
+    if (!run_reconstruct(&task, threads)) {
+        free_matrix(out);
+        return NULL;
+    }
+    return out;
+}
+
+int sparse_reconstruct_to_buffer(const SparseSVD *svd, unsigned char *pixels, int stride,
+                                 int max_val, int threads) {
+    SparseReconstructTask task = { svd, NULL, pixels, stride, max_val, NULL };
+    if (!run_reconstruct(&task, threads)) {
+        fprintf(stderr, "Error: Sparse reconstruction ran out of memory\n");
+        return 0;
+    }
+    return 1;
+}
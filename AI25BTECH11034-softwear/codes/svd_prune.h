@@ -0,0 +1,47 @@
+#ifndef SVD_PRUNE_H
+#define SVD_PRUNE_H
+
+#include "lanczos.h"
+
+// One factor (U or V) in compressed sparse column form: the nonzeros of
+// column l are values[colptr[l] .. colptr[l + 1]), at rows rowidx[...] in
+// increasing order.
+typedef struct {
+    int rows;
+    int cols;
+    int *colptr;
+    int *rowidx;
+    double *values;
+} SparseFactor;
+
+typedef struct {
+    int k;
+    double *singular_values;
+    SparseFactor *U;
+    SparseFactor *V;
+    double error_estimate;      // ||A_k - Ã_k||_F / ||A_k||_F, first order
+} SparseSVD;
+
+// Drops the entries of U_k and V_k whose σ-weighted magnitude is smallest
+// while the estimated relative Frobenius error they add stays within budget
+// (e.g. 0.01). Each dropped entry x of column l costs σ_l² x² in squared
+// error; the low-σ columns therefore go sparse first.
+SparseSVD* svd_prune(const SVDResult *svd, int k, double budget);
+void free_sparse_svd(SparseSVD *svd);
+
+double sparse_svd_density(const SparseSVD *svd);
+// Bytes to store the pruned factors (8-byte values, 4-byte indices) and
+// the dense equivalent, for comparing payloads
+size_t sparse_svd_payload_bytes(const SparseSVD *svd);
+size_t dense_svd_payload_bytes(int m, int n, int k);
+// Whether the pruned factors store in fewer bytes than the dense ones; at
+// moderate density the 4-byte indices outweigh the dropped values
+int sparse_svd_is_smaller(const SparseSVD *svd);
+
+// U Σ Vᵀ from the sparse factors, touching only nonzero pairs: its cost
+// scales with the square of the density. Rows are split across threads.
+Matrix* sparse_reconstruct(const SparseSVD *svd, Workspace *ws, int threads);
+int sparse_reconstruct_to_buffer(const SparseSVD *svd, unsigned char *pixels, int stride,
+                                 int max_val, int threads);
+
+#endif
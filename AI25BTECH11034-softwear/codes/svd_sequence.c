@@ -0,0 +1,109 @@
+#include "svd_sequence.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+SVDSequence* svd_sequence_create(double cut_threshold) {
+    SVDSequence *seq = (SVDSequence*)mem_calloc(1, sizeof(SVDSequence));
+    if (!seq) return NULL;
+    seq->cut_threshold = cut_threshold;
+    return seq;
+}
+
+void svd_sequence_free(SVDSequence *seq) {
+    if (!seq) return;
+    free_matrix(seq->prev_V);
+    mem_free(seq);
+}
+
+static double frobenius_sq(Matrix *A) {
+    double sum = 0.0;
+    for (int i = 0; i < A->rows; i++) {
+        sum += vector_dot(A->data[i], A->data[i], A->cols);
+    }
+    return sum;
+}
+
+// ||A V||_F², the energy of A inside the span of V's orthonormal columns
+static double subspace_energy(Matrix *A, Matrix *V, double *row) {
+    int k = V->cols;
+    double sum = 0.0;
+    for (int i = 0; i < A->rows; i++) {
+        memset(row, 0, k * sizeof(double));
+        for (int j = 0; j < A->cols; j++) {
+            double a = A->data[i][j];
+            for (int l = 0; l < k; l++) {
+                row[l] += a * V->data[j][l];
+            }
+        }
+        sum += vector_dot(row, row, k);
+    }
+    return sum;
+}
+
+SVDResult* svd_sequence_next(SVDSequence *seq, Matrix *A, int k, const SVDOptions *opts) {
+    SVDOptions frame_opts = *opts;
+    double total = frobenius_sq(A);
+
+    int warm = seq->prev_V && seq->prev_V->rows == A->cols;
+    if (warm && total > 0) {
+        double *row = (double*)mem_alloc(seq->prev_V->cols * sizeof(double));
+        if (!row) return NULL;
+        double captured = subspace_energy(A, seq->prev_V, row) / total;
+        mem_free(row);
+
+        // Compare what the subspace misses: the captured fraction is close
+        // to 1 for any natural image because of the mean intensity
+        double missed = 1.0 - captured;
+        double prev_missed = 1.0 - seq->prev_captured;
+        if (missed > seq->cut_threshold * prev_missed && missed > 1e-4) {
+            if (opts->verbose) {
+                printf("Scene cut: previous subspace misses %.3f%% of the energy (was %.3f%%), "
+                       "cold start\n", missed * 100.0, prev_missed * 100.0);
+            }
+            seq->scene_cuts++;
+            warm = 0;
+        }
+    }
+    if (warm) frame_opts.start = seq->prev_V;
+
+    SVDResult *svd = lanczos_svd_opts(A, k, &frame_opts);
+    if (!svd) return NULL;
+
+    seq->frames++;
+    seq->warm_frames += warm;
+    seq->total_iterations += svd->iterations;
+    if (opts->verbose) {
+        printf("Frame %d: %s start, %d %s iterations\n", seq->frames,
+               warm ? "warm" : "cold", svd->iterations, warm ? "block" : "power");
+    }
+
+    // Keep the factors for the next frame; the result itself may live in a
+    // workspace that is rewound before then.
+    if (!seq->prev_V || seq->prev_V->rows != svd->V->rows || seq->prev_V->cols != svd->k) {
+        free_matrix(seq->prev_V);
+        seq->prev_V = create_matrix_uninit(svd->V->rows, svd->k);
+    }
+    if (seq->prev_V) {
+        for (int i = 0; i < svd->V->rows; i++) {
+            memcpy(seq->prev_V->data[i], svd->V->data[i], svd->k * sizeof(double));
+        }
+    }
+
+    double kept = 0.0;
+    for (int i = 0; i < svd->k; i++) {
+        kept += svd->singular_values[i] * svd->singular_values[i];
+    }
+    seq->prev_captured = total > 0 ? kept / total : 0.0;
+    return svd;
+}
+
+void svd_sequence_report(SVDSequence *seq) {
+    printf("\n=== Sequence Statistics ===\n");
+    printf("Frames: %d (%d warm-started, %d scene cuts)\n",
+           seq->frames, seq->warm_frames, seq->scene_cuts);
+    if (seq->frames) {
+        printf("Average iterations per frame: %.1f\n",
+               (double)seq->total_iterations / seq->frames);
+    }
+}
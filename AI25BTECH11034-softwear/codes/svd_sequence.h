@@ -0,0 +1,26 @@
+#ifndef SVD_SEQUENCE_H
+#define SVD_SEQUENCE_H
+
+#include "lanczos.h"
+
+// Warm-started SVD over a sequence of similar frames. Each frame is seeded
+// with the previous frame's right singular vectors; a frame whose energy is
+// no longer captured by that subspace is treated as a scene cut and solved
+// from a cold (random) start instead.
+typedef struct {
+    Matrix *prev_V;             // heap copy of the last frame's V
+    double prev_captured;       // fraction of ||A||_F² the last factors captured
+    double cut_threshold;       // growth factor of the missed energy that means a cut
+    int frames;
+    int warm_frames;
+    int scene_cuts;
+    long total_iterations;
+} SVDSequence;
+
+SVDSequence* svd_sequence_create(double cut_threshold);
+void svd_sequence_free(SVDSequence *seq);
+
+SVDResult* svd_sequence_next(SVDSequence *seq, Matrix *A, int k, const SVDOptions *opts);
+void svd_sequence_report(SVDSequence *seq);
+
+#endif
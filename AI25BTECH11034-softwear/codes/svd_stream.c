@@ -0,0 +1,398 @@
+#define _GNU_SOURCE
+#include "svd_stream.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include "simd_kernels.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+void stream_put_u32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+uint32_t stream_get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void stream_put_f32(unsigned char *p, double v) {
+    float f = (float)v;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    stream_put_u32(p, bits);
+}
+
+double stream_get_f32(const unsigned char *p) {
+    uint32_t bits = stream_get_u32(p);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static size_t chunk_bytes(int height, int width, int count) {
+    return 8 + (size_t)count * (1 + height + width) * 4;
+}
+
+size_t svd_stream_prefix_bytes(int height, int width, int rank, int chunk_rank) {
+    if (chunk_rank <= 0) chunk_rank = SVD_STREAM_CHUNK_RANK;
+    int chunks = (rank + chunk_rank - 1) / chunk_rank;
+    return SVD_STREAM_HEADER_BYTES + (size_t)chunks * chunk_bytes(height, width, chunk_rank);
+}
+
+int stream_write_all(int fd, const unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+size_t stream_read_all(int fd, unsigned char *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return done;
+}
+
+int svd_stream_save(const char *filename, const SVDResult *svd, int k, int max_val,
+                    int chunk_rank) {
+    int m = svd->U->rows;
+    int n = svd->V->rows;
+    if (k > svd->k) k = svd->k;
+    if (chunk_rank <= 0) chunk_rank = SVD_STREAM_CHUNK_RANK;
+    if (k <= 0) {
+        fprintf(stderr, "Error: No factors to save\n");
+        return 0;
+    }
+
+    // Rank order by σ; solvers already return them sorted, so this is
+    // normally the identity
+    int *order = (int*)mem_alloc(k * sizeof(int));
+    unsigned char *buf = (unsigned char*)mem_alloc(chunk_bytes(m, n, chunk_rank));
+    if (!order || !buf) {
+        mem_free(order);
+        mem_free(buf);
+        return 0;
+    }
+    for (int l = 0; l < k; l++) {
+        int pos = l;
+        while (pos > 0 && svd->singular_values[order[pos - 1]] < svd->singular_values[l]) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = l;
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        mem_free(order);
+        mem_free(buf);
+        return 0;
+    }
+
+    unsigned char header[SVD_STREAM_HEADER_BYTES];
+    memcpy(header, "SVDP", 4);
+    stream_put_u32(header + 4, SVD_STREAM_VERSION);
+    stream_put_u32(header + 8, (uint32_t)m);
+    stream_put_u32(header + 12, (uint32_t)n);
+    stream_put_u32(header + 16, (uint32_t)k);
+    stream_put_u32(header + 20, (uint32_t)max_val);
+    stream_put_u32(header + 24, (uint32_t)chunk_rank);
+    int ok = stream_write_all(fd, header, sizeof(header));
+
+    for (int first = 0; ok && first < k; first += chunk_rank) {
+        int count = k - first < chunk_rank ? k - first : chunk_rank;
+        unsigned char *p = buf;
+        stream_put_u32(p, (uint32_t)first);
+        stream_put_u32(p + 4, (uint32_t)count);
+        p += 8;
+        for (int c = 0; c < count; c++) {
+            int l = order[first + c];
+            stream_put_f32(p, svd->singular_values[l]);
+            p += 4;
+            for (int i = 0; i < m; i++, p += 4) stream_put_f32(p, svd->U->data[i][l]);
+            for (int j = 0; j < n; j++, p += 4) stream_put_f32(p, svd->V->data[j][l]);
+        }
+        ok = stream_write_all(fd, buf, (size_t)(p - buf));
+    }
+    if (close(fd) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write factors to %s\n", filename);
+
+    mem_free(order);
+    mem_free(buf);
+    return ok;
+}
+
+typedef struct {
+    int height, width, rank, max_val, chunk_rank;
+} StreamHeader;
+
+static int parse_header(const unsigned char *p, StreamHeader *h) {
+    if (memcmp(p, "SVDP", 4) != 0 || stream_get_u32(p + 4) != SVD_STREAM_VERSION) {
+        fprintf(stderr, "Error: Not a version %d factor stream\n", SVD_STREAM_VERSION);
+        return 0;
+    }
+    uint32_t m = stream_get_u32(p + 8), n = stream_get_u32(p + 12), k = stream_get_u32(p + 16);
+    uint32_t max_val = stream_get_u32(p + 20), chunk = stream_get_u32(p + 24);
+    if (m == 0 || n == 0 || m > (1u << 20) || n > (1u << 20) || k == 0 ||
+        k > (m < n ? m : n) || max_val == 0 || max_val > 65535 || chunk == 0) {
+        fprintf(stderr, "Error: Corrupt factor stream header\n");
+        return 0;
+    }
+    h->height = (int)m;
+    h->width = (int)n;
+    h->rank = (int)k;
+    h->max_val = (int)max_val;
+    h->chunk_rank = (int)chunk;
+    return 1;
+}
+
+int svd_stream_info(const char *filename, int *height, int *width, int *rank) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    unsigned char header[SVD_STREAM_HEADER_BYTES];
+    StreamHeader h;
+    int ok = stream_read_all(fd, header, sizeof(header)) == sizeof(header) && parse_header(header, &h);
+    close(fd);
+    if (!ok) return 0;
+    if (height) *height = h.height;
+    if (width) *width = h.width;
+    if (rank) *rank = h.rank;
+    return 1;
+}
+
+SVDResult* svd_stream_load(const char *filename, int max_rank, int *max_val) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+
+    unsigned char header[SVD_STREAM_HEADER_BYTES];
+    StreamHeader h;
+    if (stream_read_all(fd, header, sizeof(header)) != sizeof(header) || !parse_header(header, &h)) {
+        close(fd);
+        return NULL;
+    }
+    int m = h.height, n = h.width;
+    int k = max_rank > 0 && max_rank < h.rank ? max_rank : h.rank;
+
+    SVDResult *svd = create_svd_result(NULL, m, n, k);
+    unsigned char *buf = (unsigned char*)mem_alloc(chunk_bytes(m, n, h.chunk_rank));
+    if (!svd || !buf) {
+        free_svd_result(svd);
+        mem_free(buf);
+        close(fd);
+        return NULL;
+    }
+
+    int loaded = 0;
+    while (loaded < k) {
+        if (stream_read_all(fd, buf, 8) != 8) break;
+        uint32_t first = stream_get_u32(buf), count = stream_get_u32(buf + 4);
+        if ((int)first != loaded || count == 0 || count > (uint32_t)h.chunk_rank ||
+            first + count > (uint32_t)h.rank) {
+            fprintf(stderr, "Error: Corrupt factor chunk at rank %d\n", loaded);
+            break;
+        }
+        size_t body = chunk_bytes(m, n, (int)count) - 8;
+        if (stream_read_all(fd, buf, body) != body) break;
+
+        const unsigned char *p = buf;
+        for (int c = 0; c < (int)count && loaded < k; c++, loaded++) {
+            svd->singular_values[loaded] = stream_get_f32(p);
+            p += 4;
+            for (int i = 0; i < m; i++, p += 4) svd->U->data[i][loaded] = stream_get_f32(p);
+            for (int j = 0; j < n; j++, p += 4) svd->V->data[j][loaded] = stream_get_f32(p);
+        }
+    }
+    close(fd);
+    mem_free(buf);
+
+    if (loaded == 0) {
+        fprintf(stderr, "Error: No complete factor chunk in %s\n", filename);
+        free_svd_result(svd);
+        return NULL;
+    }
+    if (loaded < k) {
+        printf("Warning: %s holds only rank %d of %d\n", filename, loaded, k);
+        svd->k = loaded;
+    }
+    if (max_val) *max_val = h.max_val;
+    return svd;
+}
+
+struct ProgressiveDecoder {
+    int threads;
+    int have_header;
+    StreamHeader h;
+    int applied;
+    Matrix *image;              // running sum of the applied outer products
+    unsigned char *pending;     // bytes of the incomplete header or chunk
+    size_t pending_len;
+    size_t pending_cap;
+    double *su, *sv;            // one chunk as σ-scaled U rows and V rows
+};
+
+ProgressiveDecoder* progressive_decoder_create(int threads) {
+    ProgressiveDecoder *dec = (ProgressiveDecoder*)mem_calloc(1, sizeof(ProgressiveDecoder));
+    if (!dec) return NULL;
+    dec->threads = threads;
+    return dec;
+}
+
+void progressive_decoder_destroy(ProgressiveDecoder *dec) {
+    if (!dec) return;
+    free_matrix(dec->image);
+    mem_free(dec->pending);
+    mem_free(dec->su);
+    mem_free(dec->sv);
+    mem_free(dec);
+}
+
+typedef struct {
+    ProgressiveDecoder *dec;
+    int count;
+} UpdateTask;
+
+// image[i][:] += Σ_c σ_c u_c[i] v_c for rows [begin, end)
+static void update_rows(void *arg, int begin, int end) {
+    UpdateTask *t = (UpdateTask*)arg;
+    ProgressiveDecoder *dec = t->dec;
+    int m = dec->h.height, n = dec->h.width;
+    const SimdKernels *kern = simd_kernels();
+    for (int i = begin; i < end; i++) {
+        double *row = dec->image->data[i];
+        for (int c = 0; c < t->count; c++) {
+            kern->axpy(row, dec->su[(size_t)c * m + i], dec->sv + (size_t)c * n, n);
+        }
+    }
+}
+
+static int apply_chunk(ProgressiveDecoder *dec, const unsigned char *p, int count) {
+    int m = dec->h.height, n = dec->h.width;
+    for (int c = 0; c < count; c++) {
+        double sigma = stream_get_f32(p);
+        p += 4;
+        for (int i = 0; i < m; i++, p += 4) dec->su[(size_t)c * m + i] = sigma * stream_get_f32(p);
+        for (int j = 0; j < n; j++, p += 4) dec->sv[(size_t)c * n + j] = stream_get_f32(p);
+    }
+
+    double area = (double)m * n;
+    perf_phase_begin("progressive");
+    UpdateTask task = { dec, count };
+    parallel_for(dec->threads, m, update_rows, &task);
+    perf_phase_end("progressive", 2.0 * area * count, 16.0 * area + 8.0 * area * count);
+    dec->applied += count;
+    return count;
+}
+
+static int start_stream(ProgressiveDecoder *dec, const unsigned char *p) {
+    if (!parse_header(p, &dec->h)) return 0;
+    int m = dec->h.height, n = dec->h.width, chunk = dec->h.chunk_rank;
+    if (chunk > dec->h.rank) chunk = dec->h.rank;
+    dec->image = create_matrix(m, n);
+    dec->su = (double*)mem_alloc((size_t)chunk * m * sizeof(double));
+    dec->sv = (double*)mem_alloc((size_t)chunk * n * sizeof(double));
+    if (!dec->image || !dec->su || !dec->sv) {
+        free_matrix(dec->image);
+        mem_free(dec->su);
+        mem_free(dec->sv);
+        dec->image = NULL;
+        dec->su = dec->sv = NULL;
+        return 0;
+    }
+    for (int i = 0; i < m; i++) memset(dec->image->data[i], 0, n * sizeof(double));
+    dec->have_header = 1;
+    return 1;
+}
+
+int progressive_decoder_feed(ProgressiveDecoder *dec, const unsigned char *data, size_t len) {
+    if (dec->pending_len + len > dec->pending_cap) {
+        size_t cap = dec->pending_cap ? dec->pending_cap : 4096;
+        while (cap < dec->pending_len + len) cap *= 2;
+        unsigned char *grown = (unsigned char*)mem_alloc(cap);
+        if (!grown) return -1;
+        if (dec->pending_len) memcpy(grown, dec->pending, dec->pending_len);
+        mem_free(dec->pending);
+        dec->pending = grown;
+        dec->pending_cap = cap;
+    }
+    memcpy(dec->pending + dec->pending_len, data, len);
+    dec->pending_len += len;
+
+    size_t pos = 0;
+    int added = 0;
+    if (!dec->have_header) {
+        if (dec->pending_len < SVD_STREAM_HEADER_BYTES) return 0;
+        if (!start_stream(dec, dec->pending)) return -1;
+        pos = SVD_STREAM_HEADER_BYTES;
+    }
+    while (dec->pending_len - pos >= 8) {
+        const unsigned char *p = dec->pending + pos;
+        uint32_t first = stream_get_u32(p), count = stream_get_u32(p + 4);
+        // Chunks must arrive in order, each exactly once
+        if ((int)first != dec->applied || count == 0 || count > (uint32_t)dec->h.chunk_rank ||
+            first + count > (uint32_t)dec->h.rank) {
+            fprintf(stderr, "Error: Corrupt factor chunk at rank %d\n", dec->applied);
+            return -1;
+        }
+        size_t need = chunk_bytes(dec->h.height, dec->h.width, (int)count);
+        if (dec->pending_len - pos < need) break;
+        added += apply_chunk(dec, p + 8, (int)count);
+        pos += need;
+    }
+    memmove(dec->pending, dec->pending + pos, dec->pending_len - pos);
+    dec->pending_len -= pos;
+    return added;
+}
+
+int progressive_decoder_info(const ProgressiveDecoder *dec, int *width, int *height, int *rank) {
+    if (!dec->have_header) return 0;
+    if (width) *width = dec->h.width;
+    if (height) *height = dec->h.height;
+    if (rank) *rank = dec->h.rank;
+    return 1;
+}
+
+int progressive_decoder_rank(const ProgressiveDecoder *dec) {
+    return dec->applied;
+}
+
+int progressive_decoder_render(const ProgressiveDecoder *dec, unsigned char *pixels, int stride) {
+    if (!dec->have_header || stride < dec->h.width) return 0;
+    // 16-bit sources are scaled down to the 8-bit preview
+    double max_val = dec->h.max_val > 255 ? 255 : dec->h.max_val;
+    double scale = max_val / dec->h.max_val;
+    for (int i = 0; i < dec->h.height; i++) {
+        const double *row = dec->image->data[i];
+        unsigned char *px = pixels + (size_t)i * stride;
+        for (int j = 0; j < dec->h.width; j++) {
+            double v = row[j] * scale;
+            if (v < 0) v = 0;
+            if (v > max_val) v = max_val;
+            px[j] = (unsigned char)(v + 0.5);
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,61 @@
+#ifndef SVD_STREAM_H
+#define SVD_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lanczos.h"
+
+// Progressive factor files (.svdp). Triplets are stored in descending σ
+// order, chunk_rank at a time, each chunk self-describing and decodable on
+// its own, so any prefix of the file yields a usable lower-rank image.
+//
+//   header  "SVDP", version, height, width, rank, max_val, chunk_rank
+//           (little-endian uint32)
+//   chunk   first, count (uint32), then count × (σ, u[height], v[width])
+//           as little-endian float32
+#define SVD_STREAM_VERSION 1
+#define SVD_STREAM_HEADER_BYTES 28
+#define SVD_STREAM_CHUNK_RANK 8
+
+// Writes the leading k triplets of svd. chunk_rank <= 0 uses
+// SVD_STREAM_CHUNK_RANK. Returns 1 on success.
+int svd_stream_save(const char *filename, const SVDResult *svd, int k, int max_val,
+                    int chunk_rank);
+
+// Reads only the chunks needed for the leading max_rank triplets (all of
+// them when max_rank <= 0). A truncated file gives the rank it holds.
+SVDResult* svd_stream_load(const char *filename, int max_rank, int *max_val);
+
+// Reads just the header; returns 0 when the file is missing or not a stream
+int svd_stream_info(const char *filename, int *height, int *width, int *rank);
+
+// Bytes from the start of the file that hold the first rank triplets
+size_t svd_stream_prefix_bytes(int height, int width, int rank, int chunk_rank);
+
+// Little-endian fields and whole-buffer fd I/O shared by the factor file
+// formats. stream_read_all is short only at end of file or on error.
+void stream_put_u32(unsigned char *p, uint32_t v);
+uint32_t stream_get_u32(const unsigned char *p);
+void stream_put_f32(unsigned char *p, double v);
+double stream_get_f32(const unsigned char *p);
+int stream_write_all(int fd, const unsigned char *buf, size_t len);
+size_t stream_read_all(int fd, unsigned char *buf, size_t len);
+
+// Incremental decoder: feed bytes as they arrive and every completed chunk
+// is added to the running image as a rank-count outer-product update, so
+// the preview refines without re-decoding what is already shown.
+typedef struct ProgressiveDecoder ProgressiveDecoder;
+
+ProgressiveDecoder* progressive_decoder_create(int threads);
+void progressive_decoder_destroy(ProgressiveDecoder *dec);
+// Returns the number of triplets applied by this call, or -1 on a corrupt
+// stream or allocation failure
+int progressive_decoder_feed(ProgressiveDecoder *dec, const unsigned char *data, size_t len);
+// Image size once the header has arrived; 0 before that
+int progressive_decoder_info(const ProgressiveDecoder *dec, int *width, int *height, int *rank);
+// Triplets applied so far
+int progressive_decoder_rank(const ProgressiveDecoder *dec);
+// Rounds and clamps the current image into 8-bit rows stride bytes apart
+int progressive_decoder_render(const ProgressiveDecoder *dec, unsigned char *pixels, int stride);
+
+#endif
@@ -0,0 +1,139 @@
+#include "svd_update.h"
+#include "jacobi_svd.h"
+#include "blas1.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+// Folds the rows of B (b×n) into A ≈ L diag(sigma) Rᵀ with L m×k, R n×k:
+//   C = B R, B - C Rᵀ = Raᵀ P  (P orthonormal rows, from Gram-Schmidt)
+//   [A; B] ≈ [L 0; 0 I] K [R Pᵀ]ᵀ,   K = [diag(sigma) 0; C Raᵀ]
+// and re-diagonalizes the (k+b)×(k+b) core K, keeping the top k triplets.
+static int append_rows_core(Matrix **Lp, double *sigma, Matrix **Rp, int k, Matrix *B) {
+    Matrix *L = *Lp, *R = *Rp;
+    int m = L->rows, n = R->rows, b = B->rows, p = k + b;
+
+    Matrix *C = create_matrix(b, k);
+    Matrix *Pt = create_matrix_uninit(b, n);
+    Matrix *Ra = create_matrix(b, b);
+    Matrix *K = create_matrix(p, p);
+    Matrix *Uk = create_matrix_uninit(p, p);
+    Matrix *Vk = create_matrix_uninit(p, p);
+    double *s = (double*)mem_alloc(p * sizeof(double));
+    double *proj = (double*)mem_alloc(k * sizeof(double));
+    Matrix *L_new = create_matrix_uninit(m + b, k);
+    Matrix *R_new = create_matrix_uninit(n, k);
+    int ok = C && Pt && Ra && K && Uk && Vk && s && proj && L_new && R_new;
+
+    if (ok) {
+        // Project the new rows onto span(R) twice; the second pass
+        // restores orthogonality lost to cancellation in the first
+        for (int i = 0; i < b; i++) {
+            memcpy(Pt->data[i], B->data[i], n * sizeof(double));
+            for (int pass = 0; pass < 2; pass++) {
+                memset(proj, 0, k * sizeof(double));
+                for (int j = 0; j < n; j++) blas_axpy(proj, Pt->data[i][j], R->data[j], k);
+                for (int j = 0; j < n; j++) Pt->data[i][j] -= blas_dot(proj, R->data[j], k);
+                blas_axpy(C->data[i], 1.0, proj, k);
+            }
+        }
+
+        // Gram-Schmidt on the residual rows: Pt orthonormal, Ra upper triangular
+        double scale = 0.0;
+        for (int l = 0; l < k; l++) if (sigma[l] > scale) scale = sigma[l];
+        for (int i = 0; i < b; i++) {
+            for (int j = 0; j < i; j++) {
+                double d = blas_dot(Pt->data[j], Pt->data[i], n);
+                Ra->data[j][i] = d;
+                blas_axpy(Pt->data[i], -d, Pt->data[j], n);
+            }
+            double norm = blas_nrm2(Pt->data[i], n);
+            if (norm > 1e-12 * (scale > 0 ? scale : 1.0)) {
+                Ra->data[i][i] = norm;
+                blas_scal(Pt->data[i], 1.0 / norm, n);
+            } else {
+                memset(Pt->data[i], 0, n * sizeof(double));
+            }
+        }
+
+        for (int l = 0; l < k; l++) K->data[l][l] = sigma[l];
+        for (int i = 0; i < b; i++) {
+            for (int l = 0; l < k; l++) K->data[k + i][l] = C->data[i][l];
+            for (int j = 0; j < b; j++) K->data[k + i][k + j] = Ra->data[j][i];
+        }
+
+        ok = jacobi_svd(K, s, Uk, Vk, NULL, 1) > 0;
+    }
+
+    if (ok) {
+        // L_new = [L Uk(0:k, 0:k); Uk(k:p, 0:k)], a row at a time as
+        // combinations of rows of Uk
+        for (int i = 0; i < m; i++) {
+            memset(L_new->data[i], 0, k * sizeof(double));
+            for (int t = 0; t < k; t++) blas_axpy(L_new->data[i], L->data[i][t], Uk->data[t], k);
+        }
+        for (int i = 0; i < b; i++) {
+            memcpy(L_new->data[m + i], Uk->data[k + i], k * sizeof(double));
+        }
+
+        // R_new = [R Pᵀ] Vk(:, 0:k)
+        for (int j = 0; j < n; j++) {
+            double *out = R_new->data[j];
+            memset(out, 0, k * sizeof(double));
+            for (int t = 0; t < k; t++) blas_axpy(out, R->data[j][t], Vk->data[t], k);
+            for (int i = 0; i < b; i++) blas_axpy(out, Pt->data[i][j], Vk->data[k + i], k);
+        }
+
+        memcpy(sigma, s, k * sizeof(double));
+        free_matrix(L);
+        free_matrix(R);
+        *Lp = L_new;
+        *Rp = R_new;
+    } else {
+        free_matrix(L_new);
+        free_matrix(R_new);
+    }
+
+    mem_free(proj);
+    mem_free(s);
+    free_matrix(Vk);
+    free_matrix(Uk);
+    free_matrix(K);
+    free_matrix(Ra);
+    free_matrix(Pt);
+    free_matrix(C);
+    return ok;
+}
+
+int svd_append_rows(SVDResult *svd, Matrix *rows) {
+    if (svd->from_workspace) {
+        fprintf(stderr, "Error: Cannot update an SVD that lives in a workspace\n");
+        return 0;
+    }
+    if (rows->cols != svd->V->rows) {
+        fprintf(stderr, "Error: New rows have %d columns, expected %d\n",
+                rows->cols, svd->V->rows);
+        return 0;
+    }
+    return append_rows_core(&svd->U, svd->singular_values, &svd->V, svd->k, rows);
+}
+
+// Appending columns to A is appending rows to Aᵀ = V Σ Uᵀ
+int svd_append_cols(SVDResult *svd, Matrix *cols) {
+    if (svd->from_workspace) {
+        fprintf(stderr, "Error: Cannot update an SVD that lives in a workspace\n");
+        return 0;
+    }
+    if (cols->rows != svd->U->rows) {
+        fprintf(stderr, "Error: New columns have %d rows, expected %d\n",
+                cols->rows, svd->U->rows);
+        return 0;
+    }
+
+    Matrix *rows = create_matrix_uninit(cols->cols, cols->rows);
+    if (!rows) return 0;
+    matrix_transpose(cols, rows);
+    int ok = append_rows_core(&svd->V, svd->singular_values, &svd->U, svd->k, rows);
+    free_matrix(rows);
+    return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef SVD_UPDATE_H
+#define SVD_UPDATE_H
+
+#include "lanczos.h"
+
+// Brand-style rank-k updates of a truncated SVD, e.g. for line-scan images
+// that grow by rows. A batch of b new rows (b×n) or columns (m×b) is folded
+// into svd in place in O((m + n)k² + b·k·n + (k + b)³) time, never
+// revisiting the rows already absorbed. svd must own its factors (not live
+// in a Workspace); its rank stays k.
+int svd_append_rows(SVDResult *svd, Matrix *rows);
+int svd_append_cols(SVDResult *svd, Matrix *cols);
+
+#endif
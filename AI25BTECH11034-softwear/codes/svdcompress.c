@@ -0,0 +1,134 @@
+#include "svdcompress.h"
+#include "svd_compress.h"
+#include "netpbm.h"
+#include "svd_engine.h"
+#include "parallel.h"
+#include "mem_stats.h"
+#include "rng.h"
+#include <stdio.h>
+
+struct SVDCompressor {
+    SVDCompressorConfig cfg;
+    Workspace *ws;
+    uint64_t rng;               // seeds each solve, so calls differ but replay
+};
+
+void svdc_default_config(SVDCompressorConfig *cfg) {
+    SVDOptions opts;
+    svd_default_options(&opts);
+    cfg->threads = 1;
+    cfg->power_iters = opts.power_iters;
+    cfg->tol = opts.tol;
+    cfg->low_memory = 0;
+    cfg->workspace_bytes = 0;
+    cfg->huge_pages = 0;
+    cfg->seed = 0;
+    cfg->verbose = 0;
+}
+
+SVDCompressor* svdc_create(const SVDCompressorConfig *cfg) {
+    SVDCompressor *ctx = (SVDCompressor*)mem_calloc(1, sizeof(SVDCompressor));
+    if (!ctx) return NULL;
+    if (cfg) ctx->cfg = *cfg;
+    else svdc_default_config(&ctx->cfg);
+    if (ctx->cfg.threads <= 0) ctx->cfg.threads = parallel_cpu_count();
+    ctx->rng = rng_seed(ctx->cfg.seed);
+
+    if (ctx->cfg.workspace_bytes) {
+        ctx->ws = workspace_create(ctx->cfg.workspace_bytes, ctx->cfg.huge_pages);
+        if (!ctx->ws) {
+            fprintf(stderr, "Error: Cannot allocate compressor workspace\n");
+            mem_free(ctx);
+            return NULL;
+        }
+    }
+    return ctx;
+}
+
+void svdc_destroy(SVDCompressor *ctx) {
+    if (!ctx) return;
+    workspace_destroy(ctx->ws);
+    mem_free(ctx);
+}
+
+// Same sizing policy as the CLI: room for AᵀA when the memory limit allows
+static int reserve_workspace(SVDCompressor *ctx, int m, int n, int k) {
+    int low_memory = ctx->cfg.low_memory;
+    size_t have = ctx->ws ? ctx->ws->capacity : 0;
+    size_t bytes = compress_workspace_bytes(m, n, k, low_memory);
+    if (!low_memory && bytes > have && !mem_would_fit(bytes - have)) {
+        bytes = compress_workspace_bytes(m, n, k, 1);
+    }
+    if (!ctx->ws) {
+        ctx->ws = workspace_create(bytes, ctx->cfg.huge_pages);
+        return ctx->ws != NULL;
+    }
+    return workspace_reserve(ctx->ws, bytes);
+}
+
+SVDResult* svdc_compress(SVDCompressor *ctx, const unsigned char *pixels,
+                         int width, int height, int stride, int k) {
+    if (width <= 0 || height <= 0 || k <= 0 || stride < width) {
+        fprintf(stderr, "Error: Invalid image %dx%d (stride %d) or rank %d\n",
+                width, height, stride, k);
+        return NULL;
+    }
+    if (k > width) k = width;
+    if (k > height) k = height;
+    if (!reserve_workspace(ctx, height, width, k)) {
+        fprintf(stderr, "Error: Cannot allocate compressor workspace\n");
+        return NULL;
+    }
+
+    Workspace *ws = ctx->ws;
+    size_t mark = workspace_mark(ws);
+    SVDResult *result = NULL;
+
+    Matrix *A = workspace_matrix(ws, height, width);
+    if (A) {
+        for (int i = 0; i < height; i++) {
+            widen_u8_to_double(pixels + (size_t)i * stride, A->data[i], width);
+        }
+
+        SVDOptions opts;
+        svd_default_options(&opts);
+        opts.power_iters = ctx->cfg.power_iters;
+        opts.tol = ctx->cfg.tol;
+        opts.low_memory = ctx->cfg.low_memory;
+        opts.ws = ws;
+        opts.seed = rng_next(&ctx->rng);
+        opts.threads = ctx->cfg.threads;
+        opts.verbose = ctx->cfg.verbose;
+
+        // The factors are built in the workspace and copied out, so the
+        // workspace is free again for the next call
+        SVDResult *svd = svd_compute(A, k, &opts);
+        if (svd) result = copy_svd_result(svd);
+    }
+
+    workspace_release(ws, mark);
+    return result;
+}
+
+int svdc_decompress(SVDCompressor *ctx, const SVDResult *svd, int k,
+                    unsigned char *pixels, int stride, int max_val) {
+    if (k <= 0 || stride < svd->V->rows || max_val <= 0 || max_val > 255) {
+        fprintf(stderr, "Error: Invalid rank %d, stride %d or max value %d\n",
+                k, stride, max_val);
+        return 0;
+    }
+    reconstruct_to_buffer(svd, k, pixels, stride, max_val, ctx->cfg.threads);
+    return 1;
+}
+
+int svdc_decompress_region(SVDCompressor *ctx, const SVDResult *svd, int k,
+                           int r0, int r1, int c0, int c1,
+                           unsigned char *pixels, int stride, int max_val) {
+    if (k <= 0 || stride < c1 - c0 || max_val <= 0 || max_val > 255) {
+        fprintf(stderr, "Error: Invalid rank %d, stride %d or max value %d\n",
+                k, stride, max_val);
+        return 0;
+    }
+    return svd_decode_region(svd, k, r0, r1, c0, c1, pixels, stride, max_val,
+                             ctx->cfg.threads);
+}
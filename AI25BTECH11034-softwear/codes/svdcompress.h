@@ -0,0 +1,51 @@
+#ifndef SVDCOMPRESS_H
+#define SVDCOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lanczos.h"
+#include "svd_decode.h"
+
+// Embeddable compressor. An SVDCompressor owns its options, thread count,
+// scratch workspace and random state, and touches no other global state, so
+// any number of contexts can be used concurrently. A single context must
+// not be used from two threads at once; give each worker its own.
+// The entry points are silent on stdout unless verbose is set; errors are
+// reported on stderr and by the NULL / 0 return value.
+
+typedef struct SVDCompressor SVDCompressor;
+
+typedef struct {
+    int threads;                // threads per call; 0 = one per online CPU
+    int power_iters;            // iteration cap per singular value
+    double tol;                 // convergence tolerance
+    int low_memory;             // never form AᵀA
+    size_t workspace_bytes;     // initial workspace; it grows to fit each image
+    int huge_pages;             // back the workspace with huge pages
+    uint64_t seed;              // random state; 0 seeds from the clock
+    int verbose;                // solver progress on stdout
+} SVDCompressorConfig;
+
+void svdc_default_config(SVDCompressorConfig *cfg);
+
+SVDCompressor* svdc_create(const SVDCompressorConfig *cfg);
+void svdc_destroy(SVDCompressor *ctx);
+
+// Rank-k factors of the width×height 8-bit image in pixels (rows stride
+// bytes apart). The result is heap-owned; release it with free_svd_result.
+SVDResult* svdc_compress(SVDCompressor *ctx, const unsigned char *pixels,
+                         int width, int height, int stride, int k);
+
+// Writes the rank-k reconstruction, clamped to [0, max_val], into pixels.
+// The image size is the factors' (U rows × V rows). Returns 1 on success.
+int svdc_decompress(SVDCompressor *ctx, const SVDResult *svd, int k,
+                    unsigned char *pixels, int stride, int max_val);
+
+// Same for rows [r0, r1) × columns [c0, c1) only, at O(area·k) cost; the
+// rectangle's top-left pixel lands at pixels. For panning over one image,
+// tile_cache_create (svd_decode.h) keeps decoded tiles between calls.
+int svdc_decompress_region(SVDCompressor *ctx, const SVDResult *svd, int k,
+                           int r0, int r1, int c0, int c1,
+                           unsigned char *pixels, int stride, int max_val);
+
+#endif
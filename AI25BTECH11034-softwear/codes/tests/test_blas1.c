@@ -0,0 +1,65 @@
+// blas_nrm2 and blas_axpy_nrm2 on every kernel level this host runs: NaN
+// anywhere in the vector propagates, and values whose squares overflow or
+// underflow still give the exact norm.
+#include "blas1.h"
+#include "simd_kernels.h"
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+#define LEN 37              // long enough for the vector loops and a tail
+
+static int failures = 0;
+
+static void expect(const char *what, double got, double want) {
+    int ok = isnan(want) ? isnan(got) :
+             isinf(want) ? got == want : fabs(got - want) <= 4 * DBL_EPSILON * want;
+    if (!ok) failures++;
+    printf("%s %-8s %-34s %.17g (want %.17g)\n", ok ? "ok  " : "FAIL",
+           simd_level_name(simd_kernels()->level), what, got, want);
+}
+
+// n copies of v with w at position at
+static double nrm2_of(int n, double v, int at, double w) {
+    double x[LEN];
+    for (int i = 0; i < n; i++) x[i] = v;
+    if (at >= 0) x[at] = w;
+    return blas_nrm2(x, n);
+}
+
+static void check_level(void) {
+    expect("{NaN, 1}", nrm2_of(2, 1.0, 0, NAN), NAN);
+    expect("{1, NaN}", nrm2_of(2, 1.0, 1, NAN), NAN);
+    expect("NaN in the vector loop", nrm2_of(LEN, 1.0, 5, NAN), NAN);
+    expect("NaN in the tail", nrm2_of(LEN, 1.0, LEN - 1, NAN), NAN);
+    expect("NaN next to inf", nrm2_of(3, INFINITY, 2, NAN), NAN);
+    expect("NaN among huge values", nrm2_of(LEN, 1e300, 7, NAN), NAN);
+    expect("NaN among tiny values", nrm2_of(LEN, 1e-300, 7, NAN), NAN);
+    expect("inf", nrm2_of(LEN, 1.0, 3, -INFINITY), INFINITY);
+
+    expect("{3e200, 4e200}", nrm2_of(2, 3e200, 1, 4e200), 5e200);
+    expect("37 x 1e300", nrm2_of(LEN, 1e300, -1, 0.0), sqrt((double)LEN) * 1e300);
+    expect("37 x DBL_MAX / 8", nrm2_of(LEN, DBL_MAX / 8, -1, 0.0), sqrt((double)LEN) * (DBL_MAX / 8));
+    expect("{3e-200, 4e-200}", nrm2_of(2, 3e-200, 1, 4e-200), 5e-200);
+    expect("37 x 1e-300", nrm2_of(LEN, 1e-300, -1, 0.0), sqrt((double)LEN) * 1e-300);
+    expect("37 x 4 * DBL_TRUE_MIN", nrm2_of(LEN, 4 * 4.9406564584124654e-324, -1, 0.0),
+           sqrt((double)LEN) * 4 * 4.9406564584124654e-324);
+    expect("zeros", nrm2_of(LEN, 0.0, -1, 0.0), 0.0);
+
+    double y[LEN], x[LEN];
+    for (int i = 0; i < LEN; i++) {
+        y[i] = 1e300;
+        x[i] = 1e300;
+    }
+    expect("axpy 1e300 + 1e300", blas_axpy_nrm2(y, 1.0, x, LEN), sqrt((double)LEN) * 2e300);
+    x[11] = NAN;
+    expect("axpy with a NaN in x", blas_axpy_nrm2(y, 1.0, x, LEN), NAN);
+}
+
+int main(void) {
+    SimdLevel best = simd_detect();
+    for (int level = SIMD_SCALAR; level <= (int)best; level++) {
+        if (simd_select((SimdLevel)level)) check_level();
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// Cache entries hold float32 factors, so a hit reconstructs from rounded
+// U, σ, V. Its output must stay within one grey level of the uncached run
+// at the same rank, with almost every pixel identical.
+#define _GNU_SOURCE
+#include "svd_compress.h"
+#include "factor_cache.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#define TOLERANCE 1             // grey levels
+#define MAX_CHANGED 0.01        // fraction of pixels allowed to differ at all
+
+static PGMImage* test_image(int width, int height) {
+    PGMImage *img = create_pgm_image(width, height, 255);
+    uint64_t rng = rng_seed(9);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            double v = 128.0 + 70.0 * ((i + 2 * j) % 23) / 23.0 + 40.0 * rng_uniform(&rng);
+            img->data[i][j] = (unsigned char)v;
+        }
+    }
+    return img;
+}
+
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[4096];
+    while (d && (e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+}
+
+static int compare(const char *what, const PGMImage *hit, const PGMImage *ref) {
+    int worst = 0;
+    long changed = 0, total = (long)ref->width * ref->height;
+    for (int i = 0; i < ref->height; i++) {
+        for (int j = 0; j < ref->width; j++) {
+            int d = abs((int)hit->data[i][j] - (int)ref->data[i][j]);
+            if (d > worst) worst = d;
+            if (d) changed++;
+        }
+    }
+    int ok = worst <= TOLERANCE && changed <= MAX_CHANGED * total;
+    printf("%s %-22s max diff %d, %ld of %ld pixels differ\n", ok ? "ok  " : "FAIL", what, worst,
+           changed, total);
+    return ok;
+}
+
+int main(void) {
+    char dir[] = "/tmp/test_cache_precision_XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    FactorCache *cache = factor_cache_open(dir, 0);
+    PGMImage *img = test_image(150, 120);
+
+    CompressOptions opts;
+    compress_default_options(&opts);
+    opts.tune = NULL;
+    PGMImage *ref40 = compress_image_svd_opts(img, 40, &opts);
+    PGMImage *ref15 = compress_image_svd_opts(img, 15, &opts);
+
+    opts.cache = cache;
+    PGMImage *miss = compress_image_svd_opts(img, 40, &opts);
+    PGMImage *hit40 = compress_image_svd_opts(img, 40, &opts);
+    PGMImage *hit15 = compress_image_svd_opts(img, 15, &opts);
+
+    int ok = cache && ref40 && ref15 && miss && hit40 && hit15 && cache->hits == 2;
+    printf("%s cache hits %ld (want 2)\n", ok ? "ok  " : "FAIL", cache ? cache->hits : 0);
+    if (ok) {
+        ok &= compare("k=40 miss vs uncached", miss, ref40);
+        ok &= compare("k=40 hit vs uncached", hit40, ref40);
+        ok &= compare("k=15 hit vs uncached", hit15, ref15);
+    }
+
+    free_pgm_image(hit15);
+    free_pgm_image(hit40);
+    free_pgm_image(miss);
+    free_pgm_image(ref15);
+    free_pgm_image(ref40);
+    free_pgm_image(img);
+    factor_cache_close(cache);
+    remove_dir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// On a tuned host different ranks of one image go to different exact
+// engines (here dense at k=150, Lanczos at k=10); the factor cache must
+// still serve the lower rank from the entry the higher one stored.
+#define _GNU_SOURCE
+#include "svd_compress.h"
+#include "factor_cache.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+// Equal per-unit costs, so the cheaper working width wins: Lanczos
+// (max(2k, k + 32)) below min(m, n) = 160, dense above it
+static const char *profile_text =
+    "svdcompress-profile 1\n"
+    "threads 1\n"
+    "reflector_block 32\n"
+    "engine lanczos 1e-9 0 1\n"
+    "engine dense 1e-9 0 1\n";
+
+static PGMImage* test_image(int width, int height) {
+    PGMImage *img = create_pgm_image(width, height, 255);
+    uint64_t rng = rng_seed(5);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            double v = 128.0 + 60.0 * ((i * j) % 17) / 17.0 + 40.0 * rng_uniform(&rng);
+            img->data[i][j] = (unsigned char)v;
+        }
+    }
+    return img;
+}
+
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[4096];
+    while (d && (e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+}
+
+int main(void) {
+    char dir[] = "/tmp/test_cache_tuned_XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    char profile[4200];
+    snprintf(profile, sizeof(profile), "%s/profile", dir);
+    FILE *f = fopen(profile, "w");
+    if (!f) return 1;
+    fputs(profile_text, f);
+    fclose(f);
+    // Read once, on the first autotune_default call
+    setenv("SVD_TUNE_PROFILE", profile, 1);
+
+    char cache_dir[4200];
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", dir);
+    FactorCache *cache = factor_cache_open(cache_dir, 0);
+    PGMImage *img = test_image(200, 160);
+    CompressOptions opts;
+    compress_default_options(&opts);
+    opts.cache = cache;
+
+    int ok = cache && opts.tune != NULL;
+    static const int ranks[] = { 150, 10, 150 };
+    static const long want_hits[] = { 0, 1, 2 };
+    for (int r = 0; ok && r < 3; r++) {
+        PGMImage *out = compress_image_svd_opts(img, ranks[r], &opts);
+        ok = out && cache->hits == want_hits[r];
+        printf("%s k=%-3d cache hits %ld (want %ld)\n", ok ? "ok  " : "FAIL", ranks[r],
+               cache ? cache->hits : 0, want_hits[r]);
+        free_pgm_image(out);
+    }
+
+    free_pgm_image(img);
+    factor_cache_close(cache);
+    remove_dir(cache_dir);
+    remove_dir(dir);
+    return ok ? 0 : 1;
+}
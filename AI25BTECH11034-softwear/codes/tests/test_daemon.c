@@ -0,0 +1,197 @@
+// The compression daemon end to end, in a child process on a temporary
+// socket: a COMPRESS_SHM job must leave the rank-k reconstruction in the
+// shared memory, a file job with a "2%" target must pick the smallest rank
+// whose discarded singular values stay under 2%, bad requests and short
+// shared-memory objects must get ERR replies, and SHUTDOWN must drain and
+// exit cleanly.
+#define _GNU_SOURCE
+#include "svd_daemon.h"
+#include "svd_engine.h"
+#include "pgm_io.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define WIDTH 96
+#define HEIGHT 80
+#define SHM_RANK 12
+
+static int failures = 0;
+
+static void expect(const char *what, int ok, const char *reply) {
+    if (!ok) failures++;
+    printf("%s %-28s %s\n", ok ? "ok  " : "FAIL", what, reply);
+}
+
+static PGMImage* test_image(void) {
+    PGMImage *img = create_pgm_image(WIDTH, HEIGHT, 255);
+    uint64_t rng = rng_seed(31);
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            double v = 60.0 + 1.2 * i + 0.8 * j + 30.0 * sin(i * 0.3) * cos(j * 0.2) +
+                       8.0 * rng_uniform(&rng);
+            img->data[i][j] = (unsigned char)v;
+        }
+    }
+    return img;
+}
+
+// Every singular triplet of the image, largest first
+static SVDResult* full_svd(const PGMImage *img) {
+    Matrix *A = create_matrix(HEIGHT, WIDTH);
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) A->data[i][j] = img->data[i][j];
+    }
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    SVDResult *svd = svd_compute(A, HEIGHT < WIDTH ? HEIGHT : WIDTH, &opts);
+    free_matrix(A);
+    return svd;
+}
+
+// Largest difference from the rounded rank-k reconstruction
+static int max_diff(const SVDResult *svd, int k, const unsigned char *pixels, int stride) {
+    int worst = 0;
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            double v = 0.0;
+            for (int l = 0; l < k; l++) {
+                v += svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            if (v < 0) v = 0;
+            if (v > 255) v = 255;
+            int d = abs((int)pixels[(size_t)i * stride + j] - (int)(v + 0.5));
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+static int reply_rank(const char *reply) {
+    int k = -1;
+    return sscanf(reply, "OK k=%d", &k) == 1 ? k : -1;
+}
+
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[4096];
+    while (d && (e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+}
+
+int main(void) {
+    char dir[] = "/tmp/test_daemon_XXXXXX";
+    if (!mkdtemp(dir)) return 1;
+    char sock[4200], input[4200], output[4200], shm_name[64], request[9000], reply[4096];
+    snprintf(sock, sizeof(sock), "%s/sock", dir);
+    snprintf(input, sizeof(input), "%s/in.pgm", dir);
+    snprintf(output, sizeof(output), "%s/out.pgm", dir);
+    snprintf(shm_name, sizeof(shm_name), "/test_daemon_%d", (int)getpid());
+
+    PGMImage *img = test_image();
+    SVDResult *ref = full_svd(img);
+    if (!ref || !write_image(input, img)) return 1;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        DaemonConfig cfg;
+        svd_daemon_default_config(&cfg);
+        cfg.workers = 2;
+        cfg.threads_per_job = 1;
+        _exit(svd_daemon_run(sock, &cfg) ? 0 : 1);
+    }
+    // Never hang the suite on a daemon that does not answer
+    alarm(120);
+    struct stat st;
+    for (int tries = 0; tries < 500 && stat(sock, &st) != 0; tries++) usleep(10000);
+    usleep(50000);
+
+    int ok = svd_daemon_request(sock, "STATS", reply, sizeof(reply));
+    expect("STATS before any job", ok && strncmp(reply, "OK queued=0", 11) == 0, reply);
+
+    // Pixels in shared memory are replaced by the rank-k image
+    int fd = shm_open(shm_name, O_CREAT | O_RDWR, 0600);
+    size_t len = (size_t)WIDTH * HEIGHT;
+    unsigned char *shm = NULL;
+    if (fd >= 0 && ftruncate(fd, (off_t)len) == 0) {
+        shm = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (shm == MAP_FAILED) shm = NULL;
+    }
+    if (fd >= 0) close(fd);
+    if (shm) {
+        for (int i = 0; i < HEIGHT; i++) memcpy(shm + (size_t)i * WIDTH, img->data[i], WIDTH);
+    }
+    snprintf(request, sizeof(request), "COMPRESS_SHM %s %d %d %d", shm_name, WIDTH, HEIGHT, SHM_RANK);
+    ok = shm && svd_daemon_request(sock, request, reply, sizeof(reply));
+    int diff = ok ? max_diff(ref, SHM_RANK, shm, WIDTH) : -1;
+    expect("COMPRESS_SHM k=12", ok && reply_rank(reply) == SHM_RANK && diff <= 1, reply);
+    printf("     max diff from the rank-%d reconstruction %d\n", SHM_RANK, diff);
+    if (shm) munmap(shm, len);
+
+    // Smallest rank whose tail energy is at most 2% of the total
+    double energy = 0.0, tail;
+    int p = HEIGHT < WIDTH ? HEIGHT : WIDTH, want = p;
+    for (int l = 0; l < p; l++) energy += ref->singular_values[l] * ref->singular_values[l];
+    tail = energy;
+    for (int l = 0; l < p; l++) {
+        tail -= ref->singular_values[l] * ref->singular_values[l];
+        if (sqrt(fmax(tail, 0.0)) <= 0.02 * sqrt(energy)) {
+            want = l + 1;
+            break;
+        }
+    }
+    snprintf(request, sizeof(request), "COMPRESS %s %s 2%%", input, output);
+    ok = svd_daemon_request(sock, request, reply, sizeof(reply));
+    int got = ok ? reply_rank(reply) : -1;
+    PGMImage *out = got > 0 ? read_image(output) : NULL;
+    int same_size = out && out->width == WIDTH && out->height == HEIGHT;
+    diff = same_size ? max_diff(ref, want, out->pixels, out->stride) : -1;
+    expect("COMPRESS 2%", got == want && diff >= 0 && diff <= 1, reply);
+    printf("     want k=%d, max diff from the rank-%d reconstruction %d\n", want, want, diff);
+    free_pgm_image(out);
+
+    // A shared-memory object shorter than width × height
+    snprintf(request, sizeof(request), "COMPRESS_SHM %s %d %d 5", shm_name, WIDTH, HEIGHT + 1);
+    ok = svd_daemon_request(sock, request, reply, sizeof(reply));
+    expect("short shared memory", ok && strstr(reply, "ERR shared memory") == reply, reply);
+    shm_unlink(shm_name);
+
+    static const char *bad[] = {
+        "RESIZE a b 3", "COMPRESS only-two-args 5", "COMPRESS a b 0", "COMPRESS a b 2.5",
+        "COMPRESS_SHM /test_daemon_missing 10 10 5"
+    };
+    for (int r = 0; r < 5; r++) {
+        ok = svd_daemon_request(sock, bad[r], reply, sizeof(reply));
+        expect(bad[r], ok && strncmp(reply, "ERR ", 4) == 0, reply);
+    }
+
+    ok = svd_daemon_request(sock, "STATS", reply, sizeof(reply));
+    expect("STATS after the jobs", ok && strstr(reply, " running=0 done=2 failed=5 ") != NULL, reply);
+
+    ok = svd_daemon_request(sock, "SHUTDOWN", reply, sizeof(reply));
+    int status = -1;
+    int exited = waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    expect("SHUTDOWN", ok && exited && stat(sock, &st) != 0, reply);
+
+    free_svd_result(ref);
+    free_pgm_image(img);
+    remove_dir(dir);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+// Region-of-interest decoding against a full rank-k reconstruction:
+// svd_decode_region must match it on every rectangle (edges, single
+// pixels, strided output), reject rectangles outside the image, and the
+// tile cache must assemble the same pixels across tile borders, evicting
+// once full and serving repeated views from cache.
+#include "svd_decode.h"
+#include "svd_engine.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEIGHT 150
+#define WIDTH 130
+#define RANK 25
+#define K 18                    // decoded rank, below the stored one
+
+static unsigned char full[HEIGHT][WIDTH];
+static int failures = 0;
+
+// Rounded and clamped U_k Σ_k V_kᵀ, summed in plain order
+static void reconstruct(const SVDResult *svd, int max_val) {
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            double v = 0.0;
+            for (int l = 0; l < K; l++) {
+                v += svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            if (!(v > 0)) v = 0;
+            if (v > max_val) v = max_val;
+            full[i][j] = (unsigned char)(v + 0.5);
+        }
+    }
+}
+
+// The decoder's dot products sum in another order, so a value within
+// rounding of a .5 boundary may land one level off
+static int region_diff(const unsigned char *pixels, int stride, int r0, int r1, int c0, int c1) {
+    int worst = 0;
+    for (int i = r0; i < r1; i++) {
+        for (int j = c0; j < c1; j++) {
+            int d = abs((int)pixels[(size_t)(i - r0) * stride + (j - c0)] - (int)full[i][j]);
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+static void expect(const char *what, int r0, int r1, int c0, int c1, int ok, int diff) {
+    ok = ok && diff <= 1;
+    if (!ok) failures++;
+    printf("%s %-10s [%3d,%3d)x[%3d,%3d) max diff %d\n", ok ? "ok  " : "FAIL", what, r0, r1, c0, c1,
+           diff);
+}
+
+int main(void) {
+    // Values straddle 0 and 255 so clamping is exercised
+    uint64_t rng = rng_seed(23);
+    Matrix *A = create_matrix(HEIGHT, WIDTH);
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            A->data[i][j] = 128.0 + 150.0 * ((i / 10 + j / 13) % 3 - 1) + 80.0 * rng_uniform(&rng);
+        }
+    }
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    SVDResult *svd = svd_compute(A, RANK, &opts);
+    if (!svd) return 1;
+    reconstruct(svd, 255);
+
+    static const int rects[][4] = {
+        { 0, HEIGHT, 0, WIDTH }, { 37, 91, 12, 77 }, { 0, 1, 0, 1 },
+        { HEIGHT - 1, HEIGHT, WIDTH - 1, WIDTH }, { 5, 6, 0, WIDTH }, { 0, HEIGHT, 64, 65 },
+        { 100, HEIGHT, 90, WIDTH }
+    };
+    int nrects = sizeof(rects) / sizeof(rects[0]);
+    // Output rows further apart than the region is wide, with a guard byte
+    int stride = WIDTH + 7;
+    unsigned char *pixels = malloc((size_t)HEIGHT * stride);
+    for (int r = 0; r < nrects; r++) {
+        int r0 = rects[r][0], r1 = rects[r][1], c0 = rects[r][2], c1 = rects[r][3];
+        memset(pixels, 0xA5, (size_t)HEIGHT * stride);
+        int ok = svd_decode_region(svd, K, r0, r1, c0, c1, pixels, stride, 255, 3);
+        for (int i = 0; ok && i < r1 - r0; i++) ok = pixels[(size_t)i * stride + (c1 - c0)] == 0xA5;
+        expect("region", r0, r1, c0, c1, ok, ok ? region_diff(pixels, stride, r0, r1, c0, c1) : 0);
+    }
+
+    static const int bad[][4] = {
+        { 0, HEIGHT + 1, 0, WIDTH }, { -1, 10, 0, 10 }, { 10, 10, 0, 10 }, { 0, 10, 20, 5 }
+    };
+    for (int r = 0; r < 4; r++) {
+        int ok = !svd_decode_region(svd, K, bad[r][0], bad[r][1], bad[r][2], bad[r][3], pixels, stride,
+                                    255, 1);
+        if (!ok) failures++;
+        printf("%s rejects [%d,%d)x[%d,%d)\n", ok ? "ok  " : "FAIL", bad[r][0], bad[r][1], bad[r][2],
+               bad[r][3]);
+    }
+
+    // 32-pixel tiles (ragged at the right and bottom), room for six of the
+    // 5 × 5 grid, so panning evicts
+    TileCache *cache = tile_cache_create(svd, K, 32, 6, 255, 2);
+    long hits = 0, misses = 0;
+    for (int r = 0; cache && r < nrects; r++) {
+        int r0 = rects[r][0], r1 = rects[r][1], c0 = rects[r][2], c1 = rects[r][3];
+        int ok = tile_cache_decode_region(cache, r0, r1, c0, c1, pixels, stride);
+        expect("tiles", r0, r1, c0, c1, ok, ok ? region_diff(pixels, stride, r0, r1, c0, c1) : 0);
+    }
+    // A view inside two tiles, then again: the second time all hits
+    int ok = cache && tile_cache_decode_region(cache, 40, 60, 20, 50, pixels, stride);
+    long hits0 = 0, misses0 = 0;
+    if (cache) tile_cache_stats(cache, &hits0, &misses0);
+    ok = ok && tile_cache_decode_region(cache, 40, 60, 20, 50, pixels, stride);
+    if (cache) tile_cache_stats(cache, &hits, &misses);
+    ok = ok && misses == misses0 && hits == hits0 + 2 && region_diff(pixels, stride, 40, 60, 20, 50) <= 1;
+    if (!ok) failures++;
+    printf("%s repeated view: %ld more hits, %ld more misses (want 2, 0); %ld misses in all\n",
+           ok ? "ok  " : "FAIL", hits - hits0, misses - misses0, misses);
+    ok = cache && !tile_cache_decode_region(cache, 0, HEIGHT, 0, WIDTH + 1, pixels, stride);
+    if (!ok) failures++;
+    printf("%s tile cache rejects a region past the edge\n", ok ? "ok  " : "FAIL");
+
+    tile_cache_destroy(cache);
+    free(pixels);
+    free_svd_result(svd);
+    free_matrix(A);
+    return failures ? 1 : 0;
+}
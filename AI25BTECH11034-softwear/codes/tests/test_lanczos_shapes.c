@@ -0,0 +1,120 @@
+// Thick-restart Lanczos on wide, tall and tiny shapes, where the Krylov
+// space is clamped to min(m, n): singular values must match Jacobi's and
+// the vectors must reconstruct A's rank-k part. The warm-started subspace
+// iteration (Rayleigh-Ritz through jacobi_svd) must agree too, and
+// jacobi_svd must report a matrix it cannot converge on.
+#include "lanczos.h"
+#include "svd_engine.h"
+#include "jacobi_svd.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+static Matrix* random_matrix(int m, int n, uint64_t seed) {
+    uint64_t rng = rng_seed(seed);
+    Matrix *A = create_matrix(m, n);
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) A->data[i][j] = rng_uniform(&rng) * 255.0;
+    }
+    return A;
+}
+
+static int check_shape(int m, int n, int k) {
+    Matrix *A = random_matrix(m, n, 1000 * m + n);
+    int p = m < n ? m : n;
+    double *ref = (double*)malloc(p * sizeof(double));
+    int ref_ok = jacobi_svd(A, ref, NULL, NULL, NULL, 1) > 0;
+
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_LANCZOS;
+    opts.verbose = 0;
+    opts.seed = 7;
+    SVDResult *svd = lanczos_restarted_svd(A, k, &opts);
+    int ok = ref_ok && svd != NULL;
+    double worst = 0.0;
+    for (int l = 0; ok && l < k; l++) {
+        double rel = fabs(svd->singular_values[l] - ref[l]) / ref[0];
+        if (rel > worst) worst = rel;
+    }
+    // ‖A v_l - σ_l u_l‖ for every triplet
+    double resid = 0.0;
+    for (int l = 0; ok && l < k; l++) {
+        for (int i = 0; i < m; i++) {
+            double av = 0.0;
+            for (int j = 0; j < n; j++) av += A->data[i][j] * svd->V->data[j][l];
+            double d = av - svd->singular_values[l] * svd->U->data[i][l];
+            resid += d * d;
+        }
+    }
+    resid = sqrt(resid) / ref[0];
+    ok = ok && worst < 1e-6 && resid < 1e-5;
+    printf("%-4s %4dx%-4d k=%-3d sigma err %.2e residual %.2e\n",
+           ok ? "ok" : "FAIL", m, n, k, worst, resid);
+
+    free_svd_result(svd);
+    free(ref);
+    free_matrix(A);
+    return ok;
+}
+
+// Seeded with the vectors of a nearby matrix, as a video frame would be
+static int check_warm_start(int m, int n, int k) {
+    Matrix *A = random_matrix(m, n, 77);
+    Matrix *B = random_matrix(m, n, 78);
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) B->data[i][j] = A->data[i][j] + 0.01 * B->data[i][j];
+    }
+    int p = m < n ? m : n;
+    double *ref = (double*)malloc(p * sizeof(double));
+    int ok = jacobi_svd(B, ref, NULL, NULL, NULL, 1) > 0;
+
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.verbose = 0;
+    opts.seed = 7;
+    SVDResult *prev = svd_compute(A, k, &opts);
+    opts.start = prev ? prev->V : NULL;
+    SVDResult *svd = prev ? svd_compute(B, k, &opts) : NULL;
+    double worst = 0.0;
+    for (int l = 0; ok && svd && l < k; l++) {
+        double rel = fabs(svd->singular_values[l] - ref[l]) / ref[0];
+        if (rel > worst) worst = rel;
+    }
+    ok = ok && svd && worst < 1e-6;
+    printf("%-4s %4dx%-4d k=%-3d warm start, sigma err %.2e\n", ok ? "ok" : "FAIL", m, n, k, worst);
+
+    free_svd_result(svd);
+    free_svd_result(prev);
+    free(ref);
+    free_matrix(B);
+    free_matrix(A);
+    return ok;
+}
+
+static int check_nan(void) {
+    Matrix *A = random_matrix(12, 9, 3);
+    A->data[4][5] = NAN;
+    double s[9];
+    int sweeps = jacobi_svd(A, s, NULL, NULL, NULL, 1);
+    int ok = sweeps < 0;
+    printf("%-4s NaN entry: jacobi_svd returns %d (want < 0)\n", ok ? "ok" : "FAIL", sweeps);
+    free_matrix(A);
+    return ok;
+}
+
+int main(void) {
+    static const int shapes[][3] = {
+        { 1, 400, 1 }, { 400, 1, 1 }, { 2, 20, 2 }, { 20, 2, 1 },
+        { 40, 400, 40 }, { 40, 400, 10 }, { 400, 40, 40 },
+        { 120, 500, 10 }, { 500, 120, 10 }, { 60, 61, 20 }
+    };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        failed += !check_shape(shapes[i][0], shapes[i][1], shapes[i][2]);
+    }
+    failed += !check_warm_start(150, 90, 12);
+    failed += !check_nan();
+    return failed ? 1 : 0;
+}
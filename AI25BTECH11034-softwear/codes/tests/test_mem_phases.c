@@ -0,0 +1,60 @@
+// Allocations made by parallel_for workers while the driver opens and
+// closes phases must all be counted, globally and in the phase that stays
+// open around them.
+#include "mem_stats.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 8
+#define ALLOCS_PER_ITEM 2000
+
+static void allocate_items(void *arg, int begin, int end) {
+    (void)arg;
+    for (int i = begin; i < end; i++) {
+        for (int a = 0; a < ALLOCS_PER_ITEM; a++) mem_free(mem_alloc(64));
+    }
+}
+
+static long phase_allocs(const char *name) {
+    FILE *fp = tmpfile();
+    if (!fp) return -1;
+    mem_report(fp);
+    rewind(fp);
+    char line[256], phase[64];
+    double peak;
+    long allocs = -1, count;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, " %63s peak %lf MB, %ld allocations", phase, &peak, &count) == 3 &&
+            strcmp(phase, name) == 0) {
+            allocs = count;
+        }
+    }
+    fclose(fp);
+    return allocs;
+}
+
+int main(void) {
+    long before = mem_alloc_count();
+    long expected = 0;
+    mem_phase_begin("outer");
+    for (int round = 0; round < 20; round++) {
+        mem_phase_begin("inner");
+        parallel_for(THREADS, THREADS, allocate_items, NULL);
+        mem_phase_end("inner");
+        expected += (long)THREADS * ALLOCS_PER_ITEM;
+    }
+    mem_phase_end("outer");
+
+    long total = mem_alloc_count() - before;
+    long outer = phase_allocs("outer");
+    long inner = phase_allocs("inner");
+    int ok = total == expected && outer == expected && inner == expected;
+    printf("%s %ld allocations on %d threads: %ld counted, outer phase %ld, inner phase %ld\n",
+           ok ? "ok  " : "FAIL", expected, THREADS, total, outer, inner);
+
+    // Opening more phases than the stack holds must not overrun it
+    for (int i = 0; i < 40; i++) mem_phase_begin("deep");
+    for (int i = 0; i < 40; i++) mem_phase_end("deep");
+    return ok ? 0 : 1;
+}
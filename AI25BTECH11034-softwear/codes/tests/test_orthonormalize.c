@@ -0,0 +1,189 @@
+// The orthonormalization kernels against their definition: blocked
+// Householder QR (at several panel widths), tree TSQR (plain and
+// transposed, odd block counts included) and CholeskyQR2 must each give an
+// orthonormal Q with Q R = A and R upper triangular. CholeskyQR2 must
+// decline a rank-deficient block, and block_orthonormalize must still span
+// it through the TSQR fallback.
+#include "matrix.h"
+#include "rng.h"
+#include <stdio.h>
+#include <math.h>
+
+static int failures = 0;
+
+static Matrix* random_matrix(int m, int n, uint64_t seed) {
+    uint64_t rng = rng_seed(seed);
+    Matrix *A = create_matrix(m, n);
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) A->data[i][j] = rng_uniform(&rng);
+    }
+    return A;
+}
+
+// max |QᵀQ - I|
+static double orthogonality(const Matrix *Q) {
+    double worst = 0.0;
+    for (int a = 0; a < Q->cols; a++) {
+        for (int b = 0; b <= a; b++) {
+            double dot = 0.0;
+            for (int i = 0; i < Q->rows; i++) dot += Q->data[i][a] * Q->data[i][b];
+            double d = fabs(dot - (a == b ? 1.0 : 0.0));
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+// max |Q R - A| relative to max |A|, with R read as upper triangular; also
+// fails when R has anything below the diagonal
+static double factor_error(const Matrix *A, const Matrix *Q, const Matrix *R) {
+    double worst = 0.0, scale = 0.0;
+    for (int i = 0; i < R->rows; i++) {
+        for (int j = 0; j < i; j++) {
+            if (R->data[i][j] != 0.0) return INFINITY;
+        }
+    }
+    for (int i = 0; i < A->rows; i++) {
+        for (int j = 0; j < A->cols; j++) {
+            double qr = 0.0;
+            for (int l = 0; l <= j; l++) qr += Q->data[i][l] * R->data[l][j];
+            if (fabs(qr - A->data[i][j]) > worst) worst = fabs(qr - A->data[i][j]);
+            if (fabs(A->data[i][j]) > scale) scale = fabs(A->data[i][j]);
+        }
+    }
+    return worst / scale;
+}
+
+static void expect(const char *what, int m, int n, double orth, double err) {
+    int ok = orth < 1e-12 && err < 1e-12;
+    if (!ok) failures++;
+    printf("%s %-24s %5dx%-4d orthogonality %.1e, |QR - A| %.1e\n", ok ? "ok  " : "FAIL", what, m, n,
+           orth, err);
+}
+
+static void check_householder(int m, int n, int block) {
+    Matrix *A = random_matrix(m, n, 10 * m + n);
+    Matrix *B = copy_matrix(A);
+    Matrix *Q = create_matrix(m, n);
+    Matrix *R = create_matrix(n, n);
+    double tau[256];
+    int saved = householder_block();
+    householder_set_block(block);
+    int ok = householder_qr(B, tau);
+    for (int j = 0; j < n; j++) Q->data[j][j] = 1.0;
+    ok = ok && householder_apply(B, tau, 0, Q);
+    householder_set_block(saved);
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) R->data[i][j] = B->data[i][j];
+    }
+    char what[64];
+    snprintf(what, sizeof(what), "householder block %d", block);
+    if (ok) {
+        expect(what, m, n, orthogonality(Q), factor_error(A, Q, R));
+    } else {
+        failures++;
+        printf("FAIL %s %dx%d\n", what, m, n);
+    }
+    free_matrix(R);
+    free_matrix(Q);
+    free_matrix(B);
+    free_matrix(A);
+}
+
+static void check_tsqr(int m, int n, int threads, int transpose) {
+    Matrix *A = random_matrix(m, n, 20 * m + n);
+    Matrix *At = create_matrix(n, m);
+    matrix_transpose(A, At);
+    TSQR *f = tsqr_factor(transpose ? At : A, transpose, threads);
+    Matrix *Q = create_matrix(m, n);
+    Matrix *R = create_matrix(n, n);
+    Matrix *I = create_matrix(n, n);
+    for (int j = 0; j < n; j++) I->data[j][j] = 1.0;
+    int ok = f && tsqr_apply_q(f, I, Q, threads);
+    char what[64];
+    snprintf(what, sizeof(what), "tsqr%s %d blocks", transpose ? " of Aᵀ," : "", f ? f->blocks : 0);
+    if (ok) {
+        tsqr_get_r(f, R);
+        expect(what, m, n, orthogonality(Q), factor_error(A, Q, R));
+    } else {
+        failures++;
+        printf("FAIL %s %dx%d\n", what, m, n);
+    }
+    tsqr_free(f);
+    free_matrix(I);
+    free_matrix(R);
+    free_matrix(Q);
+    free_matrix(At);
+    free_matrix(A);
+}
+
+static void check_cholesky_qr2(int m, int n, int threads) {
+    Matrix *A = random_matrix(m, n, 30 * m + n);
+    Matrix *Q = copy_matrix(A);
+    Matrix *R = create_matrix(n, n);
+    if (cholesky_qr2(Q, R, threads)) {
+        expect("cholesky_qr2", m, n, orthogonality(Q), factor_error(A, Q, R));
+    } else {
+        failures++;
+        printf("FAIL cholesky_qr2 declined a well-conditioned %dx%d\n", m, n);
+    }
+    free_matrix(R);
+    free_matrix(Q);
+    free_matrix(A);
+}
+
+// Column 3 repeats column 1: CholeskyQR2 must decline, and the fallback's
+// orthonormal columns must still reproduce every column of V
+static void check_rank_deficient(int m, int n, int threads) {
+    Matrix *A = random_matrix(m, n, 40 * m + n);
+    for (int i = 0; i < m; i++) A->data[i][3] = A->data[i][1];
+    Matrix *Q = copy_matrix(A);
+    int declined = !cholesky_qr2(Q, NULL, threads);
+    free_matrix(Q);
+    Q = copy_matrix(A);
+    int ok = block_orthonormalize(Q, NULL, threads);
+
+    // max |A - Q Qᵀ A|
+    double span = 0.0;
+    for (int j = 0; ok && j < n; j++) {
+        double c[64];
+        for (int l = 0; l < n; l++) {
+            c[l] = 0.0;
+            for (int i = 0; i < m; i++) c[l] += Q->data[i][l] * A->data[i][j];
+        }
+        for (int i = 0; i < m; i++) {
+            double r = A->data[i][j];
+            for (int l = 0; l < n; l++) r -= Q->data[i][l] * c[l];
+            if (fabs(r) > span) span = fabs(r);
+        }
+    }
+    double orth = ok ? orthogonality(Q) : INFINITY;
+    ok = ok && declined && orth < 1e-12 && span < 1e-12;
+    if (!ok) failures++;
+    printf("%s %-24s %5dx%-4d cholesky declined %d, orthogonality %.1e, |A - QQᵀA| %.1e\n",
+           ok ? "ok  " : "FAIL", "rank-deficient block", m, n, declined, orth, span);
+    free_matrix(Q);
+    free_matrix(A);
+}
+
+int main(void) {
+    // Narrower, equal to and wider than one panel, plus a ragged last panel
+    check_householder(120, 40, 1);
+    check_householder(120, 40, 8);
+    check_householder(120, 40, 32);
+    check_householder(70, 70, 16);
+    check_householder(200, 45, 32);
+
+    check_tsqr(1000, 20, 1, 0);
+    check_tsqr(1000, 20, 4, 0);
+    check_tsqr(1000, 20, 5, 0);         // odd count: a node with one child
+    check_tsqr(999, 17, 3, 1);
+    check_tsqr(60, 20, 8, 0);           // blocks capped at rows / cols
+
+    check_cholesky_qr2(2000, 30, 1);
+    check_cholesky_qr2(2000, 30, 4);
+
+    check_rank_deficient(500, 12, 1);
+    check_rank_deficient(500, 12, 4);
+    return failures ? 1 : 0;
+}
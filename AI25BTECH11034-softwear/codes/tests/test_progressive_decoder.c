@@ -0,0 +1,127 @@
+// Progressive decoding of a .svdp stream: fed in pieces it must render the
+// same image as the triplets svd_stream_load reads back; a truncated chunk
+// is held until the rest arrives, and a repeated chunk is rejected.
+#define _GNU_SOURCE
+#include "svd_stream.h"
+#include "svd_engine.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define HEIGHT 40
+#define WIDTH 30
+#define RANK 20
+#define CHUNK 8
+
+// Rounded and clamped reconstruction from the leading rank triplets
+static void reference(const SVDResult *svd, int rank, unsigned char *px) {
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            double v = 0.0;
+            for (int l = 0; l < rank; l++) {
+                v += svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            if (v < 0) v = 0;
+            if (v > 255) v = 255;
+            px[i * WIDTH + j] = (unsigned char)(v + 0.5);
+        }
+    }
+}
+
+// The decoder sums in another order, so allow one level at .5 boundaries
+static int check(const char *what, ProgressiveDecoder *dec, const SVDResult *svd, int rank) {
+    unsigned char got[HEIGHT * WIDTH], want[HEIGHT * WIDTH];
+    int ok = progressive_decoder_rank(dec) == rank &&
+             progressive_decoder_render(dec, got, WIDTH);
+    int worst = 0;
+    if (ok) {
+        reference(svd, rank, want);
+        for (int i = 0; i < HEIGHT * WIDTH; i++) {
+            int d = abs((int)got[i] - (int)want[i]);
+            if (d > worst) worst = d;
+        }
+        ok = worst <= 1;
+    }
+    printf("%s %-28s rank %d (want %d), max diff %d\n", ok ? "ok  " : "FAIL", what,
+           progressive_decoder_rank(dec), rank, worst);
+    return ok;
+}
+
+static unsigned char* read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    rewind(f);
+    unsigned char *buf = malloc(*len);
+    if (buf && fread(buf, 1, *len, f) != *len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(void) {
+    uint64_t rng = rng_seed(17);
+    Matrix *A = create_matrix(HEIGHT, WIDTH);
+    for (int i = 0; i < HEIGHT; i++) {
+        for (int j = 0; j < WIDTH; j++) {
+            A->data[i][j] = 128.0 + 60.0 * ((i * j) % 11) / 11.0 + 60.0 * rng_uniform(&rng);
+        }
+    }
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    SVDResult *svd = svd_compute(A, RANK, &opts);
+
+    char path[] = "/tmp/test_progressive_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || !svd) return 1;
+    close(fd);
+    size_t len = 0;
+    unsigned char *file = svd_stream_save(path, svd, RANK, 255, CHUNK) ? read_file(path, &len) : NULL;
+    // The float32 triplets as stored, for the references
+    SVDResult *stored = file ? svd_stream_load(path, 0, NULL) : NULL;
+    unlink(path);
+    if (!stored) return 1;
+
+    size_t chunk = svd_stream_prefix_bytes(HEIGHT, WIDTH, CHUNK, CHUNK) - SVD_STREAM_HEADER_BYTES;
+    size_t one = SVD_STREAM_HEADER_BYTES + chunk;
+    // Two full chunks and a last one of RANK % CHUNK triplets
+    int ok = len == one + chunk + 8 + (size_t)(RANK % CHUNK) * (1 + HEIGHT + WIDTH) * 4;
+
+    // Whole stream in 100-byte pieces
+    ProgressiveDecoder *dec = progressive_decoder_create(2);
+    for (size_t pos = 0; pos < len; pos += 100) {
+        if (progressive_decoder_feed(dec, file + pos, len - pos < 100 ? len - pos : 100) < 0) ok = 0;
+    }
+    ok &= check("whole stream in pieces", dec, stored, RANK);
+    progressive_decoder_destroy(dec);
+
+    // A chunk cut short waits for its tail
+    dec = progressive_decoder_create(1);
+    size_t cut = one + chunk / 2;
+    int added = progressive_decoder_feed(dec, file, cut);
+    ok &= added == CHUNK && check("truncated second chunk", dec, stored, CHUNK);
+    added = progressive_decoder_feed(dec, file + cut, one + chunk - cut);
+    ok &= added == CHUNK && check("rest of the second chunk", dec, stored, 2 * CHUNK);
+    progressive_decoder_destroy(dec);
+
+    // The first chunk sent twice
+    dec = progressive_decoder_create(1);
+    added = progressive_decoder_feed(dec, file, one);
+    ok &= added == CHUNK;
+    added = progressive_decoder_feed(dec, file + SVD_STREAM_HEADER_BYTES, chunk);
+    printf("%s duplicate chunk returns %d (want -1)\n", added == -1 ? "ok  " : "FAIL", added);
+    ok &= added == -1 && check("after the duplicate", dec, stored, CHUNK);
+    progressive_decoder_destroy(dec);
+
+    free(file);
+    free_svd_result(stored);
+    free_svd_result(svd);
+    free_matrix(A);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// --prune keeps the dense factors when the pruned ones would not store in
+// fewer bytes: noise has no small entries to drop, so the pruned
+// compression must reproduce the dense one pixel for pixel. An image that
+// is blank outside one block has exactly-zero vector entries and must
+// still come out sparse.
+#include "svd_compress.h"
+#include "svd_prune.h"
+#include "dense_svd.h"
+#include "rng.h"
+#include <stdio.h>
+#include <string.h>
+
+static PGMImage* test_image(int width, int height, int block) {
+    PGMImage *img = create_pgm_image(width, height, 255);
+    uint64_t rng = rng_seed(width * 31 + height);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            if (block && (i >= block || j >= block)) continue;
+            img->data[i][j] = (unsigned char)((rng_uniform(&rng) + 0.5) * 255.0);
+        }
+    }
+    return img;
+}
+
+static PGMImage* compress(PGMImage *img, int k, double prune) {
+    CompressOptions opts;
+    compress_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.tune = NULL;
+    opts.prune = prune;
+    return compress_image_svd_opts(img, k, &opts);
+}
+
+static int check_noise_falls_back(void) {
+    PGMImage *img = test_image(96, 80, 0);
+    PGMImage *dense = compress(img, 10, 0.0);
+    PGMImage *pruned = compress(img, 10, 0.01);
+    int same = dense && pruned;
+    for (int i = 0; same && i < img->height; i++) {
+        same = memcmp(dense->data[i], pruned->data[i], img->width) == 0;
+    }
+    printf("%s noise with --prune 0.01 matches the dense reconstruction\n", same ? "ok  " : "FAIL");
+    free_pgm_image(pruned);
+    free_pgm_image(dense);
+    free_pgm_image(img);
+    return same;
+}
+
+static int check_block_stays_sparse(void) {
+    PGMImage *img = test_image(200, 160, 24);
+    Matrix *A = pgm_to_matrix(img);
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.verbose = 0;
+    SVDResult *svd = dense_svd(A, 8, &opts);
+    SparseSVD *sparse = svd ? svd_prune(svd, 8, 0.01) : NULL;
+    int ok = sparse && sparse_svd_is_smaller(sparse);
+    printf("%s 24x24 block in 200x160 prunes to %.1f%% nonzero\n", ok ? "ok  " : "FAIL",
+           sparse ? sparse_svd_density(sparse) * 100.0 : 0.0);
+    free_sparse_svd(sparse);
+    free_svd_result(svd);
+    free_matrix(A);
+    free_pgm_image(img);
+    return ok;
+}
+
+int main(void) {
+    int ok = check_noise_falls_back();
+    ok &= check_block_stays_sparse();
+    return ok ? 0 : 1;
+}
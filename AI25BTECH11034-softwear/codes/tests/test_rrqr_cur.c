@@ -0,0 +1,122 @@
+// The approximate engines against the optimal rank-k error: on a matrix
+// with a known spectrum, ‖A - Â‖_F from rrqr_svd and cur_svd must stay
+// within a small factor of the Eckart-Young tail sqrt(Σ_{l>k} σ_l²) (2 for
+// RRQR, 3 for the sketched CUR); on an exact rank-k matrix both must be
+// exact. Results must be in SVD form: orthonormal U and V and descending
+// non-negative σ.
+#include "rrqr_cur.h"
+#include "rng.h"
+#include <stdio.h>
+#include <math.h>
+
+#define M 160
+#define N 110
+
+static int failures = 0;
+
+// Q1 diag(sigma) Q2ᵀ with random orthonormal Q1 (M×p), Q2 (N×p)
+static Matrix* with_spectrum(const double *sigma, int p, uint64_t seed) {
+    uint64_t rng = rng_seed(seed);
+    Matrix *Q1 = create_matrix(M, p), *Q2 = create_matrix(N, p);
+    for (int i = 0; i < M; i++) {
+        for (int l = 0; l < p; l++) Q1->data[i][l] = rng_uniform(&rng);
+    }
+    for (int j = 0; j < N; j++) {
+        for (int l = 0; l < p; l++) Q2->data[j][l] = rng_uniform(&rng);
+    }
+    block_orthonormalize(Q1, NULL, 1);
+    block_orthonormalize(Q2, NULL, 1);
+    Matrix *A = create_matrix(M, N);
+    for (int i = 0; i < M; i++) {
+        for (int j = 0; j < N; j++) {
+            double v = 0.0;
+            for (int l = 0; l < p; l++) v += Q1->data[i][l] * sigma[l] * Q2->data[j][l];
+            A->data[i][j] = v;
+        }
+    }
+    free_matrix(Q2);
+    free_matrix(Q1);
+    return A;
+}
+
+static double orthonormality(const Matrix *Q, int k) {
+    double worst = 0.0;
+    for (int a = 0; a < k; a++) {
+        for (int b = 0; b <= a; b++) {
+            double dot = 0.0;
+            for (int i = 0; i < Q->rows; i++) dot += Q->data[i][a] * Q->data[i][b];
+            if (fabs(dot - (a == b)) > worst) worst = fabs(dot - (a == b));
+        }
+    }
+    return worst;
+}
+
+// ‖A - U Σ Vᵀ‖_F, or -1 when svd is not a valid rank-k SVD
+static double approx_error(const Matrix *A, const SVDResult *svd, int k) {
+    if (!svd || svd->k != k) return -1.0;
+    const double *s = svd->singular_values;
+    for (int l = 0; l < k; l++) {
+        if (s[l] < 0 || (l && s[l] > s[l - 1])) return -1.0;
+    }
+    if (orthonormality(svd->U, k) > 1e-10 || orthonormality(svd->V, k) > 1e-10) return -1.0;
+    double sum = 0.0;
+    for (int i = 0; i < M; i++) {
+        for (int j = 0; j < N; j++) {
+            double r = A->data[i][j];
+            for (int l = 0; l < k; l++) {
+                r -= svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            sum += r * r;
+        }
+    }
+    return sqrt(sum);
+}
+
+static void check(const char *what, Matrix *A, int k, double optimal) {
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.verbose = 0;
+    opts.seed = 9;
+    static const char *names[] = { "rrqr", "cur" };
+    static const double factor[] = { 2.0, 3.0 };
+    for (int e = 0; e < 2; e++) {
+        SVDResult *svd = e == 0 ? rrqr_svd(A, k, &opts) : cur_svd(A, k, &opts);
+        double err = approx_error(A, svd, k);
+        // An exact rank-k matrix must come back to rounding
+        int ok = err >= 0 && (optimal > 0 ? err <= factor[e] * optimal : err <= 1e-8);
+        if (!ok) failures++;
+        printf("%s %-4s %-22s k=%-3d error %.3e, optimal %.3e, ratio %.3f\n", ok ? "ok  " : "FAIL",
+               names[e], what, k, err, optimal, optimal > 0 ? err / optimal : 0.0);
+        free_svd_result(svd);
+    }
+}
+
+int main(void) {
+    double sigma[N];
+    int p = N;
+
+    // Exact rank 12
+    for (int l = 0; l < p; l++) sigma[l] = l < 12 ? 100.0 / (l + 1) : 0.0;
+    Matrix *A = with_spectrum(sigma, 12, 1);
+    check("exact rank 12", A, 12, 0.0);
+    free_matrix(A);
+
+    // Geometric decay
+    for (int l = 0; l < p; l++) sigma[l] = 100.0 * pow(0.7, l);
+    A = with_spectrum(sigma, p, 2);
+    for (int k = 5; k <= 20; k += 15) {
+        double tail = 0.0;
+        for (int l = k; l < p; l++) tail += sigma[l] * sigma[l];
+        check("geometric 0.7^l", A, k, sqrt(tail));
+    }
+    free_matrix(A);
+
+    // Slow decay, the hard case for column selection
+    for (int l = 0; l < p; l++) sigma[l] = 100.0 / (l + 1);
+    A = with_spectrum(sigma, p, 3);
+    double tail = 0.0;
+    for (int l = 15; l < p; l++) tail += sigma[l] * sigma[l];
+    check("harmonic 1/l", A, 15, sqrt(tail));
+    free_matrix(A);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+// Corpus mode against a dense SVD of the stacked images: the streamed TSQR
+// builder must give the stack's singular values and dominant right
+// subspace, encoding must equal A V_k, decoding the rounded C V_kᵀ, and the
+// dictionary and coefficient files must round trip at float32 precision,
+// refusing coefficients written against another basis.
+#define _GNU_SOURCE
+#include "shared_basis.h"
+#include "svd_engine.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#define WIDTH 60
+#define IMAGES 4
+#define PATTERNS 6              // row space shared by the whole corpus
+#define RANK 10
+
+static const int heights[IMAGES] = { 50, 40, 70, 30 };
+static int failures = 0;
+
+static void expect(const char *what, int ok, double value) {
+    if (!ok) failures++;
+    printf("%s %-40s %.2e\n", ok ? "ok  " : "FAIL", what, value);
+}
+
+// Rows mix PATTERNS fixed row patterns, plus a little noise
+static Matrix* corpus_image(int index, const Matrix *patterns, uint64_t *rng) {
+    Matrix *A = create_matrix(heights[index], WIDTH);
+    for (int i = 0; i < A->rows; i++) {
+        double w[PATTERNS];
+        for (int p = 0; p < PATTERNS; p++) w[p] = rng_uniform(rng) * 60.0 / (p + 1);
+        for (int j = 0; j < WIDTH; j++) {
+            double v = 128.0 + 0.5 * rng_uniform(rng);
+            for (int p = 0; p < PATTERNS; p++) v += w[p] * patterns->data[p][j];
+            A->data[i][j] = v;
+        }
+    }
+    return A;
+}
+
+static SharedBasis* learn(Matrix **images, int count) {
+    SharedBasisBuilder *b = shared_basis_builder_create(WIDTH, 2);
+    for (int i = 0; b && i < count; i++) {
+        if (!shared_basis_builder_add(b, images[i])) return NULL;
+    }
+    SharedBasis *basis = b ? shared_basis_builder_finish(b, RANK) : NULL;
+    shared_basis_builder_free(b);
+    return basis;
+}
+
+int main(void) {
+    uint64_t rng = rng_seed(41);
+    Matrix *patterns = create_matrix(PATTERNS, WIDTH);
+    for (int p = 0; p < PATTERNS; p++) {
+        for (int j = 0; j < WIDTH; j++) patterns->data[p][j] = sin((p + 1) * 0.37 * j + p);
+    }
+    Matrix *images[IMAGES];
+    int total = 0;
+    for (int i = 0; i < IMAGES; i++) {
+        images[i] = corpus_image(i, patterns, &rng);
+        total += heights[i];
+    }
+
+    // Reference: dense SVD of the stack
+    Matrix *stack = create_matrix(total, WIDTH);
+    for (int i = 0, r = 0; i < IMAGES; i++) {
+        for (int y = 0; y < heights[i]; y++, r++) {
+            for (int j = 0; j < WIDTH; j++) stack->data[r][j] = images[i]->data[y][j];
+        }
+    }
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    SVDResult *ref = svd_compute(stack, RANK, &opts);
+    SharedBasis *basis = learn(images, IMAGES);
+    if (!ref || !basis) return 1;
+
+    double worst = 0.0;
+    for (int l = 0; l < RANK; l++) {
+        double rel = fabs(basis->singular_values[l] - ref->singular_values[l]) / ref->singular_values[0];
+        if (rel > worst) worst = rel;
+    }
+    expect("singular values of the stack", worst < 1e-10 && basis->images == IMAGES, worst);
+
+    // Leading PATTERNS + 1 vectors (mean plus patterns) are well separated
+    // from the noise: each basis vector must lie in the reference span
+    int lead = PATTERNS + 1;
+    worst = 0.0;
+    for (int l = 0; l < lead; l++) {
+        double in_span = 0.0;
+        for (int q = 0; q < lead; q++) {
+            double dot = 0.0;
+            for (int j = 0; j < WIDTH; j++) dot += basis->V->data[j][l] * ref->V->data[j][q];
+            in_span += dot * dot;
+        }
+        if (fabs(1.0 - in_span) > worst) worst = fabs(1.0 - in_span);
+    }
+    expect("dominant right subspace", worst < 1e-8, worst);
+
+    // Encode and decode every image at k = lead
+    double enc_err = 0.0;
+    int dec_err = 0, dec_ok = 1;
+    double fit = 0.0;
+    for (int i = 0; i < IMAGES; i++) {
+        Matrix *A = images[i];
+        Matrix *C = shared_basis_encode(basis, A, lead, 2);
+        unsigned char *px = malloc((size_t)A->rows * WIDTH);
+        dec_ok = dec_ok && C && px && shared_basis_decode(basis, C, px, WIDTH, 255, 2);
+        for (int y = 0; dec_ok && y < A->rows; y++) {
+            for (int l = 0; l < lead; l++) {
+                double c = 0.0;
+                for (int j = 0; j < WIDTH; j++) c += A->data[y][j] * basis->V->data[j][l];
+                if (fabs(c - C->data[y][l]) > enc_err) enc_err = fabs(c - C->data[y][l]);
+            }
+            for (int j = 0; j < WIDTH; j++) {
+                double v = 0.0;
+                for (int l = 0; l < lead; l++) v += C->data[y][l] * basis->V->data[j][l];
+                if (fabs(v - A->data[y][j]) > fit) fit = fabs(v - A->data[y][j]);
+                if (v < 0) v = 0;
+                if (v > 255) v = 255;
+                int d = abs((int)px[y * WIDTH + j] - (int)(v + 0.5));
+                if (d > dec_err) dec_err = d;
+            }
+        }
+        free(px);
+        free_matrix(C);
+    }
+    expect("encode equals A V_k", dec_ok && enc_err < 1e-9, enc_err);
+    expect("decode matches the rounded C V_k", dec_ok && dec_err <= 1, dec_err);
+    // The corpus is rank PATTERNS + 1 up to noise of ±0.25
+    expect("rank-7 fit to the corpus", dec_ok && fit < 1.0, fit);
+
+    // Dictionary and coefficients through their files
+    char dict[] = "/tmp/test_shared_basis_XXXXXX";
+    char coeffs[] = "/tmp/test_shared_coeffs_XXXXXX";
+    int fd1 = mkstemp(dict), fd2 = mkstemp(coeffs);
+    if (fd1 < 0 || fd2 < 0) return 1;
+    close(fd1);
+    close(fd2);
+    SharedBasis *loaded = shared_basis_save(dict, basis) ? shared_basis_load(dict) : NULL;
+    worst = 0.0;
+    int same = loaded && loaded->width == WIDTH && loaded->rank == RANK && loaded->id == basis->id;
+    for (int j = 0; same && j < WIDTH; j++) {
+        for (int l = 0; l < RANK; l++) {
+            if (fabs(loaded->V->data[j][l] - basis->V->data[j][l]) > worst) {
+                worst = fabs(loaded->V->data[j][l] - basis->V->data[j][l]);
+            }
+        }
+    }
+    expect("dictionary file round trip", same && worst < 1e-7, worst);
+
+    Matrix *C = loaded ? shared_basis_encode(loaded, images[2], lead, 1) : NULL;
+    int max_val = 0;
+    Matrix *C2 = C && shared_basis_save_coeffs(coeffs, loaded, C, 255)
+                     ? shared_basis_load_coeffs(coeffs, loaded, &max_val) : NULL;
+    worst = 0.0;
+    same = C2 && max_val == 255 && C2->rows == C->rows && C2->cols == lead;
+    for (int y = 0; same && y < C->rows; y++) {
+        for (int l = 0; l < lead; l++) {
+            double rel = fabs(C2->data[y][l] - C->data[y][l]) / (fabs(C->data[y][l]) + 1.0);
+            if (rel > worst) worst = rel;
+        }
+    }
+    expect("coefficient file round trip", same && worst < 1e-6, worst);
+
+    // A basis learned from part of the corpus has another id
+    SharedBasis *other = learn(images, 2);
+    Matrix *C3 = other ? shared_basis_load_coeffs(coeffs, other, &max_val) : NULL;
+    expect("coefficients refused for another basis", other && other->id != basis->id && !C3, 0.0);
+
+    unlink(dict);
+    unlink(coeffs);
+    free_matrix(C3);
+    free_shared_basis(other);
+    free_matrix(C2);
+    free_matrix(C);
+    free_shared_basis(loaded);
+    free_shared_basis(basis);
+    free_svd_result(ref);
+    free_matrix(stack);
+    for (int i = 0; i < IMAGES; i++) free_matrix(images[i]);
+    free_matrix(patterns);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+// Every kernel of every level this host runs against the scalar table, on
+// lengths that hit the vector loops and every tail: element-wise results
+// and reductions within rounding of the scalar ones (FMA and the summation
+// order differ per level), pixel widening and quantization exact, including
+// NaN, out-of-range and half-way values. Also $SVD_SIMD capping the level
+// picked on first use, level names round tripping, and simd_select
+// refusing levels the host lacks.
+#define _GNU_SOURCE
+#include "simd_kernels.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define MAXLEN 1001
+
+static const int lengths[] = { 0, 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 67, 130, MAXLEN };
+#define NLENGTHS ((int)(sizeof(lengths) / sizeof(lengths[0])))
+
+static int failures = 0;
+static double worst_rel;        // largest error over the rounding bound, this kernel
+static int mismatches;          // exact kernels: differing elements
+
+static void expect(const char *kernel, int ok, const char *detail) {
+    if (!ok) failures++;
+    printf("%s %-8s %-16s %s\n", ok ? "ok  " : "FAIL", simd_level_name(simd_kernels()->level),
+           kernel, detail);
+}
+
+// |got - want| against a bound of a few ulps of scale, the sum of magnitudes
+static void close_to(double got, double want, double scale, int n) {
+    double bound = 4.0 * (n + 2) * DBL_EPSILON * scale;
+    double rel = fabs(got - want) / (bound > 0 ? bound : DBL_MIN);
+    if (!(rel <= worst_rel)) worst_rel = rel;     // NaN sticks
+}
+
+static void report_close(const char *kernel) {
+    char detail[64];
+    snprintf(detail, sizeof(detail), "error %.2f of the rounding bound", worst_rel);
+    expect(kernel, worst_rel <= 1.0, detail);
+}
+
+static void report_exact(const char *kernel) {
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%d elements differ", mismatches);
+    expect(kernel, mismatches == 0, detail);
+}
+
+static void fill(double *x, int n, double scale, uint64_t *rng) {
+    for (int i = 0; i < n; i++) x[i] = scale * rng_uniform(rng);
+}
+
+static void check_level(const SimdKernels *ref) {
+    const SimdKernels *k = simd_kernels();
+    static double a[MAXLEN], b[MAXLEN], y1[MAXLEN], y2[MAXLEN], x1[MAXLEN], x2[MAXLEN];
+    uint64_t rng = rng_seed(7 + k->level);
+    double s = 0.6, c = 0.8;
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(a, n, 10.0, &rng);
+        fill(b, n, 3.0, &rng);
+        double mag = 0.0;
+        for (int i = 0; i < n; i++) mag += fabs(a[i] * b[i]);
+        close_to(k->dot(a, b, n), ref->dot(a, b, n), mag, n);
+    }
+    report_close("dot");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(a, n, 10.0, &rng);
+        fill(y1, n, 5.0, &rng);
+        memcpy(y2, y1, n * sizeof(double));
+        k->axpy(y1, -0.7, a, n);
+        ref->axpy(y2, -0.7, a, n);
+        for (int i = 0; i < n; i++) close_to(y1[i], y2[i], fabs(0.7 * a[i]) + fabs(y2[i]), 0);
+    }
+    report_close("axpy");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(x1, n, 10.0, &rng);
+        memcpy(x2, x1, n * sizeof(double));
+        k->scal(x1, 1.3, n);
+        ref->scal(x2, 1.3, n);
+        for (int i = 0; i < n; i++) close_to(x1[i], x2[i], fabs(x2[i]), 0);
+    }
+    report_close("scal");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(a, n, 10.0, &rng);
+        fill(y1, n, 5.0, &rng);
+        memcpy(y2, y1, n * sizeof(double));
+        double got = k->axpy_sumsq(y1, 0.4, a, n), want = ref->axpy_sumsq(y2, 0.4, a, n);
+        double mag = 0.0;
+        for (int i = 0; i < n; i++) {
+            double term = fabs(0.4 * a[i]) + fabs(y2[i]);
+            close_to(y1[i], y2[i], term, 0);
+            mag += term * term;
+        }
+        close_to(got, want, mag, n);
+    }
+    report_close("axpy_sumsq");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(x1, n, 10.0, &rng);
+        fill(b, n, 10.0, &rng);
+        memcpy(x2, x1, n * sizeof(double));
+        double got = k->scal_diff_sumsq(x1, -0.9, b, n);
+        double want = ref->scal_diff_sumsq(x2, -0.9, b, n);
+        double mag = 0.0;
+        for (int i = 0; i < n; i++) {
+            close_to(x1[i], x2[i], fabs(x2[i]), 0);
+            mag += (fabs(x2[i]) + fabs(b[i])) * (fabs(x2[i]) + fabs(b[i]));
+        }
+        close_to(got, want, mag, n);
+    }
+    report_close("scal_diff_sumsq");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(a, n, 10.0, &rng);
+        fill(b, n, 10.0, &rng);
+        double mag = 0.0;
+        for (int i = 0; i < n; i++) mag += fabs(a[i]) + fabs(b[i]);
+        close_to(k->abs_diff_sum(a, b, n), ref->abs_diff_sum(a, b, n), mag, n);
+    }
+    report_close("abs_diff_sum");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(a, n, 10.0, &rng);
+        fill(b, n, 3.0, &rng);
+        double got[3], want[3], mag[3] = { 0.0, 0.0, 0.0 };
+        k->pair_sums(a, b, n, &got[0], &got[1], &got[2]);
+        ref->pair_sums(a, b, n, &want[0], &want[1], &want[2]);
+        for (int i = 0; i < n; i++) {
+            mag[0] += a[i] * a[i];
+            mag[1] += b[i] * b[i];
+            mag[2] += fabs(a[i] * b[i]);
+        }
+        for (int q = 0; q < 3; q++) close_to(got[q], want[q], mag[q], n);
+    }
+    report_close("pair_sums");
+
+    worst_rel = 0.0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        fill(x1, n, 10.0, &rng);
+        fill(y1, n, 10.0, &rng);
+        memcpy(x2, x1, n * sizeof(double));
+        memcpy(y2, y1, n * sizeof(double));
+        k->rot(x1, y1, n, c, s);
+        ref->rot(x2, y2, n, c, s);
+        for (int i = 0; i < n; i++) {
+            // Both outputs are combinations of the same two inputs
+            double scale = fabs(c * x2[i]) + fabs(s * y2[i]) + fabs(s * x2[i]) + fabs(c * y2[i]);
+            close_to(x1[i], x2[i], scale, 0);
+            close_to(y1[i], y2[i], scale, 0);
+        }
+    }
+    report_close("rot");
+
+    static unsigned char bytes[2 * MAXLEN];
+    mismatches = 0;
+    for (int t = 0; t < NLENGTHS; t++) {
+        int n = lengths[t];
+        for (int i = 0; i < 2 * n; i++) bytes[i] = (unsigned char)rng_next(&rng);
+        // Every byte value, including the top bit that a signed widen would flip
+        for (int i = 0; i < 2 * n && i < 256; i++) bytes[i] = (unsigned char)(255 - i);
+        k->widen_u8(bytes, x1, n);
+        ref->widen_u8(bytes, x2, n);
+        for (int i = 0; i < n; i++) mismatches += x1[i] != x2[i] || x2[i] != bytes[i];
+        k->widen_u16be(bytes, x1, n);
+        ref->widen_u16be(bytes, x2, n);
+        for (int i = 0; i < n; i++) {
+            mismatches += x1[i] != x2[i] || x2[i] != bytes[2 * i] * 256 + bytes[2 * i + 1];
+        }
+    }
+    report_exact("widen_u8/u16be");
+
+    // NaN, infinities, negatives, values past max_val and exact halves
+    static const double special[] = {
+        NAN, -NAN, INFINITY, -INFINITY, -0.0, -0.5, -1e300, 0.49999999999999994, 0.5, 1.5, 2.5,
+        99.5, 100.5, 254.5, 255.0, 255.4, 255.5, 256.0, 1e300
+    };
+    int nspecial = sizeof(special) / sizeof(special[0]);
+    static const double max_vals[] = { 255.0, 100.0, 1.0, 1000.0 };
+    static unsigned char q1[MAXLEN], q2[MAXLEN];
+    mismatches = 0;
+    for (int m = 0; m < 4; m++) {
+        for (int t = 0; t < NLENGTHS; t++) {
+            int n = lengths[t];
+            fill(a, n, 600.0, &rng);
+            for (int i = 0; i < n; i++) {
+                if (rng_next(&rng) % 3 == 0) a[i] = special[rng_next(&rng) % nspecial];
+                else if (rng_next(&rng) % 2 == 0) a[i] = floor(a[i]) + 0.5;
+            }
+            memset(q1, 0xA5, n + 1);
+            k->quantize_u8(a, q1, n, max_vals[m]);
+            ref->quantize_u8(a, q2, n, max_vals[m]);
+            for (int i = 0; i < n; i++) mismatches += q1[i] != q2[i];
+            mismatches += q1[n] != 0xA5;        // wrote past the end
+        }
+    }
+    report_exact("quantize_u8");
+}
+
+int main(void) {
+    // Read once, on first use: caps the default at sse2
+    setenv("SVD_SIMD", "sse2", 1);
+    SimdLevel best = simd_detect(), capped = best < SIMD_SSE2 ? best : SIMD_SSE2;
+    int ok = simd_kernels()->level == capped;
+    if (!ok) failures++;
+    printf("%s $SVD_SIMD=sse2 gives %s (host supports %s)\n", ok ? "ok  " : "FAIL",
+           simd_level_name(simd_kernels()->level), simd_level_name(best));
+
+    ok = 1;
+    for (int l = SIMD_SCALAR; l <= SIMD_AVX512; l++) {
+        SimdLevel back;
+        ok = ok && simd_level_parse(simd_level_name((SimdLevel)l), &back) && back == (SimdLevel)l;
+        // Levels past the host's are refused and leave the table alone
+        if (l > (int)best) ok = ok && !simd_select((SimdLevel)l) && simd_kernels()->level == capped;
+    }
+    SimdLevel unused;
+    ok = ok && !simd_level_parse("avx3", &unused) && !simd_level_parse("", &unused);
+    if (!ok) failures++;
+    printf("%s level names round trip, unknown names and unsupported levels refused\n",
+           ok ? "ok  " : "FAIL");
+
+    if (!simd_select(SIMD_SCALAR)) return 1;
+    SimdKernels ref = *simd_kernels();
+    for (int level = SIMD_SCALAR; level <= (int)best; level++) {
+        if (simd_select((SimdLevel)level)) check_level(&ref);
+    }
+    return failures ? 1 : 0;
+}
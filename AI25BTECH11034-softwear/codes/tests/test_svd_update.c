@@ -0,0 +1,124 @@
+// Appending rows or columns to a rank-k SVD must match a fresh rank-k SVD
+// of the grown matrix: the same leading singular values and about the
+// same residual ‖A - U Σ Vᵀ‖_F.
+#include "svd_update.h"
+#include "svd_engine.h"
+#include "rng.h"
+#include <stdio.h>
+#include <math.h>
+
+#define RANK 10
+#define NOISE 1e-3
+
+// A rank-8 image-like matrix with a 1/l spectrum plus small noise
+static Matrix* test_matrix(int m, int n, uint64_t seed) {
+    uint64_t rng = rng_seed(seed);
+    Matrix *A = create_matrix(m, n);
+    for (int l = 0; l < 8; l++) {
+        double u[128], v[128];
+        for (int i = 0; i < m; i++) u[i] = rng_uniform(&rng);
+        for (int j = 0; j < n; j++) v[j] = rng_uniform(&rng);
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) A->data[i][j] += 100.0 / (l + 1) * u[i] * v[j];
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) A->data[i][j] += NOISE * rng_uniform(&rng);
+    }
+    return A;
+}
+
+static Matrix* sub_matrix(const Matrix *A, int rows, int cols) {
+    Matrix *S = create_matrix(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) S->data[i][j] = A->data[i][j];
+    }
+    return S;
+}
+
+static Matrix* block(const Matrix *A, int r0, int c0, int rows, int cols) {
+    Matrix *S = create_matrix(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) S->data[i][j] = A->data[r0 + i][c0 + j];
+    }
+    return S;
+}
+
+static SVDResult* fresh_svd(Matrix *A) {
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    return svd_compute(A, RANK, &opts);
+}
+
+static double residual(const Matrix *A, const SVDResult *svd) {
+    double sum = 0.0;
+    for (int i = 0; i < A->rows; i++) {
+        for (int j = 0; j < A->cols; j++) {
+            double r = A->data[i][j];
+            for (int l = 0; l < svd->k; l++) {
+                r -= svd->U->data[i][l] * svd->singular_values[l] * svd->V->data[j][l];
+            }
+            sum += r * r;
+        }
+    }
+    return sqrt(sum);
+}
+
+static int compare(const char *what, Matrix *full, SVDResult *updated) {
+    SVDResult *ref = fresh_svd(full);
+    int ok = ref != NULL;
+    double worst = 0.0;
+    for (int l = 0; ok && l < 8; l++) {
+        double rel = fabs(updated->singular_values[l] - ref->singular_values[l]) /
+                     ref->singular_values[0];
+        if (rel > worst) worst = rel;
+    }
+    double r_up = residual(full, updated), r_ref = ok ? residual(full, ref) : 0.0;
+    ok = ok && worst < 1e-6 && r_up <= 1.1 * r_ref;
+    printf("%s %-18s sigma err %.2e, residual %.3e vs fresh %.3e\n", ok ? "ok  " : "FAIL", what,
+           worst, r_up, r_ref);
+    free_svd_result(ref);
+    return ok;
+}
+
+int main(void) {
+    int ok = 1;
+    Matrix *A = test_matrix(67, 45, 11);
+
+    Matrix *top = sub_matrix(A, 60, 40);
+    SVDResult *svd = fresh_svd(top);
+    Matrix *rows = block(A, 60, 0, 7, 40);
+    Matrix *grown = sub_matrix(A, 67, 40);
+    ok &= svd && svd_append_rows(svd, rows) && svd->U->rows == 67 &&
+          compare("60x40 + 7 rows", grown, svd);
+    free_svd_result(svd);
+    free_matrix(grown);
+    free_matrix(rows);
+
+    svd = fresh_svd(top);
+    Matrix *cols = block(A, 0, 40, 60, 5);
+    grown = sub_matrix(A, 60, 45);
+    ok &= svd && svd_append_cols(svd, cols) && svd->V->rows == 45 &&
+          compare("60x40 + 5 columns", grown, svd);
+    free_svd_result(svd);
+    free_matrix(grown);
+    free_matrix(cols);
+
+    // Rows in several batches, one at a time
+    svd = fresh_svd(top);
+    grown = sub_matrix(A, 67, 40);
+    for (int i = 60; ok && svd && i < 67; i++) {
+        Matrix *row = block(A, i, 0, 1, 40);
+        ok &= svd_append_rows(svd, row);
+        free_matrix(row);
+    }
+    ok &= svd && compare("60x40 + 7 x 1 row", grown, svd);
+    free_svd_result(svd);
+    free_matrix(grown);
+
+    free_matrix(top);
+    free_matrix(A);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// compute_tridiagonal_eigenvalues (the implicit QL under the dense solver)
+// on the 1-D Laplacian tridiag(-1, 2, -1), whose spectrum is known:
+// λ_k = 2 - 2cos(kπ/(n+1)), k = 1..n. Eigenvalues must match to rounding,
+// come out descending, and the eigenvectors must be orthonormal with
+// T z = λ z.
+#include "lanczos.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+static int check_laplacian(int n) {
+    double *alpha = malloc(n * sizeof(double));
+    double *beta = malloc(n * sizeof(double));
+    double *lambda = malloc(n * sizeof(double));
+    Matrix *Z = create_matrix(n, n);
+    for (int i = 0; i < n; i++) {
+        alpha[i] = 2.0;
+        beta[i] = -1.0;
+    }
+    compute_tridiagonal_eigenvalues(alpha, beta, n, lambda, Z->data);
+
+    double value_err = 0.0, residual = 0.0, ortho = 0.0;
+    for (int i = 0; i < n; i++) {
+        // Descending: the i-th is k = n - i
+        double want = 2.0 - 2.0 * cos((n - i) * PI / (n + 1));
+        if (fabs(lambda[i] - want) > value_err) value_err = fabs(lambda[i] - want);
+        for (int r = 0; r < n; r++) {
+            double tz = 2.0 * Z->data[r][i];
+            if (r > 0) tz -= Z->data[r - 1][i];
+            if (r < n - 1) tz -= Z->data[r + 1][i];
+            double d = fabs(tz - lambda[i] * Z->data[r][i]);
+            if (d > residual) residual = d;
+        }
+        for (int j = 0; j <= i; j++) {
+            double dot = 0.0;
+            for (int r = 0; r < n; r++) dot += Z->data[r][i] * Z->data[r][j];
+            double d = fabs(dot - (i == j ? 1.0 : 0.0));
+            if (d > ortho) ortho = d;
+        }
+    }
+    double tol = 64 * n * 2.220446049250313e-16;
+    int ok = value_err <= tol && residual <= tol && ortho <= tol;
+    printf("%s laplacian n=%-4d eigenvalue err %.1e, residual %.1e, orthogonality %.1e\n",
+           ok ? "ok  " : "FAIL", n, value_err, residual, ortho);
+
+    // Unchanged inputs, and the same values without eigenvectors
+    double *bare = malloc(n * sizeof(double));
+    compute_tridiagonal_eigenvalues(alpha, beta, n, bare, NULL);
+    int same = 1;
+    for (int i = 0; i < n; i++) {
+        if (alpha[i] != 2.0 || (i < n - 1 && beta[i] != -1.0) || fabs(bare[i] - lambda[i]) > tol) same = 0;
+    }
+    printf("%s laplacian n=%-4d inputs kept, values without vectors agree\n", same ? "ok  " : "FAIL", n);
+
+    free(bare);
+    free_matrix(Z);
+    free(lambda);
+    free(beta);
+    free(alpha);
+    return ok && same;
+}
+
+// Zero couplings split T into blocks; diagonal 1x1 blocks are their own
+// eigenvalues
+static int check_split(void) {
+    enum { N = 9 };
+    double alpha[N], beta[N], lambda[N];
+    for (int i = 0; i < N; i++) {
+        alpha[i] = (i * 5) % N;
+        beta[i] = 0.0;
+    }
+    compute_tridiagonal_eigenvalues(alpha, beta, N, lambda, NULL);
+    int ok = 1;
+    for (int i = 0; i < N; i++) ok &= lambda[i] == N - 1 - i;
+    printf("%s diagonal n=%d sorted descending\n", ok ? "ok  " : "FAIL", N);
+    return ok;
+}
+
+int main(void) {
+    int ok = 1;
+    static const int sizes[] = { 1, 2, 7, 50, 200 };
+    for (int i = 0; i < 5; i++) ok &= check_laplacian(sizes[i]);
+    ok &= check_split();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// Truncated HOSVD against its definition: a stack of exact multilinear
+// rank (r1, r2, r3) must come back exactly at those ranks, a noisy stack
+// must meet the HOSVD error bound ‖X - X̂‖² ≤ Σ over modes of the discarded
+// σ² of each unfolding (from a dense SVD of the unfoldings), the factors
+// must be orthonormal, oversized ranks clamped, and the .svdt container
+// must round trip at float32 precision.
+#define _GNU_SOURCE
+#include "tucker.h"
+#include "svd_engine.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#define ROWS 30
+#define COLS 25
+#define SLICES 8
+
+static int failures = 0;
+
+static void expect(const char *what, int ok, double value) {
+    if (!ok) failures++;
+    printf("%s %-44s %.2e\n", ok ? "ok  " : "FAIL", what, value);
+}
+
+// X[i][j][t] = background + Σ G[a][b][c] A[i][a] B[j][b] C[t][c] + noise
+static void make_stack(Matrix **X, const int r[3], double background, double noise,
+                       uint64_t seed) {
+    uint64_t rng = rng_seed(seed);
+    Matrix *A = create_matrix(ROWS, r[0]);
+    Matrix *B = create_matrix(COLS, r[1]);
+    Matrix *C = create_matrix(SLICES, r[2]);
+    double G[8][8][8];
+    Matrix *factors[3] = { A, B, C };
+    for (int mode = 0; mode < 3; mode++) {
+        for (int i = 0; i < factors[mode]->rows; i++) {
+            for (int a = 0; a < r[mode]; a++) factors[mode]->data[i][a] = rng_uniform(&rng);
+        }
+    }
+    for (int a = 0; a < r[0]; a++) {
+        for (int b = 0; b < r[1]; b++) {
+            for (int c = 0; c < r[2]; c++) G[a][b][c] = 400.0 * rng_uniform(&rng) / (1 + a + b + c);
+        }
+    }
+    for (int t = 0; t < SLICES; t++) {
+        X[t] = create_matrix(ROWS, COLS);
+        for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+                double v = background + noise * rng_uniform(&rng);
+                for (int a = 0; a < r[0]; a++) {
+                    for (int b = 0; b < r[1]; b++) {
+                        for (int c = 0; c < r[2]; c++) {
+                            v += G[a][b][c] * A->data[i][a] * B->data[j][b] * C->data[t][c];
+                        }
+                    }
+                }
+                X[t]->data[i][j] = v;
+            }
+        }
+    }
+    free_matrix(C);
+    free_matrix(B);
+    free_matrix(A);
+}
+
+// ‖X - Y‖_F² and ‖X‖_F²
+static double diff_sq(Matrix **X, Matrix **Y, double *norm_sq) {
+    double d = 0.0, x = 0.0;
+    for (int t = 0; t < SLICES; t++) {
+        for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+                double e = X[t]->data[i][j] - Y[t]->data[i][j];
+                d += e * e;
+                x += X[t]->data[i][j] * X[t]->data[i][j];
+            }
+        }
+    }
+    if (norm_sq) *norm_sq = x;
+    return d;
+}
+
+static double orthonormality(const Matrix *Q) {
+    double worst = 0.0;
+    for (int a = 0; a < Q->cols; a++) {
+        for (int b = 0; b <= a; b++) {
+            double dot = 0.0;
+            for (int i = 0; i < Q->rows; i++) dot += Q->data[i][a] * Q->data[i][b];
+            if (fabs(dot - (a == b)) > worst) worst = fabs(dot - (a == b));
+        }
+    }
+    return worst;
+}
+
+// Σ of σ² beyond rank r of the mode-n unfolding, from a dense SVD
+static double discarded(Matrix **X, int mode, int r) {
+    int dims[3] = { ROWS, COLS, SLICES };
+    int m = dims[mode], n = ROWS * COLS * SLICES / m;
+    Matrix *U = create_matrix(m, n);
+    for (int t = 0; t < SLICES; t++) {
+        for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+                double v = X[t]->data[i][j];
+                if (mode == 0) U->data[i][j * SLICES + t] = v;
+                else if (mode == 1) U->data[j][i * SLICES + t] = v;
+                else U->data[t][i * COLS + j] = v;
+            }
+        }
+    }
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.engine = SVD_ENGINE_DENSE;
+    opts.verbose = 0;
+    int p = m < n ? m : n;
+    SVDResult *svd = svd_compute(U, p, &opts);
+    double sum = 0.0;
+    for (int l = r; svd && l < p; l++) sum += svd->singular_values[l] * svd->singular_values[l];
+    free_svd_result(svd);
+    free_matrix(U);
+    return sum;
+}
+
+static TuckerTensor* compress_and_rebuild(Matrix **X, const int ranks[3], Matrix **Y) {
+    TuckerTensor *t = tucker_compress(X, SLICES, ranks, 255, 2);
+    for (int s = 0; s < SLICES; s++) Y[s] = create_matrix(ROWS, COLS);
+    if (t && !tucker_reconstruct(t, Y, 2)) {
+        free_tucker(t);
+        t = NULL;
+    }
+    return t;
+}
+
+static void free_stack(Matrix **X) {
+    for (int t = 0; t < SLICES; t++) free_matrix(X[t]);
+}
+
+int main(void) {
+    Matrix *X[SLICES], *Y[SLICES];
+    static const int exact[3] = { 4, 3, 2 };
+    make_stack(X, exact, 0.0, 0.0, 3);
+    TuckerTensor *t = compress_and_rebuild(X, exact, Y);
+    double norm_sq = 1.0, err = t ? sqrt(diff_sq(X, Y, &norm_sq) / norm_sq) : INFINITY;
+    expect("exact multilinear rank (4, 3, 2) recovered", err < 1e-10, err);
+    size_t params = t ? tucker_parameter_count(t) : 0;
+    expect("parameter count is factors plus core",
+           params == (size_t)ROWS * 4 + COLS * 3 + SLICES * 2 + 4 * 3 * 2, (double)params);
+    free_tucker(t);
+    free_stack(Y);
+    free_stack(X);
+
+    // Background plus rank-(4, 3, 2) signal plus noise, cut to (5, 4, 3)
+    static const int ranks[3] = { 5, 4, 3 };
+    make_stack(X, exact, 128.0, 6.0, 4);
+    t = compress_and_rebuild(X, ranks, Y);
+    double got = t ? diff_sq(X, Y, NULL) : INFINITY;
+    double bound = discarded(X, 0, ranks[0]) + discarded(X, 1, ranks[1]) + discarded(X, 2, ranks[2]);
+    expect("HOSVD error within the discarded energy", got <= bound * (1 + 1e-9), got / bound);
+    double orth = 0.0;
+    for (int mode = 0; t && mode < 3; mode++) {
+        double o = orthonormality(t->factors[mode]);
+        if (o > orth) orth = o;
+    }
+    expect("orthonormal factors", t && orth < 1e-12, orth);
+
+    // Through the container file
+    char path[] = "/tmp/test_tucker_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return 1;
+    close(fd);
+    TuckerTensor *loaded = t && tucker_save(path, t) ? tucker_load(path) : NULL;
+    Matrix *Z[SLICES];
+    for (int s = 0; s < SLICES; s++) Z[s] = create_matrix(ROWS, COLS);
+    int ok = loaded && loaded->ranks[0] == 5 && loaded->ranks[1] == 4 && loaded->ranks[2] == 3 &&
+             loaded->max_val == 255 && tucker_reconstruct(loaded, Z, 1);
+    err = ok ? sqrt(diff_sq(Y, Z, &norm_sq) / norm_sq) : INFINITY;
+    expect(".svdt round trip, relative difference", ok && err < 1e-6, err);
+    unlink(path);
+    free_stack(Z);
+    free_tucker(loaded);
+    free_tucker(t);
+    free_stack(Y);
+
+    // Ranks past every mode's size clamp to the full tensor: lossless
+    static const int huge[3] = { 100, 100, 100 };
+    t = compress_and_rebuild(X, huge, Y);
+    ok = t && t->ranks[0] == ROWS && t->ranks[1] == COLS && t->ranks[2] == SLICES;
+    err = ok ? sqrt(diff_sq(X, Y, &norm_sq) / norm_sq) : INFINITY;
+    expect("oversized ranks clamp, lossless", ok && err < 1e-12, err);
+    free_tucker(t);
+    free_stack(Y);
+    free_stack(X);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,374 @@
+#define _GNU_SOURCE
+#include "tucker.h"
+#include "svd_engine.h"
+#include "svd_stream.h"
+#include "perf_counters.h"
+#include "mem_stats.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TUCKER_VERSION 1
+#define TUCKER_HEADER_BYTES 36
+
+void free_tucker(TuckerTensor *t) {
+    if (!t) return;
+    for (int d = 0; d < 3; d++) free_matrix(t->factors[d]);
+    free_matrix(t->core);
+    mem_free(t);
+}
+
+size_t tucker_parameter_count(const TuckerTensor *t) {
+    return (size_t)t->rows * t->ranks[0] + (size_t)t->cols * t->ranks[1] +
+           (size_t)t->slices * t->ranks[2] + (size_t)t->ranks[0] * t->ranks[1] * t->ranks[2];
+}
+
+// Mode-d unfolding: row i lists every entry whose mode-d index is i
+static Matrix* unfold(Matrix **slices, int count, int mode) {
+    int m = slices[0]->rows, n = slices[0]->cols;
+    Matrix *X;
+    if (mode == 0) {
+        X = create_matrix_uninit(m, n * count);
+        if (!X) return NULL;
+        for (int i = 0; i < m; i++) {
+            for (int t = 0; t < count; t++) {
+                memcpy(X->data[i] + (size_t)t * n, slices[t]->data[i], n * sizeof(double));
+            }
+        }
+    } else if (mode == 1) {
+        X = create_matrix_uninit(n, m * count);
+        if (!X) return NULL;
+        for (int t = 0; t < count; t++) {
+            for (int i = 0; i < m; i++) {
+                const double *row = slices[t]->data[i];
+                for (int j = 0; j < n; j++) X->data[j][(size_t)t * m + i] = row[j];
+            }
+        }
+    } else {
+        X = create_matrix_uninit(count, m * n);
+        if (!X) return NULL;
+        for (int t = 0; t < count; t++) {
+            for (int i = 0; i < m; i++) {
+                memcpy(X->data[t] + (size_t)i * n, slices[t]->data[i], n * sizeof(double));
+            }
+        }
+    }
+    return X;
+}
+
+// Leading r left singular vectors of the mode unfolding
+static Matrix* mode_factor(Matrix **slices, int count, int mode, int r, int threads) {
+    Matrix *X = unfold(slices, count, mode);
+    if (!X) return NULL;
+    SVDOptions opts;
+    svd_default_options(&opts);
+    opts.threads = threads;
+    opts.verbose = 0;
+    SVDResult *svd = svd_compute(X, r, &opts);
+    free_matrix(X);
+    if (!svd) return NULL;
+    Matrix *U = create_matrix_uninit(svd->U->rows, r);
+    if (U) {
+        for (int i = 0; i < U->rows; i++) memcpy(U->data[i], svd->U->data[i], r * sizeof(double));
+    }
+    free_svd_result(svd);
+    return U;
+}
+
+typedef struct {
+    const TuckerTensor *t;
+    Matrix **slices;
+    Matrix *Y;                  // slices × (r1·r2): U1ᵀ S_t U2 flattened
+    int *ok;
+} ProjectTask;
+
+// Y_t = U1ᵀ S_t U2 for slices [begin, end)
+static void project_slices(void *arg, int begin, int end) {
+    ProjectTask *p = (ProjectTask*)arg;
+    const TuckerTensor *t = p->t;
+    int m = t->rows, n = t->cols, r1 = t->ranks[0], r2 = t->ranks[1];
+    const Matrix *U1 = t->factors[0], *U2 = t->factors[1];
+    double *Z = (double*)mem_alloc((size_t)m * r2 * sizeof(double));
+    if (!Z) {
+        p->ok[begin] = 0;
+        return;
+    }
+    for (int s = begin; s < end; s++) {
+        const Matrix *S = p->slices[s];
+        for (int i = 0; i < m; i++) {
+            double *z = Z + (size_t)i * r2;
+            memset(z, 0, r2 * sizeof(double));
+            for (int j = 0; j < n; j++) {
+                double a = S->data[i][j];
+                const double *u = U2->data[j];
+                for (int b = 0; b < r2; b++) z[b] += a * u[b];
+            }
+        }
+        double *y = p->Y->data[s];
+        memset(y, 0, (size_t)r1 * r2 * sizeof(double));
+        for (int i = 0; i < m; i++) {
+            const double *z = Z + (size_t)i * r2;
+            for (int a = 0; a < r1; a++) {
+                double u = U1->data[i][a];
+                double *ya = y + (size_t)a * r2;
+                for (int b = 0; b < r2; b++) ya[b] += u * z[b];
+            }
+        }
+    }
+    mem_free(Z);
+}
+
+typedef struct {
+    const Matrix *U3;
+    const Matrix *in;           // slices × len, or r3 × len
+    Matrix *out;
+    int transpose;              // out = U3ᵀ in (core), else out = U3 in (expansion)
+} ModeThreeTask;
+
+// Mode-3 product on flattened frontal slices, output rows [begin, end)
+static void mode_three_rows(void *arg, int begin, int end) {
+    ModeThreeTask *p = (ModeThreeTask*)arg;
+    int len = p->in->cols;
+    int inner = p->in->rows;
+    for (int c = begin; c < end; c++) {
+        double *o = p->out->data[c];
+        memset(o, 0, len * sizeof(double));
+        for (int s = 0; s < inner; s++) {
+            double w = p->transpose ? p->U3->data[s][c] : p->U3->data[c][s];
+            const double *x = p->in->data[s];
+            for (int e = 0; e < len; e++) o[e] += w * x[e];
+        }
+    }
+}
+
+TuckerTensor* tucker_compress(Matrix **slices, int count, const int ranks[3], int max_val,
+                              int threads) {
+    if (count <= 0) return NULL;
+    int m = slices[0]->rows, n = slices[0]->cols;
+    for (int s = 1; s < count; s++) {
+        if (slices[s]->rows != m || slices[s]->cols != n) {
+            fprintf(stderr, "Error: Slice %d is %dx%d, expected %dx%d\n", s,
+                    slices[s]->cols, slices[s]->rows, n, m);
+            return NULL;
+        }
+    }
+
+    TuckerTensor *t = (TuckerTensor*)mem_calloc(1, sizeof(TuckerTensor));
+    if (!t) return NULL;
+    t->rows = m;
+    t->cols = n;
+    t->slices = count;
+    t->max_val = max_val;
+    int dims[3] = { m, n, count };
+    double total = (double)m * n * count;
+    for (int d = 0; d < 3; d++) {
+        int other = (int)(total / dims[d] < dims[d] ? total / dims[d] : dims[d]);
+        t->ranks[d] = ranks[d] <= 0 || ranks[d] > other ? other : ranks[d];
+    }
+
+    perf_phase_begin("tucker_factors");
+    for (int d = 0; d < 3 && t; d++) {
+        t->factors[d] = mode_factor(slices, count, d, t->ranks[d], threads);
+        if (!t->factors[d]) {
+            free_tucker(t);
+            t = NULL;
+        }
+    }
+    perf_phase_end("tucker_factors", 0.0, 0.0);
+    if (!t) return NULL;
+
+    int r1 = t->ranks[0], r2 = t->ranks[1], r3 = t->ranks[2];
+    Matrix *Y = create_matrix_uninit(count, r1 * r2);
+    int *ok = (int*)mem_alloc(count * sizeof(int));
+    t->core = create_matrix_uninit(r3, r1 * r2);
+    if (!Y || !ok || !t->core) {
+        free_matrix(Y);
+        mem_free(ok);
+        free_tucker(t);
+        return NULL;
+    }
+    for (int s = 0; s < count; s++) ok[s] = 1;
+
+    perf_phase_begin("tucker_core");
+    ProjectTask project = { t, slices, Y, ok };
+    parallel_for(threads, count, project_slices, &project);
+    ModeThreeTask three = { t->factors[2], Y, t->core, 1 };
+    parallel_for(threads, r3, mode_three_rows, &three);
+    perf_phase_end("tucker_core", 2.0 * total * r2 + 2.0 * m * r1 * r2 * count +
+                   2.0 * count * r1 * r2 * r3, 8.0 * total);
+
+    int good = 1;
+    for (int s = 0; s < count; s++) good = good && ok[s];
+    free_matrix(Y);
+    mem_free(ok);
+    if (!good) {
+        free_tucker(t);
+        return NULL;
+    }
+    return t;
+}
+
+typedef struct {
+    const TuckerTensor *t;
+    const Matrix *M;            // slices × (r1·r2): core expanded along mode 3
+    Matrix **out;
+    int *ok;
+} ExpandTask;
+
+// S_t = U1 M_t U2ᵀ for slices [begin, end)
+static void expand_slices(void *arg, int begin, int end) {
+    ExpandTask *p = (ExpandTask*)arg;
+    const TuckerTensor *t = p->t;
+    int m = t->rows, n = t->cols, r1 = t->ranks[0], r2 = t->ranks[1];
+    const Matrix *U1 = t->factors[0], *U2 = t->factors[1];
+    double *W = (double*)mem_alloc((size_t)m * r2 * sizeof(double));
+    if (!W) {
+        p->ok[begin] = 0;
+        return;
+    }
+    for (int s = begin; s < end; s++) {
+        const double *mt = p->M->data[s];
+        for (int i = 0; i < m; i++) {
+            double *w = W + (size_t)i * r2;
+            memset(w, 0, r2 * sizeof(double));
+            for (int a = 0; a < r1; a++) {
+                double u = U1->data[i][a];
+                const double *row = mt + (size_t)a * r2;
+                for (int b = 0; b < r2; b++) w[b] += u * row[b];
+            }
+        }
+        Matrix *S = p->out[s];
+        for (int i = 0; i < m; i++) {
+            const double *w = W + (size_t)i * r2;
+            double *o = S->data[i];
+            for (int j = 0; j < n; j++) {
+                const double *u = U2->data[j];
+                double sum = 0.0;
+                for (int b = 0; b < r2; b++) sum += w[b] * u[b];
+                o[j] = sum;
+            }
+        }
+    }
+    mem_free(W);
+}
+
+int tucker_reconstruct(const TuckerTensor *t, Matrix **out, int threads) {
+    int count = t->slices;
+    Matrix *M = create_matrix_uninit(count, t->ranks[0] * t->ranks[1]);
+    int *ok = (int*)mem_alloc(count * sizeof(int));
+    if (!M || !ok) {
+        free_matrix(M);
+        mem_free(ok);
+        return 0;
+    }
+    for (int s = 0; s < count; s++) ok[s] = 1;
+
+    double total = (double)t->rows * t->cols * count;
+    perf_phase_begin("tucker_expand");
+    ModeThreeTask three = { t->factors[2], t->core, M, 0 };
+    parallel_for(threads, count, mode_three_rows, &three);
+    ExpandTask expand = { t, M, out, ok };
+    parallel_for(threads, count, expand_slices, &expand);
+    perf_phase_end("tucker_expand", 2.0 * total * t->ranks[1], 8.0 * total);
+
+    int good = 1;
+    for (int s = 0; s < count; s++) good = good && ok[s];
+    free_matrix(M);
+    mem_free(ok);
+    return good;
+}
+
+int tucker_save(const char *filename, const TuckerTensor *t) {
+    size_t values = tucker_parameter_count(t);
+    size_t len = TUCKER_HEADER_BYTES + values * 4;
+    unsigned char *buf = (unsigned char*)mem_alloc(len);
+    if (!buf) return 0;
+    memcpy(buf, "SVDT", 4);
+    uint32_t fields[8] = { TUCKER_VERSION, (uint32_t)t->rows, (uint32_t)t->cols,
+                           (uint32_t)t->slices, (uint32_t)t->ranks[0], (uint32_t)t->ranks[1],
+                           (uint32_t)t->ranks[2], (uint32_t)t->max_val };
+    for (int f = 0; f < 8; f++) stream_put_u32(buf + 4 + 4 * f, fields[f]);
+    unsigned char *p = buf + TUCKER_HEADER_BYTES;
+    const Matrix *parts[4] = { t->factors[0], t->factors[1], t->factors[2], t->core };
+    for (int q = 0; q < 4; q++) {
+        for (int i = 0; i < parts[q]->rows; i++) {
+            for (int j = 0; j < parts[q]->cols; j++, p += 4) stream_put_f32(p, parts[q]->data[i][j]);
+        }
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        mem_free(buf);
+        return 0;
+    }
+    int ok = stream_write_all(fd, buf, len);
+    if (close(fd) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write %s\n", filename);
+    mem_free(buf);
+    return ok;
+}
+
+TuckerTensor* tucker_load(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+    unsigned char header[TUCKER_HEADER_BYTES];
+    if (stream_read_all(fd, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, "SVDT", 4) != 0 || stream_get_u32(header + 4) != TUCKER_VERSION) {
+        fprintf(stderr, "Error: %s is not a version %d Tucker container\n", filename, TUCKER_VERSION);
+        close(fd);
+        return NULL;
+    }
+    uint32_t f[7];
+    for (int i = 0; i < 7; i++) f[i] = stream_get_u32(header + 8 + 4 * i);
+    if (f[0] == 0 || f[1] == 0 || f[2] == 0 || f[0] > (1u << 20) || f[1] > (1u << 20) ||
+        f[2] > (1u << 20) || f[3] == 0 || f[3] > f[0] || f[4] == 0 || f[4] > f[1] ||
+        f[5] == 0 || f[5] > f[2]) {
+        fprintf(stderr, "Error: Corrupt Tucker header in %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    TuckerTensor *t = (TuckerTensor*)mem_calloc(1, sizeof(TuckerTensor));
+    if (!t) {
+        close(fd);
+        return NULL;
+    }
+    t->rows = (int)f[0];
+    t->cols = (int)f[1];
+    t->slices = (int)f[2];
+    for (int d = 0; d < 3; d++) t->ranks[d] = (int)f[3 + d];
+    t->max_val = (int)f[6];
+    int dims[3] = { t->rows, t->cols, t->slices };
+    int ok = 1;
+    for (int d = 0; d < 3; d++) {
+        t->factors[d] = create_matrix_uninit(dims[d], t->ranks[d]);
+        ok = ok && t->factors[d];
+    }
+    t->core = create_matrix_uninit(t->ranks[2], t->ranks[0] * t->ranks[1]);
+    size_t len = tucker_parameter_count(t) * 4;
+    unsigned char *body = (unsigned char*)mem_alloc(len);
+    ok = ok && t->core && body && stream_read_all(fd, body, len) == len;
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to read %s\n", filename);
+        mem_free(body);
+        free_tucker(t);
+        return NULL;
+    }
+
+    const unsigned char *p = body;
+    Matrix *parts[4] = { t->factors[0], t->factors[1], t->factors[2], t->core };
+    for (int q = 0; q < 4; q++) {
+        for (int i = 0; i < parts[q]->rows; i++) {
+            for (int j = 0; j < parts[q]->cols; j++, p += 4) parts[q]->data[i][j] = stream_get_f32(p);
+        }
+    }
+    mem_free(body);
+    return t;
+}
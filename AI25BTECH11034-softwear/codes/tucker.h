@@ -0,0 +1,37 @@
+#ifndef TUCKER_H
+#define TUCKER_H
+
+#include <stddef.h>
+#include "lanczos.h"
+
+// Truncated HOSVD of an image stack (rows × cols × slices), for volumes,
+// time-lapses and multi-page scans whose slices are correlated. Each mode
+// unfolding is decomposed with svd_compute (so the wide unfoldings take the
+// TSQR path) and truncated to its multilinear rank; the core is the stack
+// projected on the three factors. A slice is rebuilt as
+// U1 (Σ_c U3[t][c] G_c) U2ᵀ.
+typedef struct {
+    int rows;
+    int cols;
+    int slices;
+    int ranks[3];               // multilinear ranks r1 (rows), r2 (cols), r3 (slices)
+    Matrix *factors[3];         // rows × r1, cols × r2, slices × r3
+    Matrix *core;               // r3 × (r1·r2): frontal slice c row-major in row c
+    int max_val;
+} TuckerTensor;
+
+// Ranks beyond what a mode supports are clamped. Slices must share a size.
+TuckerTensor* tucker_compress(Matrix **slices, int count, const int ranks[3], int max_val,
+                              int threads);
+// Rebuilds every slice into out[t] (rows × cols), slices split across threads
+int tucker_reconstruct(const TuckerTensor *t, Matrix **out, int threads);
+void free_tucker(TuckerTensor *t);
+// Numbers stored: factors plus core
+size_t tucker_parameter_count(const TuckerTensor *t);
+
+// Container file (.svdt): "SVDT", version, rows, cols, slices, r1, r2, r3,
+// max_val, then U1, U2, U3 and the core row by row as little-endian float32
+int tucker_save(const char *filename, const TuckerTensor *t);
+TuckerTensor* tucker_load(const char *filename);
+
+#endif
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include "workspace.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define WORKSPACE_ALIGN 64
+#define HUGE_PAGE_SIZE (2u << 20)
+
+static size_t align_up(size_t bytes, size_t align) {
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+static unsigned char* map_huge(size_t bytes) {
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        // No reserved hugetlbfs pages: ask for transparent huge pages instead
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    }
+    return (unsigned char*)p;
+}
+
+static int workspace_map(Workspace *ws, size_t bytes) {
+    if (ws->huge_pages) {
+        bytes = align_up(bytes, HUGE_PAGE_SIZE);
+        if (!mem_would_fit(bytes)) return 0;
+        ws->base = map_huge(bytes);
+        if (ws->base) mem_track(bytes);
+    } else {
+        ws->base = (unsigned char*)mem_alloc(bytes + WORKSPACE_ALIGN);
+    }
+    if (!ws->base) return 0;
+    ws->capacity = bytes;
+    return 1;
+}
+
+static void workspace_unmap(Workspace *ws) {
+    if (!ws->base) return;
+    if (ws->huge_pages) {
+        munmap(ws->base, ws->capacity);
+        mem_untrack(ws->capacity);
+    } else {
+        mem_free(ws->base);
+    }
+    ws->base = NULL;
+    ws->capacity = 0;
+}
+
+Workspace* workspace_create(size_t bytes, int huge_pages) {
+    Workspace *ws = (Workspace*)mem_calloc(1, sizeof(Workspace));
+    if (!ws) return NULL;
+
+    ws->huge_pages = huge_pages;
+    if (!workspace_map(ws, bytes)) {
+        fprintf(stderr, "Error: Cannot allocate %.2f MB workspace\n", bytes / 1048576.0);
+        mem_free(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+void workspace_destroy(Workspace *ws) {
+    if (!ws) return;
+    workspace_unmap(ws);
+    mem_free(ws);
+}
+
+// Grows an idle workspace to at least bytes (e.g. for a larger image in a
+// batch); a workspace that is already big enough is left untouched.
+int workspace_reserve(Workspace *ws, size_t bytes) {
+    if (bytes <= ws->capacity) return 1;
+    if (ws->used != 0) {
+        fprintf(stderr, "Error: Cannot grow a workspace that is in use\n");
+        return 0;
+    }
+    workspace_unmap(ws);
+    if (!workspace_map(ws, bytes)) {
+        fprintf(stderr, "Error: Cannot allocate %.2f MB workspace\n", bytes / 1048576.0);
+        return 0;
+    }
+    return 1;
+}
+
+void* workspace_alloc(Workspace *ws, size_t bytes) {
+    unsigned char *start = (unsigned char*)align_up((size_t)ws->base, WORKSPACE_ALIGN);
+    size_t offset = align_up(ws->used, WORKSPACE_ALIGN);
+    if (offset + bytes > ws->capacity) {
+        fprintf(stderr, "Error: Workspace exhausted (need %zu bytes, %zu of %zu used)\n",
+                bytes, ws->used, ws->capacity);
+        return NULL;
+    }
+    ws->used = offset + bytes;
+    if (ws->used > ws->high_water) ws->high_water = ws->used;
+    return start + offset;
+}
+
+Matrix* workspace_matrix(Workspace *ws, int rows, int cols) {
+    void *block = workspace_alloc(ws, matrix_storage_bytes(rows, cols));
+    if (!block) return NULL;
+    return matrix_init_block(block, rows, cols, 1);
+}
+
+size_t workspace_available(Workspace *ws) {
+    size_t offset = align_up(ws->used, WORKSPACE_ALIGN);
+    return offset < ws->capacity ? ws->capacity - offset : 0;
+}
+
+size_t workspace_mark(Workspace *ws) {
+    return ws->used;
+}
+
+void workspace_release(Workspace *ws, size_t mark) {
+    if (mark < ws->used) ws->used = mark;
+}
+
+void workspace_reset(Workspace *ws) {
+    ws->used = 0;
+}
+
+void* scratch_alloc(Workspace *ws, size_t bytes) {
+    return ws ? workspace_alloc(ws, bytes) : mem_alloc(bytes);
+}
+
+void scratch_free(Workspace *ws, void *ptr) {
+    if (!ws) mem_free(ptr);
+}
+
+Matrix* scratch_matrix(Workspace *ws, int rows, int cols) {
+    return ws ? workspace_matrix(ws, rows, cols) : create_matrix_uninit(rows, cols);
+}
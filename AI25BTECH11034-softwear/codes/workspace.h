@@ -0,0 +1,35 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stddef.h>
+#include "matrix.h"
+
+// Bump allocator for solver and reconstruction scratch. Sized once up front
+// (see compress_workspace_bytes) and rewound between images, so steady-state
+// compression does no heap allocation. Matrices and vectors handed out here
+// are released together by workspace_release/workspace_reset.
+typedef struct {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+    size_t high_water;
+    int huge_pages;         // backed by an anonymous mapping instead of the heap
+} Workspace;
+
+Workspace* workspace_create(size_t bytes, int huge_pages);
+void workspace_destroy(Workspace *ws);
+int workspace_reserve(Workspace *ws, size_t bytes);
+
+void* workspace_alloc(Workspace *ws, size_t bytes);
+Matrix* workspace_matrix(Workspace *ws, int rows, int cols);
+size_t workspace_available(Workspace *ws);
+size_t workspace_mark(Workspace *ws);
+void workspace_release(Workspace *ws, size_t mark);
+void workspace_reset(Workspace *ws);
+
+// Scratch helpers that fall back to the heap when ws is NULL
+void* scratch_alloc(Workspace *ws, size_t bytes);
+void scratch_free(Workspace *ws, void *ptr);
+Matrix* scratch_matrix(Workspace *ws, int rows, int cols);
+
+#endif